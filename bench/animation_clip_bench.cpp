@@ -0,0 +1,164 @@
+// Compares pose sampling through the baked AnimationClip against the original
+// per-frame walk over the assimp key arrays, for increasingly long clips.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <assimp/scene.h>
+
+#include "animation_clip.hpp"
+
+const unsigned int CHANNELS = 64;
+const unsigned int QUERIES = 2000;
+const double TICKS_PER_SECOND = 30.0;
+
+// keeps the sampled values observable so the timed loops are not optimised away
+volatile float sink;
+
+// The key-walk path AnimatedModel used before clips were baked
+static unsigned int findKey(float animationTime, const aiVectorKey* keys, unsigned int count)
+{
+    for (unsigned int i = 0; i < count - 1; i++)
+    {
+        if (animationTime < (float)keys[i + 1].mTime)
+            return i;
+    }
+    return 0;
+}
+
+static unsigned int findKey(float animationTime, const aiQuatKey* keys, unsigned int count)
+{
+    for (unsigned int i = 0; i < count - 1; i++)
+    {
+        if (animationTime < (float)keys[i + 1].mTime)
+            return i;
+    }
+    return 0;
+}
+
+static void sampleKeys(float animationTime, const aiNodeAnim* nodeAnim, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale)
+{
+    unsigned int p = findKey(animationTime, nodeAnim->mPositionKeys, nodeAnim->mNumPositionKeys);
+    float factor = (animationTime - (float)nodeAnim->mPositionKeys[p].mTime) / (float)(nodeAnim->mPositionKeys[p + 1].mTime - nodeAnim->mPositionKeys[p].mTime);
+    aiVector3D position = nodeAnim->mPositionKeys[p].mValue + factor * (nodeAnim->mPositionKeys[p + 1].mValue - nodeAnim->mPositionKeys[p].mValue);
+    translation = glm::vec3(position.x, position.y, position.z);
+
+    unsigned int r = findKey(animationTime, nodeAnim->mRotationKeys, nodeAnim->mNumRotationKeys);
+    factor = (animationTime - (float)nodeAnim->mRotationKeys[r].mTime) / (float)(nodeAnim->mRotationKeys[r + 1].mTime - nodeAnim->mRotationKeys[r].mTime);
+    aiQuaternion q;
+    aiQuaternion::Interpolate(q, nodeAnim->mRotationKeys[r].mValue, nodeAnim->mRotationKeys[r + 1].mValue, factor);
+    q = q.Normalize();
+    rotation = glm::quat(q.w, q.x, q.y, q.z);
+
+    unsigned int s = findKey(animationTime, nodeAnim->mScalingKeys, nodeAnim->mNumScalingKeys);
+    factor = (animationTime - (float)nodeAnim->mScalingKeys[s].mTime) / (float)(nodeAnim->mScalingKeys[s + 1].mTime - nodeAnim->mScalingKeys[s].mTime);
+    aiVector3D scaling = nodeAnim->mScalingKeys[s].mValue + factor * (nodeAnim->mScalingKeys[s + 1].mValue - nodeAnim->mScalingKeys[s].mValue);
+    scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+}
+
+static aiAnimation* makeAnimation(unsigned int keyCount)
+{
+    aiAnimation* animation = new aiAnimation();
+    animation->mTicksPerSecond = TICKS_PER_SECOND;
+    animation->mDuration = keyCount - 1;
+    animation->mNumChannels = CHANNELS;
+    animation->mChannels = new aiNodeAnim*[CHANNELS];
+
+    for (unsigned int c = 0; c < CHANNELS; c++)
+    {
+        aiNodeAnim* channel = new aiNodeAnim();
+        channel->mNodeName = aiString("bone" + std::to_string(c));
+        channel->mNumPositionKeys = channel->mNumRotationKeys = channel->mNumScalingKeys = keyCount;
+        channel->mPositionKeys = new aiVectorKey[keyCount];
+        channel->mRotationKeys = new aiQuatKey[keyCount];
+        channel->mScalingKeys = new aiVectorKey[keyCount];
+        for (unsigned int k = 0; k < keyCount; k++)
+        {
+            float phase = 0.1f * k + c;
+            channel->mPositionKeys[k].mTime = k;
+            channel->mPositionKeys[k].mValue = aiVector3D(std::sin(phase), std::cos(phase), 0.5f * phase);
+            channel->mRotationKeys[k].mTime = k;
+            channel->mRotationKeys[k].mValue = aiQuaternion(std::cos(0.5f * phase), 0.0f, std::sin(0.5f * phase), 0.0f);
+            channel->mScalingKeys[k].mTime = k;
+            channel->mScalingKeys[k].mValue = aiVector3D(1.0f);
+        }
+        animation->mChannels[c] = channel;
+    }
+
+    return animation;
+}
+
+int main()
+{
+    const unsigned int keyCounts[] = { 30, 300, 3000, 30000 };
+
+    std::printf("%10s %16s %16s %10s %12s\n", "keys", "key walk ns", "baked ns", "speedup", "max error");
+
+    for (unsigned int keyCount : keyCounts)
+    {
+        aiAnimation* animation = makeAnimation(keyCount);
+        AnimationClip clip;
+        clip.Bake(animation, (float)TICKS_PER_SECOND);
+
+        std::vector<float> times(QUERIES);
+        for (unsigned int i = 0; i < QUERIES; i++)
+            times[i] = clip.Duration * (float)std::rand() / (float)RAND_MAX;
+
+        glm::vec3 t, s;
+        glm::quat r;
+        float checksum = 0.0f;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < QUERIES; i++)
+        {
+            float ticks = times[i] * (float)TICKS_PER_SECOND;
+            for (unsigned int c = 0; c < CHANNELS; c++)
+            {
+                sampleKeys(ticks, animation->mChannels[c], t, r, s);
+                checksum += t.x + r.w;
+            }
+        }
+        double walkNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < QUERIES; i++)
+        {
+            ClipFrame frame = clip.FrameAt(times[i]);
+            for (unsigned int c = 0; c < CHANNELS; c++)
+            {
+                clip.SampleChannel(frame, c, t, r, s);
+                checksum += t.x + r.w;
+            }
+        }
+        double bakedNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+        // Accuracy of the baked path against the key walk at the same times
+        float maxError = 0.0f;
+        for (unsigned int i = 0; i < QUERIES; i++)
+        {
+            ClipFrame frame = clip.FrameAt(times[i]);
+            for (unsigned int c = 0; c < CHANNELS; c++)
+            {
+                glm::vec3 bt, bs;
+                glm::quat br;
+                sampleKeys(times[i] * (float)TICKS_PER_SECOND, animation->mChannels[c], t, r, s);
+                clip.SampleChannel(frame, c, bt, br, bs);
+                maxError = std::max(maxError, glm::length(bt - t));
+                maxError = std::max(maxError, 1.0f - std::abs(glm::dot(br, r)));
+            }
+        }
+
+        double samples = (double)QUERIES * CHANNELS;
+        std::printf("%10u %16.1f %16.1f %9.1fx %12.6f\n", keyCount, walkNs / samples, bakedNs / samples, walkNs / bakedNs, maxError);
+        sink = checksum;
+
+        delete animation;
+    }
+
+    return 0;
+}
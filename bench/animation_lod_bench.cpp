@@ -0,0 +1,70 @@
+// Plays a crowd at the speed the player and the horde play their clips through each
+// animation LOD tier, counting the skeleton evaluations and timing the updates, and
+// checks that the reduced tiers pose less often than the near one.
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "animation_system.hpp"
+#include "bench_rig.hpp"
+
+const unsigned int BONES = 64;
+const unsigned int FRAMES = 60;
+const unsigned int CHARACTERS = 200;
+const unsigned int UPDATES = 600;   // ten seconds at 60 Hz
+const float SWING = 0.3f;
+const float TIME_SCALE = 25.0f;     // PLAYER_ANIMATION_SPEED
+
+int main()
+{
+    AnimatedModelPtr model = makeSwingingModel(BONES, FRAMES, SWING);
+    AnimationLodSettings settings;
+    const char* names[] = { "near", "medium", "far" };
+    // as the AnimationSystem picks them for each tier
+    const PoseLod lods[] = { PoseLod(), PoseLod(settings.MediumRate, false), PoseLod(settings.FarRate, true) };
+    const float seconds = UPDATES / 60.0f;
+
+    std::printf("%u characters, clips at %gx, %.0f s at 60 Hz\n", CHARACTERS, TIME_SCALE, seconds);
+    std::printf("%-8s %8s %14s %12s\n", "tier", "rate", "poses/s/char", "us/update");
+
+    double nearPoses = 0.0;
+    bool fewer = true;
+    for (unsigned int t = 0; t < 3; t++)
+    {
+        std::vector<AnimationInstance*> instances;
+        for (unsigned int i = 0; i < CHARACTERS; i++)
+        {
+            instances.push_back(new AnimationInstance(model));
+            instances.back()->TimeScale = TIME_SCALE;
+            instances.back()->SetTime(0.01f * i);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int u = 0; u < UPDATES; u++)
+            for (unsigned int i = 0; i < CHARACTERS; i++)
+            {
+                instances[i]->Update(1.0f / 60.0f);
+                instances[i]->EvaluatePose(lods[t]);
+            }
+        double updateTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / UPDATES;
+
+        unsigned int poses = 0;
+        for (unsigned int i = 0; i < CHARACTERS; i++)
+        {
+            poses += instances[i]->PoseCount();
+            delete instances[i];
+        }
+        double posesPerSecond = poses / (seconds * CHARACTERS);
+        if (t == 0)
+            nearPoses = posesPerSecond;
+        else
+            fewer = fewer && posesPerSecond < nearPoses;
+
+        std::printf("%-8s %8g %14.1f %12.1f\n", names[t], lods[t].Rate, posesPerSecond, updateTime);
+    }
+
+    std::printf("reduced tiers pose less often than near: %s\n", fewer ? "yes" : "NO");
+    return fewer ? 0 : 1;
+}
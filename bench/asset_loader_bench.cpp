@@ -0,0 +1,180 @@
+// Loads the same cooked model a number of times, first one after the other on the
+// main thread and then through the asset loader with a frame loop pumping its uploads.
+// Without a GL context the upload half copies the bytes a GPU upload would send.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "asset_loader.hpp"
+#include "cooked_model.hpp"
+
+const unsigned int GRID = 100;
+const unsigned int BONES = 64;
+const unsigned int CLIPS = 4;
+const unsigned int FRAMES = 120;
+const unsigned int LOADS = 24;
+// what the frame loop spends on everything but uploads
+const double FRAME_MILLISECONDS = 2.0;
+const size_t BYTE_BUDGET = 2 * 1024 * 1024;
+const double MILLISECOND_BUDGET = 2.0;
+const char* const COOKED_FILE = "asset_loader_bench.dgm";
+
+static ModelData makeModel()
+{
+    ModelData data;
+
+    for (unsigned int y = 0; y <= GRID; y++)
+    {
+        for (unsigned int x = 0; x <= GRID; x++)
+        {
+            ModelVertex vertex;
+            vertex.Position = glm::vec3((float)x, (float)y, 0.0f);
+            vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertex.TexCoords = glm::vec2((float)x / GRID, (float)y / GRID);
+            vertex.BoneIDs = glm::ivec4(y * BONES / (GRID + 1), std::min(y * BONES / (GRID + 1) + 1, BONES - 1), 0, 0);
+            vertex.BoneWeights = glm::vec4(0.75f, 0.25f, 0.0f, 0.0f);
+            data.Vertices.push_back(vertex);
+        }
+    }
+    for (unsigned int y = 0; y < GRID; y++)
+    {
+        for (unsigned int x = 0; x < GRID; x++)
+        {
+            unsigned int corner = y * (GRID + 1) + x;
+            unsigned int quad[6] = { corner, corner + 1, corner + GRID + 2, corner, corner + GRID + 2, corner + GRID + 1 };
+            data.Indices.insert(data.Indices.end(), quad, quad + 6);
+        }
+    }
+
+    ModelSubmesh submesh;
+    submesh.BaseVertex = 0;
+    submesh.BaseIndex = 0;
+    submesh.IndicesCount = (unsigned int)data.Indices.size();
+    submesh.MaterialIndex = 0;
+    data.Submeshes.push_back(submesh);
+
+    for (unsigned int b = 0; b < BONES; b++)
+    {
+        data.Rig.NodeNames.push_back("bone" + std::to_string(b));
+        data.Rig.Parents.push_back((int)b - 1);
+        data.Rig.BindTransforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        data.Rig.BoneIndices.push_back(b);
+        data.Rig.BoneOffsets.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -(float)b, 0.0f)));
+    }
+    data.Rig.Prepare();
+
+    data.Clips.resize(CLIPS);
+    for (unsigned int c = 0; c < CLIPS; c++)
+    {
+        AnimationClip& clip = data.Clips[c];
+        clip.Name = "clip" + std::to_string(c);
+        clip.Duration = (FRAMES - 1) / CLIP_SAMPLE_RATE;
+        clip.Resize(FRAMES, BONES);
+        for (unsigned int b = 0; b < BONES; b++)
+            clip.ChannelNames[b] = data.Rig.NodeNames[b];
+        for (unsigned int f = 0; f < FRAMES; f++)
+        {
+            for (unsigned int b = 0; b < BONES; b++)
+            {
+                float angle = 0.1f * std::sin(0.1f * f + 0.2f * b + c);
+                clip.SetSample(f, b, glm::vec3(0.0f, 1.0f, 0.0f), glm::quat(std::cos(angle), 0.0f, 0.0f, std::sin(angle)), glm::vec3(1.0f));
+            }
+        }
+    }
+    return data;
+}
+
+// The CPU half of ResourceManager::LoadModel, false when the file does not open
+static bool readModel(AnimatedModel& model, CookedModel& cooked)
+{
+    if (!cooked.Open(COOKED_FILE) || !model.PrepareFromCooked(cooked))
+        return false;
+    ClipCompressionSettings compression;
+    model.CompressClips(compression);
+    return true;
+}
+
+// Stands in for the GL upload, reads what glBufferData would
+static void uploadModel(const CookedModel& cooked, std::vector<unsigned char>& staging, size_t bytes)
+{
+    staging.resize(std::max(staging.size(), bytes));
+    size_t vertexBytes = std::min(bytes, cooked.VertexCount() * sizeof(ModelVertex));
+    std::memcpy(staging.data(), cooked.Vertices(), vertexBytes);
+    std::memset(staging.data() + vertexBytes, 0, bytes - vertexBytes);
+}
+
+int main()
+{
+    if (!WriteCookedModel(COOKED_FILE, makeModel()))
+        return 1;
+
+    std::vector<unsigned char> staging;
+    unsigned int failures = 0;
+    size_t uploadSize = 0;
+
+    // one after the other, as Game::Init used to
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < LOADS; i++)
+    {
+        AnimatedModel model;
+        CookedModel cooked;
+        failures += !readModel(model, cooked);
+        uploadSize = model.UploadSize();
+        uploadModel(cooked, staging, uploadSize);
+    }
+    double serialTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // through the loader, the frame loop pumping uploads within the budget
+    AssetLoader loader;
+    std::vector<std::shared_ptr<AnimatedModel> > models;
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < LOADS; i++)
+    {
+        std::shared_ptr<AnimatedModel> model = std::make_shared<AnimatedModel>();
+        std::shared_ptr<CookedModel> cooked = std::make_shared<CookedModel>();
+        std::shared_ptr<bool> loaded = std::make_shared<bool>(false);
+        models.push_back(model);
+        loader.Load([=]()
+        {
+            *loaded = readModel(*model, *cooked);
+            return *loaded ? model->UploadSize() : 0;
+        },
+        [=, &staging, &failures]()
+        {
+            failures += !*loaded;
+            if (*loaded)
+                uploadModel(*cooked, staging, model->UploadSize());
+            cooked->Close();
+        });
+    }
+
+    unsigned int frames = 0;
+    size_t largestFrameUpload = 0;
+    double longestFrameUpload = 0.0;
+    while (!loader.IsIdle())
+    {
+        loader.PumpUploads(BYTE_BUDGET, MILLISECOND_BUDGET);
+        largestFrameUpload = std::max(largestFrameUpload, loader.LastUploadSize());
+        longestFrameUpload = std::max(longestFrameUpload, loader.LastUploadTime());
+        frames++;
+        std::this_thread::sleep_for(std::chrono::microseconds((long long)(FRAME_MILLISECONDS * 1000.0)));
+    }
+    double loaderTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::printf("%u loads of a model with %u vertices, %u bones, %u clips of %u frames, %.1f KiB to upload each\n",
+                LOADS, (GRID + 1) * (GRID + 1), BONES, CLIPS, FRAMES, uploadSize / 1024.0);
+    std::printf("main thread only: %.1f ms, the main thread blocked throughout\n", serialTime);
+    std::printf("asset loader on %u threads: %.1f ms over %u frames of %.1f ms, at most %.1f KiB and %.3f ms of uploads a frame\n",
+                loader.ThreadCount(), loaderTime, frames, FRAME_MILLISECONDS, largestFrameUpload / 1024.0, longestFrameUpload);
+    std::printf("%u failures\n", failures);
+
+    std::remove(COOKED_FILE);
+    return failures == 0 ? 0 : 1;
+}
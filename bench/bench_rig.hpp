@@ -0,0 +1,71 @@
+#ifndef BENCH_RIG_H
+#define BENCH_RIG_H
+
+// The synthetic rig the animation benches share, no files or GL needed: a binary
+// tree of bones named "bone0" on and one looping clip named "bench"
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "animated_model.hpp"
+
+// Adds a binary tree of bones to skeleton, each offset 0.1 further down, and sizes
+// clip for frames samples of the first channels of them, every one by default
+static void makeBoneTree(unsigned int bones, unsigned int frames, Skeleton& skeleton, AnimationClip& clip, unsigned int channels = 0)
+{
+    if (channels == 0)
+        channels = bones;
+    clip.Name = "bench";
+    clip.Duration = (frames - 1) / CLIP_SAMPLE_RATE;
+    clip.Resize(frames, channels);
+
+    for (unsigned int i = 0; i < bones; i++)
+    {
+        std::string name = "bone" + std::to_string(i);
+        skeleton.NodeNames.push_back(name);
+        skeleton.Parents.push_back(i == 0 ? -1 : (int)(i - 1) / 2);
+        skeleton.BindTransforms.push_back(glm::mat4(1.0f));
+        skeleton.BoneIndices.push_back(i);
+        skeleton.BoneOffsets.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f * i, 0.0f)));
+        if (i < channels)
+            clip.ChannelNames[i] = name;
+    }
+}
+
+// Samples every channel of clip with a sine swing of amplitude radians about axis, a
+// little out of phase from bone to bone, each bone length above its parent and the
+// root at the origin
+static void swingClip(AnimationClip& clip, float amplitude, const glm::vec3& axis = glm::vec3(1.0f, 0.0f, 0.0f), float length = 0.1f)
+{
+    for (unsigned int f = 0; f < clip.FrameCount; f++)
+    {
+        for (unsigned int c = 0; c < clip.ChannelCount; c++)
+        {
+            float angle = amplitude * std::sin(0.2f * f + 0.3f * c);
+            glm::vec3 translation(0.0f, c == 0 ? 0.0f : length, 0.0f);
+            clip.SetSample(f, c, translation, glm::angleAxis(angle, axis), glm::vec3(1.0f));
+        }
+    }
+}
+
+// The bone tree swinging as a model, skinning the vertices when there are any
+static AnimatedModelPtr makeSwingingModel(unsigned int bones, unsigned int frames, float amplitude,
+                                          const std::vector<SkinningVertex>& vertices = std::vector<SkinningVertex>())
+{
+    Skeleton skeleton;
+    AnimationClip clip;
+    makeBoneTree(bones, frames, skeleton, clip);
+    swingClip(clip, amplitude);
+
+    std::shared_ptr<AnimatedModel> model = std::make_shared<AnimatedModel>();
+    model->InitSkeleton(skeleton, std::vector<AnimationClip>(1, clip));
+    if (!vertices.empty())
+        model->InitSkinningVertices(vertices);
+    return model;
+}
+
+#endif
@@ -0,0 +1,85 @@
+// Compresses a long synthetic clip at a few tolerances and reports the memory kept,
+// the largest joint error against the baked clip and the cost of posing from it.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "bench_rig.hpp"
+
+const unsigned int BONES = 64;
+const unsigned int FRAMES = 900;   // 30 seconds at the clip rate
+const unsigned int POSES = 5000;
+
+// Mocap-like motion: smooth swings of different speeds, a root that travels, and a
+// quarter of the channels (fingers, face) that never move
+static void makeRig(Skeleton& skeleton, AnimationClip& clip)
+{
+    makeBoneTree(BONES, FRAMES, skeleton, clip);
+
+    for (unsigned int f = 0; f < FRAMES; f++)
+    {
+        for (unsigned int c = 0; c < BONES; c++)
+        {
+            float t = f / CLIP_SAMPLE_RATE;
+            float angle = c % 4 == 3 ? 0.1f : 0.3f * std::sin((1.0f + 0.05f * c) * t + 0.3f * c);
+            glm::vec3 translation = c == 0 ? glm::vec3(0.5f * t, 0.05f * std::sin(6.0f * t), 0.0f) : glm::vec3(0.0f, 0.1f, 0.0f);
+            glm::quat rotation = glm::normalize(glm::quat(std::cos(angle), std::sin(angle), 0.2f * std::sin(angle), 0.0f));
+            clip.SetSample(f, c, translation, rotation, glm::vec3(1.0f));
+        }
+    }
+}
+
+static double timePoses(const AnimatedModel& model)
+{
+    const AnimationClip& clip = model.GetClip(0);
+    PoseScratch scratch;
+    std::vector<Affine> palette(model.BonesCount());
+    volatile float sink = 0.0f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int p = 0; p < POSES; p++)
+    {
+        model.GetSkeleton().Evaluate(clip, model.GetClipChannels(0), clip.FrameAt(0.0137f * p), scratch, palette.data());
+        sink = palette[p % BONES].Rows[0][3];
+    }
+    (void)sink;
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / POSES;
+}
+
+int main()
+{
+    const float tolerances[] = { 0.0001f, 0.001f, 0.01f };
+
+    Skeleton skeleton;
+    AnimationClip clip;
+    makeRig(skeleton, clip);
+
+    AnimatedModel baked;
+    baked.InitSkeleton(skeleton, std::vector<AnimationClip>(1, clip));
+    double bakedTime = timePoses(baked);
+
+    std::printf("%u bones, %u frames, baked clip %.1f KiB, %.2f us/pose\n", BONES, FRAMES, clip.MemorySize() / 1024.0, bakedTime);
+    std::printf("%10s %12s %8s %10s %14s %10s\n", "tolerance", "KiB", "ratio", "keys", "max error", "us/pose");
+
+    bool withinTolerance = true;
+    for (float tolerance : tolerances)
+    {
+        ClipCompressionSettings settings;
+        settings.Tolerance = tolerance;
+
+        AnimatedModel model;
+        model.InitSkeleton(skeleton, std::vector<AnimationClip>(1, clip));
+        model.CompressClips(settings);
+
+        const ClipCompressionStats& stats = model.GetCompressionStats()[0];
+        std::printf("%10g %12.1f %7.1fx %10u %14g %10.2f\n", tolerance, stats.CompressedSize / 1024.0,
+                    (double)stats.BakedSize / stats.CompressedSize, stats.KeyCount, stats.MaxPoseError, timePoses(model));
+
+        // every key error stacks up along a chain of up to six bones
+        withinTolerance = withinTolerance && stats.MaxPoseError <= 20.0f * tolerance;
+    }
+
+    return withinTolerance ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+// Cooks a synthetic 1024x1024 RGBA image with its mip chain, then times mapping the
+// cooked file back and reading every level as the upload would. The levels are checked
+// against a straightforward 2x2 box filter of the level above.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "cooked_image.hpp"
+
+const unsigned int SIZE = 1024;
+const unsigned int CHANNELS = 4;
+const unsigned int ROUNDS = 50;
+const char* const COOKED_FILE = "cooked_image_bench.dgt";
+
+int main()
+{
+    std::vector<unsigned char> pixels((size_t)SIZE * SIZE * CHANNELS);
+    std::srand(1);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = (unsigned char)(std::rand() & 0xFF);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    if (!WriteCookedImage(COOKED_FILE, pixels.data(), SIZE, SIZE, CHANNELS, 1234))
+        return 1;
+    double cookTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    CookedImage cooked;
+    unsigned long long checksum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+    {
+        if (!cooked.Open(COOKED_FILE))
+            return 1;
+        for (unsigned int level = 0; level < cooked.LevelCount(); level++)
+        {
+            const unsigned char* texels = cooked.LevelPixels(level);
+            for (unsigned int i = 0; i < cooked.Level(level).Size; i += 64)
+                checksum += texels[i];
+        }
+        if (r + 1 < ROUNDS)
+            cooked.Close();
+    }
+    double loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+    // every level must be the box filter of the one above, the first the image itself
+    unsigned int mismatches = cooked.LevelCount() != 11 || cooked.SourceHash() != 1234 || cooked.Channels() != CHANNELS;
+    mismatches += !std::equal(pixels.begin(), pixels.end(), cooked.LevelPixels(0));
+    for (unsigned int level = 1; level < cooked.LevelCount(); level++)
+    {
+        const CookedImageLevel& above = cooked.Level(level - 1);
+        const CookedImageLevel& range = cooked.Level(level);
+        const unsigned char* source = cooked.LevelPixels(level - 1);
+        const unsigned char* texels = cooked.LevelPixels(level);
+        mismatches += range.Width != std::max(above.Width / 2, 1u) || range.Height != std::max(above.Height / 2, 1u);
+        for (unsigned int y = 0; y < range.Height; y++)
+        {
+            for (unsigned int x = 0; x < range.Width; x++)
+            {
+                for (unsigned int c = 0; c < CHANNELS; c++)
+                {
+                    unsigned int sum = 0;
+                    for (unsigned int k = 0; k < 4; k++)
+                        sum += source[(((y * 2 + k / 2) * above.Width) + x * 2 + k % 2) * CHANNELS + c];
+                    mismatches += texels[(y * range.Width + x) * CHANNELS + c] != (sum + 2) / 4;
+                }
+            }
+        }
+    }
+
+    std::printf("%ux%u RGBA8, %u levels, %.1f KiB cooked\n", SIZE, SIZE, cooked.LevelCount(), cooked.FileSize() / 1024.0);
+    std::printf("cooked in %.1f ms, mapped and read in %.3f ms (checksum %llu)\n", cookTime, loadTime, checksum);
+    std::printf("%u mismatches\n", mismatches);
+
+    cooked.Close();
+    std::remove(COOKED_FILE);
+    return mismatches == 0 ? 0 : 1;
+}
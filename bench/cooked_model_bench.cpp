@@ -0,0 +1,206 @@
+// Cooks a synthetic skinned grid mesh with a few clips, then times mapping the cooked
+// file back and reading out everything the runtime needs. Also measures the vertex
+// cache order of the triangles before and after optimising it.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cooked_model.hpp"
+#include "vertex_cache.hpp"
+
+const unsigned int GRID = 200;
+const unsigned int BONES = 64;
+const unsigned int CLIPS = 4;
+const unsigned int FRAMES = 120;
+const unsigned int ROUNDS = 20;
+const char* const COOKED_FILE = "cooked_model_bench.dgm";
+
+static ModelData makeModel()
+{
+    ModelData data;
+
+    // a grid of GRID x GRID quads, each vertex weighted to the bones of its row
+    for (unsigned int y = 0; y <= GRID; y++)
+    {
+        for (unsigned int x = 0; x <= GRID; x++)
+        {
+            ModelVertex vertex;
+            vertex.Position = glm::vec3((float)x, (float)y, 0.0f);
+            vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertex.TexCoords = glm::vec2((float)x / GRID, (float)y / GRID);
+            vertex.BoneIDs = glm::ivec4(y * BONES / (GRID + 1), std::min(y * BONES / (GRID + 1) + 1, BONES - 1), 0, 0);
+            vertex.BoneWeights = glm::vec4(0.75f, 0.25f, 0.0f, 0.0f);
+            data.Vertices.push_back(vertex);
+        }
+    }
+
+    // triangles in random order, as an exporter that knows nothing of vertex caches might leave them
+    std::vector<unsigned int> triangles;
+    for (unsigned int y = 0; y < GRID; y++)
+    {
+        for (unsigned int x = 0; x < GRID; x++)
+        {
+            unsigned int corner = y * (GRID + 1) + x;
+            unsigned int quad[6] = { corner, corner + 1, corner + GRID + 2, corner, corner + GRID + 2, corner + GRID + 1 };
+            triangles.insert(triangles.end(), quad, quad + 6);
+        }
+    }
+    std::vector<unsigned int> order(triangles.size() / 3);
+    for (unsigned int t = 0; t < order.size(); t++)
+        order[t] = t;
+    std::srand(1);
+    std::random_shuffle(order.begin(), order.end());
+    for (unsigned int t = 0; t < order.size(); t++)
+        data.Indices.insert(data.Indices.end(), &triangles[order[t] * 3], &triangles[order[t] * 3] + 3);
+
+    ModelSubmesh submesh;
+    submesh.BaseVertex = 0;
+    submesh.BaseIndex = 0;
+    submesh.IndicesCount = (unsigned int)data.Indices.size();
+    submesh.MaterialIndex = 0;
+    data.Submeshes.push_back(submesh);
+
+    ModelTexture texture;
+    texture.Type = "texture_diffuse";
+    texture.Path = "grid.png";
+    data.Textures.push_back(texture);
+
+    for (unsigned int b = 0; b < BONES; b++)
+    {
+        data.Rig.NodeNames.push_back("bone" + std::to_string(b));
+        data.Rig.Parents.push_back((int)b - 1);
+        data.Rig.BindTransforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        data.Rig.BoneIndices.push_back(b);
+        data.Rig.BoneOffsets.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -(float)b, 0.0f)));
+    }
+    data.Rig.Prepare();
+
+    data.Clips.resize(CLIPS);
+    for (unsigned int c = 0; c < CLIPS; c++)
+    {
+        AnimationClip& clip = data.Clips[c];
+        clip.Name = "clip" + std::to_string(c);
+        clip.Duration = (FRAMES - 1) / CLIP_SAMPLE_RATE;
+        clip.Resize(FRAMES, BONES);
+        for (unsigned int b = 0; b < BONES; b++)
+            clip.ChannelNames[b] = data.Rig.NodeNames[b];
+        for (unsigned int f = 0; f < FRAMES; f++)
+        {
+            for (unsigned int b = 0; b < BONES; b++)
+            {
+                float angle = 0.1f * std::sin(0.1f * f + 0.2f * b + c);
+                clip.SetSample(f, b, glm::vec3(0.0f, 1.0f, 0.0f), glm::quat(std::cos(angle), 0.0f, 0.0f, std::sin(angle)), glm::vec3(1.0f));
+            }
+        }
+    }
+    return data;
+}
+
+// Each triangle as its three indices starting from the smallest, keeping the winding
+static std::vector<unsigned long long> sortedTriangles(const std::vector<unsigned int>& indices, const std::vector<ModelVertex>& vertices)
+{
+    std::vector<unsigned long long> keys;
+    for (unsigned int t = 0; t < indices.size() / 3; t++)
+    {
+        unsigned int v[3];
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            // by position, so the vertex order does not matter
+            const glm::vec3& position = vertices[indices[t * 3 + k]].Position;
+            v[k] = (unsigned int)position.y * (GRID + 1) + (unsigned int)position.x;
+        }
+        std::rotate(v, std::min_element(v, v + 3), v + 3);
+        keys.push_back(((unsigned long long)v[0] << 42) | ((unsigned long long)v[1] << 21) | v[2]);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+int main()
+{
+    ModelData data = makeModel();
+    std::vector<unsigned long long> originalTriangles = sortedTriangles(data.Indices, data.Vertices);
+    unsigned int vertexCount = (unsigned int)data.Vertices.size();
+    unsigned int indexCount = (unsigned int)data.Indices.size();
+
+    float before16 = VertexCacheMissRatio(data.Indices.data(), indexCount, vertexCount, 16);
+    float before32 = VertexCacheMissRatio(data.Indices.data(), indexCount, vertexCount, 32);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    OptimizeVertexCache(data.Indices.data(), indexCount, vertexCount);
+    double optimizeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    float after16 = VertexCacheMissRatio(data.Indices.data(), indexCount, vertexCount, 16);
+    float after32 = VertexCacheMissRatio(data.Indices.data(), indexCount, vertexCount, 32);
+
+    std::vector<unsigned int> remap;
+    OptimizeVertexFetch(data.Indices.data(), indexCount, vertexCount, remap);
+    std::vector<ModelVertex> reordered(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        reordered[remap[v]] = data.Vertices[v];
+    data.Vertices.swap(reordered);
+
+    unsigned int mismatches = sortedTriangles(data.Indices, data.Vertices) != originalTriangles;
+
+    start = std::chrono::high_resolution_clock::now();
+    if (!WriteCookedModel(COOKED_FILE, data))
+        return 1;
+    double writeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // what InitFromCooked does short of the GPU upload, reading every vertex and index
+    // in place where the upload would
+    CookedModel cooked;
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+    std::vector<ModelTexture> textures;
+    double checksum = 0.0;
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+    {
+        if (!cooked.Open(COOKED_FILE))
+            return 1;
+        cooked.ReadTextures(textures);
+        cooked.ReadSkeleton(skeleton);
+        cooked.ReadClips(clips);
+        for (unsigned int v = 0; v < cooked.VertexCount(); v++)
+            checksum += cooked.Vertices()[v].Position.x;
+        for (unsigned int i = 0; i < cooked.IndexCount(); i++)
+            checksum += cooked.Indices()[i];
+        if (r + 1 < ROUNDS)
+            cooked.Close();
+    }
+    double loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+    // everything read back must be what was written
+    mismatches += cooked.VertexCount() != data.Vertices.size() || cooked.IndexCount() != data.Indices.size() || cooked.SubmeshCount() != 1;
+    mismatches += !std::equal(data.Indices.begin(), data.Indices.end(), cooked.Indices());
+    for (unsigned int v = 0; v < cooked.VertexCount(); v++)
+        mismatches += std::memcmp(&data.Vertices[v], &cooked.Vertices()[v], sizeof(ModelVertex)) != 0;
+    mismatches += textures.size() != 1 || textures[0].Path != "grid.png" || textures[0].Type != "texture_diffuse";
+    mismatches += skeleton.NodeNames != data.Rig.NodeNames || skeleton.Parents != data.Rig.Parents || skeleton.BoneIndices != data.Rig.BoneIndices;
+    for (unsigned int b = 0; b < BONES; b++)
+        mismatches += skeleton.BoneOffsets[b] != data.Rig.BoneOffsets[b] || skeleton.BindTransforms[b] != data.Rig.BindTransforms[b];
+    mismatches += clips.size() != CLIPS;
+    for (unsigned int c = 0; c < clips.size(); c++)
+    {
+        mismatches += clips[c].Name != data.Clips[c].Name || clips[c].Duration != data.Clips[c].Duration ||
+                      clips[c].FrameCount != FRAMES || clips[c].ChannelNames != data.Clips[c].ChannelNames ||
+                      clips[c].Samples != data.Clips[c].Samples;
+    }
+
+    std::printf("%u vertices, %u triangles, %u bones, %u clips of %u frames, %.1f KB cooked\n",
+                vertexCount, indexCount / 3, BONES, CLIPS, FRAMES, cooked.FileSize() / 1024.0);
+    std::printf("vertex cache misses per triangle, FIFO 16: %.3f -> %.3f, FIFO 32: %.3f -> %.3f, optimised in %.1f ms\n",
+                before16, after16, before32, after32, optimizeTime);
+    std::printf("written in %.2f ms, mapped and read in %.3f ms (checksum %.0f)\n", writeTime, loadTime, checksum);
+    std::printf("%u mismatches\n", mismatches);
+
+    cooked.Close();
+    std::remove(COOKED_FILE);
+    return mismatches == 0 ? 0 : 1;
+}
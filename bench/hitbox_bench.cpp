@@ -0,0 +1,227 @@
+// Tests batches of bullet segments and blast spheres against the posed hitbox capsules
+// of a few dozen characters and checks every answer against brute force sampling.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "bench_rig.hpp"
+#include "hitbox_set.hpp"
+
+const unsigned int BONES = 24;
+const unsigned int FRAMES = 60;
+const unsigned int CHARACTERS = 48;
+const unsigned int BULLETS = 20000;
+const unsigned int ROUNDS = 20;
+const float SCALE = 0.01f;
+
+// A spine of bones along y with a ring of vertices around each, so every bone
+// carries a cylinder of skin, and a clip that sways the spine
+static AnimatedModelPtr makeModel()
+{
+    Skeleton skeleton;
+    AnimationClip clip;
+    clip.Name = "bench";
+    clip.Duration = (FRAMES - 1) / CLIP_SAMPLE_RATE;
+    clip.Resize(FRAMES, BONES);
+
+    for (unsigned int i = 0; i < BONES; i++)
+    {
+        std::string name = "bone" + std::to_string(i);
+        skeleton.NodeNames.push_back(name);
+        skeleton.Parents.push_back((int)i - 1);
+        skeleton.BindTransforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, i == 0 ? 0.0f : 10.0f, 0.0f)));
+        skeleton.BoneIndices.push_back(i);
+        skeleton.BoneOffsets.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -10.0f * i, 0.0f)));
+        clip.ChannelNames[i] = name;
+    }
+
+    swingClip(clip, 0.04f, glm::vec3(0.0f, 0.0f, 1.0f), 10.0f);
+
+    std::vector<SkinningVertex> vertices;
+    for (unsigned int b = 0; b < BONES; b++)
+    {
+        for (unsigned int ring = 0; ring < 3; ring++)
+        {
+            for (unsigned int k = 0; k < 12; k++)
+            {
+                float angle = k * 6.2831853f / 12.0f;
+                SkinningVertex vertex = {};
+                vertex.Position[0] = 3.0f * std::cos(angle);
+                vertex.Position[1] = 10.0f * b + 4.0f * ring;
+                vertex.Position[2] = 3.0f * std::sin(angle);
+                vertex.Bones[0] = b;
+                vertex.Weights[0] = 1.0f;
+                vertices.push_back(vertex);
+            }
+        }
+    }
+
+    std::shared_ptr<AnimatedModel> model = std::make_shared<AnimatedModel>();
+    model->InitSkeleton(skeleton, std::vector<AnimationClip>(1, clip));
+    model->InitSkinningVertices(vertices);
+    return model;
+}
+
+static float random(float low, float high)
+{
+    return low + (high - low) * (rand() / (float)RAND_MAX);
+}
+
+static float pointSegmentDistance(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b)
+{
+    glm::vec3 ab = b - a;
+    float t = glm::clamp(glm::dot(point - a, ab) / std::max(glm::dot(ab, ab), 1e-12f), 0.0f, 1.0f);
+    return glm::length(point - (a + ab * t));
+}
+
+struct WorldCapsule
+{
+    unsigned int Character;
+    int Bone;
+    glm::vec3 A, B;
+    float Radius;
+};
+
+int main()
+{
+    AnimatedModelPtr model = makeModel();
+    const std::vector<BoneCapsule>& capsules = model->GetHitboxes();
+
+    // characters on a grid two units apart, posed at scattered phases
+    std::vector<AnimationInstance*> instances;
+    std::vector<glm::mat4> matrices;
+    std::vector<WorldCapsule> world;
+    for (unsigned int i = 0; i < CHARACTERS; i++)
+    {
+        instances.push_back(new AnimationInstance(model));
+        instances.back()->SetTime(0.1f * i);
+        instances.back()->EvaluatePose();
+
+        glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * (i % 8), 0.0f, 2.0f * (i / 8)));
+        matrices.push_back(glm::scale(matrix, glm::vec3(SCALE)));
+
+        const Affine* palette = instances[i]->GetPalette();
+        for (unsigned int c = 0; c < capsules.size(); c++)
+        {
+            glm::mat4 bone = Mat4FromAffine(palette[capsules[c].Bone]);
+            WorldCapsule capsule;
+            capsule.Character = i;
+            capsule.Bone = capsules[c].Bone;
+            capsule.A = glm::vec3(matrices[i] * bone * glm::vec4(capsules[c].A, 1.0f));
+            capsule.B = glm::vec3(matrices[i] * bone * glm::vec4(capsules[c].B, 1.0f));
+            capsule.Radius = capsules[c].Radius * SCALE;
+            world.push_back(capsule);
+        }
+    }
+
+    // bullets fly across the field at body height, a frame of travel each
+    std::vector<HitSegment> bullets(BULLETS);
+    for (unsigned int b = 0; b < BULLETS; b++)
+    {
+        bullets[b].Start = glm::vec3(random(-1.0f, 16.0f), random(0.0f, 2.5f), random(-1.0f, 12.0f));
+        float heading = random(0.0f, 6.2831853f);
+        bullets[b].End = bullets[b].Start + glm::vec3(std::cos(heading), 0.0f, std::sin(heading)) * 0.5f;
+        bullets[b].Radius = 0.01f;
+    }
+    std::vector<HitSphere> blasts(BULLETS / 10);
+    for (unsigned int b = 0; b < blasts.size(); b++)
+    {
+        blasts[b].Center = glm::vec3(random(-1.0f, 16.0f), random(0.0f, 2.5f), random(-1.0f, 12.0f));
+        blasts[b].Radius = 0.1f;
+    }
+
+    HitboxSet hitboxes;
+    std::vector<HitResult> bulletHits, blastHits;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+    {
+        hitboxes.Clear();
+        for (unsigned int i = 0; i < CHARACTERS; i++)
+            hitboxes.Add(capsules, instances[i]->GetPalette(), matrices[i]);
+    }
+    double addTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+        hitboxes.QuerySegments(bullets, bulletHits);
+    double segmentTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+    unsigned int capsuleTests = hitboxes.LastCapsuleTests();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+        hitboxes.QuerySpheres(blasts, blastHits);
+    double sphereTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+    // Brute force: a bullet sampled densely must come within reach of a capsule where
+    // the query reports a hit, and of none where it reports a miss. A hit must be on a
+    // capsule the bullet reaches no later than it enters any other, at that fraction
+    unsigned int hits = 0, mismatches = 0;
+    const unsigned int SAMPLES = 256;
+    const float tolerance = 2.0f / SAMPLES;
+    for (unsigned int b = 0; b < BULLETS; b++)
+    {
+        float length = glm::length(bullets[b].End - bullets[b].Start);
+        float step = length / SAMPLES;
+        glm::vec3 middle = 0.5f * (bullets[b].Start + bullets[b].End);
+        bool inside = false, near = false;
+        // the first fractions where the bullet is near or inside any capsule, and near the one hit
+        float firstNear = 2.0f, firstInside = 2.0f, hitNear = 2.0f;
+        for (unsigned int c = 0; c < world.size(); c++)
+        {
+            // every capsule is tried, sampling is skipped only where no point of the bullet can reach
+            if (pointSegmentDistance(middle, world[c].A, world[c].B) > 0.5f * length + world[c].Radius + bullets[b].Radius + step)
+                continue;
+            for (unsigned int s = 0; s <= SAMPLES; s++)
+            {
+                glm::vec3 point = glm::mix(bullets[b].Start, bullets[b].End, (float)s / SAMPLES);
+                float distance = pointSegmentDistance(point, world[c].A, world[c].B) - world[c].Radius - bullets[b].Radius;
+                float fraction = (float)s / SAMPLES;
+                if (distance <= -step)
+                {
+                    inside = true;
+                    firstInside = std::min(firstInside, fraction);
+                }
+                if (distance <= step)
+                {
+                    near = true;
+                    firstNear = std::min(firstNear, fraction);
+                    if ((int)world[c].Character == bulletHits[b].Character && world[c].Bone == bulletHits[b].Bone)
+                        hitNear = std::min(hitNear, fraction);
+                }
+            }
+        }
+        const HitResult& hit = bulletHits[b];
+        hits += hit.Character >= 0;
+        if ((hit.Character >= 0 && !near) || (hit.Character < 0 && inside))
+            mismatches++;
+        else if (hit.Character >= 0 && (hitNear > firstInside + tolerance || hit.Fraction < firstNear - tolerance ||
+                                         hit.Fraction > firstInside + tolerance))
+            mismatches++;
+    }
+    for (unsigned int b = 0; b < blasts.size(); b++)
+    {
+        bool overlaps = false;
+        for (unsigned int c = 0; c < world.size(); c++)
+            overlaps = overlaps || pointSegmentDistance(blasts[b].Center, world[c].A, world[c].B) <= world[c].Radius + blasts[b].Radius;
+        if (overlaps != (blastHits[b].Character >= 0))
+            mismatches++;
+    }
+
+    std::printf("%u characters, %u capsules, posed into the set in %.1f us\n", CHARACTERS, hitboxes.CapsuleCount(), addTime);
+    std::printf("%u segments: %.3f ms, %.1f M/s, %u hits, %.2f capsule tests per segment (%u without the bounding spheres)\n",
+                BULLETS, segmentTime, BULLETS / (segmentTime * 1000.0), hits, (double)capsuleTests / BULLETS, hitboxes.CapsuleCount());
+    std::printf("%u spheres: %.3f ms, %.1f M/s\n", (unsigned int)blasts.size(), sphereTime, blasts.size() / (sphereTime * 1000.0));
+    std::printf("%u mismatches against brute force\n", mismatches);
+
+    for (unsigned int i = 0; i < CHARACTERS; i++)
+        delete instances[i];
+    return mismatches == 0 ? 0 : 1;
+}
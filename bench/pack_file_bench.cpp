@@ -0,0 +1,155 @@
+// Packs synthetic shader-like text files and a few incompressible ones, then times
+// opening all of them through the Vfs: from the files on disk, from the mounted pack
+// one by one, and from the pack after a parallel Preload. Every view is checked
+// against the file it came from.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lz4_block.hpp"
+#include "pack_file.hpp"
+#include "vfs.hpp"
+
+const unsigned int TEXT_FILES = 24;
+const unsigned int TEXT_SIZE = 2 * 1024 * 1024;
+const unsigned int BINARY_FILES = 4;
+const unsigned int BINARY_SIZE = 1024 * 1024;
+const unsigned int ROUNDS = 5;
+const char* const PACK = "pack_file_bench.dgp";
+const char* const MOUNT_POINT = "pack_bench_files/";
+
+static std::string makeText(unsigned int size)
+{
+    static const char* const words[] = { "uniform ", "vec3 ", "float ", "normalize(", "texture(", "gl_Position ", "= ", "* ",
+                                         "lightColor", "fragPos", ");\n", "    ", "in ", "out ", "return ", "0.5" };
+    std::string text;
+    while (text.size() < size)
+        text += words[std::rand() % 16];
+    text.resize(size);
+    return text;
+}
+
+static std::string makeBinary(unsigned int size)
+{
+    std::string bytes(size, 0);
+    for (unsigned int i = 0; i < size; i++)
+        bytes[i] = (char)(std::rand() & 0xFF);
+    return bytes;
+}
+
+// opens every path, false when a view differs from its contents
+static bool openAll(const std::vector<std::string>& paths, const std::vector<std::string>& contents, unsigned long long& checksum)
+{
+    bool matches = true;
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        FileView view;
+        if (!Vfs::Open(paths[i], view) || view.Size() != contents[i].size() ||
+            std::string((const char*)view.Data(), view.Size()) != contents[i])
+            matches = false;
+        for (size_t b = 0; b < view.Size(); b += 4096)
+            checksum += view.Data()[b];
+    }
+    return matches;
+}
+
+int main()
+{
+    std::srand(1);
+    std::vector<std::string> names, contents;
+    for (unsigned int i = 0; i < TEXT_FILES + BINARY_FILES; i++)
+    {
+        std::ostringstream name;
+        name << "pack_file_bench_" << i << (i < TEXT_FILES ? ".glsl" : ".bin");
+        names.push_back(name.str());
+        contents.push_back(i < TEXT_FILES ? makeText(TEXT_SIZE) : makeBinary(BINARY_SIZE));
+        std::ofstream file(name.str().c_str(), std::ios::binary | std::ios::trunc);
+        file.write(contents.back().data(), contents.back().size());
+    }
+
+    // the LZ4 blocks on their own
+    std::vector<unsigned char> compressed(Lz4CompressBound(PACK_BLOCK_SIZE)), decompressed(PACK_BLOCK_SIZE);
+    const unsigned char* block = (const unsigned char*)contents[0].data();
+    size_t compressedSize = Lz4Compress(block, PACK_BLOCK_SIZE, compressed.data(), compressed.size());
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    unsigned int mismatches = 0;
+    for (unsigned int r = 0; r < 100; r++)
+        mismatches += !Lz4Decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size());
+    double blockTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / 100;
+    mismatches += !std::equal(decompressed.begin(), decompressed.end(), block);
+
+    std::vector<PackSource> sources;
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        PackSource source = { names[i], names[i], true };
+        sources.push_back(source);
+    }
+    start = std::chrono::high_resolution_clock::now();
+    if (!WritePackFile(PACK, sources))
+        return 1;
+    double packTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    PackFile pack;
+    if (!pack.Open(PACK))
+        return 1;
+    unsigned long long size = 0, stored = 0;
+    unsigned int compressedCount = 0;
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        const PackEntry* entry = pack.Find(names[i]);
+        mismatches += entry == nullptr || pack.EntryPath(*entry) != names[i];
+        if (entry == nullptr)
+            continue;
+        size += entry->Size;
+        stored += entry->StoredSize;
+        compressedCount += (entry->Flags & PACK_ENTRY_LZ4) != 0;
+    }
+    mismatches += pack.Find("missing") != nullptr || compressedCount != TEXT_FILES;
+    pack.Close();
+
+    std::vector<std::string> diskPaths = names, packPaths;
+    for (unsigned int i = 0; i < names.size(); i++)
+        packPaths.push_back(MOUNT_POINT + names[i]);
+
+    unsigned long long checksum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+        mismatches += !openAll(diskPaths, contents, checksum);
+    double diskTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+    if (!Vfs::Mount(PACK, MOUNT_POINT))
+        return 1;
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+        mismatches += !openAll(packPaths, contents, checksum);
+    double serialTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < ROUNDS; r++)
+    {
+        Vfs::Preload(packPaths);
+        mismatches += !openAll(packPaths, contents, checksum);
+    }
+    double preloadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+    Vfs::UnmountAll();
+
+    std::printf("%u files, %u compressed, %.1f MiB -> %.1f MiB packed in %.1f ms\n", (unsigned int)names.size(), compressedCount,
+                size / (1024.0 * 1024.0), stored / (1024.0 * 1024.0), packTime);
+    std::printf("LZ4 block: %.1f%% of %u KiB, decompressed at %.0f MiB/s\n", 100.0 * compressedSize / PACK_BLOCK_SIZE,
+                PACK_BLOCK_SIZE / 1024, PACK_BLOCK_SIZE / (1024.0 * 1024.0) / blockTime);
+    std::printf("opened all: %.2f ms from disk, %.2f ms from the pack, %.2f ms from the pack preloaded (checksum %llu)\n",
+                diskTime, serialTime, preloadTime, checksum);
+    std::printf("%u from packs, %u from disk, %.1f MiB decompressed\n", Vfs::PackReadCount(), Vfs::DiskReadCount(),
+                Vfs::DecompressedSize() / (1024.0 * 1024.0));
+    std::printf("%u mismatches\n", mismatches);
+
+    for (unsigned int i = 0; i < names.size(); i++)
+        std::remove(names[i].c_str());
+    std::remove(PACK);
+    return mismatches == 0 ? 0 : 1;
+}
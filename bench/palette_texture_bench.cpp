@@ -0,0 +1,92 @@
+// Validates the baked palette texture against the CPU pose evaluation and compares
+// the per-character CPU cost of both ways of animating a background character.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "bench_rig.hpp"
+#include "palette_texture.hpp"
+
+const unsigned int BONES = 64;
+const unsigned int FRAMES = 60;
+const unsigned int CHARACTERS = 1000;
+const unsigned int UPDATES = 50;
+// a swing of a few degrees per frame, blending matrices between frames is only a
+// fair stand-in for blending rotations at that kind of speed
+const float SWING = 0.3f;
+
+static float maxDifference(const Affine* a, const std::vector<Affine>& b)
+{
+    float difference = 0.0f;
+    for (unsigned int m = 0; m < b.size(); m++)
+        for (unsigned int row = 0; row < 3; row++)
+            for (unsigned int column = 0; column < 4; column++)
+                difference = std::max(difference, std::fabs(a[m].Rows[row][column] - b[m].Rows[row][column]));
+    return difference;
+}
+
+int main()
+{
+    AnimatedModelPtr model = makeSwingingModel(BONES, FRAMES, SWING);
+
+    PaletteTexture palettes;
+    palettes.Bake(model->GetSkeleton(), std::vector<AnimationClip>(1, model->GetClip(0)),
+                  std::vector<ChannelMap>(1, model->GetClipChannels(0)));
+
+    // the texture matches the CPU pose exactly on baked frames and up to the
+    // difference between blending matrices and blending rotations in between
+    AnimationInstance instance(model);
+    std::vector<Affine> sampled(model->BonesCount());
+    float frameError = 0.0f, blendError = 0.0f;
+    for (unsigned int step = 0; step < FRAMES * 4; step++)
+    {
+        float time = step / (4.0f * CLIP_SAMPLE_RATE);
+        instance.SetTime(time);
+        instance.EvaluatePose();
+        palettes.Sample(0, time, sampled.data());
+
+        float difference = maxDifference(instance.GetPalette(), sampled);
+        if (step % 4 == 0)
+            frameError = std::max(frameError, difference);
+        else
+            blendError = std::max(blendError, difference);
+    }
+
+    std::vector<AnimationInstance*> instances;
+    for (unsigned int i = 0; i < CHARACTERS; i++)
+    {
+        instances.push_back(new AnimationInstance(model));
+        instances.back()->SetTime(0.01f * i);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int u = 0; u < UPDATES; u++)
+        for (unsigned int i = 0; i < CHARACTERS; i++)
+        {
+            instances[i]->Update(1.0f / 60.0f);
+            instances[i]->EvaluatePose();
+        }
+    double poseTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / (UPDATES * CHARACTERS);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int u = 0; u < UPDATES; u++)
+        for (unsigned int i = 0; i < CHARACTERS; i++)
+            instances[i]->Update(1.0f / 60.0f);
+    double clockTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / (UPDATES * CHARACTERS);
+
+    for (unsigned int i = 0; i < CHARACTERS; i++)
+        delete instances[i];
+
+    std::printf("%u bones, %u baked frames, %u KiB of texels\n", BONES, palettes.Height, (unsigned int)(palettes.Texels.size() * sizeof(float) / 1024));
+    std::printf("max abs error on baked frames  %g\n", frameError);
+    std::printf("max abs error between frames   %g\n", blendError);
+    std::printf("%-22s %12s\n", "cpu per character", "ns/update");
+    std::printf("%-22s %12.1f\n", "evaluated pose", poseTime);
+    std::printf("%-22s %12.1f\n", "baked (clock only)", clockTime);
+
+    return frameError < 1e-4f ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// Measures the parallel pose-update stage: bone palettes evaluated per second for
+// crowds of 100, 1k and 5k characters on 1 to N threads.
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "animation_system.hpp"
+#include "bench_rig.hpp"
+
+const unsigned int BONES = 64;
+const unsigned int FRAMES = 60;
+const unsigned int UPDATES = 50;
+const float SWING = 1.0f;
+
+int main()
+{
+    const unsigned int crowds[] = { 100, 1000, 5000 };
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    AnimatedModelPtr model = makeSwingingModel(BONES, FRAMES, SWING);
+
+    std::printf("%8s %8s %14s %16s %9s\n", "chars", "threads", "ms/update", "poses/s", "speedup");
+
+    for (unsigned int crowd : crowds)
+    {
+        std::vector<AnimationInstance*> instances;
+        for (unsigned int i = 0; i < crowd; i++)
+        {
+            instances.push_back(new AnimationInstance(model));
+            instances.back()->SetTime(0.01f * i);
+        }
+
+        double singleThreadTime = 0.0;
+
+        for (unsigned int threads = 1; threads <= maxThreads; threads++)
+        {
+            AnimationSystem system(threads - 1);
+            for (unsigned int i = 0; i < crowd; i++)
+                system.Add(instances[i]);
+
+            system.Update(1.0f / 60.0f); // warm up
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned int u = 0; u < UPDATES; u++)
+                system.Update(1.0f / 60.0f);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / UPDATES;
+
+            if (threads == 1)
+                singleThreadTime = ms;
+
+            std::printf("%8u %8u %14.3f %16.0f %8.2fx\n", crowd, threads, ms, crowd * 1000.0 / ms, singleThreadTime / ms);
+        }
+
+        for (unsigned int i = 0; i < crowd; i++)
+            delete instances[i];
+    }
+
+    return 0;
+}
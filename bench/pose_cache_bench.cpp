@@ -0,0 +1,97 @@
+// Measures the pose update of crowds whose characters play one clip at scattered
+// phases, posed one by one and through the pose cache at a few phase quanta.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "animation_system.hpp"
+#include "bench_rig.hpp"
+
+const unsigned int BONES = 64;
+const unsigned int FRAMES = 60;
+const unsigned int UPDATES = 50;
+const float SWING = 1.0f;
+
+// Largest difference between the palette of each instance and its exact pose
+static float maxPoseError(const std::vector<AnimationInstance*>& instances)
+{
+    PoseScratch scratch;
+    std::vector<Affine> exact(BONES);
+    float error = 0.0f;
+    for (unsigned int i = 0; i < instances.size(); i++)
+    {
+        const AnimatedModel& model = *instances[i]->GetModel();
+        model.Pose(0, model.GetClip(0).FrameAt(instances[i]->GetTime()), false, scratch, exact.data());
+        const Affine* palette = instances[i]->GetPalette();
+        for (unsigned int b = 0; b < BONES; b++)
+            for (unsigned int row = 0; row < 3; row++)
+                for (unsigned int column = 0; column < 4; column++)
+                    error = std::max(error, std::fabs(palette[b].Rows[row][column] - exact[b].Rows[row][column]));
+    }
+    return error;
+}
+
+int main()
+{
+    const unsigned int crowds[] = { 1000, 5000 };
+    const float quanta[] = { 0.0f, 0.5f, 1.0f, 2.0f };
+
+    AnimatedModelPtr model = makeSwingingModel(BONES, FRAMES, SWING);
+
+    std::printf("%8s %8s %12s %10s %10s %10s %12s\n", "chars", "quantum", "ms/update", "speedup", "distinct", "hit rate", "max error");
+
+    bool sharedPoses = true;
+    for (unsigned int crowd : crowds)
+    {
+        std::vector<AnimationInstance*> instances;
+        for (unsigned int i = 0; i < crowd; i++)
+        {
+            instances.push_back(new AnimationInstance(model));
+            instances.back()->SetTime(0.0137f * i);
+        }
+
+        double unsharedTime = 0.0;
+        for (float quantum : quanta)
+        {
+            AnimationSystem system(0);
+            system.LodSettings.Enabled = false;
+            system.PoseSharing.Enabled = quantum > 0.0f;
+            system.PoseSharing.Quantum = quantum;
+            for (unsigned int i = 0; i < crowd; i++)
+                system.Add(instances[i]);
+
+            system.Update(1.0f / 60.0f); // warm up
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned int u = 0; u < UPDATES; u++)
+                system.Update(1.0f / 60.0f);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / UPDATES;
+
+            const PoseCache& cache = system.GetPoseCache();
+            if (quantum <= 0.0f)
+            {
+                unsharedTime = ms;
+                std::printf("%8u %8s %12.3f %10s %10u %10s %12g\n", crowd, "off", ms, "", crowd, "", maxPoseError(instances));
+            }
+            else
+            {
+                std::printf("%8u %8g %12.3f %9.2fx %10u %9.1f%% %12g\n", crowd, quantum, ms, unsharedTime / ms,
+                            cache.LastDistinctPoses(), cache.LastHitRate() * 100.0f, maxPoseError(instances));
+                // one pose per step of the clip at most, whatever the crowd size
+                sharedPoses = sharedPoses && cache.LastDistinctPoses() <= (unsigned int)std::ceil(FRAMES / quantum) + 1;
+            }
+
+            for (unsigned int i = 0; i < crowd; i++)
+                system.Remove(instances[i]);
+        }
+
+        for (unsigned int i = 0; i < crowd; i++)
+            delete instances[i];
+    }
+
+    return sharedPoses ? 0 : 1;
+}
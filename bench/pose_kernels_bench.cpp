@@ -0,0 +1,120 @@
+// Checks the SIMD pose path (Skeleton::Evaluate on the pose kernels) against the
+// scalar glm path it replaced, then times both on a single thread.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench_rig.hpp"
+#include "skeleton.hpp"
+
+const unsigned int BONES = 67;   // deliberately not a multiple of the kernel width
+const unsigned int FRAMES = 60;
+const unsigned int POSES = 20000;
+
+static void makeRig(Skeleton& skeleton, AnimationClip& clip)
+{
+    // the last few nodes have no channel and keep their bind transformation
+    makeBoneTree(BONES, FRAMES, skeleton, clip, BONES - 3);
+    skeleton.GlobalInverseTransform = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+    for (unsigned int i = 0; i < BONES; i++)
+        skeleton.BindTransforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.2f, 0.0f));
+    skeleton.Prepare();
+
+    for (unsigned int f = 0; f < FRAMES; f++)
+    {
+        for (unsigned int c = 0; c < BONES - 3; c++)
+        {
+            float angle = 0.1f * f + 0.05f * c;
+            glm::quat rotation = glm::normalize(glm::quat(std::cos(angle), std::sin(angle), 0.3f * std::cos(0.7f * angle), 0.2f));
+            glm::vec3 scale(1.0f + 0.1f * std::sin(angle), 1.0f, 1.0f - 0.05f * std::cos(angle));
+            clip.SetSample(f, c, glm::vec3(0.01f * c, 0.1f, 0.01f * f), rotation, scale);
+        }
+    }
+}
+
+// The pose evaluation before the kernels: slerp, three matrices and two multiplies per node
+static void evaluateScalar(const Skeleton& skeleton, const AnimationClip& clip, const ChannelMap& channels, const ClipFrame& frame,
+                           std::vector<glm::mat4>& nodeTransforms, std::vector<glm::mat4>& palette)
+{
+    for (unsigned int i = 0; i < skeleton.NodeCount(); i++)
+    {
+        glm::mat4 local = skeleton.BindTransforms[i];
+        if (channels[i] >= 0)
+        {
+            glm::vec3 translation, scale;
+            glm::quat rotation;
+            clip.SampleChannel(frame, channels[i], translation, rotation, scale);
+            local = glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+        }
+
+        nodeTransforms[i] = skeleton.Parents[i] < 0 ? local : nodeTransforms[skeleton.Parents[i]] * local;
+
+        int bone = skeleton.BoneIndices[i];
+        if (bone >= 0)
+            palette[bone] = skeleton.GlobalInverseTransform * nodeTransforms[i] * skeleton.BoneOffsets[bone];
+    }
+}
+
+int main()
+{
+    Skeleton skeleton;
+    AnimationClip clip;
+    makeRig(skeleton, clip);
+    ChannelMap channels = skeleton.BindClip(clip);
+
+    std::vector<glm::mat4> nodeTransforms(skeleton.NodeCount());
+    std::vector<glm::mat4> reference(skeleton.BoneCount());
+    std::vector<Affine> palette(skeleton.BoneCount());
+    PoseScratch scratch;
+
+    // verification over every frame and a few blend factors in between
+    float maxError = 0.0f;
+    for (unsigned int step = 0; step < FRAMES * 4; step++)
+    {
+        ClipFrame frame = clip.FrameAt(step / (4.0f * CLIP_SAMPLE_RATE));
+        evaluateScalar(skeleton, clip, channels, frame, nodeTransforms, reference);
+        skeleton.Evaluate(clip, channels, frame, scratch, palette.data());
+
+        for (unsigned int b = 0; b < skeleton.BoneCount(); b++)
+            for (unsigned int row = 0; row < 3; row++)
+                for (unsigned int column = 0; column < 4; column++)
+                    maxError = std::max(maxError, std::fabs(reference[b][column][row] - palette[b].Rows[row][column]));
+    }
+
+    volatile float sink = 0.0f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int p = 0; p < POSES; p++)
+    {
+        evaluateScalar(skeleton, clip, channels, clip.FrameAt(0.013f * p), nodeTransforms, reference);
+        sink = reference[p % BONES][3][0];
+    }
+    double scalarTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / POSES;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int p = 0; p < POSES; p++)
+    {
+        skeleton.Evaluate(clip, channels, clip.FrameAt(0.013f * p), scratch, palette.data());
+        sink = palette[p % BONES].Rows[0][3];
+    }
+    double kernelTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / POSES;
+    (void)sink;
+
+#if defined(__AVX__)
+    const char* target = "AVX";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const char* target = "SSE";
+#else
+    const char* target = "scalar";
+#endif
+
+    std::printf("%u bones, kernels built for %s\n", BONES, target);
+    std::printf("max abs palette error  %g\n", maxError);
+    std::printf("%-10s %12s\n", "path", "us/pose");
+    std::printf("%-10s %12.3f\n", "scalar", scalarTime);
+    std::printf("%-10s %12.3f %8.2fx\n", "kernels", kernelTime, scalarTime / kernelTime);
+
+    return maxError < 1e-3f ? 0 : 1;
+}
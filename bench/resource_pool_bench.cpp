@@ -0,0 +1,138 @@
+// Times reaching resources the way a frame does, through a std::map keyed by name with
+// a temporary string against a handle into a ResourcePool. Then runs the pool through
+// an eviction round: unreferenced resources unloaded least recently used first, and
+// every handle still resolving, the evicted ones loaded again on Get, and a resource in
+// use kept when its name is added again.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "resource_pool.hpp"
+
+const unsigned int RESOURCES = 64;
+const unsigned int LOOKUPS = 2000000;
+const size_t RESOURCE_BYTES = 4096;
+
+// Stands in for a texture, the bytes are what a GPU upload would hold
+struct Blob
+{
+    std::vector<unsigned char> Bytes;
+    unsigned int Version;
+
+    Blob() : Version(0) {}
+};
+
+static unsigned int unloads = 0;
+
+static void unloadBlob(Blob& blob)
+{
+    std::vector<unsigned char>().swap(blob.Bytes);
+    unloads++;
+}
+
+static ResourceSize measureBlob(const Blob& blob)
+{
+    return ResourceSize(0, blob.Bytes.size());
+}
+
+static Blob makeBlob(unsigned int version)
+{
+    Blob blob;
+    blob.Bytes.assign(RESOURCE_BYTES, (unsigned char)version);
+    blob.Version = version;
+    return blob;
+}
+
+static std::string resourceName(unsigned int i)
+{
+    return "resource" + std::to_string(i);
+}
+
+int main()
+{
+    std::map<std::string, Blob> byName;
+    ResourcePool<Blob> pool(&unloadBlob, &measureBlob);
+    std::vector<ResourcePool<Blob>::Handle> handles;
+    uint64_t frame = 0;
+    for (unsigned int i = 0; i < RESOURCES; i++)
+    {
+        byName[resourceName(i)] = makeBlob(i);
+        handles.push_back(pool.Add(resourceName(i), makeBlob(i), frame, [i]() { return makeBlob(i); }));
+    }
+
+    // a frame spells the names out as string literals, which become temporary strings
+    const char* names[4] = { "resource3", "resource17", "resource42", "resource63" };
+    unsigned long long checksum = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < LOOKUPS; i++)
+        checksum += byName[names[i % 4]].Version;
+    double mapTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / LOOKUPS;
+
+    // the same four resources, resolved once
+    ResourcePool<Blob>::Handle resolved[4];
+    for (unsigned int i = 0; i < 4; i++)
+        resolved[i] = pool.Find(HashName(names[i]));
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < LOOKUPS; i++)
+        checksum += pool.Get(resolved[i % 4], frame).Version;
+    double handleTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / LOOKUPS;
+
+    unsigned int failures = 0;
+    // a name hashed by the compiler finds what the string finds
+    failures += pool.Find(HashName("resource42")) != handles[42];
+
+    // the even resources are referenced, every one is used on a frame of its own
+    for (unsigned int i = 0; i < RESOURCES; i += 2)
+        pool.Acquire(handles[i]);
+    for (unsigned int i = 0; i < RESOURCES; i++)
+        pool.Get(handles[i], ++frame);
+
+    // evict down to half the bytes, least recently used first as Trim does
+    size_t budget = RESOURCES * RESOURCE_BYTES / 2;
+    std::vector<ResourcePool<Blob>::Handle> candidates;
+    pool.ForEach([&](ResourcePool<Blob>::Handle handle)
+    {
+        if (pool.IsEvictable(handle))
+            candidates.push_back(handle);
+    });
+    std::sort(candidates.begin(), candidates.end(), [&](ResourcePool<Blob>::Handle a, ResourcePool<Blob>::Handle b)
+    {
+        return pool.LastUse(a) < pool.LastUse(b);
+    });
+    for (unsigned int i = 0; i < candidates.size() && pool.Usage().GpuBytes > budget; i++)
+        pool.Evict(candidates[i]);
+
+    // only odd ones can go and the bytes of every even one stay, so all odd ones went
+    failures += pool.Usage().GpuBytes != budget || pool.Usage().Evictions != RESOURCES / 2 || pool.Usage().Referenced != RESOURCES / 2;
+    for (unsigned int i = 0; i < RESOURCES; i++)
+        failures += pool.IsResident(handles[i]) != (i % 2 == 0);
+
+    // evicted handles still resolve, to the resource loaded again
+    for (unsigned int i = 0; i < RESOURCES; i++)
+        failures += pool.Get(handles[i], ++frame).Version != i || pool.Get(handles[i], frame).Bytes.size() != RESOURCE_BYTES;
+    failures += pool.Usage().Reloads != RESOURCES / 2 || pool.Usage().Resident != RESOURCES;
+
+    // a removed resource's handle goes stale, the next one in its slot is a new generation
+    pool.Remove(handles[1]);
+    ResourcePool<Blob>::Handle reused = pool.Add("another", makeBlob(1000), frame);
+    failures += pool.IsValid(handles[1]) || !pool.IsValid(reused) || reused.Index != handles[1].Index;
+
+    // a referenced resource is not replaced, the new value is unloaded instead; an
+    // unreferenced one is
+    unsigned int unloadsBefore = unloads;
+    failures += pool.Add(resourceName(0), makeBlob(2000), frame) != handles[0] || pool.Get(handles[0], frame).Version != 0;
+    failures += pool.Add(resourceName(3), makeBlob(3000), frame) != handles[3] || pool.Get(handles[3], frame).Version != 3000;
+    failures += unloads != unloadsBefore + 2;
+
+    pool.Clear();
+    failures += pool.Size() != 0 || pool.Usage().GpuBytes != 0 || unloads != RESOURCES / 2 + RESOURCES + 3;
+
+    std::printf("%u resources, %u lookups (checksum %llu)\n", RESOURCES, LOOKUPS, checksum);
+    std::printf("std::map by name: %.1f ns, handle: %.1f ns per lookup\n", mapTime, handleTime);
+    std::printf("%u evicted to fit %.0f KiB, %u reloaded\n", RESOURCES / 2, budget / 1024.0, RESOURCES / 2);
+    std::printf("%u failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Checks the SIMD skinning kernel against a scalar reference, then measures the
+// CPU skinning stage of the AnimationSystem in vertices per second on 1 to N
+// threads. The GPU path is timed in game, see the "Entities draw" overlay line.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "animation_system.hpp"
+#include "bench_rig.hpp"
+
+const unsigned int BONES = 64;
+const unsigned int FRAMES = 60;
+const unsigned int VERTICES = 10007;   // not a multiple of the chunk size
+const unsigned int UPDATES = 20;
+const unsigned int KERNEL_RUNS = 200;
+const float SWING = 0.3f;
+
+// The swinging bone tree with a vertex cloud weighted to up to four bones
+static AnimatedModelPtr makeModel()
+{
+    std::vector<SkinningVertex> vertices(VERTICES);
+    for (unsigned int v = 0; v < VERTICES; v++)
+    {
+        SkinningVertex& vertex = vertices[v];
+        float angle = 0.01f * v;
+        vertex.Position[0] = std::cos(angle);
+        vertex.Position[1] = 0.001f * v;
+        vertex.Position[2] = std::sin(angle);
+        vertex.Normal[0] = std::cos(angle);
+        vertex.Normal[1] = 0.0f;
+        vertex.Normal[2] = std::sin(angle);
+
+        // the fourth influence is unused on every other vertex, as in most meshes
+        float weights[4] = { 0.5f, 0.3f, 0.2f, 0.0f };
+        if (v % 2)
+        {
+            weights[2] = 0.1f;
+            weights[3] = 0.1f;
+        }
+        for (unsigned int k = 0; k < 4; k++)
+        {
+            vertex.Bones[k] = (v * 7 + k * 13) % BONES;
+            vertex.Weights[k] = weights[k];
+        }
+    }
+
+    return makeSwingingModel(BONES, FRAMES, SWING, vertices);
+}
+
+// One vertex at a time, the way the GPU path does it in gritty.vs
+static void skinScalar(unsigned int n, const SkinningVertex* vertices, const Affine* palette, SkinnedVertex* out)
+{
+    for (unsigned int v = 0; v < n; v++)
+    {
+        float blended[3][4] = {};
+        for (unsigned int k = 0; k < 4; k++)
+            for (unsigned int row = 0; row < 3; row++)
+                for (unsigned int column = 0; column < 4; column++)
+                    blended[row][column] += vertices[v].Weights[k] * palette[vertices[v].Bones[k]].Rows[row][column];
+
+        const float* p = vertices[v].Position;
+        const float* n = vertices[v].Normal;
+        float normal[3];
+        for (unsigned int row = 0; row < 3; row++)
+        {
+            out[v].Position[row] = blended[row][0] * p[0] + blended[row][1] * p[1] + blended[row][2] * p[2] + blended[row][3];
+            normal[row] = blended[row][0] * n[0] + blended[row][1] * n[1] + blended[row][2] * n[2];
+        }
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (unsigned int row = 0; row < 3; row++)
+            out[v].Normal[row] = normal[row] / length;
+    }
+}
+
+int main()
+{
+    const unsigned int crowds[] = { 10, 100 };
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    AnimatedModelPtr model = makeModel();
+    const std::vector<SkinningVertex>& vertices = model->GetSkinningVertices();
+
+    // a palette from the middle of the clip
+    AnimationInstance pose(model);
+    pose.SetTime(0.5f * model->GetClip(0).Duration);
+    pose.EvaluatePose();
+    const Affine* palette = pose.GetPalette();
+
+    std::vector<SkinnedVertex> reference(VERTICES), skinned(VERTICES);
+    skinScalar(VERTICES, vertices.data(), palette, reference.data());
+    SkinVertices(VERTICES, vertices.data(), palette, skinned.data());
+
+    float maxError = 0.0f;
+    for (unsigned int v = 0; v < VERTICES; v++)
+    {
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            maxError = std::max(maxError, std::fabs(reference[v].Position[k] - skinned[v].Position[k]));
+            maxError = std::max(maxError, std::fabs(reference[v].Normal[k] - skinned[v].Normal[k]));
+        }
+    }
+
+    volatile float sink = 0.0f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < KERNEL_RUNS; r++)
+    {
+        skinScalar(VERTICES, vertices.data(), palette, reference.data());
+        sink = reference[r].Position[0];
+    }
+    double scalarTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / KERNEL_RUNS;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < KERNEL_RUNS; r++)
+    {
+        SkinVertices(VERTICES, vertices.data(), palette, skinned.data());
+        sink = skinned[r].Position[0];
+    }
+    double kernelTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / KERNEL_RUNS;
+    (void)sink;
+
+    std::printf("%u vertices, %u bones\n", VERTICES, BONES);
+    std::printf("max abs vertex error   %g\n", maxError);
+    std::printf("%-10s %14s\n", "kernel", "Mverts/s");
+    std::printf("%-10s %14.1f\n", "scalar", VERTICES / scalarTime);
+    std::printf("%-10s %14.1f %8.2fx\n", "SIMD", VERTICES / kernelTime, scalarTime / kernelTime);
+
+    std::printf("\n%8s %8s %14s %14s %9s\n", "chars", "threads", "ms/skinning", "Mverts/s", "speedup");
+
+    for (unsigned int crowd : crowds)
+    {
+        std::vector<AnimationInstance*> instances;
+        for (unsigned int i = 0; i < crowd; i++)
+        {
+            instances.push_back(new AnimationInstance(model));
+            instances.back()->SetTime(0.01f * i);
+        }
+
+        double singleThreadTime = 0.0;
+
+        for (unsigned int threads = 1; threads <= maxThreads; threads++)
+        {
+            AnimationSystem system(threads - 1);
+            system.SetCpuSkinning(true);
+            for (unsigned int i = 0; i < crowd; i++)
+                system.Add(instances[i]);
+
+            system.Update(1.0f / 60.0f); // warm up
+
+            // only the skinning stage, the pose update is measured by pose_bench
+            double ms = 0.0;
+            unsigned long long skinnedVertices = 0;
+            for (unsigned int u = 0; u < UPDATES; u++)
+            {
+                system.Update(1.0f / 60.0f);
+                ms += system.LastSkinningTime();
+                skinnedVertices += system.LastSkinnedVertexCount();
+            }
+
+            if (threads == 1)
+                singleThreadTime = ms;
+
+            std::printf("%8u %8u %14.3f %14.1f %8.2fx\n", crowd, threads, ms / UPDATES, skinnedVertices / (ms * 1000.0), singleThreadTime / ms);
+        }
+
+        for (unsigned int i = 0; i < crowd; i++)
+            delete instances[i];
+    }
+
+    return maxError < 1e-4f ? 0 : 1;
+}
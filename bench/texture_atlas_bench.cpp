@@ -0,0 +1,90 @@
+// Sprites of many sizes, each one solid colour, packed into an atlas the way the entity
+// textures are. Times Add and Pack, then checks every mip level the atlas keeps: the
+// texels under the rect of a sprite, and one texel of that level around them, must hold
+// its colour alone.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "texture_atlas.hpp"
+
+const unsigned int SPRITES = 400;
+const unsigned int MIN_SIZE = 4;
+const unsigned int MAX_SIZE = 128;
+const unsigned int RUNS = 10;
+
+static unsigned int colourOf(unsigned int sprite)
+{
+    // never black, the empty texels between cells
+    return (sprite + 1) * 2654435761u | 0x010101u;
+}
+
+int main()
+{
+    std::srand(1);
+    std::vector<unsigned int> widths(SPRITES), heights(SPRITES);
+    std::vector<std::vector<unsigned char> > pixels(SPRITES);
+    size_t separateBytes = 0;
+    for (unsigned int s = 0; s < SPRITES; s++)
+    {
+        widths[s] = MIN_SIZE + std::rand() % (MAX_SIZE - MIN_SIZE + 1);
+        heights[s] = MIN_SIZE + std::rand() % (MAX_SIZE - MIN_SIZE + 1);
+        unsigned int colour = colourOf(s);
+        for (unsigned int i = 0; i < widths[s] * heights[s]; i++)
+        {
+            pixels[s].push_back(colour & 0xFF);
+            pixels[s].push_back((colour >> 8) & 0xFF);
+            pixels[s].push_back((colour >> 16) & 0xFF);
+        }
+        // a texture of its own with the whole mip chain
+        separateBytes += (size_t)widths[s] * heights[s] * 4 * 4 / 3;
+    }
+
+    double packTime = 0.0;
+    TextureAtlas atlas;
+    for (unsigned int run = 0; run < RUNS; run++)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for (unsigned int s = 0; s < SPRITES; s++)
+            atlas.Add(std::to_string(s), pixels[s].data(), widths[s], heights[s], 3, GL_FALSE);
+        atlas.Pack();
+        packTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // nearest filtering and nearest mipmaps: a lookup on the edge of the rect lands on
+    // the texel next to it at most
+    unsigned int bleeding = 0;
+    unsigned int size = atlas.LayerSize();
+    for (unsigned int level = 0; level < atlas.LevelCount(); level++, size /= 2)
+    {
+        const unsigned char* layers = atlas.LevelPixels(level);
+        unsigned int scale = atlas.LayerSize() / size;
+        for (unsigned int s = 0; s < SPRITES; s++)
+        {
+            const AtlasEntry* entry = atlas.Find(std::to_string(s));
+            unsigned int colour = colourOf(s);
+            const unsigned char* layer = layers + (size_t)entry->Layer * size * size * 4;
+            unsigned int x0 = entry->X / scale, y0 = entry->Y / scale;
+            unsigned int x1 = (entry->X + entry->Width + scale - 1) / scale, y1 = (entry->Y + entry->Height + scale - 1) / scale;
+            for (unsigned int y = y0 > 0 ? y0 - 1 : 0; y < y1 + 1 && y < size; y++)
+            {
+                for (unsigned int x = x0 > 0 ? x0 - 1 : 0; x < x1 + 1 && x < size; x++)
+                {
+                    const unsigned char* texel = &layer[((size_t)y * size + x) * 4];
+                    if (texel[0] != (colour & 0xFF) || texel[1] != ((colour >> 8) & 0xFF) || texel[2] != ((colour >> 16) & 0xFF) ||
+                        texel[3] != 255)
+                        bleeding++;
+                }
+            }
+        }
+    }
+
+    std::printf("%u sprites of %u to %u texels, %u runs\n", SPRITES, MIN_SIZE, MAX_SIZE, RUNS);
+    std::printf("pack:     %8.2f ms, %u layers of %u, %u mip levels, %.0f%% covered\n", packTime / RUNS, atlas.LayerCount(),
+                atlas.LayerSize(), atlas.LevelCount(), atlas.Coverage() * 100.0f);
+    std::printf("upload:   %8.1f KiB in one texture, %.1f KiB in %u textures\n", atlas.UploadSize() / 1024.0f,
+                separateBytes / 1024.0f, SPRITES);
+    std::printf("bleeding: %u texels\n", bleeding);
+    return bleeding == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+// A character set whose models share a few texture sheets, some of them copied under
+// other names. Reads the material textures of every model the way each model used to,
+// one read per path of the model, then through one texture cache shared by loader
+// threads, and compares the time and the bytes waiting for upload.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cooked_image.hpp"
+#include "texture.hpp"
+#include "texture_cache.hpp"
+
+const unsigned int SHEETS = 8;
+// byte-identical copies of every sheet at different paths
+const unsigned int COPIES = 4;
+const unsigned int SIZE = 512;
+const unsigned int CHANNELS = 4;
+const unsigned int MODELS = 64;
+const unsigned int TEXTURES_PER_MODEL = 4;
+const unsigned int THREADS = 4;
+
+static std::string sheetPath(unsigned int sheet, unsigned int copy)
+{
+    return "texture_cache_bench_" + std::to_string(sheet) + "_" + std::to_string(copy) + ".png";
+}
+
+int main()
+{
+    // only the cooked copies exist, they remember the hash of the image they came from
+    std::vector<unsigned char> pixels((size_t)SIZE * SIZE * CHANNELS);
+    std::srand(1);
+    for (unsigned int sheet = 0; sheet < SHEETS; sheet++)
+    {
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = (unsigned char)(std::rand() & 0xFF);
+        for (unsigned int copy = 0; copy < COPIES; copy++)
+        {
+            if (!WriteCookedImage(CookedImagePath(sheetPath(sheet, copy)), pixels.data(), SIZE, SIZE, CHANNELS, 1000 + sheet))
+                return 1;
+        }
+    }
+
+    // every model takes a few sheets under any of their names
+    std::vector<std::vector<std::string> > modelTextures(MODELS);
+    for (unsigned int m = 0; m < MODELS; m++)
+    {
+        for (unsigned int t = 0; t < TEXTURES_PER_MODEL; t++)
+            modelTextures[m].push_back(sheetPath((m + t * 3) % SHEETS, (m / SHEETS + t) % COPIES));
+    }
+
+    // each model on its own, one source per path of the model
+    size_t perModelBytes = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (unsigned int m = 0; m < MODELS; m++)
+    {
+        for (unsigned int t = 0; t < TEXTURES_PER_MODEL; t++)
+        {
+            TextureSource source;
+            ReadTextureSource(modelTextures[m][t], source);
+            perModelBytes += source.Size();
+            ReleaseTextureSource(source);
+        }
+    }
+    double perModelTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // one cache, the models prepared on loader threads
+    TextureCache cache;
+    std::vector<std::vector<CachedTexturePtr> > acquired(MODELS);
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < THREADS; t++)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            for (unsigned int m = t; m < MODELS; m += THREADS)
+            {
+                for (unsigned int i = 0; i < TEXTURES_PER_MODEL; i++)
+                    acquired[m].push_back(cache.Acquire(modelTextures[m][i]));
+            }
+        }));
+    }
+    for (unsigned int t = 0; t < threads.size(); t++)
+        threads[t].join();
+    double cacheTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // every image once, whatever model or path asked for it
+    unsigned int failures = cache.Count() != SHEETS || cache.SharedCount() != MODELS * TEXTURES_PER_MODEL - SHEETS;
+    std::vector<const CachedTexture*> distinct;
+    size_t cacheBytes = 0;
+    for (unsigned int m = 0; m < MODELS; m++)
+    {
+        for (unsigned int i = 0; i < TEXTURES_PER_MODEL; i++)
+        {
+            const CachedTexturePtr& texture = acquired[m][i];
+            failures += !texture || texture->ContentHash != 1000 + (m + i * 3) % SHEETS;
+            bool seen = false;
+            for (unsigned int d = 0; d < distinct.size(); d++)
+                seen |= distinct[d] == texture.get();
+            if (!seen)
+            {
+                distinct.push_back(texture.get());
+                cacheBytes += cache.UploadSize(texture);
+            }
+        }
+    }
+
+    // the last user of an image lets it go
+    for (unsigned int m = 0; m < MODELS; m++)
+    {
+        for (unsigned int i = 0; i < TEXTURES_PER_MODEL; i++)
+            cache.Release(acquired[m][i]);
+    }
+    failures += cache.Count() != 0;
+
+    std::printf("%u models with %u textures each, %u sheets of %ux%u RGBA under %u names each\n",
+                MODELS, TEXTURES_PER_MODEL, SHEETS, SIZE, SIZE, COPIES);
+    std::printf("per model: %.1f ms, %.1f MiB to upload\n", perModelTime, perModelBytes / (1024.0 * 1024.0));
+    std::printf("texture cache on %u threads: %.1f ms, %.1f MiB to upload\n", THREADS, cacheTime, cacheBytes / (1024.0 * 1024.0));
+    std::printf("%u failures\n", failures);
+
+    for (unsigned int sheet = 0; sheet < SHEETS; sheet++)
+    {
+        for (unsigned int copy = 0; copy < COPIES; copy++)
+            std::remove(CookedImagePath(sheetPath(sheet, copy)).c_str());
+    }
+    return failures == 0 ? 0 : 1;
+}
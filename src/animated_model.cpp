@@ -1,518 +1,502 @@
 #include "animated_model.hpp"
 
-AnimatedModel::AnimatedModel() : animDuration(0.0), currentAnimation(0), bonesCount(0)
+#include <algorithm>
+
+#include "gl_state.hpp"
+
+AnimatedModel::AnimatedModel() : reducedNodeCount(0), compressed(false), textureCache(nullptr),
+    pendingVertices(nullptr), pendingVertexCount(0), pendingIndices(nullptr), pendingIndexCount(0), bonesCount(0), gpuSize(0)
 {
-    VAO = 0;
-    scene = nullptr;
+    VAO = VBO = EBO = 0;
 }
 
-void AnimatedModel::InitFromScene(const aiScene* scene)
+void AnimatedModel::InitFromData(const ModelData& data)
 {
-    this->scene = scene;
-    globalInverseTransform = mat4Convert(scene->mRootNode->mTransformation);
-    globalInverseTransform = glm::inverse(globalInverseTransform);
+    PrepareFromData(data);
+    Upload();
+}
 
-    // Resize the mesh & texture vectors
-    meshes.resize(scene->mNumMeshes);
-    loadedTextures.resize(scene->mNumMaterials);
+bool AnimatedModel::InitFromCooked(const CookedModel& cooked)
+{
+    if (!PrepareFromCooked(cooked))
+        return false;
+    Upload();
+    return true;
+}
 
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
+void AnimatedModel::PrepareFromData(const ModelData& data)
+{
+    meshes = data.Submeshes;
+    loadTextures(data.Textures);
+    initAnimations(data.Rig, data.Clips);
+
+    // the importer's arrays are gone by the time Upload runs
+    preparedVertices = data.Vertices;
+    preparedIndices = data.Indices;
+    initGeometry(preparedVertices.data(), (unsigned int)preparedVertices.size(), preparedIndices.data(), (unsigned int)preparedIndices.size());
+}
 
-    unsigned int verticesCount = 0;
-    unsigned int indicesCount = 0;
+// The cooked arrays are what PrepareFromData gets from the importer, read in place
+bool AnimatedModel::PrepareFromCooked(const CookedModel& cooked)
+{
+    if (!cooked.IsOpen())
+        return false;
 
-    // Count the number of vertices and indices
-    for (unsigned int i = 0; i < meshes.size(); i++)
-    {
-        meshes[i].BaseVertex    = verticesCount;
-        meshes[i].BaseIndex     = indicesCount;
-        meshes[i].IndicesCount  = scene->mMeshes[i]->mNumFaces * 3;
-        meshes[i].MaterialIndex = scene->mMeshes[i]->mMaterialIndex;
+    meshes.assign(cooked.Submeshes(), cooked.Submeshes() + cooked.SubmeshCount());
 
-        verticesCount += scene->mMeshes[i]->mNumVertices;
-        indicesCount += meshes[i].IndicesCount;
-    }
+    std::vector<ModelTexture> materialTextures;
+    cooked.ReadTextures(materialTextures);
+    loadTextures(materialTextures);
 
-    // Reserve space in the vectors for the vertices and indices
-    vertices.reserve(verticesCount);
-    indices.reserve(indicesCount);
+    Skeleton cookedSkeleton;
+    std::vector<AnimationClip> cookedClips;
+    cooked.ReadSkeleton(cookedSkeleton);
+    cooked.ReadClips(cookedClips);
+    initAnimations(cookedSkeleton, cookedClips);
 
-    // Initialize the meshes in the scene one by one
-    for (unsigned int i = 0; i < meshes.size(); i++)
-    {
-        const aiMesh* mesh = scene->mMeshes[i];
-        processMesh(i, mesh, vertices, indices, textures);
-    }
+    initGeometry(cooked.Vertices(), cooked.VertexCount(), cooked.Indices(), cooked.IndexCount());
+    return true;
+}
+
+size_t AnimatedModel::UploadSize() const
+{
+    size_t size = pendingVertexCount * sizeof(ModelVertex) + pendingIndexCount * sizeof(unsigned int);
+    size += bakedPalettes.Texels.size() * sizeof(float);
+    // an image another model uploaded already costs nothing
+    for (unsigned int i = 0; i < textures.size(); i++)
+        size += textureCache->UploadSize(textures[i].Cached);
+    return size;
+}
+
+void AnimatedModel::Upload()
+{
+    gpuSize = pendingVertexCount * sizeof(ModelVertex) + pendingIndexCount * sizeof(unsigned int) + bakedPalettes.Texels.size() * sizeof(float);
+    // the first model to upload an image makes its texture, the others take its name
+    for (unsigned int i = 0; i < textures.size(); i++)
+        textures[i].ID = textureCache->Upload(textures[i].Cached);
+
+    if (HasAnimations())
+        bakedPalettes.Upload();
 
     // create buffers/arrays
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
-    // load data into vertex buffers
+    GlState::BindVertexArray(VAO);
+    // load data into vertex buffers. The vertices are interleaved exactly as the
+    // attributes below read them, so the array goes to the GPU as it is
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    // A great thing about structs is that their memory layout is sequential for all its items.
-    // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-    // again translates to 3/2 floats which translates to a byte array.
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, pendingVertexCount * sizeof(ModelVertex), pendingVertices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, pendingIndexCount * sizeof(unsigned int), pendingIndices, GL_STATIC_DRAW);
 
     // set the vertex attribute pointers
     // vertex Positions
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)0);
     // vertex normals
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, Normal));
     // vertex texture coords
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, TexCoords));
     // vertex bone ids
     glEnableVertexAttribArray(3);
-    glVertexAttribIPointer(3, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, BoneIDs));
+    glVertexAttribIPointer(3, 4, GL_INT, sizeof(ModelVertex), (void*)offsetof(ModelVertex, BoneIDs));
     // vertex bone weights
     glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, BoneWeights));
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, BoneWeights));
+
+    GlState::BindVertexArray(0);
 
-    glBindVertexArray(0);
+    pendingVertices = nullptr;
+    pendingIndices = nullptr;
+    pendingVertexCount = pendingIndexCount = 0;
+    std::vector<ModelVertex>().swap(preparedVertices);
+    std::vector<unsigned int>().swap(preparedIndices);
 }
 
-void AnimatedModel::Draw(Shader shader)
+void AnimatedModel::Release()
 {
-    if (HasAnimations())
-        shader.SetInteger("animated", 1);
-
-    glBindVertexArray(VAO);
-
-    for (unsigned int i = 0 ; i < meshes.size() ; i++)
+    for (unsigned int i = 0; i < textures.size(); i++)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int emissionNr = 1;
-
-        for (unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            std::string number;
-            std::string name = textures[i].Type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++); // transfer unsigned int to stream
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++);
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++);
-            else if (name == "texture_emission")
-                number = std::to_string(emissionNr++);
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].ID);
-        }
-
-        glDrawElementsBaseVertex(GL_TRIANGLES,
-                                 meshes[i].IndicesCount,
-                                 GL_UNSIGNED_INT,
-                                 (void*)(sizeof(unsigned int) * meshes[i].BaseIndex),
-                                 meshes[i].BaseVertex);
+        if (textureCache != nullptr)
+            textureCache->Release(textures[i].Cached);
+        textures[i].Cached.reset();
+        textures[i].ID = 0;
     }
+    bakedPalettes.Release();
 
-    // Make sure the VAO is not changed from the outside
-    glBindVertexArray(0);
-
-    if (HasAnimations())
-        shader.SetInteger("animated", 0);
+    if (VAO != 0)
+    {
+        GlState::DeleteVertexArray(VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+    VAO = VBO = EBO = 0;
+    gpuSize = 0;
 }
 
-void AnimatedModel::SetBoneTransformations(Shader shader, GLfloat currentTime)
+size_t AnimatedModel::MemorySize() const
 {
-    if (HasAnimations())
+    size_t size = skinningVertices.capacity() * sizeof(SkinningVertex) + hitboxes.capacity() * sizeof(BoneCapsule) +
+                  bakedPalettes.Texels.capacity() * sizeof(float);
+    // library clips are counted by their library, their reduced copies bound here
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    for (unsigned int i = 0; i < clips.size(); i++)
     {
-        std::vector<glm::mat4> transforms;
-        boneTransform((float)currentTime, transforms);
-        shader.SetMatrix4v("gBones", transforms);
+        if (libraryClips[i].Library == nullptr && clips[i])
+            size += clips[i]->MemorySize();
     }
+    for (unsigned int i = 0; i < reducedClips.size(); i++)
+        size += reducedClips[i].MemorySize();
+    return size;
 }
 
-void AnimatedModel::SetAnimation(unsigned int animation)
+void AnimatedModel::initAnimations(const Skeleton& skeleton, const std::vector<AnimationClip>& clips)
 {
-    if (animation >= 0 && animation < GetNumAnimations())
-        currentAnimation = animation;
+    InitSkeleton(skeleton, clips);
+
+    if (HasAnimations())
+        bakedPalettes.Bake(this->skeleton, clips, clipChannels);
 }
 
-void AnimatedModel::processMesh(unsigned int meshIndex,
-                                const aiMesh* mesh,
-                                std::vector<Vertex>& vertices,
-                                std::vector<unsigned int>& indices,
-                                std::vector<Texture>& textures)
+void AnimatedModel::initGeometry(const ModelVertex* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
 {
-    // Walk through each of the mesh's vertices
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    // keep what CPU skinning reads, in the layout its kernel wants
+    std::vector<SkinningVertex> skinning(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; i++)
     {
-        Vertex vertex;
-        glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-        // positions
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.Position = vector;
-        // normals
-        if (mesh->HasNormals())
+        for (unsigned int k = 0; k < 3; k++)
         {
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.Normal = vector;
+            skinning[i].Position[k] = vertices[i].Position[k];
+            skinning[i].Normal[k] = vertices[i].Normal[k];
         }
-        // texture coordinates
-        if (mesh->HasTextureCoords(0)) // does the mesh contain texture coordinates?
+        for (unsigned int k = 0; k < NUM_BONES_PER_VERTEX; k++)
         {
-            glm::vec2 vec;
-            // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-            // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-            vec.x = mesh->mTextureCoords[0][i].x;
-            vec.y = mesh->mTextureCoords[0][i].y;
-            vertex.TexCoords = vec;
+            skinning[i].Bones[k] = vertices[i].BoneIDs[k];
+            skinning[i].Weights[k] = vertices[i].BoneWeights[k];
         }
-        else
-            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-        // Bone Weights are initialised in next for loop
-        vertex.BoneWeights = glm::vec4(0.0f);
-
-        vertices.push_back(vertex);
     }
+    InitSkinningVertices(skinning);
 
-        // process bones
-    for (unsigned int i = 0; i < mesh->mNumBones; i++)
-    {
-        unsigned int boneIndex = 0;
-        std::string boneName(mesh->mBones[i]->mName.data);
-
-        if (boneMapping.find(boneName) == boneMapping.end())
-        {
-            // allocate an index for the new bone
-            boneIndex = bonesCount;
-            bonesCount++;
-            BoneMatrix boneMatrix;
-            boneMatrices.push_back(boneMatrix);
-
-            boneMatrices[boneIndex].BoneOffset = mat4Convert(mesh->mBones[i]->mOffsetMatrix);
-            boneMapping[boneName] = boneIndex;
-        }
-        else
-            boneIndex = boneMapping[boneName];
-
-        for (unsigned int j = 0; j < mesh->mBones[i]->mNumWeights; j++)
-        {
-            unsigned int vertexID = meshes[meshIndex].BaseVertex + mesh->mBones[i]->mWeights[j].mVertexId;
-            float boneWeight = mesh->mBones[i]->mWeights[j].mWeight;
-
-            for (unsigned int g = 0; g < NUM_BONES_PER_VERTEX; g++)
-            {
-                if (vertices[vertexID].BoneWeights[g] == 0.0)
-                {
-                    vertices[vertexID].BoneIDs[g] = boneIndex;
-                    vertices[vertexID].BoneWeights[g] = boneWeight;
-                    break;
-                }
-            }
-        }
-    }
+    pendingVertices = vertices;
+    pendingVertexCount = vertexCount;
+    pendingIndices = indices;
+    pendingIndexCount = indexCount;
+}
 
-    // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+void AnimatedModel::InitSkeleton(const Skeleton& skeleton, const std::vector<AnimationClip>& clips)
+{
+    this->skeleton = skeleton;
+    this->skeleton.Prepare();
+    bonesCount = skeleton.BoneCount();
+
+    this->clips.resize(clips.size());
+    libraryClips.assign(clips.size(), LibraryClip());
+    clipChannels.resize(clips.size());
+    for (unsigned int i = 0; i < clips.size(); i++)
     {
-        const aiFace face = mesh->mFaces[i];
-        assert(face.mNumIndices == 3);
-        // retrieve all indices of the face and store them in the indices vector
-        for (unsigned int j = 0; j < face.mNumIndices; j++)
-            indices.push_back(face.mIndices[j]);
+        this->clips[i] = std::make_shared<const AnimationClip>(clips[i]);
+        libraryClips[i].Library = nullptr;
+        clipChannels[i] = skeleton.BindClip(clips[i]);
     }
 
-    // process materials
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-    // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-    // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-    // Same applies to other texture as the following list summarizes:
-    // diffuse: texture_diffuseN
-    // specular: texture_specularN
-    // normal: texture_normalN
-    // emission: texture_emissionN
-
-    // 1. diffuse maps
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-    // 2. specular maps
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-    // 3. normal maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-    // 4. emission maps
-    std::vector<Texture> emissionMaps = loadMaterialTextures(material, aiTextureType_EMISSIVE, "texture_emission");
-    textures.insert(textures.end(), emissionMaps.begin(), emissionMaps.end());
+    buildReducedSkeleton();
 }
 
-void AnimatedModel::boneTransform(float timeInSeconds, std::vector<glm::mat4>& transforms)
+void AnimatedModel::InitSkinningVertices(const std::vector<SkinningVertex>& vertices)
 {
-    glm::mat4 identity = glm::mat4(1.0f);
-
-    // Calculate animation duration
-    unsigned int numPosKeys = scene->mAnimations[currentAnimation]->mChannels[0]->mNumPositionKeys;
-    animDuration = scene->mAnimations[currentAnimation]->mChannels[0]->mPositionKeys[numPosKeys - 1].mTime;
-
-    float ticksPerSecond = (float)(scene->mAnimations[currentAnimation]->mTicksPerSecond != 0 ? scene->mAnimations[currentAnimation]->mTicksPerSecond : 25.0f);
-    float timeInTicks = timeInSeconds * ticksPerSecond;
-    float animationTime = fmod(timeInTicks, animDuration);
-    readNodeHeirarchy(animationTime, scene->mRootNode, identity);
-    transforms.resize(bonesCount);
-
-    for (unsigned int  i = 0; i < bonesCount; i++)
-        transforms[i] = boneMatrices[i].FinalTransformation;
+    skinningVertices = vertices;
+    hitboxes = BuildBoneCapsules(vertices, bonesCount);
+    buildReducedSkeleton();
 }
 
-uint AnimatedModel::findPosition(float animationTime, const aiNodeAnim* nodeAnim)
+// Far LOD tiers only sample the channels of the nodes the reduced skeleton still
+// animates, so their clips are cut down to those channels as well
+void AnimatedModel::buildReducedSkeleton()
 {
-    for (uint i = 0 ; i < nodeAnim->mNumPositionKeys - 1 ; i++)
+    // without vertices every bone counts the same and only small leaf chains go
+    std::vector<float> boneWeights(bonesCount, skinningVertices.empty() ? 1.0f : 0.0f);
+    for (unsigned int i = 0; i < skinningVertices.size(); i++)
     {
-        if (animationTime < (float)nodeAnim->mPositionKeys[i + 1].mTime)
-            return i;
+        for (unsigned int k = 0; k < NUM_BONES_PER_VERTEX; k++)
+        {
+            if (skinningVertices[i].Bones[k] >= 0 && skinningVertices[i].Bones[k] < (int)bonesCount)
+                boneWeights[skinningVertices[i].Bones[k]] += skinningVertices[i].Weights[k];
+        }
     }
 
-    assert(0);
+    reducedNodeCount = skeleton.Reduce(boneWeights, LOD_MIN_WEIGHT_SHARE, reducedSkeleton);
 
-    return 0;
+    reducedClips.resize(clips.size());
+    reducedClipChannels.resize(clips.size());
+    for (unsigned int i = 0; i < clips.size(); i++)
+    {
+        // library clips not bound yet get theirs when they are
+        if (clips[i])
+            bindReducedClip(i);
+    }
 }
 
-uint AnimatedModel::findRotation(float animationTime, const aiNodeAnim* nodeAnim)
+void AnimatedModel::bindReducedClip(unsigned int animation) const
 {
-    assert(nodeAnim->mNumRotationKeys > 0);
-
-    for (uint i = 0 ; i < nodeAnim->mNumRotationKeys - 1 ; i++)
+    std::vector<int> channels;
+    for (unsigned int n = 0; n < reducedNodeCount; n++)
     {
-        if (animationTime < (float)nodeAnim->mRotationKeys[i + 1].mTime)
-            return i;
+        int channel = clips[animation]->FindChannel(reducedSkeleton.NodeNames[n]);
+        if (channel >= 0)
+            channels.push_back(channel);
     }
+    reducedClips[animation] = clips[animation]->Subset(channels);
+    if (compressed)
+        reducedClips[animation].Compress(compression);
+    reducedClipChannels[animation] = reducedSkeleton.BindClip(reducedClips[animation]);
+}
 
-    assert(0);
-
-    return 0;
+unsigned int AnimatedModel::AddLibraryClip(ClipLibrary* library, const std::string& name)
+{
+    LibraryClip libraryClip;
+    libraryClip.Library = library;
+    libraryClip.Name = name;
+    libraryClip.Failed = false;
+
+    clips.push_back(AnimationClipPtr());
+    libraryClips.push_back(libraryClip);
+    clipChannels.push_back(ChannelMap());
+    reducedClips.push_back(AnimationClip());
+    reducedClipChannels.push_back(ChannelMap());
+    return (unsigned int)clips.size() - 1;
 }
 
-uint AnimatedModel::findScaling(float animationTime, const aiNodeAnim* nodeAnim)
+// The remap tables are built once per model and clip, so a shared clip costs a
+// model its channel maps and reduced copy, never the samples
+bool AnimatedModel::RequireClip(unsigned int animation) const
 {
-    assert(nodeAnim->mNumScalingKeys > 0);
+    if (animation >= clips.size())
+        return false;
+    if (libraryClips[animation].Library == nullptr)
+        return true;
+
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    LibraryClip& libraryClip = libraryClips[animation];
+    if (clips[animation])
+        return true;
+    if (libraryClip.Failed)
+        return false;
+
+    AnimationClipPtr clip = libraryClip.Library->Get(libraryClip.Name);
+    if (!clip)
+    {
+        libraryClip.Failed = true;
+        return false;
+    }
 
-    for (uint i = 0 ; i < nodeAnim->mNumScalingKeys - 1 ; i++)
+    ChannelMap channels = skeleton.BindClip(*clip);
+    unsigned int boundNodes = 0;
+    for (unsigned int n = 0; n < channels.size(); n++)
+        boundNodes += channels[n] >= 0;
+    if (boundNodes == 0)
     {
-        if (animationTime < (float)nodeAnim->mScalingKeys[i + 1].mTime)
-            return i;
+        std::cout << "ERROR::CLIP_LIBRARY: Clip " << libraryClip.Name << " animates no bone of the skeleton" << std::endl;
+        libraryClip.Failed = true;
+        return false;
     }
 
-    assert(0);
+    clipChannels[animation] = channels;
+    clips[animation] = clip;
+    bindReducedClip(animation);
+    return true;
+}
 
-    return 0;
+static glm::vec3 transformPoint(const Affine& transform, const glm::vec3& point)
+{
+    const float (*rows)[4] = transform.Rows;
+    return glm::vec3(rows[0][0] * point.x + rows[0][1] * point.y + rows[0][2] * point.z + rows[0][3],
+                     rows[1][0] * point.x + rows[1][1] * point.y + rows[1][2] * point.z + rows[1][3],
+                     rows[2][0] * point.x + rows[2][1] * point.y + rows[2][2] * point.z + rows[2][3]);
 }
 
-void AnimatedModel::calcInterpolatedPosition(aiVector3D& out, float animationTime, const aiNodeAnim* nodeAnim)
+void AnimatedModel::CompressClips(const ClipCompressionSettings& settings)
 {
-    if (nodeAnim->mNumPositionKeys == 1)
+    compressed = true;
+    compression = settings;
+    compressionStats.assign(clips.size(), ClipCompressionStats());
+
+    // the pose error is measured at the joints, where each bone sits in the bind pose
+    std::vector<glm::vec3> joints(bonesCount);
+    for (unsigned int b = 0; b < bonesCount; b++)
     {
-        out = nodeAnim->mPositionKeys[0].mValue;
-        return;
+        glm::mat4 bindPose = glm::inverse(skeleton.BoneOffsets[b]);
+        joints[b] = glm::vec3(bindPose[3][0], bindPose[3][1], bindPose[3][2]);
     }
 
-    uint positionIndex = findPosition(animationTime, nodeAnim);
-    uint nextPositionIndex = (positionIndex + 1);
-    assert(nextPositionIndex < nodeAnim->mNumPositionKeys);
-    float deltaTime = (float)(nodeAnim->mPositionKeys[nextPositionIndex].mTime - nodeAnim->mPositionKeys[positionIndex].mTime);
-    float factor = (animationTime - (float)nodeAnim->mPositionKeys[positionIndex].mTime) / deltaTime;
-    assert(factor >= 0.0f && factor <= 1.0f);
-    const aiVector3D& start = nodeAnim->mPositionKeys[positionIndex].mValue;
-    const aiVector3D& end = nodeAnim->mPositionKeys[nextPositionIndex].mValue;
-    aiVector3D delta = end - start;
-    out = start + factor * delta;
-}
-
-void AnimatedModel::calcInterpolatedRotation(aiQuaternion& out, float animationTime, const aiNodeAnim* nodeAnim)
-{
-    // we need at least two values to interpolate...
-    if (nodeAnim->mNumRotationKeys == 1)
+    PoseScratch scratch;
+    std::vector<Affine> bakedPalette(bonesCount), palette(bonesCount);
+    for (unsigned int i = 0; i < clips.size(); i++)
     {
-        out = nodeAnim->mRotationKeys[0].mValue;
-        return;
+        // library clips are compressed, or not, by their library
+        if (libraryClips[i].Library != nullptr)
+            continue;
+
+        const AnimationClip& baked = *clips[i];
+        std::shared_ptr<AnimationClip> clip = std::make_shared<AnimationClip>(baked);
+        clip->Compress(settings);
+        reducedClips[i].Compress(settings);
+
+        ClipCompressionStats& stats = compressionStats[i];
+        stats.BakedSize = baked.MemorySize();
+        stats.CompressedSize = clip->MemorySize();
+        stats.KeyCount = clip->Compressed.KeyCount();
+        stats.MaxPoseError = 0.0f;
+
+        for (unsigned int f = 0; f < baked.FrameCount; f++)
+        {
+            ClipFrame frame;
+            frame.Frame0 = f;
+            frame.Frame1 = f;
+            frame.Factor = 0.0f;
+            skeleton.Evaluate(baked, clipChannels[i], frame, scratch, bakedPalette.data());
+            skeleton.Evaluate(*clip, clipChannels[i], frame, scratch, palette.data());
+
+            for (unsigned int b = 0; b < bonesCount; b++)
+                stats.MaxPoseError = std::max(stats.MaxPoseError, glm::length(transformPoint(bakedPalette[b], joints[b]) - transformPoint(palette[b], joints[b])));
+        }
+        clips[i] = clip;
     }
+}
 
-    uint rotationIndex = findRotation(animationTime, nodeAnim);
-    uint nextRotationIndex = (rotationIndex + 1);
-    assert(nextRotationIndex < nodeAnim->mNumRotationKeys);
-    float deltaTime = (float)(nodeAnim->mRotationKeys[nextRotationIndex].mTime - nodeAnim->mRotationKeys[rotationIndex].mTime);
-    float factor = (animationTime - (float)nodeAnim->mRotationKeys[rotationIndex].mTime) / deltaTime;
-    assert(factor >= 0.0f && factor <= 1.0f);
-    const aiQuaternion& startRotationQ = nodeAnim->mRotationKeys[rotationIndex].mValue;
-    const aiQuaternion& endRotationQ   = nodeAnim->mRotationKeys[nextRotationIndex].mValue;
-    aiQuaternion::Interpolate(out, startRotationQ, endRotationQ, factor);
-    out = out.Normalize();
+void AnimatedModel::Pose(unsigned int animation, const ClipFrame& frame, bool reducedBones, PoseScratch& scratch, Affine* out) const
+{
+    if (reducedBones)
+        reducedSkeleton.Evaluate(reducedClips[animation], reducedClipChannels[animation], frame, scratch, out);
+    else
+        skeleton.Evaluate(*clips[animation], clipChannels[animation], frame, scratch, out);
 }
 
-void AnimatedModel::calcInterpolatedScaling(aiVector3D& out, float animationTime, const aiNodeAnim* nodeAnim)
+void AnimatedModel::Draw(Shader shader) const
 {
-    if (nodeAnim->mNumScalingKeys == 1)
-    {
-        out = nodeAnim->mScalingKeys[0].mValue;
-        return;
-    }
+    if (HasAnimations())
+        shader.SetInteger("animated", 1);
 
-    uint scalingIndex = findScaling(animationTime, nodeAnim);
-    uint nextScalingIndex = (scalingIndex + 1);
-    assert(nextScalingIndex < nodeAnim->mNumScalingKeys);
-    float deltaTime = (float)(nodeAnim->mScalingKeys[nextScalingIndex].mTime - nodeAnim->mScalingKeys[scalingIndex].mTime);
-    float factor = (animationTime - (float)nodeAnim->mScalingKeys[scalingIndex].mTime) / deltaTime;
-    assert(factor >= 0.0f && factor <= 1.0f);
-    const aiVector3D& start = nodeAnim->mScalingKeys[scalingIndex].mValue;
-    const aiVector3D& end   = nodeAnim->mScalingKeys[nextScalingIndex].mValue;
-    aiVector3D delta = end - start;
-    out = start + factor * delta;
+    GlState::BindVertexArray(VAO);
+    drawMeshes(shader);
+
+    if (HasAnimations())
+        shader.SetInteger("animated", 0);
 }
 
-void AnimatedModel::readNodeHeirarchy(float animationTime, const aiNode* node, const glm::mat4& parentTransform)
+void AnimatedModel::DrawInstanced(Shader shader, GLsizei instanceCount) const
 {
-    std::string nodeName(node->mName.data);
-
-    const aiAnimation* animation = scene->mAnimations[currentAnimation];
+    shader.SetInteger("animated", 1);
+    shader.SetInteger("instanced", 1);
 
-    glm::mat4 nodeTransformation = mat4Convert(node->mTransformation);
+    GlState::BindVertexArray(VAO);
+    drawMeshes(shader, instanceCount);
 
-    const aiNodeAnim* nodeAnim = findNodeAnim(animation, nodeName);
+    shader.SetInteger("instanced", 0);
+    shader.SetInteger("animated", 0);
+}
 
-    if (nodeAnim)
-    {
-        // Interpolate scaling and generate scaling transformation matrix
-        aiVector3D scaling;
-        calcInterpolatedScaling(scaling, animationTime, nodeAnim);
-        glm::vec3 scale = glm::vec3(scaling.x, scaling.y, scaling.z);
-        glm::mat4 scalingM = glm::scale(glm::mat4(1.0f), scale);
-
-        // Interpolate rotation and generate rotation transformation matrix
-        aiQuaternion rotationQ;
-        calcInterpolatedRotation(rotationQ, animationTime, nodeAnim);
-        glm::quat rotate = quatConvert(rotationQ);
-        glm::mat4 rotationM = glm::toMat4(rotate);
-
-        // Interpolate translation and generate translation transformation matrix
-        aiVector3D translation;
-        calcInterpolatedPosition(translation, animationTime, nodeAnim);
-        glm::vec3 translate = glm::vec3(translation.x, translation.y, translation.z);
-        glm::mat4 translationM = glm::translate(glm::mat4(1.0f), translate);
-
-        // Combine the above transformations
-        nodeTransformation = translationM * rotationM * scalingM;
-    }
+void AnimatedModel::DrawSkinned(Shader shader, GLuint skinnedVertexArray) const
+{
+    GlState::BindVertexArray(skinnedVertexArray);
+    drawMeshes(shader);
+}
 
-    // Combine with node Transformation with Parent Transformation
-    glm::mat4 globalTransformation = parentTransform * nodeTransformation;
+GLuint AnimatedModel::CreateSkinnedVertexArray(GLuint skinnedVBO) const
+{
+    GLuint vertexArray;
+    glGenVertexArrays(1, &vertexArray);
+    GlState::BindVertexArray(vertexArray);
 
-    if (boneMapping.find(nodeName) != boneMapping.end())
-    {
-        uint boneIndex = boneMapping[nodeName];
-        boneMatrices[boneIndex].FinalTransformation = globalInverseTransform * globalTransformation * boneMatrices[boneIndex].BoneOffset;
-    }
+    // positions and normals come from the skinned vertices
+    glBindBuffer(GL_ARRAY_BUFFER, skinnedVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, Position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, Normal));
+    // texture coords and indices are shared with the model
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, TexCoords));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 
-    for (uint i = 0 ; i < node->mNumChildren ; i++)
-        readNodeHeirarchy(animationTime, node->mChildren[i], globalTransformation);
+    GlState::BindVertexArray(0);
+    return vertexArray;
 }
 
-const aiNodeAnim* AnimatedModel::findNodeAnim(const aiAnimation* animation, const std::string nodeName)
+void AnimatedModel::drawMeshes(Shader shader, GLsizei instanceCount) const
 {
-    for (uint i = 0 ; i < animation->mNumChannels ; i++) {
-        const aiNodeAnim* nodeAnim = animation->mChannels[i];
-
-        if (std::string(nodeAnim->mNodeName.data) == nodeName)
-            return nodeAnim;
+    // bind appropriate textures, every mesh draws with all of them
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        // a lookup of the hash, nothing is uploaded once the sampler holds the unit
+        shader.SetInteger(textures[i].Sampler, i);
+        GlState::BindTexture(i, GL_TEXTURE_2D, textures[i].ID);
     }
 
-    return NULL;
+    for (unsigned int i = 0 ; i < meshes.size() ; i++)
+    {
+        if (instanceCount > 1)
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES,
+                                              meshes[i].IndicesCount,
+                                              GL_UNSIGNED_INT,
+                                              (void*)(sizeof(unsigned int) * meshes[i].BaseIndex),
+                                              instanceCount,
+                                              meshes[i].BaseVertex);
+        else
+            glDrawElementsBaseVertex(GL_TRIANGLES,
+                                     meshes[i].IndicesCount,
+                                     GL_UNSIGNED_INT,
+                                     (void*)(sizeof(unsigned int) * meshes[i].BaseIndex),
+                                     meshes[i].BaseVertex);
+    }
 }
 
-// checks all material textures of a given type and loads the textures if they're not loaded yet.
-// the required info is returned as a Texture struct.
-std::vector<AnimatedModel::Texture> AnimatedModel::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+void AnimatedModel::loadTextures(const std::vector<ModelTexture>& materialTextures)
 {
-    std::vector<Texture> texs;
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    TextureCache& cache = getTextureCache();
+    // the N of each type's samplers, as in texture_diffuseN
+    unsigned int diffuseNr  = 1;
+    unsigned int specularNr = 1;
+    unsigned int normalNr   = 1;
+    unsigned int emissionNr = 1;
+    for (unsigned int i = 0; i < materialTextures.size(); i++)
     {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-        // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for (unsigned int j = 0; j < loadedTextures.size(); j++)
+        // the units above are the engine's own
+        if (textures.size() == (size_t)MATERIAL_TEXTURE_UNITS)
         {
-            if (strcmp(loadedTextures[j].Path.data(), str.C_Str()) == 0)
-            {
-                texs.push_back(loadedTextures[j]);
-                skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                break;
-            }
-        }
-        if (!skip)
-        {   // if texture hasn't been loaded already, load it
-            Texture texture;
-            texture.ID = textureFromFile(str.C_Str(), this->directory);
-            texture.Type = typeName;
-            texture.Path = str.C_Str();
-            texs.push_back(texture);
-            loadedTextures.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+            std::cout << "ERROR::MODEL: More than " << MATERIAL_TEXTURE_UNITS << " textures, " << materialTextures[i].Path << " is left out" << std::endl;
+            continue;
         }
+
+        std::string number;
+        const std::string& type = materialTextures[i].Type;
+        if (type == "texture_diffuse")
+            number = std::to_string(diffuseNr++);
+        else if (type == "texture_specular")
+            number = std::to_string(specularNr++);
+        else if (type == "texture_normal")
+            number = std::to_string(normalNr++);
+        else if (type == "texture_emission")
+            number = std::to_string(emissionNr++);
+
+        Texture texture(type, materialTextures[i].Path, type + number);
+        // the cache reads each image once, whichever path or model it comes from
+        texture.Cached = cache.Acquire(this->directory + '/' + texture.Path);
+        textures.push_back(texture);
     }
-    return texs;
 }
 
-unsigned int AnimatedModel::textureFromFile(const char* filename, const std::string& directory, bool /* gamma */)
+TextureCache& AnimatedModel::getTextureCache()
 {
-    std::string path = std::string(filename);
-    path = directory + '/' + path;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-        else
-            format = GL_RED;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-        stbi_image_free(data);
-    }
-    else
+    if (textureCache == nullptr)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        ownTextureCache.reset(new TextureCache());
+        textureCache = ownTextureCache.get();
     }
-
-    return textureID;
+    return *textureCache;
 }
\ No newline at end of file
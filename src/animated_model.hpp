@@ -2,9 +2,11 @@
 #define ANIMATED_MODEL_H
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 
 #include <glad/glad.h>
 
@@ -12,125 +14,201 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 
-#include <stb_image.h>
-
-#include <assimp/scene.h>
-
 #include "utils.hpp"
 #include "shader.hpp"
+#include "animation_clip.hpp"
+#include "clip_library.hpp"
+#include "cooked_model.hpp"
+#include "model_data.hpp"
+#include "skeleton.hpp"
+#include "palette_texture.hpp"
+#include "hitbox_set.hpp"
+#include "texture.hpp"
+#include "texture_cache.hpp"
+
+// Subtrees carrying less than this share of the skin weight are left out of the
+// reduced skeleton that far animation LOD tiers evaluate
+const float LOD_MIN_WEIGHT_SHARE = 0.02f;
+
+// What compressing the clips of a model cost and saved, one entry per clip
+struct ClipCompressionStats
+{
+    size_t BakedSize;
+    size_t CompressedSize;
+    unsigned int KeyCount;
+    // largest distance between a joint posed from the baked and from the compressed
+    // clip over every frame, in model units
+    float MaxPoseError;
+};
 
-// For converting between ASSIMP and glm
-static inline glm::vec3 vec3Convert(const aiVector3D& vector) { return glm::vec3(vector.x, vector.y, vector.z); }
-static inline glm::vec2 vec2Convert(const aiVector3D& vector) { return glm::vec2(vector.x, vector.y); }
-static inline glm::quat quatConvert(const aiQuaternion& quaternion) { return glm::quat(quaternion.w, quaternion.x, quaternion.y, quaternion.z); }
-static inline glm::mat4 mat4Convert(const aiMatrix4x4& matrix) { return glm::transpose(glm::make_mat4(&matrix.a1)); }
-static inline glm::mat4 mat4Convert(const aiMatrix3x3& matrix) { return glm::transpose(glm::make_mat3(&matrix.a1)); }
-
+// Read-only model asset: meshes, GPU buffers, textures, skeleton and baked clips.
+// It holds no playback state, so one loaded model is shared by every
+// AnimationInstance that uses it.
 class AnimatedModel
 {
     public:
         AnimatedModel();
         ~AnimatedModel() {};
 
-        void InitFromScene(const aiScene* scene);
-
-        void Draw(Shader shader);
-
-        void SetAnimation(unsigned int animation);
-        void SetBoneTransformations(Shader shader, GLfloat currentTime);
+        AnimatedModel(const AnimatedModel&) = delete;
+        AnimatedModel& operator=(const AnimatedModel&) = delete;
+
+        // Uploads imported model data, the caller can free it afterwards
+        void InitFromData(const ModelData& data);
+        // Uploads the vertex and index buffers straight from the mapped file, false when
+        // the cooked model is not open
+        bool InitFromCooked(const CookedModel& cooked);
+        // The two halves of InitFromData and InitFromCooked, for loading off the GL thread.
+        // Prepare does the CPU work on any thread: skeleton, clips, baked palettes, hitboxes
+        // and the texture files decoded. Upload then creates the GL objects on the GL
+        // thread; a cooked model has to stay open until then, the vertices are read from it
+        void PrepareFromData(const ModelData& data);
+        bool PrepareFromCooked(const CookedModel& cooked);
+        void Upload();
+        bool IsUploaded() const { return VAO != 0; }
+        // bytes Upload sends to the GPU
+        size_t UploadSize() const;
+        // Deletes the buffers and textures Upload made, on the GL thread. The model cannot
+        // be drawn afterwards
+        void Release();
+        // Bytes the model keeps in main memory (clips of the model file, palettes,
+        // skinning vertices and hitboxes) and on the GPU since Upload. The material
+        // textures are counted by the texture cache, they may be shared
+        size_t MemorySize() const;
+        size_t GpuMemorySize() const { return gpuSize; }
+        // Sets the skeleton and clips directly, binding every clip to the skeleton
+        void InitSkeleton(const Skeleton& skeleton, const std::vector<AnimationClip>& clips);
+        // Compresses every clip of the model file, done once after loading
+        void CompressClips(const ClipCompressionSettings& settings);
+        // Appends a clip of the library as the next animation. It is read and bound to the
+        // skeleton the first time RequireClip asks for it, returns its animation index
+        unsigned int AddLibraryClip(ClipLibrary* library, const std::string& name);
+        // Thread safe. Loads and binds a library clip if that was not done yet, false when
+        // it cannot be played on this model. The clips of the model file are always ready
+        bool RequireClip(unsigned int animation) const;
+        // Poses a frame of a clip on the full or the reduced skeleton into BonesCount() matrices,
+        // both skeletons take the frames of GetClip
+        void Pose(unsigned int animation, const ClipFrame& frame, bool reducedBones, PoseScratch& scratch, Affine* out) const;
+
+        void Draw(Shader shader) const;
+        // One instanced draw per mesh, the instance data comes from the bound CrowdBuffer
+        void DrawInstanced(Shader shader, GLsizei instanceCount) const;
+        // Draws vertices skinned on the CPU through the non-animated shader path
+        void DrawSkinned(Shader shader, GLuint skinnedVertexArray) const;
+        // A VAO reading positions and normals from skinnedVBO (SkinnedVertex layout) and
+        // everything else from the model buffers, owned by the caller
+        GLuint CreateSkinnedVertexArray(GLuint skinnedVBO) const;
+        // Bind pose vertex data for CPU skinning, set when the model data is uploaded. The
+        // weights also decide which bones the reduced skeleton keeps and shape the hitboxes
+        void InitSkinningVertices(const std::vector<SkinningVertex>& vertices);
 
         unsigned int BonesCount() const { return bonesCount; }
-        bool HasAnimations() { return scene->HasAnimations(); }
-        unsigned int GetNumAnimations() { return scene->mNumAnimations; }
+        unsigned int VertexCount() const { return (unsigned int)skinningVertices.size(); }
+        unsigned int MeshCount() const { return (unsigned int)meshes.size(); }
+        // material textures, a draw binds them from unit 0 up, at most MATERIAL_TEXTURE_UNITS
+        unsigned int TextureCount() const { return (unsigned int)textures.size(); }
+        bool HasAnimations() const { return !clips.empty(); }
+        unsigned int GetNumAnimations() const { return (unsigned int)clips.size(); }
         void SetDirectory(std::string directory) { this->directory = directory; }
+        // Where Prepare gets the material textures, shared with other models. Without
+        // one the model keeps a cache of its own, set before Prepare
+        void SetTextureCache(TextureCache* cache) { textureCache = cache; }
+
+        const Skeleton& GetSkeleton() const { return skeleton; }
+        // library clips only once RequireClip succeeded
+        const AnimationClip& GetClip(unsigned int animation) const { return *clips[animation]; }
+        const ChannelMap& GetClipChannels(unsigned int animation) const { return clipChannels[animation]; }
+        // The skeleton and clips of far LOD tiers, same bones with fewer animated nodes
+        const Skeleton& GetReducedSkeleton() const { return reducedSkeleton; }
+        const AnimationClip& GetReducedClip(unsigned int animation) const { return reducedClips[animation]; }
+        const ChannelMap& GetReducedClipChannels(unsigned int animation) const { return reducedClipChannels[animation]; }
+        unsigned int ReducedNodeCount() const { return reducedNodeCount; }
+        // empty unless the clips were compressed
+        const std::vector<ClipCompressionStats>& GetCompressionStats() const { return compressionStats; }
+        // Every clip of the model file posed at load time, for characters animated on the GPU alone
+        const PaletteTexture& GetBakedPalettes() const { return bakedPalettes; }
+        const std::vector<SkinningVertex>& GetSkinningVertices() const { return skinningVertices; }
+        // one capsule per bone that carries enough vertices, fitted with the skinning vertices
+        const std::vector<BoneCapsule>& GetHitboxes() const { return hitboxes; }
 
     private:
-        #define INVALID_MATERIAL 0xFFFFFFFF
         #define NUM_BONES_PER_VERTEX 4
 
-        struct Vertex
-        {
-            glm::vec3 Position;
-            glm::vec3 Normal;
-            glm::vec2 TexCoords;
-            glm::ivec4 BoneIDs;
-            glm::vec4 BoneWeights;
-        };
-
         struct Texture
         {
             unsigned int ID;
             std::string Type;
             std::string Path;
-        };
+            CachedTexturePtr Cached;
+            // the sampler uniform it is bound to, resolved once when it is loaded
+            UniformName Sampler;
 
-        struct BoneMatrix
-        {
-            glm::mat4 BoneOffset;
-            glm::mat4 FinalTransformation;
-
-            BoneMatrix()
-            {
-                BoneOffset = glm::mat4(0.0f);
-                FinalTransformation = glm::mat4(0.0f);
-            }
+            Texture(const std::string& type, const std::string& path, const std::string& sampler) :
+                ID(0), Type(type), Path(path), Sampler(sampler) {}
         };
 
-        struct Mesh {
-            Mesh()
-            {
-                IndicesCount  = 0;
-                BaseVertex    = 0;
-                BaseIndex     = 0;
-                MaterialIndex = INVALID_MATERIAL;
-            }
-
-            unsigned int BaseVertex;
-            unsigned int BaseIndex;
-            unsigned int IndicesCount;
-            unsigned int MaterialIndex;
+        struct LibraryClip
+        {
+            ClipLibrary* Library;
+            std::string Name;
+            bool Failed;
         };
 
-        const aiScene* scene;
-        glm::mat4 globalInverseTransform;
-        // duration of the animation, can be changed if frames are not present in all interval
-        double animDuration;
-        unsigned int currentAnimation;
+        // animations resampled at load time, one per scene animation, then the clips added
+        // from a library. The per-clip data of those is filled in by RequireClip, mutable
+        // so a shared model can bind them lazily; the vectors never grow after loading
+        mutable std::vector<AnimationClipPtr> clips;
+        // Library null for the clips of the model file
+        mutable std::vector<LibraryClip> libraryClips;
+        mutable std::mutex libraryMutex;
+        // bone hierarchy flattened at load and the node to channel map of every clip, the
+        // bone remap table that binds a clip to this skeleton
+        Skeleton skeleton;
+        mutable std::vector<ChannelMap> clipChannels;
+        // generated at load from the skin weights
+        Skeleton reducedSkeleton;
+        mutable std::vector<AnimationClip> reducedClips;
+        mutable std::vector<ChannelMap> reducedClipChannels;
+        unsigned int reducedNodeCount;
+        bool compressed;
+        ClipCompressionSettings compression;
+        std::vector<ClipCompressionStats> compressionStats;
+        PaletteTexture bakedPalettes;
+        std::vector<SkinningVertex> skinningVertices;
+        std::vector<BoneCapsule> hitboxes;
 
         std::string directory;
-        std::vector<Mesh> meshes;
+        std::vector<ModelSubmesh> meshes;
+        // one per material texture, those of the same image share its cached texture
         std::vector<Texture> textures;
-        // stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
-        std::vector<Texture> loadedTextures;
+        TextureCache* textureCache;
+        std::unique_ptr<TextureCache> ownTextureCache;
+
+        // what Prepare left for Upload. The geometry points into the cooked file or the
+        // copies below, the textures wait in the texture cache
+        const ModelVertex* pendingVertices;
+        unsigned int pendingVertexCount;
+        const unsigned int* pendingIndices;
+        unsigned int pendingIndexCount;
+        std::vector<ModelVertex> preparedVertices;
+        std::vector<unsigned int> preparedIndices;
 
         unsigned int bonesCount = 0;
-        std::map<std::string, unsigned int> boneMapping;
-        std::vector<BoneMatrix> boneMatrices;
 
         GLuint VAO, VBO, EBO;
-
-        void processMesh(unsigned int meshIndex,
-                         const aiMesh* mesh,
-                         std::vector<Vertex>& vertices,
-                         std::vector<unsigned int>& indices,
-                         std::vector<Texture>& textures);
-        void boneTransform(float timeInSeconds, std::vector<glm::mat4>& transforms);
-
-        unsigned int findPosition(float animationTime, const aiNodeAnim* nodeAnim);
-        unsigned int findRotation(float animationTime, const aiNodeAnim* nodeAnim);
-        unsigned int findScaling(float animationTime, const aiNodeAnim* nodeAnim);
-
-        void calcInterpolatedPosition(aiVector3D& out, float animationTime, const aiNodeAnim* nodeAnim);
-        void calcInterpolatedRotation(aiQuaternion& out, float animationTime, const aiNodeAnim* nodeAnim);
-        void calcInterpolatedScaling(aiVector3D& out, float animationTime, const aiNodeAnim* nodeAnim);
-
-        void readNodeHeirarchy(float animationTime, const aiNode* node, const glm::mat4& parentTransform);
-        const aiNodeAnim* findNodeAnim(const aiAnimation* animation, const std::string nodeName);
-
-        // checks all material textures of a given type and loads the textures if they're not loaded yet.
-        // the required info is returned as a Texture struct.
-        std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
-        unsigned int textureFromFile(const char* filename, const std::string& directory, bool gamma = false);
+        size_t gpuSize;
+
+        void drawMeshes(Shader shader, GLsizei instanceCount = 1) const;
+        void buildReducedSkeleton();
+        void bindReducedClip(unsigned int animation) const;
+        void initAnimations(const Skeleton& skeleton, const std::vector<AnimationClip>& clips);
+        void initGeometry(const ModelVertex* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+        // acquires the textures of the submeshes from the texture cache
+        void loadTextures(const std::vector<ModelTexture>& materialTextures);
+        TextureCache& getTextureCache();
 };
 
+// Shared, refcounted handle to a loaded model
+typedef std::shared_ptr<const AnimatedModel> AnimatedModelPtr;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "animation_clip.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+#include <assimp/scene.h>
+#endif
+
+AnimationClip::AnimationClip() : Duration(0.0f), SampleRate(CLIP_SAMPLE_RATE), FrameCount(0), ChannelCount(0), ChannelStride(0)
+{
+}
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+void AnimationClip::Bake(const aiAnimation* animation, float sampleRate)
+{
+    Name = animation->mName.C_Str();
+    SampleRate = sampleRate;
+
+    double ticksPerSecond = animation->mTicksPerSecond != 0 ? animation->mTicksPerSecond : 25.0;
+
+    // The duration is taken from the last position key of the first channel, as the
+    // declared mDuration is not reliable for every exporter
+    double durationInTicks = animation->mDuration;
+    if (animation->mNumChannels > 0 && animation->mChannels[0]->mNumPositionKeys > 0)
+    {
+        const aiNodeAnim* firstChannel = animation->mChannels[0];
+        durationInTicks = firstChannel->mPositionKeys[firstChannel->mNumPositionKeys - 1].mTime;
+    }
+    Duration = (float)(durationInTicks / ticksPerSecond);
+
+    // One sample every 1/sampleRate seconds, plus the closing sample at the very end
+    Resize((unsigned int)std::ceil(Duration * SampleRate) + 1, animation->mNumChannels);
+
+    for (unsigned int c = 0; c < ChannelCount; c++)
+    {
+        ChannelNames[c] = animation->mChannels[c]->mNodeName.C_Str();
+        bakeChannel(c, animation->mChannels[c], ticksPerSecond);
+    }
+}
+#endif
+
+void AnimationClip::Resize(unsigned int frameCount, unsigned int channelCount)
+{
+    FrameCount = frameCount;
+    ChannelCount = channelCount;
+    ChannelStride = (channelCount + CLIP_CHANNEL_ALIGNMENT - 1) / CLIP_CHANNEL_ALIGNMENT * CLIP_CHANNEL_ALIGNMENT;
+
+    ChannelNames.resize(ChannelCount);
+    Samples.assign(FrameCount * CLIP_COMPONENTS * ChannelStride, 0.0f);
+
+    // padding lanes included, so the kernels never normalise a zero quaternion
+    for (unsigned int f = 0; f < FrameCount; f++)
+    {
+        std::fill_n(&Samples[(f * CLIP_COMPONENTS + CLIP_RW) * ChannelStride], ChannelStride, 1.0f);
+        std::fill_n(&Samples[(f * CLIP_COMPONENTS + CLIP_SX) * ChannelStride], 3 * ChannelStride, 1.0f);
+    }
+}
+
+void AnimationClip::SetSample(unsigned int frame, unsigned int channel, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    float* sample = &Samples[frame * CLIP_COMPONENTS * ChannelStride + channel];
+    sample[CLIP_TX * ChannelStride] = translation.x;
+    sample[CLIP_TY * ChannelStride] = translation.y;
+    sample[CLIP_TZ * ChannelStride] = translation.z;
+    sample[CLIP_RX * ChannelStride] = rotation.x;
+    sample[CLIP_RY * ChannelStride] = rotation.y;
+    sample[CLIP_RZ * ChannelStride] = rotation.z;
+    sample[CLIP_RW * ChannelStride] = rotation.w;
+    sample[CLIP_SX * ChannelStride] = scale.x;
+    sample[CLIP_SY * ChannelStride] = scale.y;
+    sample[CLIP_SZ * ChannelStride] = scale.z;
+}
+
+void AnimationClip::GetSample(unsigned int frame, unsigned int channel, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const
+{
+    if (IsCompressed())
+    {
+        Compressed.DecompressSample(frame, channel, translation, rotation, scale);
+        return;
+    }
+
+    const float* sample = &Samples[frame * CLIP_COMPONENTS * ChannelStride + channel];
+    translation = glm::vec3(sample[CLIP_TX * ChannelStride], sample[CLIP_TY * ChannelStride], sample[CLIP_TZ * ChannelStride]);
+    rotation = glm::quat(sample[CLIP_RW * ChannelStride], sample[CLIP_RX * ChannelStride], sample[CLIP_RY * ChannelStride], sample[CLIP_RZ * ChannelStride]);
+    scale = glm::vec3(sample[CLIP_SX * ChannelStride], sample[CLIP_SY * ChannelStride], sample[CLIP_SZ * ChannelStride]);
+}
+
+AnimationClip AnimationClip::Subset(const std::vector<int>& channels) const
+{
+    AnimationClip subset;
+    subset.Name = Name;
+    subset.Duration = Duration;
+    subset.SampleRate = SampleRate;
+    subset.Resize(FrameCount, (unsigned int)channels.size());
+
+    for (unsigned int c = 0; c < channels.size(); c++)
+    {
+        subset.ChannelNames[c] = ChannelNames[channels[c]];
+        for (unsigned int f = 0; f < FrameCount; f++)
+        {
+            glm::vec3 translation, scale;
+            glm::quat rotation;
+            GetSample(f, channels[c], translation, rotation, scale);
+            subset.SetSample(f, c, translation, rotation, scale);
+        }
+    }
+
+    return subset;
+}
+
+void AnimationClip::Compress(const ClipCompressionSettings& settings)
+{
+    // key frames are stored in 16 bits
+    if (IsCompressed() || FrameCount == 0 || FrameCount > 65536)
+        return;
+
+    std::vector<float> tolerances(ChannelCount, settings.Tolerance);
+    for (unsigned int c = 0; c < ChannelCount; c++)
+    {
+        std::map<std::string, float>::const_iterator tolerance = settings.ChannelTolerances.find(ChannelNames[c]);
+        if (tolerance != settings.ChannelTolerances.end())
+            tolerances[c] = tolerance->second;
+    }
+
+    Compressed.Compress(FrameCount, ChannelCount, ChannelStride, Samples.data(), tolerances, settings.Reach);
+    std::vector<float>().swap(Samples);
+}
+
+size_t AnimationClip::MemorySize() const
+{
+    return IsCompressed() ? Compressed.MemorySize() : Samples.capacity() * sizeof(float);
+}
+
+ClipFrame AnimationClip::FrameAt(float timeInSeconds) const
+{
+    ClipFrame frame;
+    frame.Frame0 = 0;
+    frame.Frame1 = 0;
+    frame.Factor = 0.0f;
+
+    if (FrameCount < 2 || Duration <= 0.0f)
+        return frame;
+
+    float position = std::fmod(timeInSeconds, Duration) * SampleRate;
+    if (position < 0.0f)
+        position += Duration * SampleRate;
+
+    frame.Frame0 = (unsigned int)position;
+    if (frame.Frame0 > FrameCount - 2)
+        frame.Frame0 = FrameCount - 2;
+    frame.Frame1 = frame.Frame0 + 1;
+    frame.Factor = glm::clamp(position - (float)frame.Frame0, 0.0f, 1.0f);
+
+    return frame;
+}
+
+void AnimationClip::SampleChannel(const ClipFrame& frame, unsigned int channel, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const
+{
+    glm::vec3 translation0, translation1, scale0, scale1;
+    glm::quat rotation0, rotation1;
+    GetSample(frame.Frame0, channel, translation0, rotation0, scale0);
+    GetSample(frame.Frame1, channel, translation1, rotation1, scale1);
+
+    translation = glm::mix(translation0, translation1, frame.Factor);
+    rotation = glm::normalize(glm::slerp(rotation0, rotation1, frame.Factor));
+    scale = glm::mix(scale0, scale1, frame.Factor);
+}
+
+int AnimationClip::FindChannel(const std::string& name) const
+{
+    for (unsigned int c = 0; c < ChannelCount; c++)
+    {
+        if (ChannelNames[c] == name)
+            return c;
+    }
+
+    return -1;
+}
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+// Resample one assimp channel at the clip rate. Sample times only ever grow, so each
+// key array is walked once with a cursor instead of searched for every sample.
+void AnimationClip::bakeChannel(unsigned int channel, const aiNodeAnim* nodeAnim, double ticksPerSecond)
+{
+    unsigned int positionKey = 0, rotationKey = 0, scalingKey = 0;
+    glm::quat previousRotation;
+
+    for (unsigned int f = 0; f < FrameCount; f++)
+    {
+        double time = std::min((double)f / SampleRate, (double)Duration) * ticksPerSecond;
+
+        // translation
+        const aiVectorKey* positionKeys = nodeAnim->mPositionKeys;
+        while (positionKey + 1 < nodeAnim->mNumPositionKeys && positionKeys[positionKey + 1].mTime <= time)
+            positionKey++;
+        aiVector3D position = positionKeys[positionKey].mValue;
+        if (positionKey + 1 < nodeAnim->mNumPositionKeys && time > positionKeys[positionKey].mTime)
+        {
+            float factor = (float)((time - positionKeys[positionKey].mTime) / (positionKeys[positionKey + 1].mTime - positionKeys[positionKey].mTime));
+            position = position + factor * (positionKeys[positionKey + 1].mValue - position);
+        }
+
+        // rotation
+        const aiQuatKey* rotationKeys = nodeAnim->mRotationKeys;
+        while (rotationKey + 1 < nodeAnim->mNumRotationKeys && rotationKeys[rotationKey + 1].mTime <= time)
+            rotationKey++;
+        aiQuaternion rotation = rotationKeys[rotationKey].mValue;
+        if (rotationKey + 1 < nodeAnim->mNumRotationKeys && time > rotationKeys[rotationKey].mTime)
+        {
+            float factor = (float)((time - rotationKeys[rotationKey].mTime) / (rotationKeys[rotationKey + 1].mTime - rotationKeys[rotationKey].mTime));
+            aiQuaternion::Interpolate(rotation, rotationKeys[rotationKey].mValue, rotationKeys[rotationKey + 1].mValue, factor);
+        }
+        rotation.Normalize();
+        glm::quat q = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+        // keep consecutive samples in the same hemisphere so the runtime blend takes the short path
+        if (f > 0 && glm::dot(q, previousRotation) < 0.0f)
+            q = -q;
+        previousRotation = q;
+
+        // scaling
+        const aiVectorKey* scalingKeys = nodeAnim->mScalingKeys;
+        while (scalingKey + 1 < nodeAnim->mNumScalingKeys && scalingKeys[scalingKey + 1].mTime <= time)
+            scalingKey++;
+        aiVector3D scaling = scalingKeys[scalingKey].mValue;
+        if (scalingKey + 1 < nodeAnim->mNumScalingKeys && time > scalingKeys[scalingKey].mTime)
+        {
+            float factor = (float)((time - scalingKeys[scalingKey].mTime) / (scalingKeys[scalingKey + 1].mTime - scalingKeys[scalingKey].mTime));
+            scaling = scaling + factor * (scalingKeys[scalingKey + 1].mValue - scaling);
+        }
+
+        SetSample(f, channel, glm::vec3(position.x, position.y, position.z), q, glm::vec3(scaling.x, scaling.y, scaling.z));
+    }
+}
+#endif
@@ -0,0 +1,95 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "pose_kernels.hpp"
+#include "compressed_clip.hpp"
+
+struct aiAnimation;
+struct aiNodeAnim;
+
+// Default resampling rate (samples per second of clip time) used when baking clips
+const float CLIP_SAMPLE_RATE = 30.0f;
+// Channels are stored in planes padded to a multiple of this many lanes
+const unsigned int CLIP_CHANNEL_ALIGNMENT = POSE_KERNEL_WIDTH;
+
+// Components of a channel sample, each one stored in its own plane
+enum ClipComponent
+{
+    CLIP_TX, CLIP_TY, CLIP_TZ,
+    CLIP_RX, CLIP_RY, CLIP_RZ, CLIP_RW,
+    CLIP_SX, CLIP_SY, CLIP_SZ,
+    CLIP_COMPONENTS
+};
+
+// A pair of neighbouring baked frames and the blend factor between them
+struct ClipFrame
+{
+    unsigned int Frame0;
+    unsigned int Frame1;
+    float Factor;
+};
+
+// An animation resampled at load time to a fixed rate. Every channel has exactly
+// FrameCount samples, so sampling is a direct index into two frames plus a blend
+// instead of a search through assimp keys. Samples are stored frame-major and, within
+// a frame, one plane per component holding that component for every channel, so the
+// pose kernels can blend all channels of a frame with straight vector loads.
+class AnimationClip
+{
+    public:
+        std::string Name;
+        // duration of the clip in seconds
+        float Duration;
+        // number of samples per second of clip time
+        float SampleRate;
+        unsigned int FrameCount;
+        unsigned int ChannelCount;
+        // ChannelCount rounded up to CLIP_CHANNEL_ALIGNMENT, padding lanes hold the identity
+        unsigned int ChannelStride;
+
+        std::vector<std::string> ChannelNames;
+        // component k of channel c at frame f lives at (f * CLIP_COMPONENTS + k) * ChannelStride + c,
+        // empty once the clip is compressed
+        std::vector<float> Samples;
+        CompressedClip Compressed;
+
+        AnimationClip();
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+        void Bake(const aiAnimation* animation, float sampleRate = CLIP_SAMPLE_RATE);
+#endif
+        // Allocates identity samples, used by Bake and to build clips procedurally
+        void Resize(unsigned int frameCount, unsigned int channelCount);
+
+        void SetSample(unsigned int frame, unsigned int channel, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+        void GetSample(unsigned int frame, unsigned int channel, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const;
+        // A copy holding only the given channels, in that order, always uncompressed
+        AnimationClip Subset(const std::vector<int>& channels) const;
+        // ChannelStride values of one component at one frame, uncompressed clips only
+        const float* Plane(unsigned int frame, unsigned int component) const { return &Samples[(frame * CLIP_COMPONENTS + component) * ChannelStride]; }
+
+        // Replaces the samples with their compressed form, sampling and posing keep working
+        void Compress(const ClipCompressionSettings& settings);
+        bool IsCompressed() const { return !Compressed.Empty(); }
+        // bytes held by the samples in their current form
+        size_t MemorySize() const;
+
+        ClipFrame FrameAt(float timeInSeconds) const;
+        // Scalar reference path, the pose evaluation blends whole frames with the pose kernels instead
+        void SampleChannel(const ClipFrame& frame, unsigned int channel, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const;
+
+        int FindChannel(const std::string& name) const;
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+    private:
+        void bakeChannel(unsigned int channel, const aiNodeAnim* nodeAnim, double ticksPerSecond);
+#endif
+};
+
+#endif
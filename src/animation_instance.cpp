@@ -0,0 +1,181 @@
+#include "animation_instance.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gl_state.hpp"
+
+AnimationInstance::AnimationInstance(AnimatedModelPtr model) :
+    TimeScale(1.0f),
+    Position(0.0f),
+    BoundingRadius(1.0f),
+    model(model),
+    currentAnimation(0),
+    hasClip(model->RequireClip(0)),
+    time(0.0f),
+    posedAnimation(-1),
+    interpolating(false),
+    intervalStart(0.0f),
+    intervalEnd(0.0f),
+    poseCount(0),
+    paletteBuffer(nullptr),
+    paletteOffset(0),
+    sharedPalette(nullptr),
+    sharedOffset(0),
+    skinnedVAO(0),
+    skinnedVBO(0)
+{
+    palette.resize(model->BonesCount(), AffineFromMat4(glm::mat4(1.0f)));
+    startPalette = palette;
+    endPalette = palette;
+}
+
+AnimationInstance::~AnimationInstance()
+{
+    if (skinnedVAO != 0)
+        GlState::DeleteVertexArray(skinnedVAO);
+    if (skinnedVBO != 0)
+        glDeleteBuffers(1, &skinnedVBO);
+}
+
+void AnimationInstance::SetAnimation(unsigned int animation)
+{
+    if (model->RequireClip(animation))
+    {
+        currentAnimation = animation;
+        hasClip = true;
+    }
+}
+
+void AnimationInstance::Update(GLfloat deltaTime)
+{
+    time += deltaTime * TimeScale;
+}
+
+bool AnimationInstance::EvaluatePose(const PoseLod& lod)
+{
+    if (!hasClip)
+        return false;
+
+    if (lod.Rate <= 0.0f)
+    {
+        ClipFrame frame = (lod.ReducedBones ? model->GetReducedClip(currentAnimation) : model->GetClip(currentAnimation)).FrameAt(time);
+        if (posedAnimation == (int)currentAnimation && !interpolating && posedLod.ReducedBones == lod.ReducedBones &&
+            frame.Frame0 == posedFrame.Frame0 && frame.Frame1 == posedFrame.Frame1 && frame.Factor == posedFrame.Factor)
+            return false;
+
+        pose(time, lod.ReducedBones, palette.data());
+        posedAnimation = currentAnimation;
+        posedFrame = frame;
+        posedLod = lod;
+        interpolating = false;
+        return true;
+    }
+
+    // Reduced rate: the pose at the end of the current interval is evaluated as soon as
+    // the interval starts and the palettes in between are blended, so the palette never
+    // lags behind the clock. A new clip, LOD or a jump of the clock starts over. The
+    // rate is in real time, a clip played faster spans more clip time per interval.
+    GLfloat interval = (TimeScale != 0.0f ? std::fabs(TimeScale) : 1.0f) / lod.Rate;
+    if (!interpolating || posedAnimation != (int)currentAnimation || posedLod.Rate != lod.Rate ||
+        posedLod.ReducedBones != lod.ReducedBones || time < intervalStart || time >= intervalEnd + interval)
+    {
+        pose(time, lod.ReducedBones, startPalette.data());
+        intervalStart = time;
+        intervalEnd = time + interval;
+        pose(intervalEnd, lod.ReducedBones, endPalette.data());
+    }
+    else if (time >= intervalEnd)
+    {
+        startPalette.swap(endPalette);
+        intervalStart = intervalEnd;
+        intervalEnd += interval;
+        pose(intervalEnd, lod.ReducedBones, endPalette.data());
+    }
+
+    float factor = std::min(std::max((time - intervalStart) / (intervalEnd - intervalStart), 0.0f), 1.0f);
+    LerpFloats((unsigned int)palette.size() * 12, &startPalette[0].Rows[0][0], &endPalette[0].Rows[0][0], factor, &palette[0].Rows[0][0]);
+
+    posedAnimation = currentAnimation;
+    posedLod = lod;
+    interpolating = true;
+    return true;
+}
+
+void AnimationInstance::pose(GLfloat atTime, bool reducedBones, Affine* out)
+{
+    poseCount++;
+    model->Pose(currentAnimation, model->GetClip(currentAnimation).FrameAt(atTime), reducedBones, scratch, out);
+}
+
+void AnimationInstance::BindPalette() const
+{
+    if (paletteBuffer != nullptr)
+        paletteBuffer->Bind(sharedPalette != nullptr ? sharedOffset : paletteOffset);
+}
+
+void AnimationInstance::SetPaletteRange(const BonePaletteBuffer* buffer, GLintptr offset)
+{
+    paletteBuffer = buffer;
+    paletteOffset = offset;
+}
+
+bool AnimationInstance::SharePalette(const Affine* shared, GLintptr sharedOffset)
+{
+    bool changed = shared != sharedPalette || (shared != nullptr && sharedOffset != this->sharedOffset);
+    // the own palette goes stale meanwhile, so pose again once back on it
+    if (shared != nullptr)
+        posedAnimation = -1;
+
+    sharedPalette = shared;
+    this->sharedOffset = sharedOffset;
+    return changed;
+}
+
+void AnimationInstance::Draw(Shader shader)
+{
+    if (IsCpuSkinning() && skinnedVAO != 0)
+        model->DrawSkinned(shader, skinnedVAO);
+    else
+    {
+        BindPalette();
+        model->Draw(shader);
+    }
+}
+
+void AnimationInstance::SetCpuSkinning(bool enabled)
+{
+    if (enabled && model->HasAnimations())
+    {
+        skinnedVertices.resize(model->VertexCount());
+        // force a pose so the new vertices get skinned on the next update
+        posedAnimation = -1;
+    }
+    else
+        std::vector<SkinnedVertex>().swap(skinnedVertices);
+}
+
+void AnimationInstance::SkinVertices(unsigned int begin, unsigned int end)
+{
+    ::SkinVertices(end - begin, &model->GetSkinningVertices()[begin], GetPalette(), &skinnedVertices[begin]);
+}
+
+// Orphans the buffer before every refill, so the driver never waits for the
+// draw of the previous frame to finish reading it
+void AnimationInstance::UploadSkinnedVertices()
+{
+    if (skinnedVertices.empty())
+        return;
+
+    if (skinnedVBO == 0)
+    {
+        glGenBuffers(1, &skinnedVBO);
+        skinnedVAO = model->CreateSkinnedVertexArray(skinnedVBO);
+    }
+
+    GLsizeiptr size = skinnedVertices.size() * sizeof(SkinnedVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, skinnedVBO);
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, &skinnedVertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
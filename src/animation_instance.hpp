@@ -0,0 +1,117 @@
+#ifndef ANIMATION_INSTANCE_H
+#define ANIMATION_INSTANCE_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "animated_model.hpp"
+#include "bone_palette_buffer.hpp"
+
+// How often and on which skeleton EvaluatePose poses, picked by the AnimationSystem
+// from the animation LOD tier of the instance
+struct PoseLod
+{
+    // poses per second of real time with interpolated palettes in between, 0 poses every update
+    GLfloat Rate;
+    // evaluate the reduced skeleton of the model
+    bool ReducedBones;
+
+    PoseLod() : Rate(0.0f), ReducedBones(false) {}
+    PoseLod(GLfloat rate, bool reducedBones) : Rate(rate), ReducedBones(reducedBones) {}
+};
+
+// Per-character playback state for a shared AnimatedModel: the clip being
+// played, its clock and the bone palette of the current pose. Many instances
+// can play different clips at different times on the same model.
+class AnimationInstance
+{
+    public:
+        // scales the clock advance, clip time runs at deltaTime * TimeScale
+        GLfloat TimeScale;
+        // world-space bounds, kept up to date by the owner for animation LOD
+        glm::vec3 Position;
+        GLfloat BoundingRadius;
+
+        AnimationInstance(AnimatedModelPtr model);
+        ~AnimationInstance();
+
+        AnimationInstance(const AnimationInstance&) = delete;
+        AnimationInstance& operator=(const AnimationInstance&) = delete;
+
+        // Loads the clip first when it comes from a library, keeps the current one when
+        // the clip cannot be played
+        void SetAnimation(unsigned int animation);
+        void SetTime(GLfloat time) { this->time = time; }
+        void Update(GLfloat deltaTime);
+
+        // Called by the AnimationSystem, possibly from a worker thread. Returns false
+        // and leaves the palette alone when the pose is the same as last time
+        bool EvaluatePose(const PoseLod& lod = PoseLod());
+        // Binds the palette range of the last evaluated pose to the BonePalette block
+        void BindPalette() const;
+        // Draws the CPU skinned vertices when CPU skinning is on, the GPU skinned model otherwise
+        void Draw(Shader shader);
+
+        // CPU skinning, switched by the AnimationSystem. SkinVertices may run on worker
+        // threads for disjoint ranges, UploadSkinnedVertices needs GL
+        void SetCpuSkinning(bool enabled);
+        bool IsCpuSkinning() const { return !skinnedVertices.empty(); }
+        void SkinVertices(unsigned int begin, unsigned int end);
+        void UploadSkinnedVertices();
+
+        // Set by the AnimationSystem when the instance is registered
+        void SetPaletteRange(const BonePaletteBuffer* buffer, GLintptr offset);
+        // Makes the instance use a palette evaluated by the PoseCache, and its range of
+        // the palette buffer, in place of its own. nullptr goes back to the own palette.
+        // Returns whether that changed the palette in use
+        bool SharePalette(const Affine* shared, GLintptr sharedOffset);
+        bool IsSharingPalette() const { return sharedPalette != nullptr; }
+
+        const AnimatedModelPtr& GetModel() const { return model; }
+        unsigned int GetAnimation() const { return currentAnimation; }
+        // whether the current clip is loaded, only then is there a pose to evaluate
+        bool HasClip() const { return hasClip; }
+        GLfloat GetTime() const { return time; }
+        // skeleton evaluations since the instance was made, the reduced rate LOD makes fewer
+        unsigned int PoseCount() const { return poseCount; }
+        // BonesCount() matrices of the current pose, shared or not
+        const Affine* GetPalette() const { return sharedPalette != nullptr ? sharedPalette : palette.data(); }
+
+    private:
+        AnimatedModelPtr model;
+        unsigned int currentAnimation;
+        bool hasClip;
+        GLfloat time;
+
+        // working memory of the pose evaluation
+        PoseScratch scratch;
+        // final bone matrices, copied into the palette buffer whenever they change
+        std::vector<Affine> palette;
+        // clip and frame pair of the current palette
+        int posedAnimation;
+        ClipFrame posedFrame;
+        PoseLod posedLod;
+
+        // reduced rate LOD: the poses at both ends of the current interval of clip time
+        bool interpolating;
+        GLfloat intervalStart, intervalEnd;
+        unsigned int poseCount;
+        std::vector<Affine> startPalette, endPalette;
+
+        const BonePaletteBuffer* paletteBuffer;
+        GLintptr paletteOffset;
+        // pose cache entry in use instead of the own palette and range, if any
+        const Affine* sharedPalette;
+        GLintptr sharedOffset;
+
+        // output of CPU skinning and the streaming buffer it is drawn from
+        std::vector<SkinnedVertex> skinnedVertices;
+        GLuint skinnedVAO, skinnedVBO;
+
+        void pose(GLfloat atTime, bool reducedBones, Affine* out);
+};
+
+#endif
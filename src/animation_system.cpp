@@ -0,0 +1,245 @@
+#include "animation_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+AnimationSystem::AnimationSystem(unsigned int workerCount) :
+    pool(workerCount),
+    poseCache(palettes),
+    lastUpdateTime(0.0),
+    lastPosedCount(0),
+    hasViewer(false),
+    viewerPosition(0.0f),
+    cpuSkinning(false),
+    lastSkinningTime(0.0),
+    lastSkinnedVertexCount(0)
+{
+    for (unsigned int t = 0; t < LOD_TIER_COUNT; t++)
+        lastTierCounts[t] = 0;
+}
+
+void AnimationSystem::Add(AnimationInstance* instance)
+{
+    unsigned int bones = instance->GetModel()->BonesCount();
+    GLintptr offset = palettes.Allocate(bones);
+    // the range may hold a palette left by a previous owner, so fill it right away
+    palettes.Write(offset, instance->GetPalette(), bones);
+    instance->SetPaletteRange(&palettes, offset);
+    instance->SetCpuSkinning(cpuSkinning);
+
+    instances.push_back(instance);
+    paletteOffsets.push_back(offset);
+    posed.push_back(0);
+    sharing.push_back(0);
+    poseKeys.push_back(PoseKey());
+}
+
+void AnimationSystem::Remove(AnimationInstance* instance)
+{
+    std::vector<AnimationInstance*>::iterator found = std::find(instances.begin(), instances.end(), instance);
+    if (found == instances.end())
+        return;
+
+    unsigned int i = (unsigned int)(found - instances.begin());
+    palettes.Free(paletteOffsets[i], instance->GetModel()->BonesCount());
+    instance->SetPaletteRange(nullptr, 0);
+    instance->SharePalette(nullptr, 0);
+    instance->SetCpuSkinning(false);
+
+    instances.erase(found);
+    paletteOffsets.erase(paletteOffsets.begin() + i);
+    posed.erase(posed.begin() + i);
+    sharing.erase(sharing.begin() + i);
+    poseKeys.erase(poseKeys.begin() + i);
+}
+
+// Planes from the rows of the view projection matrix (Gribb and Hartmann)
+void AnimationSystem::SetViewer(const glm::mat4& viewProjection, const glm::vec3& position)
+{
+    glm::mat4 m = glm::transpose(viewProjection);
+    frustumPlanes[0] = m[3] + m[0];
+    frustumPlanes[1] = m[3] - m[0];
+    frustumPlanes[2] = m[3] + m[1];
+    frustumPlanes[3] = m[3] - m[1];
+    frustumPlanes[4] = m[3] + m[2];
+    frustumPlanes[5] = m[3] - m[2];
+    for (unsigned int p = 0; p < 6; p++)
+        frustumPlanes[p] /= glm::length(glm::vec3(frustumPlanes[p]));
+
+    viewerPosition = position;
+    hasViewer = true;
+}
+
+void AnimationSystem::Update(GLfloat deltaTime)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    lastPosedCount = 0;
+    for (unsigned int t = 0; t < LOD_TIER_COUNT; t++)
+        lastTierCounts[t] = 0;
+
+    bool sharePoses = PoseSharing.Enabled && PoseSharing.Quantum > 0.0f;
+    if (sharePoses)
+        poseCache.BeginFrame(PoseSharing.Quantum);
+
+    pool.ParallelFor((unsigned int)instances.size(), POSE_UPDATE_GRAIN, [this, deltaTime, sharePoses](unsigned int begin, unsigned int end)
+    {
+        unsigned int posedCount = 0;
+        unsigned int tierCounts[LOD_TIER_COUNT] = {};
+        for (unsigned int i = begin; i < end; i++)
+        {
+            instances[i]->Update(deltaTime);
+
+            AnimationLodTier tier = lodTier(instances[i]);
+            tierCounts[tier]++;
+            sharing[i] = false;
+            if (tier == LOD_HIDDEN)
+            {
+                // the cache entry in use may be gone by the time the instance shows again
+                instances[i]->SharePalette(nullptr, 0);
+                posed[i] = false;
+                continue;
+            }
+
+            PoseLod lod;
+            if (tier == LOD_MEDIUM)
+                lod = PoseLod(LodSettings.MediumRate, false);
+            else if (tier == LOD_FAR)
+                lod = PoseLod(LodSettings.FarRate, true);
+
+            // instances posed every update are posed by the cache once the keys are in
+            if (sharePoses && lod.Rate <= 0.0f && instances[i]->HasClip())
+            {
+                poseKeys[i] = poseCache.KeyOf(*instances[i], lod.ReducedBones);
+                sharing[i] = true;
+                continue;
+            }
+            instances[i]->SharePalette(nullptr, 0);
+
+            // an unchanged pose keeps the palette already in the buffer
+            posed[i] = instances[i]->EvaluatePose(lod);
+            if (posed[i] && !cpuSkinning)
+            {
+                palettes.Write(paletteOffsets[i], instances[i]->GetPalette(), instances[i]->GetModel()->BonesCount());
+            }
+            posedCount += posed[i];
+        }
+        lastPosedCount += posedCount;
+        for (unsigned int t = 0; t < LOD_TIER_COUNT; t++)
+            lastTierCounts[t] += tierCounts[t];
+    });
+
+    if (sharePoses)
+        shareCachedPoses();
+    else if (!poseCache.Empty())
+        poseCache.Clear();
+
+    if (cpuSkinning)
+        skinPosedInstances();
+
+    lastUpdateTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Serial, the lookups are a hash each. Only the distinct poses among them are
+// evaluated, across the pool, and only those new this update are uploaded
+void AnimationSystem::shareCachedPoses()
+{
+    unsigned int posedCount = 0;
+    for (unsigned int i = 0; i < instances.size(); i++)
+    {
+        if (!sharing[i])
+            continue;
+
+        unsigned int entry = poseCache.Lookup(poseKeys[i], instances[i]->GetModel());
+        bool changed = instances[i]->SharePalette(poseCache.Palette(entry), poseCache.PaletteOffset(entry));
+        posed[i] = changed || poseCache.IsNew(entry);
+        posedCount += posed[i];
+    }
+    lastPosedCount += posedCount;
+
+    poseCache.EvaluatePending(pool);
+    poseCache.EndFrame();
+}
+
+AnimationLodTier AnimationSystem::lodTier(const AnimationInstance* instance) const
+{
+    if (!LodSettings.Enabled || !hasViewer)
+        return LOD_NEAR;
+
+    for (unsigned int p = 0; p < 6; p++)
+    {
+        if (glm::dot(glm::vec3(frustumPlanes[p]), instance->Position) + frustumPlanes[p].w < -instance->BoundingRadius)
+            return LOD_HIDDEN;
+    }
+
+    GLfloat distance = glm::length(instance->Position - viewerPosition);
+    if (distance >= LodSettings.FarDistance)
+        return LOD_FAR;
+    if (distance >= LodSettings.MediumDistance)
+        return LOD_MEDIUM;
+    return LOD_NEAR;
+}
+
+void AnimationSystem::Upload()
+{
+    if (!cpuSkinning)
+    {
+        palettes.Upload();
+        return;
+    }
+
+    for (unsigned int i = 0; i < instances.size(); i++)
+    {
+        if (posed[i])
+            instances[i]->UploadSkinnedVertices();
+    }
+}
+
+void AnimationSystem::SetCpuSkinning(bool enabled)
+{
+    if (enabled == cpuSkinning)
+        return;
+
+    cpuSkinning = enabled;
+    for (unsigned int i = 0; i < instances.size(); i++)
+    {
+        instances[i]->SetCpuSkinning(enabled);
+        // back on the GPU path every palette range has to be refreshed
+        if (!enabled)
+            palettes.Write(paletteOffsets[i], instances[i]->GetPalette(), instances[i]->GetModel()->BonesCount());
+    }
+}
+
+// Splits the vertices of every instance posed this update into fixed-size chunks,
+// so a few big models or many small ones spread over the pool alike
+void AnimationSystem::skinPosedInstances()
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    skinningJobs.clear();
+    lastSkinnedVertexCount = 0;
+    for (unsigned int i = 0; i < instances.size(); i++)
+    {
+        if (!posed[i] || !instances[i]->IsCpuSkinning())
+            continue;
+
+        unsigned int vertexCount = instances[i]->GetModel()->VertexCount();
+        for (unsigned int begin = 0; begin < vertexCount; begin += SKINNING_CHUNK_SIZE)
+        {
+            SkinningJob job;
+            job.Instance = instances[i];
+            job.Begin = begin;
+            job.End = std::min(begin + SKINNING_CHUNK_SIZE, vertexCount);
+            skinningJobs.push_back(job);
+        }
+        lastSkinnedVertexCount += vertexCount;
+    }
+
+    pool.ParallelFor((unsigned int)skinningJobs.size(), 1, [this](unsigned int begin, unsigned int end)
+    {
+        for (unsigned int j = begin; j < end; j++)
+            skinningJobs[j].Instance->SkinVertices(skinningJobs[j].Begin, skinningJobs[j].End);
+    });
+
+    lastSkinningTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
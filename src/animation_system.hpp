@@ -0,0 +1,122 @@
+#ifndef ANIMATION_SYSTEM_H
+#define ANIMATION_SYSTEM_H
+
+#include <atomic>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "job_pool.hpp"
+#include "animation_instance.hpp"
+#include "bone_palette_buffer.hpp"
+#include "pose_cache.hpp"
+
+// Number of instances a worker claims at a time during the pose update
+const unsigned int POSE_UPDATE_GRAIN = 16;
+// Vertices in one CPU skinning job
+const unsigned int SKINNING_CHUNK_SIZE = 2048;
+
+// Animation LOD tiers, from full quality down to a clock that only advances
+enum AnimationLodTier
+{
+    LOD_NEAR,      // full skeleton posed every update
+    LOD_MEDIUM,    // full skeleton posed at a reduced rate, interpolated in between
+    LOD_FAR,       // reduced skeleton posed at a lower rate still
+    LOD_HIDDEN,    // outside the view, only the clock advances
+    LOD_TIER_COUNT
+};
+
+struct AnimationLodSettings
+{
+    bool Enabled;
+    // distances from the viewer where the medium and far tiers start
+    GLfloat MediumDistance;
+    GLfloat FarDistance;
+    // poses per second of real time of the medium and far tiers, whatever the TimeScale
+    GLfloat MediumRate;
+    GLfloat FarRate;
+
+    AnimationLodSettings() : Enabled(true), MediumDistance(4.0f), FarDistance(8.0f), MediumRate(15.0f), FarRate(6.0f) {}
+};
+
+// The pose-update stage: advances every registered instance's clock and
+// evaluates its bone palette, spread across a pool of worker threads. Each
+// instance only writes into its own preallocated palette and its own range of
+// the shared palette buffer, so the render pass afterwards has nothing left to
+// do but one upload. With a viewer set, every instance is first sorted into an
+// animation LOD tier by its bounds, so pose cost follows what is on screen.
+// With pose sharing on, the instances posed every update are grouped by clip and
+// quantized clip time and each group is posed once in a PoseCache.
+class AnimationSystem
+{
+    public:
+        AnimationLodSettings LodSettings;
+        PoseCacheSettings PoseSharing;
+
+        AnimationSystem(unsigned int workerCount = JobPool::DefaultWorkerCount());
+
+        void Add(AnimationInstance* instance);
+        void Remove(AnimationInstance* instance);
+
+        // Camera used by the LOD tiers of the next Update, without one everything is near
+        void SetViewer(const glm::mat4& viewProjection, const glm::vec3& position);
+        void Update(GLfloat deltaTime);
+        // Sends the palettes, or the CPU skinned vertices, that changed in the last Update to the GPU, needs GL
+        void Upload();
+
+        // Skins every registered instance on the CPU after posing it, drawn without GPU skinning
+        void SetCpuSkinning(bool enabled);
+        bool IsCpuSkinning() const { return cpuSkinning; }
+
+        unsigned int InstanceCount() const { return (unsigned int)instances.size(); }
+        unsigned int ThreadCount() const { return pool.ThreadCount(); }
+        // wall time of the last Update, in milliseconds
+        double LastUpdateTime() const { return lastUpdateTime; }
+        // instances whose pose changed in the last Update
+        unsigned int LastPosedCount() const { return lastPosedCount; }
+        // instances sorted into a tier by the last Update
+        unsigned int LastTierCount(AnimationLodTier tier) const { return lastTierCounts[tier]; }
+        // wall time of the CPU skinning part of the last Update, in milliseconds
+        double LastSkinningTime() const { return lastSkinningTime; }
+        unsigned int LastSkinnedVertexCount() const { return lastSkinnedVertexCount; }
+        GLsizeiptr LastUploadSize() const { return palettes.LastUploadSize(); }
+        // pose sharing over the last Update, empty while it is off
+        const PoseCache& GetPoseCache() const { return poseCache; }
+
+    private:
+        JobPool pool;
+        std::vector<AnimationInstance*> instances;
+        std::vector<GLintptr> paletteOffsets;
+        BonePaletteBuffer palettes;
+        PoseCache poseCache;
+        // instances that look up a shared pose this Update, and their keys
+        std::vector<unsigned char> sharing;
+        std::vector<PoseKey> poseKeys;
+        double lastUpdateTime;
+        std::atomic<unsigned int> lastPosedCount;
+
+        bool hasViewer;
+        // inward facing frustum planes, xyz normal and w distance
+        glm::vec4 frustumPlanes[6];
+        glm::vec3 viewerPosition;
+        std::atomic<unsigned int> lastTierCounts[LOD_TIER_COUNT];
+
+        bool cpuSkinning;
+        // instances posed in the last Update and the skinning jobs built from them
+        std::vector<unsigned char> posed;
+        struct SkinningJob
+        {
+            AnimationInstance* Instance;
+            unsigned int Begin, End;
+        };
+        std::vector<SkinningJob> skinningJobs;
+        double lastSkinningTime;
+        unsigned int lastSkinnedVertexCount;
+
+        AnimationLodTier lodTier(const AnimationInstance* instance) const;
+        void shareCachedPoses();
+        void skinPosedInstances();
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "asset_loader.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+AssetLoader::AssetLoader(unsigned int workerCount) :
+    quit(false),
+    requestedCount(0),
+    readCount(0),
+    uploadedCount(0),
+    lastUploadSize(0),
+    lastUploadTime(0.0)
+{
+    // without workers there would be nobody to read
+    workerCount = std::max(workerCount, 1u);
+    for (unsigned int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(&AssetLoader::workerLoop, this));
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeCondition.notify_all();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    // the workers are gone, what is left was never read or waits for its upload
+    size_t cancelled = reads.size() + uploads.size();
+    if (cancelled == 0)
+        return;
+    std::cout << "ERROR::ASSET_LOADER: " << cancelled << " loads are cancelled before their upload" << std::endl;
+    std::deque<PendingLoad> left;
+    left.swap(uploads);
+    left.insert(left.end(), reads.begin(), reads.end());
+    reads.clear();
+    for (unsigned int i = 0; i < left.size(); i++)
+    {
+        if (left[i].Cancel)
+            left[i].Cancel();
+    }
+}
+
+void AssetLoader::Load(const ReadJob& read, const UploadJob& upload, const CancelJob& cancel)
+{
+    PendingLoad load;
+    load.Read = read;
+    load.Upload = upload;
+    load.Cancel = cancel;
+    load.Bytes = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reads.push_back(load);
+        requestedCount++;
+    }
+    wakeCondition.notify_one();
+}
+
+unsigned int AssetLoader::PumpUploads(size_t byteBudget, double millisecondBudget)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    size_t bytes = 0;
+    unsigned int uploaded = 0;
+
+    while (true)
+    {
+        PendingLoad load;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (uploads.empty())
+                break;
+            // the next one goes to the next frame if it would overrun this one
+            if (uploaded > 0 && bytes + uploads.front().Bytes > byteBudget)
+                break;
+            load = uploads.front();
+            uploads.pop_front();
+        }
+
+        load.Upload();
+        bytes += load.Bytes;
+        uploaded++;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uploadedCount++;
+            if (uploadedCount == requestedCount)
+                requestedCount = readCount = uploadedCount = 0;
+        }
+
+        if (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() >= millisecondBudget)
+            break;
+    }
+
+    lastUploadSize = bytes;
+    lastUploadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return uploaded;
+}
+
+void AssetLoader::Finish()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readCondition.wait(lock, [this] { return !uploads.empty() || requestedCount == 0; });
+            if (requestedCount == 0)
+                return;
+        }
+        PumpUploads((size_t)-1, 1e30);
+    }
+}
+
+bool AssetLoader::IsIdle() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return requestedCount == 0;
+}
+
+float AssetLoader::Progress() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (requestedCount == 0)
+        return 1.0f;
+    return (readCount + uploadedCount) / (2.0f * requestedCount);
+}
+
+void AssetLoader::workerLoop()
+{
+    while (true)
+    {
+        PendingLoad load;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [this] { return quit || !reads.empty(); });
+            if (quit)
+                return;
+            load = reads.front();
+            reads.pop_front();
+        }
+
+        load.Bytes = load.Read();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uploads.push_back(load);
+            readCount++;
+        }
+        readCondition.notify_all();
+    }
+}
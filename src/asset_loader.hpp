@@ -0,0 +1,96 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "job_pool.hpp"
+
+// What PumpUploads sends to the GPU in a frame by default, a few milliseconds of a
+// 60 Hz frame whatever the size of the assets
+const size_t UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+const double UPLOAD_MILLISECONDS_PER_FRAME = 4.0;
+
+// True once the load behind the future is done, without blocking
+template <typename T>
+bool IsLoaded(const std::shared_future<T>& future)
+{
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+// Loads assets in two halves. The read half (file reads, image decode, model parsing)
+// runs on the loader's worker threads, several at once. The upload half creates the
+// GL objects, so it runs on the thread that owns the context: PumpUploads takes the
+// reads that finished, in the order they did, and uploads them until the byte or the
+// time budget of the frame is spent. The main loop keeps drawing meanwhile.
+class AssetLoader
+{
+    public:
+        // does the CPU work and returns the bytes its upload will send to the GPU
+        typedef std::function<size_t()> ReadJob;
+        typedef std::function<void()> UploadJob;
+        // stands in for the upload of a load the loader is destroyed before
+        typedef std::function<void()> CancelJob;
+
+        AssetLoader(unsigned int workerCount = JobPool::DefaultWorkerCount());
+        // Waits for the reads in progress, then cancels every load not uploaded yet, read
+        // or not: nothing more is uploaded, their cancel jobs run instead, those of the
+        // finished reads first
+        ~AssetLoader();
+
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+        // Thread safe. read runs on a worker, upload on the GL thread afterwards, or cancel
+        // instead when the loader goes first
+        void Load(const ReadJob& read, const UploadJob& upload, const CancelJob& cancel = CancelJob());
+        // GL thread, once a frame. Uploads finished reads until one of the budgets is
+        // spent; the first always goes, so an asset above the budget takes a frame of its
+        // own. Returns how many were uploaded
+        unsigned int PumpUploads(size_t byteBudget = UPLOAD_BYTES_PER_FRAME, double millisecondBudget = UPLOAD_MILLISECONDS_PER_FRAME);
+        // GL thread. Uploads without a budget until every load requested so far is done
+        void Finish();
+
+        bool IsIdle() const;
+        // Share of the work of the loads requested since the loader was last idle that
+        // is done, reads and uploads counting half each. 1 when idle
+        float Progress() const;
+
+        unsigned int ThreadCount() const { return (unsigned int)workers.size(); }
+        size_t LastUploadSize() const { return lastUploadSize; }
+        double LastUploadTime() const { return lastUploadTime; }
+
+    private:
+        struct PendingLoad
+        {
+            ReadJob Read;
+            UploadJob Upload;
+            CancelJob Cancel;
+            size_t Bytes;
+        };
+
+        std::vector<std::thread> workers;
+        mutable std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable readCondition;
+        bool quit;
+
+        std::deque<PendingLoad> reads;
+        std::deque<PendingLoad> uploads;
+        // of the current batch, cleared whenever the last of its loads is uploaded
+        unsigned int requestedCount, readCount, uploadedCount;
+
+        size_t lastUploadSize;
+        double lastUploadTime;
+
+        void workerLoop();
+};
+
+#endif
@@ -1,17 +1,19 @@
 #include "basic_entity.hpp"
 
-BasicEntity::BasicEntity(glm::vec3 position, glm::vec3 size, Texture2D texture) :
+#include "gl_state.hpp"
+
+BasicEntity::BasicEntity(glm::vec3 position, glm::vec3 size, const AtlasEntry* atlasEntry) :
     Position(position),
     size(size),
     rotation(0.0f),
-    texture(texture)
+    atlasEntry(atlasEntry)
 {
    initRenderData();
 }
 
 BasicEntity::~BasicEntity()
 {
-    glDeleteVertexArrays(1, &VAO);
+    GlState::DeleteVertexArray(VAO);
 }
 
 void BasicEntity::Update(GLfloat deltaTime)
@@ -21,6 +23,9 @@ void BasicEntity::Update(GLfloat deltaTime)
 
 void BasicEntity::Draw(Shader shader)
 {
+    if (atlasEntry == nullptr)
+        return;
+
     // Prepare transformations
     glm::mat4 modelMat = glm::mat4(1.0f);
     modelMat = glm::translate(modelMat, Position);
@@ -35,13 +40,12 @@ void BasicEntity::Draw(Shader shader)
     shader.SetInteger("entity", true);
     shader.SetMatrix4("model", modelMat);
 
-    glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
+    TextureAtlas::SetUniforms(shader, atlasEntry);
 
-    glBindVertexArray(VAO);
+    GlState::BindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
 
+    TextureAtlas::SetUniforms(shader, nullptr);
     shader.SetInteger("entity", false);
 }
 
@@ -97,7 +101,7 @@ void BasicEntity::initRenderData()
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
+    GlState::BindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -113,5 +117,5 @@ void BasicEntity::initRenderData()
     glEnableVertexAttribArray(2);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState::BindVertexArray(0);
 }
\ No newline at end of file
@@ -5,15 +5,16 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "texture.hpp"
+#include "texture_atlas.hpp"
 #include "shader.hpp"
 
+// A textured cube drawn from its entry in the bound atlas, nothing without one
 class BasicEntity
 {
     public:
         glm::vec3 Position;
 
-        BasicEntity(glm::vec3 position, glm::vec3 size, Texture2D texture);
+        BasicEntity(glm::vec3 position, glm::vec3 size, const AtlasEntry* atlasEntry);
         ~BasicEntity();
 
         void Update(GLfloat deltatime);
@@ -22,7 +23,7 @@ class BasicEntity
     private:
         glm::vec3 size;
         GLfloat rotation;
-        Texture2D texture;
+        const AtlasEntry* atlasEntry;
         GLuint VAO;
 
         void initRenderData();
@@ -0,0 +1,101 @@
+#include "bone_palette_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// Every range is bound with the full size of the block, which is allowed to run
+// into the ranges after it as long as the buffer itself is large enough
+static const GLsizeiptr BLOCK_SIZE = BONE_PALETTE_MAX_BONES * sizeof(Affine);
+
+BonePaletteBuffer::BonePaletteBuffer() :
+    UBO(0),
+    capacity(0),
+    dirtyBegin(std::numeric_limits<GLintptr>::max()),
+    dirtyEnd(0),
+    lastUploadSize(0)
+{
+}
+
+BonePaletteBuffer::~BonePaletteBuffer()
+{
+    if (UBO != 0)
+        glDeleteBuffers(1, &UBO);
+}
+
+GLintptr BonePaletteBuffer::Allocate(unsigned int boneCount)
+{
+    GLsizeiptr size = rangeSize(boneCount);
+
+    std::map<GLsizeiptr, std::vector<GLintptr> >::iterator ranges = freeRanges.find(size);
+    if (ranges != freeRanges.end() && !ranges->second.empty())
+    {
+        GLintptr offset = ranges->second.back();
+        ranges->second.pop_back();
+        return offset;
+    }
+
+    GLintptr offset = (GLintptr)data.size();
+    data.resize(data.size() + size, 0);
+    return offset;
+}
+
+void BonePaletteBuffer::Free(GLintptr offset, unsigned int boneCount)
+{
+    freeRanges[rangeSize(boneCount)].push_back(offset);
+}
+
+void BonePaletteBuffer::Write(GLintptr offset, const Affine* palette, unsigned int boneCount)
+{
+    GLsizeiptr size = boneCount * sizeof(Affine);
+    if (size == 0)
+        return;
+    std::memcpy(&data[offset], palette, size);
+
+    GLintptr begin = dirtyBegin.load();
+    while (offset < begin && !dirtyBegin.compare_exchange_weak(begin, offset))
+        ;
+    GLintptr end = dirtyEnd.load();
+    while (offset + size > end && !dirtyEnd.compare_exchange_weak(end, offset + size))
+        ;
+}
+
+void BonePaletteBuffer::Upload()
+{
+    GLintptr begin = dirtyBegin.exchange(std::numeric_limits<GLintptr>::max());
+    GLintptr end = dirtyEnd.exchange(0);
+    lastUploadSize = 0;
+
+    if (UBO == 0)
+        glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+
+    GLsizeiptr required = (GLsizeiptr)data.size() + BLOCK_SIZE;
+    if (capacity < required)
+    {
+        // grow geometrically and resend everything, offsets stay valid
+        capacity = std::max(required, capacity * 2);
+        glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+        begin = 0;
+        end = (GLintptr)data.size();
+    }
+
+    if (begin < end)
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, begin, end - begin, &data[begin]);
+        lastUploadSize = end - begin;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void BonePaletteBuffer::Bind(GLintptr offset) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, BONE_PALETTE_BINDING, UBO, offset, BLOCK_SIZE);
+}
+
+GLsizeiptr BonePaletteBuffer::rangeSize(unsigned int boneCount)
+{
+    GLsizeiptr size = boneCount * sizeof(Affine);
+    return (size + BONE_PALETTE_ALIGNMENT - 1) / BONE_PALETTE_ALIGNMENT * BONE_PALETTE_ALIGNMENT;
+}
@@ -0,0 +1,62 @@
+#ifndef BONE_PALETTE_BUFFER_H
+#define BONE_PALETTE_BUFFER_H
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "pose_kernels.hpp"
+
+// Uniform buffer binding point of the BonePalette block in gritty.vs
+const GLuint BONE_PALETTE_BINDING = 0;
+// Size of the gBones array in gritty.vs. A mat3x4 takes 48 bytes in std140, so the
+// block stays within the 16 KiB every GL 3.3 implementation guarantees
+const unsigned int BONE_PALETTE_MAX_BONES = 256;
+// Largest UNIFORM_BUFFER_OFFSET_ALIGNMENT the GL allows, valid everywhere
+const GLintptr BONE_PALETTE_ALIGNMENT = 256;
+
+// Every bone palette of every animated instance in one persistent uniform buffer.
+// An instance owns a range for as long as it is registered, its palette is written
+// there as 3x4 matrices (the Affine layout is the std140 layout of mat3x4) and the
+// draw binds that range to the BonePalette block. Writes go to a CPU copy, possibly
+// from worker threads, and Upload sends the span written since the last upload in
+// one call. Ranges whose pose did not change are simply never written.
+class BonePaletteBuffer
+{
+    public:
+        BonePaletteBuffer();
+        ~BonePaletteBuffer();
+
+        BonePaletteBuffer(const BonePaletteBuffer&) = delete;
+        BonePaletteBuffer& operator=(const BonePaletteBuffer&) = delete;
+
+        // Returns the byte offset of a range holding boneCount matrices
+        GLintptr Allocate(unsigned int boneCount);
+        void Free(GLintptr offset, unsigned int boneCount);
+
+        // Safe to call concurrently for different ranges
+        void Write(GLintptr offset, const Affine* palette, unsigned int boneCount);
+        // Needs a current GL context, creates or grows the buffer as needed
+        void Upload();
+        void Bind(GLintptr offset) const;
+
+        // bytes sent by the last Upload, for the stats overlay
+        GLsizeiptr LastUploadSize() const { return lastUploadSize; }
+
+    private:
+        GLuint UBO;
+        // size of the GL buffer, 0 until the first upload
+        GLsizeiptr capacity;
+        std::vector<unsigned char> data;
+        // free ranges by size in bytes
+        std::map<GLsizeiptr, std::vector<GLintptr> > freeRanges;
+        std::atomic<GLintptr> dirtyBegin;
+        std::atomic<GLintptr> dirtyEnd;
+        GLsizeiptr lastUploadSize;
+
+        static GLsizeiptr rangeSize(unsigned int boneCount);
+};
+
+#endif
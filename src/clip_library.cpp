@@ -0,0 +1,174 @@
+#include "clip_library.hpp"
+
+#include <iostream>
+#include <set>
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#endif
+
+#include "cooked_model.hpp"
+
+ClipLibrary::ClipLibrary() : fileLoadCount(0)
+{
+}
+
+void ClipLibrary::Register(const std::string& name, const std::string& file, const std::string& animation, const ClipCompressionSettings* compression)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Entry& entry = entries[name];
+    entry.File = file;
+    entry.Animation = animation;
+    entry.Compress = compression != nullptr;
+    entry.Compression = compression != nullptr ? *compression : ClipCompressionSettings();
+    entry.Clip.reset();
+    entry.Failed = false;
+}
+
+bool ClipLibrary::IsRegistered(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.find(name) != entries.end();
+}
+
+AnimationClipPtr ClipLibrary::Get(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<std::string, Entry>::iterator found = entries.find(name);
+    if (found == entries.end())
+    {
+        std::cout << "ERROR::CLIP_LIBRARY: No clip registered as " << name << std::endl;
+        return AnimationClipPtr();
+    }
+
+    if (!found->second.Clip && !found->second.Failed)
+        loadFile(found->second.File);
+    return found->second.Clip;
+}
+
+void ClipLibrary::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        it->second.Clip.reset();
+        it->second.Failed = false;
+    }
+}
+
+unsigned int ClipLibrary::LoadedClipCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned int count = 0;
+    for (std::map<std::string, Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        count += it->second.Clip ? 1 : 0;
+    return count;
+}
+
+size_t ClipLibrary::MemorySize() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t size = 0;
+    for (std::map<std::string, Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        size += it->second.Clip ? it->second.Clip->MemorySize() : 0;
+    return size;
+}
+
+// A clip of a file is wanted by name, or as the first one by an empty name
+static bool isWanted(const std::set<std::string>& animations, const std::string& name, unsigned int index)
+{
+    return animations.count(name) > 0 || (index == 0 && animations.count("") > 0);
+}
+
+// Bakes the wanted animations of a file, from its cooked copy when there is one
+static bool readClips(const std::string& file, const std::set<std::string>& animations, std::vector<AnimationClip>& clips)
+{
+    CookedModel cooked;
+    std::string cookedPath = CookedModelPath(file);
+    if (cooked.Open(cookedPath))
+    {
+        std::vector<AnimationClip> cookedClips;
+        cooked.ReadClips(cookedClips);
+        for (unsigned int i = 0; i < cookedClips.size(); i++)
+        {
+            if (isWanted(animations, cookedClips[i].Name, i))
+                clips.push_back(cookedClips[i]);
+        }
+        return true;
+    }
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+    if (cookedPath != file)
+    {
+        // no post-processing, only the animations are read. Files without meshes are
+        // flagged incomplete by assimp, that is expected here
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(file, 0);
+        if (!scene || !scene->mRootNode)
+        {
+            std::cout << "ERROR::ASSIMP: " << importer.GetErrorString() << std::endl;
+            return false;
+        }
+
+        for (unsigned int a = 0; a < scene->mNumAnimations; a++)
+        {
+            if (!isWanted(animations, scene->mAnimations[a]->mName.C_Str(), a))
+                continue;
+            clips.push_back(AnimationClip());
+            clips.back().Bake(scene->mAnimations[a]);
+        }
+        return true;
+    }
+#endif
+
+    std::cout << "ERROR::CLIP_LIBRARY: No cooked clips at " << cookedPath << std::endl;
+    return false;
+}
+
+// Called with the mutex held. Bakes every registered clip of the file that is not
+// loaded yet, so a file holding a whole locomotion set is read once
+void ClipLibrary::loadFile(const std::string& file)
+{
+    std::set<std::string> animations;
+    for (std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->second.File == file && !it->second.Clip && !it->second.Failed)
+            animations.insert(it->second.Animation);
+    }
+
+    std::vector<AnimationClip> fileClips;
+    bool readable = readClips(file, animations, fileClips);
+    fileLoadCount++;
+
+    for (std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        Entry& entry = it->second;
+        if (entry.File != file || entry.Clip || entry.Failed)
+            continue;
+
+        // the first clip of the file is the first one read when the name is empty
+        const AnimationClip* animation = nullptr;
+        for (unsigned int a = 0; a < fileClips.size() && animation == nullptr; a++)
+        {
+            if (entry.Animation.empty() || entry.Animation == fileClips[a].Name)
+                animation = &fileClips[a];
+        }
+
+        if (animation == nullptr)
+        {
+            if (readable)
+                std::cout << "ERROR::CLIP_LIBRARY: No animation " << entry.Animation << " in " << file << std::endl;
+            entry.Failed = true;
+            continue;
+        }
+
+        std::shared_ptr<AnimationClip> clip = std::make_shared<AnimationClip>(*animation);
+        clip->Name = it->first;
+        if (entry.Compress)
+            clip->Compress(entry.Compression);
+        entry.Clip = clip;
+    }
+}
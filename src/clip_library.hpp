@@ -0,0 +1,61 @@
+#ifndef CLIP_LIBRARY_H
+#define CLIP_LIBRARY_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "animation_clip.hpp"
+
+typedef std::shared_ptr<const AnimationClip> AnimationClipPtr;
+
+// Clips kept apart from any one model, in animation-only files. A clip is registered
+// under a name and read the first time a model asks for it; every clip registered
+// from the same file is baked by that one read. Clips are shared as they are, each
+// model binds them to its own skeleton by channel name (AnimatedModel::AddLibraryClip),
+// so one locomotion set serves every character variant with compatible bone names.
+class ClipLibrary
+{
+    public:
+        ClipLibrary();
+
+        ClipLibrary(const ClipLibrary&) = delete;
+        ClipLibrary& operator=(const ClipLibrary&) = delete;
+
+        // Nothing is read yet. animation is the name of the clip in the file, its first
+        // clip when empty; clips are compressed within the given tolerances when set
+        void Register(const std::string& name, const std::string& file, const std::string& animation = "",
+                      const ClipCompressionSettings* compression = nullptr);
+        bool IsRegistered(const std::string& name) const;
+        // Thread safe, reads the file on first use. Null when the clip cannot be loaded
+        AnimationClipPtr Get(const std::string& name);
+        // Drops the library's references, models keep the clips they bound
+        void Clear();
+
+        unsigned int FileLoadCount() const { return fileLoadCount; }
+        // clips loaded so far and the bytes of their samples
+        unsigned int LoadedClipCount() const;
+        size_t MemorySize() const;
+
+    private:
+        struct Entry
+        {
+            std::string File;
+            std::string Animation;
+            bool Compress;
+            ClipCompressionSettings Compression;
+            AnimationClipPtr Clip;
+            // the file was read and did not hold the clip, not tried again
+            bool Failed;
+        };
+
+        std::map<std::string, Entry> entries;
+        mutable std::mutex mutex;
+        unsigned int fileLoadCount;
+
+        void loadFile(const std::string& file);
+};
+
+#endif
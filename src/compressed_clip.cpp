@@ -0,0 +1,286 @@
+#include "compressed_clip.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "animation_clip.hpp"
+
+static const float QUANTIZED_MAX = 65535.0f;
+// smallest-three components lie within +-1/sqrt(2) and keep 15 bits, the top bits
+// of the first two hold the index of the component left out
+static const float SMALLEST_THREE_MAX = 32767.0f;
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+
+static uint16_t quantize(float value, float min, float extent)
+{
+    if (extent <= 0.0f)
+        return 0;
+    return (uint16_t)std::floor((value - min) / extent * QUANTIZED_MAX + 0.5f);
+}
+
+static float dequantize(uint16_t value, float min, float extent)
+{
+    return min + value / QUANTIZED_MAX * extent;
+}
+
+static void encodeRotation(glm::vec4 q, uint16_t* out)
+{
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (std::fabs(q[i]) > std::fabs(q[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, the one with a positive largest component is kept
+    if (q[largest] < 0.0f)
+        q = -1.0f * q;
+
+    for (int i = 0, j = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        float normalized = glm::clamp(q[i] / SMALLEST_THREE_RANGE * 0.5f + 0.5f, 0.0f, 1.0f);
+        out[j++] = (uint16_t)std::floor(normalized * SMALLEST_THREE_MAX + 0.5f);
+    }
+    out[0] |= (uint16_t)((largest & 1) << 15);
+    out[1] |= (uint16_t)((largest >> 1) << 15);
+}
+
+static glm::vec4 decodeRotation(const uint16_t* in)
+{
+    int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+
+    glm::vec4 q(0.0f);
+    float sum = 0.0f;
+    for (int i = 0, j = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        q[i] = ((in[j++] & 0x7fff) / SMALLEST_THREE_MAX * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+        sum += q[i] * q[i];
+    }
+    q[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+    return q;
+}
+
+static glm::vec4 interpolate(bool rotation, const glm::vec4& a, glm::vec4 b, float t)
+{
+    if (!rotation)
+        return a + (b - a) * t;
+
+    // rotations: normalised lerp along the shorter arc
+    float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    if (dot < 0.0f)
+        b = -1.0f * b;
+    glm::vec4 q = a + (b - a) * t;
+    return q * (1.0f / std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w));
+}
+
+// translations and scales by distance, rotations by the arc at reach from the joint
+static float keyError(bool rotation, const glm::vec4& a, const glm::vec4& b, float reach)
+{
+    if (!rotation)
+    {
+        glm::vec4 d = a - b;
+        return std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+    }
+
+    float dot = std::min(std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w), 1.0f);
+    return 2.0f * std::acos(dot) * reach;
+}
+
+CompressedClip::CompressedClip()
+{
+}
+
+void CompressedClip::Compress(unsigned int frameCount, unsigned int channelCount, unsigned int channelStride, const float* samples,
+                              const std::vector<float>& tolerances, float reach)
+{
+    Clear();
+    channels.resize(channelCount);
+
+    std::vector<glm::vec4> translations(frameCount), rotations(frameCount), scales(frameCount);
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        for (unsigned int f = 0; f < frameCount; f++)
+        {
+            const float* frame = samples + f * CLIP_COMPONENTS * channelStride + c;
+            translations[f] = glm::vec4(frame[CLIP_TX * channelStride], frame[CLIP_TY * channelStride], frame[CLIP_TZ * channelStride], 0.0f);
+            rotations[f] = glm::vec4(frame[CLIP_RX * channelStride], frame[CLIP_RY * channelStride], frame[CLIP_RZ * channelStride], frame[CLIP_RW * channelStride]);
+            scales[f] = glm::vec4(frame[CLIP_SX * channelStride], frame[CLIP_SY * channelStride], frame[CLIP_SZ * channelStride], 0.0f);
+        }
+
+        Channel& channel = channels[c];
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            float translationMin = translations[0][k], translationMax = translations[0][k];
+            float scaleMin = scales[0][k], scaleMax = scales[0][k];
+            for (unsigned int f = 1; f < frameCount; f++)
+            {
+                translationMin = std::min(translationMin, translations[f][k]);
+                translationMax = std::max(translationMax, translations[f][k]);
+                scaleMin = std::min(scaleMin, scales[f][k]);
+                scaleMax = std::max(scaleMax, scales[f][k]);
+            }
+            channel.TranslationMin[k] = translationMin;
+            channel.TranslationExtent[k] = translationMax - translationMin;
+            channel.ScaleMin[k] = scaleMin;
+            channel.ScaleExtent[k] = scaleMax - scaleMin;
+        }
+
+        compressTrack(TRACK_TRANSLATION, translations, tolerances[c], reach, channel);
+        compressTrack(TRACK_ROTATION, rotations, tolerances[c], reach, channel);
+        compressTrack(TRACK_SCALE, scales, tolerances[c], reach, channel);
+    }
+
+    keyFrames.shrink_to_fit();
+    keyValues.shrink_to_fit();
+}
+
+void CompressedClip::Clear()
+{
+    channels.clear();
+    keyFrames.clear();
+    keyValues.clear();
+}
+
+void CompressedClip::DecompressFrame(unsigned int frame, unsigned int channelStride, float* planes) const
+{
+    unsigned int channelCount = (unsigned int)channels.size();
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        glm::vec4 translation = sampleTrack(TRACK_TRANSLATION, channels[c], frame);
+        glm::vec4 rotation = sampleTrack(TRACK_ROTATION, channels[c], frame);
+        glm::vec4 scale = sampleTrack(TRACK_SCALE, channels[c], frame);
+
+        planes[CLIP_TX * channelStride + c] = translation.x;
+        planes[CLIP_TY * channelStride + c] = translation.y;
+        planes[CLIP_TZ * channelStride + c] = translation.z;
+        planes[CLIP_RX * channelStride + c] = rotation.x;
+        planes[CLIP_RY * channelStride + c] = rotation.y;
+        planes[CLIP_RZ * channelStride + c] = rotation.z;
+        planes[CLIP_RW * channelStride + c] = rotation.w;
+        planes[CLIP_SX * channelStride + c] = scale.x;
+        planes[CLIP_SY * channelStride + c] = scale.y;
+        planes[CLIP_SZ * channelStride + c] = scale.z;
+    }
+
+    for (unsigned int k = 0; k < CLIP_COMPONENTS; k++)
+    {
+        float identity = (k == CLIP_RW || k >= CLIP_SX) ? 1.0f : 0.0f;
+        std::fill(planes + k * channelStride + channelCount, planes + (k + 1) * channelStride, identity);
+    }
+}
+
+void CompressedClip::DecompressSample(unsigned int frame, unsigned int channel, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const
+{
+    glm::vec4 t = sampleTrack(TRACK_TRANSLATION, channels[channel], frame);
+    glm::vec4 r = sampleTrack(TRACK_ROTATION, channels[channel], frame);
+    glm::vec4 s = sampleTrack(TRACK_SCALE, channels[channel], frame);
+    translation = glm::vec3(t.x, t.y, t.z);
+    rotation = glm::quat(r.w, r.x, r.y, r.z);
+    scale = glm::vec3(s.x, s.y, s.z);
+}
+
+size_t CompressedClip::MemorySize() const
+{
+    return sizeof(CompressedClip) + channels.capacity() * sizeof(Channel) +
+           keyFrames.capacity() * sizeof(uint16_t) + keyValues.capacity() * sizeof(uint16_t);
+}
+
+// Greedy key reduction: from every kept key, the next one is the furthest frame that
+// still restores every frame in between within tolerance. The test uses the keys as
+// they decode after quantization, so the quantization error is part of the budget.
+void CompressedClip::compressTrack(TrackType type, const std::vector<glm::vec4>& values, float tolerance, float reach, Channel& channel)
+{
+    unsigned int frameCount = (unsigned int)values.size();
+    bool rotation = type == TRACK_ROTATION;
+    unsigned int firstValue = (unsigned int)keyValues.size();
+
+    // quantize every frame once, the keys are picked among them
+    std::vector<uint16_t> quantized(frameCount * 3);
+    std::vector<glm::vec4> decoded(frameCount);
+    for (unsigned int f = 0; f < frameCount; f++)
+    {
+        uint16_t* key = &quantized[f * 3];
+        if (rotation)
+        {
+            encodeRotation(values[f], key);
+            decoded[f] = decodeRotation(key);
+        }
+        else
+        {
+            const float* min = type == TRACK_TRANSLATION ? channel.TranslationMin : channel.ScaleMin;
+            const float* extent = type == TRACK_TRANSLATION ? channel.TranslationExtent : channel.ScaleExtent;
+            decoded[f] = glm::vec4(0.0f);
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                key[k] = quantize(values[f][k], min[k], extent[k]);
+                decoded[f][k] = dequantize(key[k], min[k], extent[k]);
+            }
+        }
+    }
+
+    // a track that never moves needs only its first key
+    bool constant = true;
+    for (unsigned int f = 1; f < frameCount && constant; f++)
+        constant = keyError(rotation, decoded[0], values[f], reach) <= tolerance;
+
+    std::vector<unsigned int> keys(1, 0);
+    unsigned int start = 0;
+    while (!constant && start + 1 < frameCount)
+    {
+        unsigned int end = start + 1;
+        for (unsigned int candidate = end + 1; candidate < frameCount; candidate++)
+        {
+            bool fits = true;
+            for (unsigned int f = start + 1; f < candidate && fits; f++)
+            {
+                float t = (float)(f - start) / (float)(candidate - start);
+                fits = keyError(rotation, interpolate(rotation, decoded[start], decoded[candidate], t), values[f], reach) <= tolerance;
+            }
+            if (!fits)
+                break;
+            end = candidate;
+        }
+        keys.push_back(end);
+        start = end;
+    }
+
+    Track& track = channel.Tracks[type];
+    track.FirstKey = (unsigned int)keyFrames.size();
+    track.KeyCount = (unsigned int)keys.size();
+    keyValues.resize(firstValue + keys.size() * 3);
+    for (unsigned int i = 0; i < keys.size(); i++)
+    {
+        keyFrames.push_back((uint16_t)keys[i]);
+        std::copy(&quantized[keys[i] * 3], &quantized[keys[i] * 3] + 3, &keyValues[firstValue + i * 3]);
+    }
+}
+
+glm::vec4 CompressedClip::decodeKey(TrackType type, const Channel& channel, unsigned int key) const
+{
+    const uint16_t* value = &keyValues[key * 3];
+    if (type == TRACK_ROTATION)
+        return decodeRotation(value);
+
+    const float* min = type == TRACK_TRANSLATION ? channel.TranslationMin : channel.ScaleMin;
+    const float* extent = type == TRACK_TRANSLATION ? channel.TranslationExtent : channel.ScaleExtent;
+    return glm::vec4(dequantize(value[0], min[0], extent[0]), dequantize(value[1], min[1], extent[1]), dequantize(value[2], min[2], extent[2]), 0.0f);
+}
+
+glm::vec4 CompressedClip::sampleTrack(TrackType type, const Channel& channel, unsigned int frame) const
+{
+    const Track& track = channel.Tracks[type];
+    const uint16_t* first = &keyFrames[track.FirstKey];
+    const uint16_t* last = first + track.KeyCount;
+
+    // the last key at or before the frame
+    unsigned int key = (unsigned int)(std::upper_bound(first, last, (uint16_t)frame) - first);
+    key = key > 0 ? key - 1 : 0;
+    if (key + 1 >= track.KeyCount || first[key] == frame)
+        return decodeKey(type, channel, track.FirstKey + key);
+
+    float t = (float)(frame - first[key]) / (float)(first[key + 1] - first[key]);
+    return interpolate(type == TRACK_ROTATION, decodeKey(type, channel, track.FirstKey + key), decodeKey(type, channel, track.FirstKey + key + 1), t);
+}
@@ -0,0 +1,78 @@
+#ifndef COMPRESSED_CLIP_H
+#define COMPRESSED_CLIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+// How far a compressed clip may stray from the baked one
+struct ClipCompressionSettings
+{
+    // largest error of a key left out: model units for translations, scale units for
+    // scales, and model units at Reach from the joint for rotations
+    float Tolerance;
+    float Reach;
+    // Tolerance overrides by channel (bone) name, e.g. tighter for the hips
+    std::map<std::string, float> ChannelTolerances;
+
+    ClipCompressionSettings() : Tolerance(0.001f), Reach(1.0f) {}
+};
+
+// The samples of a baked clip with every key that linear interpolation can restore
+// within tolerance left out. Each track (translation, rotation or scale of one
+// channel) keeps the frame index of its remaining keys and three 16 bit values per
+// key: rotations as smallest-three quaternions, translations and scales quantized
+// over the range of their channel. Frames are rebuilt on the fly for the pose
+// kernels, one binary search per track.
+class CompressedClip
+{
+    public:
+        CompressedClip();
+
+        // samples in the AnimationClip layout, tolerances one per channel
+        void Compress(unsigned int frameCount, unsigned int channelCount, unsigned int channelStride, const float* samples,
+                      const std::vector<float>& tolerances, float reach);
+        void Clear();
+
+        // Writes the CLIP_COMPONENTS planes of one frame, padding lanes as the identity
+        void DecompressFrame(unsigned int frame, unsigned int channelStride, float* planes) const;
+        void DecompressSample(unsigned int frame, unsigned int channel, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const;
+
+        bool Empty() const { return channels.empty(); }
+        unsigned int KeyCount() const { return (unsigned int)keyFrames.size(); }
+        size_t MemorySize() const;
+
+    private:
+        enum TrackType { TRACK_TRANSLATION, TRACK_ROTATION, TRACK_SCALE, TRACK_TYPES };
+
+        struct Track
+        {
+            unsigned int FirstKey;
+            unsigned int KeyCount;
+        };
+
+        struct Channel
+        {
+            Track Tracks[TRACK_TYPES];
+            // quantization ranges of the translation and scale tracks
+            float TranslationMin[3], TranslationExtent[3];
+            float ScaleMin[3], ScaleExtent[3];
+        };
+
+        std::vector<Channel> channels;
+        // frame of every key, the keys of a track are consecutive
+        std::vector<uint16_t> keyFrames;
+        // three quantized values per key
+        std::vector<uint16_t> keyValues;
+
+        void compressTrack(TrackType type, const std::vector<glm::vec4>& values, float tolerance, float reach, Channel& channel);
+        glm::vec4 decodeKey(TrackType type, const Channel& channel, unsigned int key) const;
+        glm::vec4 sampleTrack(TrackType type, const Channel& channel, unsigned int frame) const;
+};
+
+#endif
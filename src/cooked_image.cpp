@@ -0,0 +1,247 @@
+#include "cooked_image.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "texture.hpp"
+
+static const char COOKED_IMAGE_MAGIC[4] = { 'D', 'G', 'T', 'X' };
+static const uint32_t COOKED_IMAGE_ALIGNMENT = 16;
+
+std::string CookedImagePath(const std::string& imagePath)
+{
+    size_t slash = imagePath.find_last_of("/\\");
+    size_t dot = imagePath.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = imagePath.size();
+    return imagePath.substr(0, dot) + COOKED_IMAGE_EXTENSION;
+}
+
+bool HashFileContents(const std::string& path, uint64_t& hash)
+{
+    FileView file;
+    if (!Vfs::Open(path, file))
+        return false;
+
+    hash = 14695981039346656037ULL;
+    const unsigned char* data = file.Data();
+    for (size_t i = 0; i < file.Size(); i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return true;
+}
+
+static unsigned int levelCount(unsigned int width, unsigned int height)
+{
+    unsigned int count = 1;
+    while ((width > 1 || height > 1) && count < COOKED_IMAGE_MAX_LEVELS)
+    {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        count++;
+    }
+    return count;
+}
+
+void BuildMipChain(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+                   std::vector<std::vector<unsigned char> >& levels)
+{
+    levels.resize(levelCount(width, height));
+    levels[0].assign(pixels, pixels + (size_t)width * height * channels);
+
+    for (unsigned int level = 1; level < levels.size(); level++)
+    {
+        const std::vector<unsigned char>& source = levels[level - 1];
+        unsigned int levelWidth = std::max(width / 2, 1u);
+        unsigned int levelHeight = std::max(height / 2, 1u);
+        levels[level].resize((size_t)levelWidth * levelHeight * channels);
+
+        for (unsigned int y = 0; y < levelHeight; y++)
+        {
+            // a side of 1 texel takes the same one twice
+            unsigned int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (unsigned int x = 0; x < levelWidth; x++)
+            {
+                unsigned int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (unsigned int c = 0; c < channels; c++)
+                {
+                    unsigned int sum = source[((size_t)y0 * width + x0) * channels + c] + source[((size_t)y0 * width + x1) * channels + c] +
+                                       source[((size_t)y1 * width + x0) * channels + c] + source[((size_t)y1 * width + x1) * channels + c];
+                    levels[level][((size_t)y * levelWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        width = levelWidth;
+        height = levelHeight;
+    }
+}
+
+bool WriteCookedImage(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height,
+                      unsigned int channels, uint64_t sourceHash)
+{
+    std::vector<std::vector<unsigned char> > levels;
+    BuildMipChain(pixels, width, height, channels, levels);
+
+    CookedImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, COOKED_IMAGE_MAGIC, sizeof(COOKED_IMAGE_MAGIC));
+    header.Version = COOKED_IMAGE_VERSION;
+    header.Width = width;
+    header.Height = height;
+    header.Channels = channels;
+    header.LevelCount = (uint32_t)levels.size();
+    header.SourceHash = sourceHash;
+
+    std::vector<char> image(sizeof(header), 0);
+    for (unsigned int level = 0; level < levels.size(); level++)
+    {
+        image.resize((image.size() + COOKED_IMAGE_ALIGNMENT - 1) / COOKED_IMAGE_ALIGNMENT * COOKED_IMAGE_ALIGNMENT, 0);
+        header.Levels[level].Offset = (uint32_t)image.size();
+        header.Levels[level].Width = width;
+        header.Levels[level].Height = height;
+        header.Levels[level].Size = (uint32_t)levels[level].size();
+        image.insert(image.end(), levels[level].begin(), levels[level].end());
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    if (image.size() > UINT32_MAX)
+    {
+        std::cout << "ERROR::COOKED_IMAGE: " << path << " would be larger than 4 GB" << std::endl;
+        return false;
+    }
+    header.FileSize = (uint32_t)image.size();
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    // written aside and moved in place, so a reader never maps a half written file
+    std::ostringstream temporary;
+    temporary << path << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    {
+        std::ofstream file(temporary.str().c_str(), std::ios::binary | std::ios::trunc);
+        file.write(image.data(), image.size());
+        if (!file)
+        {
+            std::cout << "ERROR::COOKED_IMAGE: Failed to write " << path << std::endl;
+            file.close();
+            std::remove(temporary.str().c_str());
+            return false;
+        }
+    }
+    // Windows does not rename over an existing file
+    if (std::rename(temporary.str().c_str(), path.c_str()) != 0 &&
+        (std::remove(path.c_str()) != 0 || std::rename(temporary.str().c_str(), path.c_str()) != 0))
+    {
+        std::cout << "ERROR::COOKED_IMAGE: Failed to write " << path << std::endl;
+        std::remove(temporary.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+CookedImage::CookedImage() : header(nullptr)
+{
+}
+
+bool CookedImage::Open(const std::string& path)
+{
+    Close();
+    if (!Vfs::Open(path, file))
+        return false;
+    return opened(path);
+}
+
+bool CookedImage::OpenOnDisk(const std::string& path)
+{
+    Close();
+    if (!Vfs::OpenOnDisk(path, file))
+        return false;
+    return opened(path);
+}
+
+bool CookedImage::opened(const std::string& path)
+{
+    header = (const CookedImageHeader*)file.Data();
+    if (!validate(path))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CookedImage::Close()
+{
+    file.Close();
+    header = nullptr;
+}
+
+size_t CookedImage::PixelSize() const
+{
+    size_t size = 0;
+    for (unsigned int level = 0; level < header->LevelCount; level++)
+        size += header->Levels[level].Size;
+    return size;
+}
+
+bool CookedImage::validate(const std::string& path) const
+{
+    size_t size = file.Size();
+    if (size < sizeof(CookedImageHeader) || std::memcmp(header->Magic, COOKED_IMAGE_MAGIC, sizeof(COOKED_IMAGE_MAGIC)) != 0)
+    {
+        std::cout << "ERROR::COOKED_IMAGE: " << path << " is not a cooked image" << std::endl;
+        return false;
+    }
+    // an older cooked image is simply cooked again
+    if (header->Version != COOKED_IMAGE_VERSION)
+        return false;
+
+    bool valid = header->FileSize == size && header->Width > 0 && header->Height > 0 &&
+                 header->Channels >= 1 && header->Channels <= 4 &&
+                 header->LevelCount == levelCount(header->Width, header->Height);
+
+    unsigned int width = header->Width, height = header->Height;
+    for (unsigned int level = 0; valid && level < header->LevelCount; level++)
+    {
+        const CookedImageLevel& range = header->Levels[level];
+        valid = range.Width == width && range.Height == height && (uint64_t)range.Size == (uint64_t)width * height * header->Channels &&
+                range.Offset % COOKED_IMAGE_ALIGNMENT == 0 && range.Offset <= size && range.Size <= size - range.Offset;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    if (!valid)
+        std::cout << "ERROR::COOKED_IMAGE: " << path << " is damaged" << std::endl;
+    return valid;
+}
+
+bool OpenCookedImage(const std::string& imagePath, CookedImage& cooked)
+{
+    std::string cookedPath = CookedImagePath(imagePath);
+    uint64_t hash;
+    if (!HashFileContents(imagePath, hash))
+        return cooked.Open(cookedPath);
+
+    if (cooked.Open(cookedPath) && cooked.SourceHash() == hash)
+        return true;
+    // a pack's copy may be stale while the one on disk was cooked again since
+    if (cooked.OpenOnDisk(cookedPath) && cooked.SourceHash() == hash)
+        return true;
+    cooked.Close();
+
+    // missing or stale, cook it again from the image file
+    TextureImage image;
+    if (!DecodeTextureImage(imagePath, image))
+        return false;
+    bool written = WriteCookedImage(cookedPath, image.Pixels, image.Width, image.Height, image.Channels, hash);
+    FreeTextureImage(image);
+    // not Open, which would find the stale copy in the pack again
+    return written && cooked.OpenOnDisk(cookedPath);
+}
@@ -0,0 +1,100 @@
+#ifndef COOKED_IMAGE_H
+#define COOKED_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vfs.hpp"
+
+// Cooked images sit next to the image file they were cooked from with this extension
+const char* const COOKED_IMAGE_EXTENSION = ".dgt";
+// Bumped whenever the layout changes, older files are cooked again
+const uint32_t COOKED_IMAGE_VERSION = 1;
+// Enough for a 32768 texel wide image
+const unsigned int COOKED_IMAGE_MAX_LEVELS = 16;
+
+// The cooked file of an image file
+std::string CookedImagePath(const std::string& imagePath);
+
+// FNV-1a over the contents of a file, false when it cannot be read
+bool HashFileContents(const std::string& path, uint64_t& hash);
+
+// One image of the mip chain, its texels tightly packed
+struct CookedImageLevel
+{
+    uint32_t Offset;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Size;
+};
+
+// The file layout, little-endian. The header, then the mip levels from the full size
+// image down to 1x1, each aligned to 16 bytes. Offsets are from the start of the file
+struct CookedImageHeader
+{
+    char Magic[4];
+    uint32_t Version;
+    uint32_t FileSize;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Channels;
+    uint32_t LevelCount;
+    uint32_t Reserved;
+    // of the contents of the image file it was cooked from, a different hash makes it stale
+    uint64_t SourceHash;
+    CookedImageLevel Levels[COOKED_IMAGE_MAX_LEVELS];
+};
+
+// The mip chain of 8 bit texels, each level half the size of the one before (rounded
+// down, at least 1) and every texel the average of the 2x2 texels above it
+void BuildMipChain(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+                   std::vector<std::vector<unsigned char> >& levels);
+
+bool WriteCookedImage(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height,
+                      unsigned int channels, uint64_t sourceHash);
+
+// A cooked image file mapped into memory. The levels are checked once when the file is
+// opened, then go from the mapping straight to the GPU, no inflate and no mipmap
+// generation in the driver.
+class CookedImage
+{
+    public:
+        CookedImage();
+
+        // False when the file is missing, not a cooked image of this version or damaged
+        bool Open(const std::string& path);
+        // The same for the file on disk, past any pack that has one of that path
+        bool OpenOnDisk(const std::string& path);
+        void Close();
+        bool IsOpen() const { return header != nullptr; }
+
+        unsigned int Width() const { return header->Width; }
+        unsigned int Height() const { return header->Height; }
+        unsigned int Channels() const { return header->Channels; }
+        unsigned int LevelCount() const { return header->LevelCount; }
+        const CookedImageLevel& Level(unsigned int level) const { return header->Levels[level]; }
+        const unsigned char* LevelPixels(unsigned int level) const { return file.Data() + header->Levels[level].Offset; }
+        uint64_t SourceHash() const { return header->SourceHash; }
+
+        // bytes of every level together
+        size_t PixelSize() const;
+        size_t FileSize() const { return file.Size(); }
+
+    private:
+        FileView file;
+        const CookedImageHeader* header;
+
+        // checks the file just mapped, closing it again when it fails
+        bool opened(const std::string& path);
+        bool validate(const std::string& path) const;
+};
+
+// Thread safe for different files. Opens the cooked copy of an image file, cooking it
+// first when it is missing, of an older version or cooked from other contents than
+// the file has now. Without the image file whatever cooked copy there is opens. False
+// when neither works, the caller can still decode the image itself
+bool OpenCookedImage(const std::string& imagePath, CookedImage& cooked);
+
+#endif
@@ -0,0 +1,307 @@
+#include "cooked_model.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+// the arrays below are written and mapped back as they are
+static_assert(sizeof(ModelVertex) == 64, "ModelVertex must be tightly packed");
+static_assert(sizeof(ModelSubmesh) == 16, "ModelSubmesh must be tightly packed");
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "glm::mat4 must be tightly packed");
+static_assert(sizeof(unsigned int) == sizeof(uint32_t), "indices are stored as 32 bits");
+
+static const char COOKED_MODEL_MAGIC[4] = { 'D', 'G', 'M', 'D' };
+static const uint32_t COOKED_MODEL_ALIGNMENT = 16;
+
+std::string CookedModelPath(const std::string& modelPath)
+{
+    size_t slash = modelPath.find_last_of("/\\");
+    size_t dot = modelPath.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = modelPath.size();
+    return modelPath.substr(0, dot) + COOKED_MODEL_EXTENSION;
+}
+
+// Appends an array to the file image at the next aligned offset
+static CookedSection appendSection(std::vector<char>& image, const void* items, size_t itemSize, size_t count)
+{
+    image.resize((image.size() + COOKED_MODEL_ALIGNMENT - 1) / COOKED_MODEL_ALIGNMENT * COOKED_MODEL_ALIGNMENT, 0);
+
+    CookedSection section;
+    section.Offset = (uint32_t)image.size();
+    section.Count = (uint32_t)count;
+    if (count > 0)
+        image.insert(image.end(), (const char*)items, (const char*)items + itemSize * count);
+    return section;
+}
+
+static CookedString appendString(std::string& strings, const std::string& value)
+{
+    CookedString string;
+    string.Offset = (uint32_t)strings.size();
+    string.Length = (uint32_t)value.size();
+    strings += value;
+    return string;
+}
+
+bool WriteCookedModel(const std::string& path, const ModelData& data)
+{
+    std::string strings;
+
+    std::vector<CookedTexture> textures(data.Textures.size());
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        textures[i].Type = appendString(strings, data.Textures[i].Type);
+        textures[i].Path = appendString(strings, data.Textures[i].Path);
+    }
+
+    const Skeleton& rig = data.Rig;
+    std::vector<CookedNode> nodes(rig.NodeCount());
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        nodes[i].Name = appendString(strings, rig.NodeNames[i]);
+        nodes[i].Parent = rig.Parents[i];
+        nodes[i].Bone = rig.BoneIndices[i];
+        std::memcpy(nodes[i].BindTransform, glm::value_ptr(rig.BindTransforms[i]), sizeof(nodes[i].BindTransform));
+    }
+
+    std::vector<CookedClip> clips(data.Clips.size());
+    std::vector<CookedString> channelNames;
+    std::vector<float> samples;
+    for (unsigned int i = 0; i < clips.size(); i++)
+    {
+        const AnimationClip& clip = data.Clips[i];
+        if (clip.IsCompressed())
+        {
+            std::cout << "ERROR::COOKED_MODEL: Clip " << clip.Name << " is compressed, only baked clips are cooked" << std::endl;
+            return false;
+        }
+
+        clips[i].Name = appendString(strings, clip.Name);
+        clips[i].Duration = clip.Duration;
+        clips[i].SampleRate = clip.SampleRate;
+        clips[i].FrameCount = clip.FrameCount;
+        clips[i].ChannelCount = clip.ChannelCount;
+        clips[i].ChannelStride = clip.ChannelStride;
+        clips[i].FirstChannelName = (uint32_t)channelNames.size();
+        clips[i].FirstSample = (uint32_t)samples.size();
+        for (unsigned int c = 0; c < clip.ChannelCount; c++)
+            channelNames.push_back(appendString(strings, clip.ChannelNames[c]));
+        samples.insert(samples.end(), clip.Samples.begin(), clip.Samples.end());
+    }
+
+    CookedModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, COOKED_MODEL_MAGIC, sizeof(header.Magic));
+    header.Version = COOKED_MODEL_VERSION;
+    std::memcpy(header.GlobalInverseTransform, glm::value_ptr(rig.GlobalInverseTransform), sizeof(header.GlobalInverseTransform));
+
+    // the header is filled in last, once every section has its offset
+    std::vector<char> image(sizeof(CookedModelHeader), 0);
+    header.Vertices = appendSection(image, data.Vertices.data(), sizeof(ModelVertex), data.Vertices.size());
+    header.Indices = appendSection(image, data.Indices.data(), sizeof(unsigned int), data.Indices.size());
+    header.Submeshes = appendSection(image, data.Submeshes.data(), sizeof(ModelSubmesh), data.Submeshes.size());
+    header.Textures = appendSection(image, textures.data(), sizeof(CookedTexture), textures.size());
+    header.Nodes = appendSection(image, nodes.data(), sizeof(CookedNode), nodes.size());
+    header.BoneOffsets = appendSection(image, rig.BoneOffsets.data(), sizeof(glm::mat4), rig.BoneOffsets.size());
+    header.Clips = appendSection(image, clips.data(), sizeof(CookedClip), clips.size());
+    header.ChannelNames = appendSection(image, channelNames.data(), sizeof(CookedString), channelNames.size());
+    header.Samples = appendSection(image, samples.data(), sizeof(float), samples.size());
+    header.Strings = appendSection(image, strings.data(), 1, strings.size());
+
+    if (image.size() > UINT32_MAX)
+    {
+        std::cout << "ERROR::COOKED_MODEL: " << path << " would be larger than 4 GB" << std::endl;
+        return false;
+    }
+    header.FileSize = (uint32_t)image.size();
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(image.data(), image.size());
+    if (!file)
+    {
+        std::cout << "ERROR::COOKED_MODEL: Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+CookedModel::CookedModel() : header(nullptr)
+{
+}
+
+bool CookedModel::Open(const std::string& path)
+{
+    Close();
+    if (!Vfs::Open(path, file))
+        return false;
+
+    // views start on a page or on a 16 byte aligned pack entry, every section is aligned from there
+    header = (const CookedModelHeader*)file.Data();
+    if (!validate(path))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CookedModel::Close()
+{
+    file.Close();
+    header = nullptr;
+}
+
+void CookedModel::ReadTextures(std::vector<ModelTexture>& textures) const
+{
+    const CookedTexture* cooked = section<CookedTexture>(header->Textures);
+    textures.resize(header->Textures.Count);
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        textures[i].Type = readString(cooked[i].Type);
+        textures[i].Path = readString(cooked[i].Path);
+    }
+}
+
+void CookedModel::ReadSkeleton(Skeleton& skeleton) const
+{
+    const CookedNode* nodes = section<CookedNode>(header->Nodes);
+    unsigned int nodeCount = header->Nodes.Count;
+    skeleton.NodeNames.resize(nodeCount);
+    skeleton.Parents.resize(nodeCount);
+    skeleton.BindTransforms.resize(nodeCount);
+    skeleton.BoneIndices.resize(nodeCount);
+    for (unsigned int i = 0; i < nodeCount; i++)
+    {
+        skeleton.NodeNames[i] = readString(nodes[i].Name);
+        skeleton.Parents[i] = nodes[i].Parent;
+        skeleton.BindTransforms[i] = glm::make_mat4(nodes[i].BindTransform);
+        skeleton.BoneIndices[i] = nodes[i].Bone;
+    }
+
+    const glm::mat4* boneOffsets = section<glm::mat4>(header->BoneOffsets);
+    skeleton.BoneOffsets.assign(boneOffsets, boneOffsets + header->BoneOffsets.Count);
+    skeleton.GlobalInverseTransform = glm::make_mat4(header->GlobalInverseTransform);
+    skeleton.Prepare();
+}
+
+void CookedModel::ReadClips(std::vector<AnimationClip>& clips) const
+{
+    const CookedClip* cooked = section<CookedClip>(header->Clips);
+    const CookedString* channelNames = section<CookedString>(header->ChannelNames);
+    const float* samples = section<float>(header->Samples);
+
+    clips.assign(header->Clips.Count, AnimationClip());
+    for (unsigned int i = 0; i < clips.size(); i++)
+    {
+        AnimationClip& clip = clips[i];
+        clip.Name = readString(cooked[i].Name);
+        clip.Duration = cooked[i].Duration;
+        clip.SampleRate = cooked[i].SampleRate;
+        clip.Resize(cooked[i].FrameCount, cooked[i].ChannelCount);
+        for (unsigned int c = 0; c < clip.ChannelCount; c++)
+            clip.ChannelNames[c] = readString(channelNames[cooked[i].FirstChannelName + c]);
+
+        // plane by plane, the stored planes may be padded to another kernel width
+        const float* planes = samples + cooked[i].FirstSample;
+        for (unsigned int plane = 0; plane < clip.FrameCount * CLIP_COMPONENTS; plane++)
+            std::copy(planes + plane * cooked[i].ChannelStride, planes + plane * cooked[i].ChannelStride + clip.ChannelCount,
+                      clip.Samples.begin() + plane * clip.ChannelStride);
+    }
+}
+
+std::string CookedModel::readString(const CookedString& range) const
+{
+    return std::string(section<char>(header->Strings) + range.Offset, range.Length);
+}
+
+static bool sectionFits(const CookedSection& range, size_t itemSize, size_t fileSize)
+{
+    return range.Offset % COOKED_MODEL_ALIGNMENT == 0 && range.Offset <= fileSize && (fileSize - range.Offset) / itemSize >= range.Count;
+}
+
+static bool stringFits(const CookedString& range, const CookedSection& strings)
+{
+    return range.Offset <= strings.Count && range.Length <= strings.Count - range.Offset;
+}
+
+// Every count and offset is checked once here, so the accessors never have to
+bool CookedModel::validate(const std::string& path) const
+{
+    size_t size = file.Size();
+    if (size < sizeof(CookedModelHeader) || std::memcmp(header->Magic, COOKED_MODEL_MAGIC, sizeof(COOKED_MODEL_MAGIC)) != 0)
+    {
+        std::cout << "ERROR::COOKED_MODEL: " << path << " is not a cooked model" << std::endl;
+        return false;
+    }
+    if (header->Version != COOKED_MODEL_VERSION)
+    {
+        std::cout << "ERROR::COOKED_MODEL: " << path << " was cooked as version " << header->Version
+                  << ", this build reads version " << COOKED_MODEL_VERSION << std::endl;
+        return false;
+    }
+
+    bool valid = header->FileSize == size &&
+                 sectionFits(header->Vertices, sizeof(ModelVertex), size) &&
+                 sectionFits(header->Indices, sizeof(unsigned int), size) &&
+                 sectionFits(header->Submeshes, sizeof(ModelSubmesh), size) &&
+                 sectionFits(header->Textures, sizeof(CookedTexture), size) &&
+                 sectionFits(header->Nodes, sizeof(CookedNode), size) &&
+                 sectionFits(header->BoneOffsets, sizeof(glm::mat4), size) &&
+                 sectionFits(header->Clips, sizeof(CookedClip), size) &&
+                 sectionFits(header->ChannelNames, sizeof(CookedString), size) &&
+                 sectionFits(header->Samples, sizeof(float), size) &&
+                 sectionFits(header->Strings, 1, size);
+
+    // indices and bone ids must stay within their buffers, the GPU and the skinning
+    // kernels do not check them
+    const ModelSubmesh* submeshes = section<ModelSubmesh>(header->Submeshes);
+    const unsigned int* indices = section<unsigned int>(header->Indices);
+    for (unsigned int s = 0; valid && s < header->Submeshes.Count; s++)
+    {
+        const ModelSubmesh& submesh = submeshes[s];
+        valid = submesh.BaseVertex <= header->Vertices.Count && submesh.BaseIndex <= header->Indices.Count &&
+                submesh.IndicesCount <= header->Indices.Count - submesh.BaseIndex;
+        unsigned int vertexCount = valid ? header->Vertices.Count - submesh.BaseVertex : 0;
+        for (unsigned int i = submesh.BaseIndex; valid && i < submesh.BaseIndex + submesh.IndicesCount; i++)
+            valid = indices[i] < vertexCount;
+    }
+
+    const ModelVertex* vertices = section<ModelVertex>(header->Vertices);
+    for (unsigned int v = 0; valid && v < header->Vertices.Count; v++)
+    {
+        for (unsigned int k = 0; k < 4; k++)
+            valid = valid && vertices[v].BoneIDs[k] >= 0 && (uint32_t)vertices[v].BoneIDs[k] < std::max(header->BoneOffsets.Count, 1u);
+    }
+
+    const CookedTexture* textures = section<CookedTexture>(header->Textures);
+    for (unsigned int i = 0; valid && i < header->Textures.Count; i++)
+        valid = stringFits(textures[i].Type, header->Strings) && stringFits(textures[i].Path, header->Strings);
+
+    const CookedNode* nodes = section<CookedNode>(header->Nodes);
+    for (unsigned int i = 0; valid && i < header->Nodes.Count; i++)
+        valid = stringFits(nodes[i].Name, header->Strings) && nodes[i].Parent >= -1 && nodes[i].Parent < (int32_t)i &&
+                nodes[i].Bone >= -1 && nodes[i].Bone < (int32_t)header->BoneOffsets.Count;
+
+    const CookedClip* clips = section<CookedClip>(header->Clips);
+    const CookedString* channelNames = section<CookedString>(header->ChannelNames);
+    for (unsigned int i = 0; valid && i < header->Clips.Count; i++)
+    {
+        const CookedClip& clip = clips[i];
+        uint64_t sampleCount = (uint64_t)clip.FrameCount * CLIP_COMPONENTS * clip.ChannelStride;
+        valid = stringFits(clip.Name, header->Strings) && clip.FrameCount > 0 && clip.SampleRate > 0.0f &&
+                clip.ChannelStride >= clip.ChannelCount &&
+                clip.FirstChannelName <= header->ChannelNames.Count && clip.ChannelCount <= header->ChannelNames.Count - clip.FirstChannelName &&
+                clip.FirstSample <= header->Samples.Count && sampleCount <= header->Samples.Count - clip.FirstSample;
+        for (unsigned int c = 0; valid && c < clip.ChannelCount; c++)
+            valid = stringFits(channelNames[clip.FirstChannelName + c], header->Strings);
+    }
+
+    if (!valid)
+        std::cout << "ERROR::COOKED_MODEL: " << path << " is damaged" << std::endl;
+    return valid;
+}
@@ -0,0 +1,120 @@
+#ifndef COOKED_MODEL_H
+#define COOKED_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vfs.hpp"
+#include "model_data.hpp"
+
+// Cooked models sit next to the file they were cooked from with this extension
+const char* const COOKED_MODEL_EXTENSION = ".dgm";
+// Bumped whenever the layout changes, older files are rejected and imported again
+const uint32_t COOKED_MODEL_VERSION = 1;
+
+// The cooked file of a model file, the path itself for a cooked file
+std::string CookedModelPath(const std::string& modelPath);
+
+// The file layout, little-endian. A header, then sections of plain arrays each aligned
+// to 16 bytes. Offsets are from the start of the file
+struct CookedSection
+{
+    uint32_t Offset;
+    uint32_t Count;
+};
+
+// Range of the string section, not null terminated
+struct CookedString
+{
+    uint32_t Offset;
+    uint32_t Length;
+};
+
+struct CookedModelHeader
+{
+    char Magic[4];
+    uint32_t Version;
+    uint32_t FileSize;
+    CookedSection Vertices;       // ModelVertex, the vertex buffer as it is uploaded
+    CookedSection Indices;        // uint32_t, in vertex cache order within each submesh
+    CookedSection Submeshes;      // ModelSubmesh
+    CookedSection Textures;       // CookedTexture
+    CookedSection Nodes;          // CookedNode, parents before their children
+    CookedSection BoneOffsets;    // glm::mat4
+    CookedSection Clips;          // CookedClip
+    CookedSection ChannelNames;   // CookedString, the channels of every clip in turn
+    CookedSection Samples;        // float, the sample planes of every clip in turn
+    CookedSection Strings;        // char
+    float GlobalInverseTransform[16];
+};
+
+struct CookedTexture
+{
+    CookedString Type;
+    CookedString Path;
+};
+
+struct CookedNode
+{
+    CookedString Name;
+    int32_t Parent;
+    int32_t Bone;
+    float BindTransform[16];
+};
+
+struct CookedClip
+{
+    CookedString Name;
+    float Duration;
+    float SampleRate;
+    uint32_t FrameCount;
+    uint32_t ChannelCount;
+    // channel stride of the stored planes, padding lanes included
+    uint32_t ChannelStride;
+    uint32_t FirstChannelName;
+    uint32_t FirstSample;
+};
+
+// Stores the model as given, clips must be uncompressed
+bool WriteCookedModel(const std::string& path, const ModelData& data);
+
+// A cooked model file mapped into memory. Everything is checked once when the file
+// is opened; the vertex and index arrays are then used in place and go from the
+// mapping straight into the GPU buffers, the skeleton and clips are copied out.
+class CookedModel
+{
+    public:
+        CookedModel();
+
+        // False when the file is missing, not a cooked model of this version or damaged
+        bool Open(const std::string& path);
+        void Close();
+        bool IsOpen() const { return header != nullptr; }
+
+        unsigned int VertexCount() const { return header->Vertices.Count; }
+        const ModelVertex* Vertices() const { return section<ModelVertex>(header->Vertices); }
+        unsigned int IndexCount() const { return header->Indices.Count; }
+        const unsigned int* Indices() const { return section<unsigned int>(header->Indices); }
+        unsigned int SubmeshCount() const { return header->Submeshes.Count; }
+        const ModelSubmesh* Submeshes() const { return section<ModelSubmesh>(header->Submeshes); }
+
+        void ReadTextures(std::vector<ModelTexture>& textures) const;
+        // Ready to evaluate, the skeleton is prepared
+        void ReadSkeleton(Skeleton& skeleton) const;
+        // Padded to the channel alignment of this build, whatever the cooker's was
+        void ReadClips(std::vector<AnimationClip>& clips) const;
+
+        size_t FileSize() const { return file.Size(); }
+
+    private:
+        FileView file;
+        const CookedModelHeader* header;
+
+        template <typename T>
+        const T* section(const CookedSection& range) const { return (const T*)(file.Data() + range.Offset); }
+        std::string readString(const CookedString& range) const;
+        bool validate(const std::string& path) const;
+};
+
+#endif
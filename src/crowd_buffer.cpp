@@ -0,0 +1,66 @@
+#include "crowd_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "gl_state.hpp"
+
+CrowdBuffer::CrowdBuffer() : TBO(0), texture(0), capacity(0), maxTexels(0), instanceCount(0), stride(0)
+{
+}
+
+CrowdBuffer::~CrowdBuffer()
+{
+    if (texture != 0)
+        GlState::DeleteTexture(texture);
+    if (TBO != 0)
+        glDeleteBuffers(1, &TBO);
+}
+
+void CrowdBuffer::Resize(unsigned int instanceCount, unsigned int boneCount)
+{
+    this->instanceCount = instanceCount;
+    stride = (boneCount + 1) * 3;
+    texels.resize((size_t)instanceCount * stride * 4);
+}
+
+void CrowdBuffer::Write(unsigned int instance, const Affine& model, const Affine* palette)
+{
+    float* destination = &texels[(size_t)instance * stride * 4];
+    // an Affine is three rows of four floats, exactly three texels
+    std::memcpy(destination, &model, sizeof(Affine));
+    std::memcpy(destination + 12, palette, (stride / 3 - 1) * sizeof(Affine));
+}
+
+unsigned int CrowdBuffer::UploadBatch(Shader shader, unsigned int first)
+{
+    if (TBO == 0)
+    {
+        glGenBuffers(1, &TBO);
+        glGenTextures(1, &texture);
+        GlState::BindTexture(CROWD_TEXTURE_UNIT, GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, TBO);
+        // GL 3.3 only guarantees 65536 texels, most drivers allow far more
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    }
+
+    if (first >= instanceCount || stride == 0)
+        return 0;
+
+    unsigned int count = std::min(instanceCount - first, std::max((unsigned int)maxTexels / stride, 1u));
+    GLsizeiptr size = (GLsizeiptr)count * stride * 4 * sizeof(float);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, TBO);
+    // orphan the storage of the previous batch, the draw reading it may still be queued
+    capacity = std::max(capacity, size);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, &texels[(size_t)first * stride * 4]);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    GlState::BindTexture(CROWD_TEXTURE_UNIT, GL_TEXTURE_BUFFER, texture);
+
+    shader.SetInteger("crowdPalettes", CROWD_TEXTURE_UNIT);
+    shader.SetInteger("crowdStride", stride);
+
+    return count;
+}
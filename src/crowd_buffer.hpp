@@ -0,0 +1,46 @@
+#ifndef CROWD_BUFFER_H
+#define CROWD_BUFFER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gl_state.hpp"
+#include "shader.hpp"
+#include "pose_kernels.hpp"
+
+// Per-instance data of an instanced crowd draw in one RGBA32F buffer texture. An
+// instance takes three texels for the rows of its model matrix followed by three
+// per bone for its palette, and gritty.vs finds them from gl_InstanceID. A crowd
+// larger than the buffer texture size of the GL is drawn in several batches.
+class CrowdBuffer
+{
+    public:
+        CrowdBuffer();
+        ~CrowdBuffer();
+
+        CrowdBuffer(const CrowdBuffer&) = delete;
+        CrowdBuffer& operator=(const CrowdBuffer&) = delete;
+
+        void Resize(unsigned int instanceCount, unsigned int boneCount);
+        // Safe to call concurrently for different instances
+        void Write(unsigned int instance, const Affine& model, const Affine* palette);
+
+        // Sends the instances from first on that fit in one batch and binds them for
+        // the next draw, returns how many that is. Needs a current GL context
+        unsigned int UploadBatch(Shader shader, unsigned int first);
+
+        unsigned int InstanceCount() const { return instanceCount; }
+
+    private:
+        GLuint TBO, texture;
+        // size of the GL buffer in bytes
+        GLsizeiptr capacity;
+        GLint maxTexels;
+        unsigned int instanceCount;
+        // texels per instance
+        unsigned int stride;
+        std::vector<float> texels;
+};
+
+#endif
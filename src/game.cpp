@@ -1,3 +1,4 @@
+#include <chrono>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
@@ -5,6 +6,8 @@
 #include <imgui.h>
 
 #include "game.hpp"
+#include "gl_state.hpp"
+#include "vfs.hpp"
 
 bool pixelate = true;
 bool freeCam = false;
@@ -17,16 +20,38 @@ static float linearAtt = 0.13f;
 static float quadraticAtt = 0.68f;
 static glm::vec3 lightColor = glm::vec3(0.7f, 0.1f, 0.0f);
 
+// the aim probe runs from chest height straight ahead of the player
+const GLfloat AIM_HEIGHT = 0.15f;
+const GLfloat AIM_RANGE = 10.0f;
+
 Game::Game(GLFWwindow *window, GLuint windowWidth, GLuint windowHeight, GLuint framebufferWidth, GLuint framebufferHeight)
-    : State(GAME_MENU),
+    : State(GAME_LOADING),
       Keys(),
       KeysProcessed(),
       window(window),
       windowWidth(windowWidth),
       windowHeight(windowHeight),
       framebufferWidth(framebufferWidth),
-      framebufferHeight(framebufferHeight)
+      framebufferHeight(framebufferHeight),
+      pixelator(nullptr),
+      textRenderer(nullptr),
+      soundEngine(nullptr),
+      freeCamera(nullptr),
+      player(nullptr),
+      light(nullptr),
+      shadow(nullptr),
+      currentLevel(nullptr),
+      animationSystem(nullptr),
+      horde(nullptr),
+      hitboxTime(0.0),
+      entityDrawQuery(0),
+      entityDrawQueryPending(false),
+      entityDrawVertices(0),
+      entityDrawTime(0.0)
 {
+    aimHit.Character = -1;
+    aimHit.Bone = -1;
+    aimHit.Fraction = 1.0f;
     lastMouseX = windowWidth / 2.0f;
     lastMouseY = windowHeight / 2.0f;
     firstMouse = true;
@@ -34,6 +59,12 @@ Game::Game(GLFWwindow *window, GLuint windowWidth, GLuint windowHeight, GLuint f
 
 Game::~Game()
 {
+    releaseResources();
+    entityAtlas.reset();
+    if (entityDrawQuery != 0)
+        glDeleteQueries(1, &entityDrawQuery);
+    delete horde;
+    delete animationSystem;
     delete shadow;
     delete light;
     delete player;
@@ -41,7 +72,8 @@ Game::~Game()
     delete pixelator;
     delete freeCamera;
     delete currentLevel;
-    soundEngine->drop();
+    if (soundEngine != nullptr)
+        soundEngine->drop();
 }
 
 void Game::SetFramebufferSize(GLuint windowWidth, GLuint windowHeight, GLuint framebufferWidth, GLuint framebufferHeight)
@@ -51,49 +83,70 @@ void Game::SetFramebufferSize(GLuint windowWidth, GLuint windowHeight, GLuint fr
     this->framebufferWidth = framebufferWidth;
     this->framebufferHeight = framebufferHeight;
 
-    updateCamera();
+    // the camera follows the player, there is none while the first level loads
+    if (player != nullptr)
+        updateCamera();
 
     pixelator->SetFramebufferSize(windowWidth, windowHeight, framebufferWidth, framebufferHeight);
 }
 
 void Game::Init()
 {
-    // Load shaders
-    ResourceManager::LoadShader("../src/shaders/gritty.vs", "../src/shaders/gritty.fs", nullptr, "gritty");
-    ResourceManager::LoadShader("../src/shaders/text.vs", "../src/shaders/text.fs", nullptr, "text");
-    ResourceManager::LoadShader("../src/shaders/normalizer.vs", "../src/shaders/normalizer.fs", "../src/shaders/normalizer.gs", "normalizer");
-
-    // Load Textures
-    ResourceManager::LoadTexture("../assets/tiles.png", GL_TRUE, "tiles", GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
-    ResourceManager::LoadTexture("../assets/player.png", GL_FALSE, "player", GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
-    ResourceManager::LoadTexture("../assets/test.png", GL_FALSE, "test", GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
-    ResourceManager::LoadTexture("../assets/shadow.png", GL_TRUE, "shadow", GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
-
-    // Configure Text Renderer
-    glm::mat4 ortho = glm::ortho(0.0f, static_cast<GLfloat>(windowWidth), static_cast<GLfloat>(windowHeight), 0.0f, -1.0f, 1.0f);
-    ResourceManager::GetShader("text").Use().SetMatrix4("projection", ortho);
-    ResourceManager::GetShader("text").Use().SetInteger("text", 0);
-    textRenderer = new TextRenderer(ResourceManager::GetShader("text"));
-    textRenderer->LoadFont("../assets/PressStart2P-Regular.ttf", 16);
-
     // Set render-specific controls
     pixelator = new Pixelator(windowWidth, windowHeight, framebufferWidth, framebufferHeight);
 
-    // Initalize Level
-    currentLevel = new Level("../assets/level1.png", ResourceManager::GetTexture("tiles"));
+    // Initialize other objects
+    soundEngine = createIrrKlangDevice();
 
-    // Configure Player
-    player = new PlayerEntity(currentLevel->PlayerStartPosition, glm::vec3(0.0015f), ResourceManager::GetTexture("player"), ResourceManager::LoadModel("../assets/player.fbx", "playerModel"));
-    light = new BasicEntity(currentLevel->PlayerStartPosition + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.05f), ResourceManager::GetTexture("test"));
-    shadow = new Shadow(currentLevel->PlayerStartPosition, glm::vec3(0.5f), ResourceManager::GetTexture("shadow"));
+    // What the pack compressed is decompressed in one parallel batch up front, the
+    // loaders then only find views
+    Vfs::Preload({ "../src/shaders/gritty.vs", "../src/shaders/gritty.fs", "../src/shaders/text.vs", "../src/shaders/text.fs",
+                   "../src/shaders/normalizer.vs", "../src/shaders/normalizer.fs", "../src/shaders/normalizer.gs",
+                   "../assets/PressStart2P-Regular.ttf", "../assets/level1.png" });
 
-    // Configure Camera
-    freeCamera = new Camera();
-    freeCamera->Position = glm::vec3(player->Position.x, player->Position.y + 1.0f, player->Position.z);
-    updateCamera();
+    // Everything else is read and decoded on the loader threads while the loading screen
+    // is up, the main loop uploads it a few pieces a frame
+    // Load shaders
+    ResourceManager::LoadShaderAsync("../src/shaders/gritty.vs", "../src/shaders/gritty.fs", nullptr, "gritty");
+    ResourceManager::LoadShaderAsync("../src/shaders/text.vs", "../src/shaders/text.fs", nullptr, "text");
+    ResourceManager::LoadShaderAsync("../src/shaders/normalizer.vs", "../src/shaders/normalizer.fs", "../src/shaders/normalizer.gs", "normalizer");
 
-    // Initialize other objects
-    soundEngine = createIrrKlangDevice();
+    // Load Textures
+    ResourceManager::LoadTextureAsync("../assets/tiles.png", GL_TRUE, "tiles", GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+    // Rasterize the font, its textures are made with the text renderer
+    std::shared_ptr<std::vector<GlyphBitmap> > glyphs = std::make_shared<std::vector<GlyphBitmap> >();
+    fontGlyphs = glyphs;
+    ResourceManager::GetLoader().Load([glyphs]()
+    {
+        TextRenderer::RasterizeFont("../assets/PressStart2P-Regular.ttf", 16, *glyphs);
+        return (size_t)0;
+    },
+    []() {});
+
+    // The entity textures, packed in one atlas so their draws bind nothing. Models with
+    // textures of their own bind those instead
+    std::shared_ptr<TextureAtlas> atlas = std::make_shared<TextureAtlas>();
+    entityAtlas = atlas;
+    ResourceManager::GetLoader().Load([atlas]()
+    {
+        atlas->Add("player", "../assets/player.png", GL_FALSE);
+        atlas->Add("test", "../assets/test.png", GL_FALSE);
+        atlas->Add("shadow", "../assets/shadow.png", GL_TRUE);
+        atlas->Pack();
+        return atlas->UploadSize();
+    },
+    [atlas]() { atlas->Upload(); });
+
+    // Load the player model
+    // player.fbx is in centimetres and drawn at 0.0015, so half a millimetre never shows
+    ClipCompressionSettings playerCompression;
+    playerCompression.Tolerance = 0.05f;
+    playerCompression.Reach = 50.0f;
+    ResourceManager::LoadModelAsync("../assets/player.fbx", "playerModel", &playerCompression);
+
+    // Initalize Level
+    loadLevel("../assets/level1.png");
 }
 
 void Game::Reset()
@@ -103,18 +156,46 @@ void Game::Reset()
 
 void Game::DoTheMainLoop(GLfloat deltaTime)
 {
+    if (State == GAME_LOADING)
+    {
+        ResourceManager::GetLoader().PumpUploads();
+        unsigned int compiling = ResourceManager::PumpShaderCompiles();
+        if (ResourceManager::GetLoader().IsIdle() && compiling == 0)
+            finishLoading();
+        else
+        {
+            ProcessInput(deltaTime);
+            showLoadingScreen();
+            return;
+        }
+    }
+
     if (showGameStats)
         showGameStatsOverlay(&showGameStats, deltaTime);
     if (showGameEditor)
         showGameEditorWindow(&showGameEditor);
+    // the overlay showed the uniforms set and GL state changed during the last frame
+    Shader::ResetUniformCounters();
+    GlState::ResetCounters();
 
     ProcessInput(deltaTime);
     Update(deltaTime);
     Render(deltaTime);
+
+    ResourceManager::Trim();
 }
 
 void Game::ProcessInput(GLfloat deltaTime)
 {
+    if (State == GAME_LOADING)
+    {
+        // ESC quits while loading too
+        if (Keys[GLFW_KEY_ESCAPE] && !KeysProcessed[GLFW_KEY_ESCAPE])
+        {
+            KeysProcessed[GLFW_KEY_ESCAPE] = GL_TRUE;
+            glfwSetWindowShouldClose(window, GL_TRUE);
+        }
+    }
     if (State == GAME_MENU)
     {
         // ESC quits the game
@@ -304,6 +385,31 @@ void Game::Update(GLfloat deltaTime)
         light->Position = player->Position + glm::vec3(0.0f, 1.0f, 0.0f);
         shadow->Position = glm::vec3(player->Position.x, 0.0f, player->Position.z);
     }
+
+    // Pose every animated instance in parallel, drawing only uploads the palettes
+    animationSystem->Update(deltaTime);
+    horde->Update(deltaTime);
+    updateHitboxes();
+}
+
+// Rebuilt from the poses of this update, then every hit query of the frame runs in
+// one batch against it
+void Game::updateHitboxes()
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    hitboxes.Clear();
+    horde->AddHitboxes(hitboxes);
+
+    std::vector<HitSegment> aim(1);
+    aim[0].Start = player->Position + glm::vec3(0.0f, AIM_HEIGHT, 0.0f);
+    aim[0].End = aim[0].Start + player->Facing() * AIM_RANGE;
+    aim[0].Radius = 0.0f;
+    std::vector<HitResult> results;
+    hitboxes.QuerySegments(aim, results);
+    aimHit = results[0];
+
+    hitboxTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
 void Game::Render(GLfloat deltaTime)
@@ -314,21 +420,39 @@ void Game::Render(GLfloat deltaTime)
     if (pixelate)
         pixelator->BeginRender();
 
+    // One upload for every palette, or skinned vertex buffer, that changed in the last update
+    animationSystem->Upload();
+
     if (State == GAME_ACTIVE ||
         State == GAME_PAUSED ||
         State == GAME_MENU ||
         State == GAME_WIN)
     {
-
-        currentLevel->Draw(ResourceManager::GetShader("gritty"));
-        shadow->Draw(ResourceManager::GetShader("gritty"));
-        player->Draw(ResourceManager::GetShader("gritty"));
+        // the entities below only pick their part of it
+        entityAtlas->Bind();
+
+        currentLevel->Draw(ResourceManager::GetShader(grittyShader));
+        shadow->Draw(ResourceManager::GetShader(grittyShader));
+
+        // a single query in flight, the frames in between are not timed
+        readEntityDrawQuery();
+        bool timeEntities = !entityDrawQueryPending;
+        if (timeEntities)
+            glBeginQuery(GL_TIME_ELAPSED, entityDrawQuery);
+        player->Draw(ResourceManager::GetShader(grittyShader));
+        horde->Draw(ResourceManager::GetShader(grittyShader));
+        if (timeEntities)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            entityDrawQueryPending = true;
+            entityDrawVertices = player->GetAnimation()->GetModel()->VertexCount() * (1 + horde->Size());
+        }
 
         if (debugViz)
         {
-            currentLevel->Draw(ResourceManager::GetShader("normalizer"));
-            shadow->Draw(ResourceManager::GetShader("normalizer"));
-            player->Draw(ResourceManager::GetShader("normalizer"));
+            currentLevel->Draw(ResourceManager::GetShader(normalizerShader));
+            shadow->Draw(ResourceManager::GetShader(normalizerShader));
+            player->Draw(ResourceManager::GetShader(normalizerShader));
         }
 
     }
@@ -350,6 +474,101 @@ void Game::Render(GLfloat deltaTime)
     }
 }
 
+// Level transitions go through the loading screen as well, the level image is decoded
+// on a loader thread and the level is built once it and the tiles are there
+void Game::loadLevel(const std::string& file)
+{
+    State = GAME_LOADING;
+
+    std::shared_ptr<TextureImage> image = std::make_shared<TextureImage>();
+    levelImage = image;
+    ResourceManager::GetLoader().Load([image, file]()
+    {
+        if (!DecodeTextureImage(file, *image, 1))
+            std::cout << "ERROR::GAME: Failed to load level " << file << std::endl;
+        return (size_t)0;
+    },
+    []() {});
+}
+
+// Called once the loader is idle, every resource requested is in the resource manager
+void Game::finishLoading()
+{
+    // the names are resolved here once, frames only go through the handles
+    grittyShader = ResourceManager::FindShader(HashName("gritty"));
+    textShader = ResourceManager::FindShader(HashName("text"));
+    normalizerShader = ResourceManager::FindShader(HashName("normalizer"));
+    tilesTexture = ResourceManager::FindTexture(HashName("tiles"));
+    playerModel = ResourceManager::FindModel(HashName("playerModel"));
+
+    delete currentLevel;
+    currentLevel = new Level(*levelImage, ResourceManager::GetTexture(tilesTexture));
+    levelImage.reset();
+
+    if (player == nullptr)
+        initWorld();
+    else
+    {
+        initPlayer();
+        horde->Resize(horde->Size(), currentLevel, player->Position);
+    }
+    State = GAME_MENU;
+}
+
+// What the first level needs on top of the level itself
+void Game::initWorld()
+{
+    // the entities, the level and the text renderer keep copies of these
+    acquireResources();
+
+    ResourceManager::GetShader(grittyShader).SetUniformBlockBinding("BonePalette", BONE_PALETTE_BINDING);
+    // a buffer sampler left on unit 0 would clash with the diffuse sampler of every draw
+    ResourceManager::GetShader(grittyShader).Use().SetInteger("crowdPalettes", CROWD_TEXTURE_UNIT);
+    ResourceManager::GetShader(grittyShader).Use().SetInteger("atlas", ATLAS_TEXTURE_UNIT);
+
+    // Configure Text Renderer
+    glm::mat4 ortho = glm::ortho(0.0f, static_cast<GLfloat>(windowWidth), static_cast<GLfloat>(windowHeight), 0.0f, -1.0f, 1.0f);
+    ResourceManager::GetShader(textShader).Use().SetMatrix4("projection", ortho);
+    ResourceManager::GetShader(textShader).Use().SetInteger("text", 0);
+    textRenderer = new TextRenderer(ResourceManager::GetShader(textShader));
+    textRenderer->LoadGlyphs(*fontGlyphs);
+    fontGlyphs.reset();
+
+    // Configure Player
+    player = new PlayerEntity(currentLevel->PlayerStartPosition, glm::vec3(0.0015f), entityAtlas->Find("player"), ResourceManager::GetModel(playerModel));
+    light = new BasicEntity(currentLevel->PlayerStartPosition + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.05f), entityAtlas->Find("test"));
+    shadow = new Shadow(currentLevel->PlayerStartPosition, glm::vec3(0.5f), entityAtlas->Find("shadow"));
+
+    // Every animated instance is posed by the animation system before rendering
+    animationSystem = new AnimationSystem();
+    animationSystem->Add(player->GetAnimation());
+    horde = new Horde(ResourceManager::GetModel(playerModel), entityAtlas->Find("player"), glm::vec3(0.0015f), animationSystem);
+    glGenQueries(1, &entityDrawQuery);
+
+    // Configure Camera
+    freeCamera = new Camera();
+    freeCamera->Position = glm::vec3(player->Position.x, player->Position.y + 1.0f, player->Position.z);
+    updateCamera();
+}
+
+void Game::acquireResources()
+{
+    ResourceManager::Acquire(grittyShader);
+    ResourceManager::Acquire(textShader);
+    ResourceManager::Acquire(normalizerShader);
+    ResourceManager::Acquire(tilesTexture);
+    ResourceManager::Acquire(playerModel);
+}
+
+void Game::releaseResources()
+{
+    ResourceManager::Release(grittyShader);
+    ResourceManager::Release(textShader);
+    ResourceManager::Release(normalizerShader);
+    ResourceManager::Release(tilesTexture);
+    ResourceManager::Release(playerModel);
+}
+
 void Game::initPlayer()
 {
     player->Position = currentLevel->PlayerStartPosition;
@@ -358,7 +577,7 @@ void Game::initPlayer()
 void Game::updateCamera()
 {
     glm::mat4 ortho = glm::ortho(0.0f, static_cast<GLfloat>(windowWidth), static_cast<GLfloat>(windowHeight), 0.0f, -1.0f, 1.0f);
-    ResourceManager::GetShader("text").Use().SetMatrix4("projection", ortho);
+    ResourceManager::GetShader(textShader).Use().SetMatrix4("projection", ortho);
 
     camPosition = player->Position + glm::vec3(0.0f, 2.0f, 2.0f);
     glm::mat4 perspective = glm::perspective(glm::radians(80.0f), static_cast<GLfloat>(windowWidth) / static_cast<GLfloat>(windowHeight), 0.1f, 100.0f);
@@ -370,22 +589,68 @@ void Game::updateCamera()
     else
         view = glm::lookAt(camPosition, player->Position, glm::vec3(0.0f, 1.0f, 0.0f));
 
-    ResourceManager::GetShader("gritty").Use().SetInteger("freeCam", freeCam);
-    ResourceManager::GetShader("gritty").Use().SetMatrix4("view", view);
-    ResourceManager::GetShader("gritty").Use().SetMatrix4("projection", perspective);
-    ResourceManager::GetShader("gritty").Use().SetVector3f("playerLightPos", playerLightPos);
-    ResourceManager::GetShader("gritty").Use().SetVector3f("lightColor", lightColor);
-    ResourceManager::GetShader("gritty").Use().SetFloat("constantAtt", constantAtt);
-    ResourceManager::GetShader("gritty").Use().SetFloat("linearAtt", linearAtt);
-    ResourceManager::GetShader("gritty").Use().SetFloat("quadraticAtt", quadraticAtt);
+    Shader& gritty = ResourceManager::GetShader(grittyShader).Use();
+    gritty.SetInteger("freeCam", freeCam);
+    gritty.SetMatrix4("view", view);
+    gritty.SetMatrix4("projection", perspective);
+    gritty.SetVector3f("playerLightPos", playerLightPos);
+    gritty.SetVector3f("lightColor", lightColor);
+    gritty.SetFloat("constantAtt", constantAtt);
+    gritty.SetFloat("linearAtt", linearAtt);
+    gritty.SetFloat("quadraticAtt", quadraticAtt);
+
+    // animation LOD tiers follow the camera that renders
+    animationSystem->SetViewer(perspective * view, freeCam ? freeCamera->Position : camPosition);
 
     if (debugViz)
     {
-        ResourceManager::GetShader("normalizer").Use().SetMatrix4("view", view);
-        ResourceManager::GetShader("normalizer").Use().SetMatrix4("projection", perspective);
+        ResourceManager::GetShader(normalizerShader).Use().SetMatrix4("view", view);
+        ResourceManager::GetShader(normalizerShader).Use().SetMatrix4("projection", perspective);
     }
 }
 
+void Game::readEntityDrawQuery()
+{
+    if (!entityDrawQueryPending)
+        return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(entityDrawQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(entityDrawQuery, GL_QUERY_RESULT, &elapsed);
+    entityDrawTime = elapsed / 1000000.0;
+    entityDrawQueryPending = false;
+}
+
+void Game::showLoadingScreen()
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    ImGuiWindowFlags windowFlags = ImGuiWindowFlags_NoMove |
+                                   ImGuiWindowFlags_NoDecoration |
+                                   ImGuiWindowFlags_AlwaysAutoResize |
+                                   ImGuiWindowFlags_NoSavedSettings |
+                                   ImGuiWindowFlags_NoNav;
+
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImVec2 windowPos(viewport->WorkPos.x + viewport->WorkSize.x * 0.5f, viewport->WorkPos.y + viewport->WorkSize.y * 0.5f);
+    ImGui::SetNextWindowPos(windowPos, ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+
+    const AssetLoader& loader = ResourceManager::GetLoader();
+    if (ImGui::Begin("Loading", nullptr, windowFlags))
+    {
+        ImGui::Text("LOADING");
+        ImGui::ProgressBar(loader.Progress(), ImVec2(300.0f, 0.0f));
+        ImGui::Text("%u loader threads, %.1f KiB uploaded in %.2f ms last frame", loader.ThreadCount(),
+                    loader.LastUploadSize() / 1024.0f, loader.LastUploadTime());
+    }
+    ImGui::End();
+}
+
 void Game::showGameStatsOverlay(bool* pOpen, GLfloat deltaTime)
 {
     const float PAD = 10.0f;
@@ -410,6 +675,46 @@ void Game::showGameStatsOverlay(bool* pOpen, GLfloat deltaTime)
     {
         ImGui::Text("Player Position: x:%.1f, y:%.1f, z:%.1f", player->Position.x, player->Position.y, player->Position.z);
         ImGui::Text("FPS: %i", (int)(1 / deltaTime));
+        ImGui::Text("Animated: %u instances", animationSystem->InstanceCount());
+        ImGui::Text("Pose update: %.2f ms on %u threads", animationSystem->LastUpdateTime(), animationSystem->ThreadCount());
+        ImGui::Text("LOD tiers: %u near, %u medium, %u far, %u hidden", animationSystem->LastTierCount(LOD_NEAR),
+                    animationSystem->LastTierCount(LOD_MEDIUM), animationSystem->LastTierCount(LOD_FAR), animationSystem->LastTierCount(LOD_HIDDEN));
+        ImGui::Text("Palettes: %u posed, %.1f KiB uploaded", animationSystem->LastPosedCount(), animationSystem->LastUploadSize() / 1024.0f);
+        if (animationSystem->PoseSharing.Enabled)
+        {
+            const PoseCache& poseCache = animationSystem->GetPoseCache();
+            ImGui::Text("Pose cache: %u lookups, %u distinct, %u evaluated, %.0f%% hits", poseCache.LastLookups(),
+                        poseCache.LastDistinctPoses(), poseCache.LastEvaluations(), poseCache.LastHitRate() * 100.0f);
+        }
+        if (animationSystem->IsCpuSkinning())
+            ImGui::Text("CPU skinning: %.2f ms, %.1f Mverts/s", animationSystem->LastSkinningTime(),
+                        animationSystem->LastSkinningTime() > 0.0 ? animationSystem->LastSkinnedVertexCount() / (animationSystem->LastSkinningTime() * 1000.0) : 0.0);
+        ImGui::Text("Horde: %u members, %u draw calls", horde->Size(), horde->LastDrawCalls());
+        ImGui::Text("Hitboxes: %u capsules, %.2f ms, aim on member %d bone %d", hitboxes.CapsuleCount(), hitboxTime, aimHit.Character, aimHit.Bone);
+        ImGui::Text("Entities draw: %.2f ms GPU, %.1f Mverts/s", entityDrawTime,
+                    entityDrawTime > 0.0 ? entityDrawVertices / (entityDrawTime * 1000.0) : 0.0);
+        const char* categories[RESOURCE_CATEGORY_COUNT] = { "Shaders", "Textures", "Models" };
+        for (unsigned int c = 0; c < RESOURCE_CATEGORY_COUNT; c++)
+        {
+            const ResourceUsage& usage = ResourceManager::GetUsage((ResourceCategory)c);
+            ImGui::Text("%s: %u of %u resident, %u referenced, %.1f KiB CPU, %.1f KiB GPU, %u evicted, %u reloaded", categories[c],
+                        usage.Resident, usage.Count, usage.Referenced, usage.CpuBytes / 1024.0f, usage.GpuBytes / 1024.0f,
+                        usage.Evictions, usage.Reloads);
+        }
+        ImGui::Text("Clip library: %.1f KiB CPU", ResourceManager::GetClipLibrary().MemorySize() / 1024.0f);
+        const TextureCache& textureCache = ResourceManager::GetTextureCache();
+        ImGui::Text("Model textures: %u images, %u shared, %.1f KiB GPU", textureCache.Count(), textureCache.SharedCount(),
+                    textureCache.GpuMemorySize() / 1024.0f);
+        ImGui::Text("Entity atlas: %u images, %u layers of %u, %.0f%% covered, %.1f KiB GPU", entityAtlas->EntryCount(),
+                    entityAtlas->LayerCount(), entityAtlas->LayerSize(), entityAtlas->Coverage() * 100.0f,
+                    entityAtlas->MemorySize() / 1024.0f);
+        ImGui::Text("Uniforms: %u uploaded, %u unchanged and skipped", Shader::UniformUploads(), Shader::UniformUploadsSkipped());
+        ImGui::Text("GL state: %u calls issued, %u redundant and filtered", GlState::IssuedCalls(), GlState::FilteredCalls());
+        const ProgramCache& programCache = ResourceManager::GetProgramCache();
+        ImGui::Text("Shader programs: %u from cache, %u compiled, %u invalidated, %.1f ms to link", programCache.Hits(),
+                    programCache.Misses(), programCache.Invalidations(), ResourceManager::GetShaderCompileTime());
+        ImGui::Text("Files: %u from packs, %u from disk, %.1f KiB decompressed", Vfs::PackReadCount(), Vfs::DiskReadCount(),
+                    Vfs::DecompressedSize() / 1024.0f);
     }
     ImGui::End();
 }
@@ -427,10 +732,59 @@ void Game::showGameEditorWindow(bool* pOpen)
         static float color[3] = { lightColor.r, lightColor.g, lightColor.b };
         ImGui::ColorEdit3("color", color);
         lightColor = glm::vec3(color[0], color[1], color[2]);
-        ResourceManager::GetShader("gritty").Use().SetFloat("constantAtt", constantAtt);
-        ResourceManager::GetShader("gritty").Use().SetFloat("linearAtt", linearAtt);
-        ResourceManager::GetShader("gritty").Use().SetFloat("quadraticAtt", quadraticAtt);
-        ResourceManager::GetShader("gritty").Use().SetVector3f("lightColor", lightColor);
+        ResourceManager::GetShader(grittyShader).Use().SetFloat("constantAtt", constantAtt);
+        ResourceManager::GetShader(grittyShader).Use().SetFloat("linearAtt", linearAtt);
+        ResourceManager::GetShader(grittyShader).Use().SetFloat("quadraticAtt", quadraticAtt);
+        ResourceManager::GetShader(grittyShader).Use().SetVector3f("lightColor", lightColor);
+    }
+    ImGui::End();
+
+    if (ImGui::Begin("Horde", pOpen, windowFlags))
+    {
+        static int hordeSize = 0;
+        if (ImGui::SliderInt("size", &hordeSize, 0, HORDE_MAX_SIZE))
+            horde->Resize(hordeSize, currentLevel, player->Position);
+        static bool bakedPalettes = false;
+        if (ImGui::Checkbox("baked palettes", &bakedPalettes))
+            horde->SetBaked(bakedPalettes);
+        static bool instancedDraw = false;
+        if (ImGui::Checkbox("instanced draw", &instancedDraw))
+            horde->SetInstanced(instancedDraw);
+        static bool cpuSkinning = false;
+        if (ImGui::Checkbox("CPU skinning", &cpuSkinning))
+            animationSystem->SetCpuSkinning(cpuSkinning);
+
+        ImGui::Separator();
+        AnimationLodSettings& lod = animationSystem->LodSettings;
+        ImGui::Checkbox("animation LOD", &lod.Enabled);
+        ImGui::SliderFloat("medium distance", &lod.MediumDistance, 0.0f, 20.0f);
+        ImGui::SliderFloat("far distance", &lod.FarDistance, lod.MediumDistance, 40.0f);
+        ImGui::SliderFloat("medium rate", &lod.MediumRate, 1.0f, 30.0f);
+        ImGui::SliderFloat("far rate", &lod.FarRate, 1.0f, 30.0f);
+
+        ImGui::Separator();
+        PoseCacheSettings& poseSharing = animationSystem->PoseSharing;
+        ImGui::Checkbox("pose sharing", &poseSharing.Enabled);
+        ImGui::SliderFloat("phase quantum (frames)", &poseSharing.Quantum, 0.25f, 8.0f);
+
+        ImGui::Separator();
+        const AnimatedModel& model = *player->GetAnimation()->GetModel();
+        const std::vector<ClipCompressionStats>& clipStats = model.GetCompressionStats();
+        for (unsigned int i = 0; i < clipStats.size(); i++)
+            ImGui::Text("%s: %.1f -> %.1f KiB, %u keys, max error %.3f", model.GetClip(i).Name.c_str(),
+                        clipStats[i].BakedSize / 1024.0f, clipStats[i].CompressedSize / 1024.0f, clipStats[i].KeyCount, clipStats[i].MaxPoseError);
+    }
+    ImGui::End();
+
+    if (ImGui::Begin("Resources", pOpen, windowFlags))
+    {
+        // unreferenced resources over budget are evicted at the end of the frame
+        static int cpuBudget = (int)(RESOURCE_CPU_BUDGET / (1024 * 1024));
+        static int gpuBudget = (int)(RESOURCE_GPU_BUDGET / (1024 * 1024));
+        bool budgetChanged = ImGui::SliderInt("CPU budget (MiB)", &cpuBudget, 0, 2048);
+        budgetChanged |= ImGui::SliderInt("GPU budget (MiB)", &gpuBudget, 0, 4096);
+        if (budgetChanged)
+            ResourceManager::SetBudget((size_t)cpuBudget * 1024 * 1024, (size_t)gpuBudget * 1024 * 1024);
     }
     ImGui::End();
 }
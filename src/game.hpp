@@ -1,6 +1,10 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -17,9 +21,14 @@ using namespace irrklang;
 #include "pixelator.hpp"
 #include "level.hpp"
 #include "camera.hpp"
+#include "animation_system.hpp"
+#include "horde.hpp"
+#include "hitbox_set.hpp"
+#include "texture_atlas.hpp"
 
 enum GameState
 {
+    GAME_LOADING,
     GAME_ACTIVE,
     GAME_PAUSED,
     GAME_MENU,
@@ -66,9 +75,42 @@ class Game
         BasicEntity    *light;
         Shadow         *shadow;
         Level          *currentLevel;
-
+        AnimationSystem *animationSystem;
+        Horde          *horde;
+        // posed horde hitboxes of the current frame and the hit of the player's aim
+        HitboxSet      hitboxes;
+        HitResult      aimHit;
+        double         hitboxTime;
+
+        // resolved by name once loading is done
+        ShaderHandle   grittyShader, textShader, normalizerShader;
+        TextureHandle  tilesTexture;
+        ModelHandle    playerModel;
+
+        // decoded on the loader threads, turned into the level and the text renderer's
+        // glyphs once everything else has been uploaded
+        std::shared_ptr<TextureImage> levelImage;
+        std::shared_ptr<std::vector<GlyphBitmap> > fontGlyphs;
+        // the entity textures in one array texture, packed on a loader thread
+        std::shared_ptr<TextureAtlas> entityAtlas;
+
+        // GPU time of the animated entity draws, read back a few frames late
+        GLuint         entityDrawQuery;
+        bool           entityDrawQueryPending;
+        GLuint         entityDrawVertices;
+        double         entityDrawTime;
+
+        void loadLevel(const std::string& file);
+        void finishLoading();
+        void initWorld();
         void initPlayer();
+        // references to every resource resolved in finishLoading, kept from eviction
+        void acquireResources();
+        void releaseResources();
         void updateCamera();
+        void updateHitboxes();
+        void readEntityDrawQuery();
+        void showLoadingScreen();
         void showGameStatsOverlay(bool* pOpen, GLfloat deltaTime);
         void showGameEditorWindow(bool* pOpen);
 };
@@ -0,0 +1,183 @@
+#include "gl_state.hpp"
+
+// what a new context starts with
+GLuint GlState::program = 0;
+GLuint GlState::vertexArray = 0;
+GLuint GlState::drawFramebuffer = 0;
+GLuint GlState::readFramebuffer = 0;
+GLuint GlState::activeUnit = 0;
+GLuint GlState::textures[GL_STATE_TEXTURE_UNITS][GlState::TEXTURE_TARGETS] = {};
+GLuint GlState::capabilities[GlState::CAPABILITIES] = {};
+GLenum GlState::blendSource = GL_ONE;
+GLenum GlState::blendDestination = GL_ZERO;
+unsigned int GlState::issued = 0;
+unsigned int GlState::filtered = 0;
+
+static int textureTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_2D:
+            return 0;
+        case GL_TEXTURE_2D_ARRAY:
+            return 1;
+        case GL_TEXTURE_BUFFER:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+static int capabilityIndex(GLenum capability)
+{
+    switch (capability)
+    {
+        case GL_BLEND:
+            return 0;
+        case GL_DEPTH_TEST:
+            return 1;
+        case GL_CULL_FACE:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+void GlState::UseProgram(GLuint program)
+{
+    if (change(GlState::program, program))
+        glUseProgram(program);
+}
+
+void GlState::BindVertexArray(GLuint vertexArray)
+{
+    if (change(GlState::vertexArray, vertexArray))
+        glBindVertexArray(vertexArray);
+}
+
+void GlState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int index = textureTargetIndex(target);
+    if (unit >= GL_STATE_TEXTURE_UNITS || index < 0)
+    {
+        activateUnit(unit);
+        issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if (!change(textures[unit][index], texture))
+        return;
+    activateUnit(unit);
+    glBindTexture(target, texture);
+}
+
+void GlState::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if (target == GL_FRAMEBUFFER)
+    {
+        if (drawFramebuffer == framebuffer && readFramebuffer == framebuffer)
+        {
+            filtered++;
+            return;
+        }
+        drawFramebuffer = readFramebuffer = framebuffer;
+        issued++;
+    }
+    else if (!change(target == GL_DRAW_FRAMEBUFFER ? drawFramebuffer : readFramebuffer, framebuffer))
+        return;
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GlState::Enable(GLenum capability)
+{
+    setCapability(capability, GL_TRUE);
+}
+
+void GlState::Disable(GLenum capability)
+{
+    setCapability(capability, GL_FALSE);
+}
+
+void GlState::BlendFunc(GLenum source, GLenum destination)
+{
+    if (blendSource == source && blendDestination == destination)
+    {
+        filtered++;
+        return;
+    }
+    blendSource = source;
+    blendDestination = destination;
+    issued++;
+    glBlendFunc(source, destination);
+}
+
+// A deleted object is unbound wherever it was bound in this context
+void GlState::DeleteProgram(GLuint program)
+{
+    // one in use stays in use until another is, GL deletes it then
+    glDeleteProgram(program);
+}
+
+void GlState::DeleteVertexArray(GLuint vertexArray)
+{
+    if (GlState::vertexArray == vertexArray)
+        GlState::vertexArray = 0;
+    glDeleteVertexArrays(1, &vertexArray);
+}
+
+void GlState::DeleteTexture(GLuint texture)
+{
+    for (GLuint unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+    {
+        for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+        {
+            if (textures[unit][target] == texture)
+                textures[unit][target] = 0;
+        }
+    }
+    glDeleteTextures(1, &texture);
+}
+
+void GlState::DeleteFramebuffer(GLuint framebuffer)
+{
+    if (drawFramebuffer == framebuffer)
+        drawFramebuffer = 0;
+    if (readFramebuffer == framebuffer)
+        readFramebuffer = 0;
+    glDeleteFramebuffers(1, &framebuffer);
+}
+
+bool GlState::change(GLuint& current, GLuint value)
+{
+    if (current == value)
+    {
+        filtered++;
+        return false;
+    }
+    current = value;
+    issued++;
+    return true;
+}
+
+// part of a bind, only counted when it reaches GL
+void GlState::activateUnit(GLuint unit)
+{
+    if (activeUnit == unit)
+        return;
+    activeUnit = unit;
+    issued++;
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GlState::setCapability(GLenum capability, GLuint enabled)
+{
+    int index = capabilityIndex(capability);
+    if (index >= 0 && !change(capabilities[index], enabled))
+        return;
+    if (index < 0)
+        issued++;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
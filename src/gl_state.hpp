@@ -0,0 +1,71 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Texture units whose bindings are remembered, binds to higher ones always go to GL
+const GLuint GL_STATE_TEXTURE_UNITS = 16;
+
+// The units of the engine's own samplers, at the top of the 16 every GL 4.1 context
+// has. Material textures bind from unit 0 up, the first one is the diffuse map gritty.fs
+// samples as image, and may take the units below these
+const GLint PALETTE_TEXTURE_UNIT = 13;   // baked palettes, read by the vertex shader
+const GLint CROWD_TEXTURE_UNIT = 14;     // the instanced crowd buffer texture
+const GLint ATLAS_TEXTURE_UNIT = 15;     // the entity atlas, bound for the whole frame
+const GLint MATERIAL_TEXTURE_UNITS = PALETTE_TEXTURE_UNIT;
+
+static_assert(MATERIAL_TEXTURE_UNITS <= PALETTE_TEXTURE_UNIT && PALETTE_TEXTURE_UNIT < CROWD_TEXTURE_UNIT &&
+              CROWD_TEXTURE_UNIT < ATLAS_TEXTURE_UNIT && ATLAS_TEXTURE_UNIT < (GLint)GL_STATE_TEXTURE_UNITS,
+              "material and engine texture units overlap");
+
+// The GL state the engine changes while it draws, as the last call through here left
+// it. A call that would set what is already set never reaches the driver. Every bind of
+// a program, vertex array, texture or framebuffer and every switch of blending, depth
+// test or face culling goes through here, or the state kept would be wrong; deletes do
+// too, so a name GL hands out again is bound for real. Dear ImGui changes some of this
+// state and restores it when it is done. GL thread only.
+class GlState
+{
+    public:
+        static void UseProgram(GLuint program);
+        static void BindVertexArray(GLuint vertexArray);
+        // Binds to target of the unit, GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or
+        // GL_TEXTURE_BUFFER; the active unit only changes when the binding does
+        static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+        // GL_FRAMEBUFFER binds both the draw and the read framebuffer
+        static void BindFramebuffer(GLenum target, GLuint framebuffer);
+        // GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE
+        static void Enable(GLenum capability);
+        static void Disable(GLenum capability);
+        static void BlendFunc(GLenum source, GLenum destination);
+
+        static void DeleteProgram(GLuint program);
+        static void DeleteVertexArray(GLuint vertexArray);
+        static void DeleteTexture(GLuint texture);
+        static void DeleteFramebuffer(GLuint framebuffer);
+
+        // calls passed on to GL and filtered out since ResetCounters
+        static unsigned int IssuedCalls() { return issued; }
+        static unsigned int FilteredCalls() { return filtered; }
+        static void ResetCounters() { issued = filtered = 0; }
+
+    private:
+        // the targets bindings are kept for
+        static const unsigned int TEXTURE_TARGETS = 3;
+        static const unsigned int CAPABILITIES = 3;
+
+        static GLuint program, vertexArray, drawFramebuffer, readFramebuffer;
+        static GLuint activeUnit;
+        static GLuint textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGETS];
+        static GLuint capabilities[CAPABILITIES];
+        static GLenum blendSource, blendDestination;
+        static unsigned int issued, filtered;
+
+        // false, and the call counted as filtered, when current already holds value;
+        // otherwise current becomes value and the call is counted as issued
+        static bool change(GLuint& current, GLuint value);
+        static void activateUnit(GLuint unit);
+        static void setCapability(GLenum capability, GLuint enabled);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef HASH_NAME_H
+#define HASH_NAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// FNV-1a of a name. constexpr, so a name written in the source is hashed by the
+// compiler and looking it up costs no string at all
+constexpr uint32_t HashName(const char* name, uint32_t hash = 2166136261u)
+{
+    return *name == '\0' ? hash : HashName(name + 1, (hash ^ (uint32_t)(unsigned char)*name) * 16777619u);
+}
+
+inline uint32_t HashName(const std::string& name)
+{
+    return HashName(name.c_str());
+}
+
+// HashName of the first Length characters, unrolled over them. Passed a literal it
+// folds to a constant even where no constant expression is asked for, which the
+// recursion above does not
+template <size_t Length>
+struct UnrolledHashName
+{
+    static constexpr uint32_t Hash(const char* name, uint32_t hash = 2166136261u)
+    {
+        return UnrolledHashName<Length - 1>::Hash(name + 1, (hash ^ (uint32_t)(unsigned char)*name) * 16777619u);
+    }
+};
+
+template <>
+struct UnrolledHashName<0>
+{
+    static constexpr uint32_t Hash(const char*, uint32_t hash = 2166136261u) { return hash; }
+};
+
+#endif
@@ -0,0 +1,292 @@
+#include "hitbox_set.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static glm::vec3 transformPoint(const Affine& transform, const glm::vec3& point)
+{
+    const float (*rows)[4] = transform.Rows;
+    return glm::vec3(rows[0][0] * point.x + rows[0][1] * point.y + rows[0][2] * point.z + rows[0][3],
+                     rows[1][0] * point.x + rows[1][1] * point.y + rows[1][2] * point.z + rows[1][3],
+                     rows[2][0] * point.x + rows[2][1] * point.y + rows[2][2] * point.z + rows[2][3]);
+}
+
+// Main axis of a point cloud by power iteration on its covariance
+static glm::vec3 mainAxis(const std::vector<glm::vec3>& points, const glm::vec3& centroid)
+{
+    glm::mat3 covariance(0.0f);
+    for (unsigned int i = 0; i < points.size(); i++)
+    {
+        glm::vec3 d = points[i] - centroid;
+        covariance += glm::mat3(d * d.x, d * d.y, d * d.z);
+    }
+
+    glm::vec3 axis(1.0f, 1.0f, 1.0f);
+    for (unsigned int iteration = 0; iteration < 16; iteration++)
+    {
+        glm::vec3 next = covariance * axis;
+        float length = glm::length(next);
+        if (length < 1e-12f)
+            return glm::vec3(0.0f, 1.0f, 0.0f);
+        axis = next / length;
+    }
+    return axis;
+}
+
+std::vector<BoneCapsule> BuildBoneCapsules(const std::vector<SkinningVertex>& vertices, unsigned int boneCount)
+{
+    std::vector<std::vector<glm::vec3> > bonePoints(boneCount);
+    for (unsigned int v = 0; v < vertices.size(); v++)
+    {
+        int bone = -1;
+        float weight = 0.0f;
+        for (unsigned int k = 0; k < 4; k++)
+        {
+            if (vertices[v].Weights[k] > weight && vertices[v].Bones[k] >= 0 && vertices[v].Bones[k] < (int)boneCount)
+            {
+                bone = vertices[v].Bones[k];
+                weight = vertices[v].Weights[k];
+            }
+        }
+        if (bone >= 0)
+            bonePoints[bone].push_back(glm::vec3(vertices[v].Position[0], vertices[v].Position[1], vertices[v].Position[2]));
+    }
+
+    std::vector<BoneCapsule> capsules;
+    for (unsigned int b = 0; b < boneCount; b++)
+    {
+        const std::vector<glm::vec3>& points = bonePoints[b];
+        if (points.size() < HITBOX_MIN_VERTICES)
+            continue;
+
+        glm::vec3 centroid(0.0f);
+        for (unsigned int i = 0; i < points.size(); i++)
+            centroid += points[i];
+        centroid /= (float)points.size();
+
+        glm::vec3 axis = mainAxis(points, centroid);
+        float low = 0.0f, high = 0.0f, radius = 0.0f;
+        for (unsigned int i = 0; i < points.size(); i++)
+        {
+            glm::vec3 d = points[i] - centroid;
+            float along = glm::dot(d, axis);
+            low = std::min(low, along);
+            high = std::max(high, along);
+            radius = std::max(radius, glm::length(d - along * axis));
+        }
+
+        // the hemispherical caps cover the ends, so the segment stops a radius short of them
+        float middle = 0.5f * (low + high);
+        low = std::min(low + radius, middle);
+        high = std::max(high - radius, middle);
+
+        BoneCapsule capsule;
+        capsule.Bone = b;
+        capsule.A = centroid + low * axis;
+        capsule.B = centroid + high * axis;
+        capsule.Radius = radius;
+        capsules.push_back(capsule);
+    }
+    return capsules;
+}
+
+// Squared distance between segments p1q1 and p2q2, s and t locate the closest points
+// (Ericson, Real-Time Collision Detection 5.1.9)
+static float segmentSegmentDistance2(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2, float& s, float& t)
+{
+    const float epsilon = 1e-12f;
+    glm::vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+
+    if (a <= epsilon && e <= epsilon)
+    {
+        s = t = 0.0f;
+        return glm::dot(r, r);
+    }
+    if (a <= epsilon)
+    {
+        s = 0.0f;
+        t = glm::clamp(f / e, 0.0f, 1.0f);
+    }
+    else
+    {
+        float c = glm::dot(d1, r);
+        if (e <= epsilon)
+        {
+            t = 0.0f;
+            s = glm::clamp(-c / a, 0.0f, 1.0f);
+        }
+        else
+        {
+            float b = glm::dot(d1, d2);
+            float denominator = a * e - b * b;
+            s = denominator != 0.0f ? glm::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f)
+            {
+                t = 0.0f;
+                s = glm::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else if (t > 1.0f)
+            {
+                t = 1.0f;
+                s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+
+    glm::vec3 difference = (p1 + d1 * s) - (p2 + d2 * t);
+    return glm::dot(difference, difference);
+}
+
+static float pointSegmentDistance2(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b)
+{
+    glm::vec3 ab = b - a;
+    float length2 = glm::dot(ab, ab);
+    float t = length2 > 0.0f ? glm::clamp(glm::dot(point - a, ab) / length2, 0.0f, 1.0f) : 0.0f;
+    glm::vec3 difference = point - (a + ab * t);
+    return glm::dot(difference, difference);
+}
+
+HitboxSet::HitboxSet() : lastSphereTests(0), lastCapsuleTests(0)
+{
+}
+
+void HitboxSet::Clear()
+{
+    characters.clear();
+    bounds.clear();
+    capsuleA.clear();
+    capsuleB.clear();
+    capsuleRadii.clear();
+    capsuleBones.clear();
+}
+
+unsigned int HitboxSet::Add(const std::vector<BoneCapsule>& capsules, const Affine* palette, const glm::mat4& model)
+{
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+    Character character;
+    character.FirstCapsule = (unsigned int)capsuleBones.size();
+    character.CapsuleCount = (unsigned int)capsules.size();
+
+    glm::vec3 center(0.0f);
+    for (unsigned int c = 0; c < capsules.size(); c++)
+    {
+        const Affine& bone = palette[capsules[c].Bone];
+        glm::vec3 a = glm::vec3(model * glm::vec4(transformPoint(bone, capsules[c].A), 1.0f));
+        glm::vec3 b = glm::vec3(model * glm::vec4(transformPoint(bone, capsules[c].B), 1.0f));
+        capsuleA.push_back(a);
+        capsuleB.push_back(b);
+        capsuleRadii.push_back(capsules[c].Radius * scale);
+        capsuleBones.push_back(capsules[c].Bone);
+        center += a + b;
+    }
+    if (!capsules.empty())
+        center /= 2.0f * capsules.size();
+
+    float radius = 0.0f;
+    for (unsigned int c = character.FirstCapsule; c < capsuleBones.size(); c++)
+    {
+        radius = std::max(radius, glm::length(capsuleA[c] - center) + capsuleRadii[c]);
+        radius = std::max(radius, glm::length(capsuleB[c] - center) + capsuleRadii[c]);
+    }
+
+    characters.push_back(character);
+    bounds.push_back(glm::vec4(center, radius));
+    return (unsigned int)characters.size() - 1;
+}
+
+void HitboxSet::QuerySegments(const std::vector<HitSegment>& segments, std::vector<HitResult>& results) const
+{
+    results.resize(segments.size());
+    lastSphereTests = 0;
+    lastCapsuleTests = 0;
+
+    for (unsigned int s = 0; s < segments.size(); s++)
+    {
+        const HitSegment& segment = segments[s];
+        HitResult& result = results[s];
+        result.Character = -1;
+        result.Bone = -1;
+        result.Fraction = 1.0f;
+        glm::vec3 direction = segment.End - segment.Start;
+        float length2 = glm::dot(direction, direction);
+
+        for (unsigned int i = 0; i < characters.size(); i++)
+        {
+            float reach = bounds[i].w + segment.Radius;
+            if (pointSegmentDistance2(glm::vec3(bounds[i]), segment.Start, segment.End) > reach * reach)
+                continue;
+
+            const Character& character = characters[i];
+            for (unsigned int c = character.FirstCapsule; c < character.FirstCapsule + character.CapsuleCount; c++)
+            {
+                float along, across;
+                float capsuleReach = capsuleRadii[c] + segment.Radius;
+                float distance2 = segmentSegmentDistance2(segment.Start, segment.End, capsuleA[c], capsuleB[c], along, across);
+                if (distance2 > capsuleReach * capsuleReach)
+                    continue;
+                // back from the closest approach to where the segment comes within reach of
+                // the capsule's closest point, measured on the line so an approach clamped
+                // to the segment's end does not reach back too far
+                float entry = 0.0f;
+                if (length2 > 0.0f)
+                {
+                    glm::vec3 closest = capsuleA[c] + (capsuleB[c] - capsuleA[c]) * across - segment.Start;
+                    float projected = glm::dot(closest, direction) / length2;
+                    glm::vec3 offset = closest - direction * projected;
+                    float half2 = std::max(capsuleReach * capsuleReach - glm::dot(offset, offset), 0.0f);
+                    entry = std::max(projected - std::sqrt(half2 / length2), 0.0f);
+                }
+                if (result.Character < 0 || entry < result.Fraction)
+                {
+                    result.Character = i;
+                    result.Bone = capsuleBones[c];
+                    result.Fraction = entry;
+                }
+            }
+            lastCapsuleTests += character.CapsuleCount;
+        }
+        lastSphereTests += (unsigned int)characters.size();
+    }
+}
+
+void HitboxSet::QuerySpheres(const std::vector<HitSphere>& spheres, std::vector<HitResult>& results) const
+{
+    results.resize(spheres.size());
+    lastSphereTests = 0;
+    lastCapsuleTests = 0;
+
+    for (unsigned int s = 0; s < spheres.size(); s++)
+    {
+        const HitSphere& sphere = spheres[s];
+        HitResult& result = results[s];
+        result.Character = -1;
+        result.Bone = -1;
+        result.Fraction = 0.0f;
+        float deepest = 0.0f;
+
+        for (unsigned int i = 0; i < characters.size(); i++)
+        {
+            glm::vec3 offset = sphere.Center - glm::vec3(bounds[i]);
+            float reach = bounds[i].w + sphere.Radius;
+            if (glm::dot(offset, offset) > reach * reach)
+                continue;
+
+            const Character& character = characters[i];
+            for (unsigned int c = character.FirstCapsule; c < character.FirstCapsule + character.CapsuleCount; c++)
+            {
+                float depth = capsuleRadii[c] + sphere.Radius - std::sqrt(pointSegmentDistance2(sphere.Center, capsuleA[c], capsuleB[c]));
+                if (depth >= 0.0f && (result.Character < 0 || depth > deepest))
+                {
+                    result.Character = i;
+                    result.Bone = capsuleBones[c];
+                    deepest = depth;
+                }
+            }
+            lastCapsuleTests += character.CapsuleCount;
+        }
+        lastSphereTests += (unsigned int)characters.size();
+    }
+}
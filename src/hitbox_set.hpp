@@ -0,0 +1,88 @@
+#ifndef HITBOX_SET_H
+#define HITBOX_SET_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "pose_kernels.hpp"
+
+// Bones carrying fewer vertices than this get no capsule
+const unsigned int HITBOX_MIN_VERTICES = 4;
+
+// Capsule around the vertices a bone carries most of, a segment swept by a sphere.
+// Endpoints are in bind-pose model space, so the palette matrix of the bone poses them
+struct BoneCapsule
+{
+    unsigned int Bone;
+    glm::vec3 A, B;
+    float Radius;
+};
+
+// Fits a capsule per bone to the vertices whose largest weight is on that bone: the
+// segment follows their main axis and the radius reaches the farthest of them
+std::vector<BoneCapsule> BuildBoneCapsules(const std::vector<SkinningVertex>& vertices, unsigned int boneCount);
+
+// A bullet over one frame, from Start to End, with a radius of its own
+struct HitSegment
+{
+    glm::vec3 Start, End;
+    float Radius;
+};
+
+struct HitSphere
+{
+    glm::vec3 Center;
+    float Radius;
+};
+
+struct HitResult
+{
+    // -1 when nothing was hit
+    int Character;
+    int Bone;
+    // along the segment where it comes within reach of the capsule hit first, 0 for spheres
+    float Fraction;
+};
+
+// The posed capsules of every character of a frame in world space, with a bounding
+// sphere per character. Queries come in batches and test a bullet against the bounding
+// spheres first, so only the few characters it passes near cost capsule tests.
+class HitboxSet
+{
+    public:
+        HitboxSet();
+
+        void Clear();
+        // Poses the capsules of a model with a character's palette and model matrix, which
+        // may scale uniformly. Returns the index of the character in query results
+        unsigned int Add(const std::vector<BoneCapsule>& capsules, const Affine* palette, const glm::mat4& model);
+
+        // First capsule along each segment, results has one entry per segment
+        void QuerySegments(const std::vector<HitSegment>& segments, std::vector<HitResult>& results) const;
+        // Deepest capsule overlapping each sphere
+        void QuerySpheres(const std::vector<HitSphere>& spheres, std::vector<HitResult>& results) const;
+
+        unsigned int CharacterCount() const { return (unsigned int)characters.size(); }
+        unsigned int CapsuleCount() const { return (unsigned int)capsuleBones.size(); }
+        // tests run by the last query, to check how much the bounding spheres reject
+        unsigned int LastSphereTests() const { return lastSphereTests; }
+        unsigned int LastCapsuleTests() const { return lastCapsuleTests; }
+
+    private:
+        struct Character
+        {
+            unsigned int FirstCapsule, CapsuleCount;
+        };
+
+        std::vector<Character> characters;
+        // bounding spheres, apart so the reject loop reads nothing else
+        std::vector<glm::vec4> bounds;
+        std::vector<glm::vec3> capsuleA, capsuleB;
+        std::vector<float> capsuleRadii;
+        std::vector<int> capsuleBones;
+
+        mutable unsigned int lastSphereTests, lastCapsuleTests;
+};
+
+#endif
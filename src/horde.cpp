@@ -0,0 +1,194 @@
+#include "horde.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "player_entity.hpp"
+
+Horde::Horde(AnimatedModelPtr model, const AtlasEntry* atlasEntry, glm::vec3 size, AnimationSystem* animationSystem) :
+    model(model),
+    atlasEntry(atlasEntry),
+    size(size),
+    animationSystem(animationSystem),
+    baked(false),
+    instanced(false),
+    lastDrawCalls(0)
+{
+}
+
+Horde::~Horde()
+{
+    while (!members.empty())
+        removeMember();
+}
+
+void Horde::Resize(unsigned int count, Level* level, glm::vec3 center)
+{
+    count = std::min(count, HORDE_MAX_SIZE);
+
+    // Walk the floor grid around the center in growing square rings, moving the
+    // existing members to the new spots first and adding new ones after
+    unsigned int placed = 0;
+    for (int ring = 1; placed < count && ring < 200; ring++)
+    {
+        for (int z = -ring; z <= ring && placed < count; z++)
+        {
+            for (int x = -ring; x <= ring && placed < count; x++)
+            {
+                if (std::abs(x) != ring && std::abs(z) != ring)
+                    continue;
+
+                glm::vec3 position = center + glm::vec3(x * HORDE_SPACING, 0.0f, z * HORDE_SPACING);
+                if (!level->HasFloorAt(position.x, position.z))
+                    continue;
+
+                if (placed < members.size())
+                {
+                    members[placed].Position = position;
+                    members[placed].Animation->Position = position;
+                }
+                else
+                    addMember(position);
+                placed++;
+            }
+        }
+    }
+
+    while (members.size() > placed)
+        removeMember();
+}
+
+void Horde::SetBaked(bool baked)
+{
+    // without clips there is nothing baked to sample
+    baked = baked && model->HasAnimations();
+    if (baked == this->baked)
+        return;
+
+    this->baked = baked;
+    for (unsigned int i = 0; i < members.size(); i++)
+    {
+        if (baked)
+            animationSystem->Remove(members[i].Animation);
+        else
+            animationSystem->Add(members[i].Animation);
+    }
+}
+
+void Horde::Update(GLfloat deltaTime)
+{
+    if (!baked)
+        return;
+
+    for (unsigned int i = 0; i < members.size(); i++)
+        members[i].Animation->Update(deltaTime);
+}
+
+void Horde::Draw(Shader shader)
+{
+    shader.Use();
+    shader.SetInteger("entity", true);
+    shader.SetInteger("baked", baked);
+
+    bool atlased = atlasEntry != nullptr && model->TextureCount() == 0;
+    if (atlased)
+        TextureAtlas::SetUniforms(shader, atlasEntry);
+
+    if (instanced && !baked && model->HasAnimations())
+        drawInstanced(shader);
+    else
+    {
+        const PaletteTexture& palettes = model->GetBakedPalettes();
+
+        for (unsigned int i = 0; i < members.size(); i++)
+        {
+            shader.SetMatrix4("model", modelMatrix(members[i]));
+
+            if (baked)
+                palettes.SetUniforms(shader, members[i].Animation->GetAnimation(), members[i].Animation->GetTime());
+            members[i].Animation->Draw(shader);
+        }
+        lastDrawCalls = (unsigned int)members.size() * model->MeshCount();
+    }
+
+    if (atlased)
+        TextureAtlas::SetUniforms(shader, nullptr);
+    shader.SetInteger("baked", false);
+    shader.SetInteger("entity", false);
+}
+
+// Members posed by the system already hold their palette, baked ones are sampled
+// from the palette texture the way the vertex shader does
+void Horde::AddHitboxes(HitboxSet& hitboxes)
+{
+    const std::vector<BoneCapsule>& capsules = model->GetHitboxes();
+    sampledPalette.resize(model->BonesCount());
+    for (unsigned int i = 0; i < members.size(); i++)
+    {
+        const AnimationInstance* animation = members[i].Animation;
+        const Affine* palette = animation->GetPalette();
+        if (baked)
+        {
+            model->GetBakedPalettes().Sample(animation->GetAnimation(), animation->GetTime(), sampledPalette.data());
+            palette = sampledPalette.data();
+        }
+        hitboxes.Add(capsules, palette, modelMatrix(members[i]));
+    }
+}
+
+glm::mat4 Horde::modelMatrix(const HordeMember& member) const
+{
+    glm::mat4 modelMat = glm::mat4(1.0f);
+    modelMat = glm::translate(modelMat, member.Position);
+    modelMat = glm::rotate(modelMat, glm::radians(member.Rotation), glm::vec3(0.0f, 1.0f, 0.0f));
+    modelMat = glm::scale(modelMat, size);
+    return modelMat;
+}
+
+// The palettes were posed by the AnimationSystem during the update, they are only
+// gathered here next to the model matrices
+void Horde::drawInstanced(Shader shader)
+{
+    crowd.Resize((unsigned int)members.size(), model->BonesCount());
+    for (unsigned int i = 0; i < members.size(); i++)
+        crowd.Write(i, AffineFromMat4(modelMatrix(members[i])), members[i].Animation->GetPalette());
+
+    lastDrawCalls = 0;
+    for (unsigned int first = 0; first < members.size(); )
+    {
+        unsigned int count = crowd.UploadBatch(shader, first);
+        if (count == 0)
+            break;
+
+        model->DrawInstanced(shader, count);
+        lastDrawCalls += model->MeshCount();
+        first += count;
+    }
+}
+
+void Horde::addMember(glm::vec3 position)
+{
+    const PlayerAnimations animations[] = { IDLE, WALK, RUN };
+
+    HordeMember member;
+    member.Position = position;
+    member.Rotation = (rand() % 8) * 45.0f;
+    member.Animation = new AnimationInstance(model);
+    member.Animation->TimeScale = PLAYER_ANIMATION_SPEED;
+    member.Animation->Position = position;
+    member.Animation->SetAnimation(animations[rand() % 3]);
+    // start at a random phase so the horde does not move in lockstep
+    member.Animation->SetTime((rand() % 1000) / 1000.0f);
+
+    if (!baked)
+        animationSystem->Add(member.Animation);
+    members.push_back(member);
+}
+
+void Horde::removeMember()
+{
+    if (!baked)
+        animationSystem->Remove(members.back().Animation);
+    delete members.back().Animation;
+    members.pop_back();
+}
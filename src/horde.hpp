@@ -0,0 +1,78 @@
+#ifndef HORDE_H
+#define HORDE_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader.hpp"
+#include "texture_atlas.hpp"
+#include "level.hpp"
+#include "animated_model.hpp"
+#include "animation_instance.hpp"
+#include "animation_system.hpp"
+#include "crowd_buffer.hpp"
+#include "hitbox_set.hpp"
+
+const unsigned int HORDE_MAX_SIZE = 5000;
+const GLfloat HORDE_SPACING = 0.5f;
+
+struct HordeMember
+{
+    glm::vec3 Position;
+    GLfloat Rotation;
+    AnimationInstance* Animation;
+};
+
+// A crowd of animated characters sharing one model, spread over the level floor
+// around a point. Every member owns an AnimationInstance registered with the
+// AnimationSystem, which poses them all before the horde is drawn. In baked mode
+// the members leave the system, only their clocks advance on the CPU and the
+// vertex shader samples the model's baked palette texture instead. In instanced
+// mode the posed palettes and model matrices of all members go to a CrowdBuffer
+// and the whole horde is drawn with one instanced call per mesh.
+class Horde
+{
+    public:
+        // The model is drawn with the atlas entry unless it binds textures of its own
+        Horde(AnimatedModelPtr model, const AtlasEntry* atlasEntry, glm::vec3 size, AnimationSystem* animationSystem);
+        ~Horde();
+
+        void Resize(unsigned int count, Level* level, glm::vec3 center);
+        void SetBaked(bool baked);
+        // Has no effect while baked, baked members are drawn one by one
+        void SetInstanced(bool instanced) { this->instanced = instanced; }
+        // Advances the clocks of baked members, the system updates the others
+        void Update(GLfloat deltaTime);
+        void Draw(Shader shader);
+        // Adds every member with its current pose, member i becomes the character first + i
+        void AddHitboxes(HitboxSet& hitboxes);
+
+        unsigned int Size() const { return (unsigned int)members.size(); }
+        bool IsBaked() const { return baked; }
+        bool IsInstanced() const { return instanced; }
+        // draw calls issued by the last Draw, for the stats overlay
+        unsigned int LastDrawCalls() const { return lastDrawCalls; }
+
+    private:
+        AnimatedModelPtr model;
+        const AtlasEntry* atlasEntry;
+        glm::vec3 size;
+        AnimationSystem* animationSystem;
+        std::vector<HordeMember> members;
+        bool baked;
+        bool instanced;
+        CrowdBuffer crowd;
+        unsigned int lastDrawCalls;
+        // pose of a baked member, sampled on the CPU for its hitboxes
+        std::vector<Affine> sampledPalette;
+
+        glm::mat4 modelMatrix(const HordeMember& member) const;
+        void drawInstanced(Shader shader);
+        void addMember(glm::vec3 position);
+        void removeMember();
+};
+
+#endif
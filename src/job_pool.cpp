@@ -0,0 +1,102 @@
+#include "job_pool.hpp"
+
+#include <algorithm>
+
+JobPool::JobPool(unsigned int workerCount) :
+    quit(false),
+    job(nullptr),
+    count(0),
+    grainSize(1),
+    batch(0),
+    nextIndex(0),
+    busyWorkers(0)
+{
+    for (unsigned int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(&JobPool::workerLoop, this));
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeCondition.notify_all();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+void JobPool::ParallelFor(unsigned int count, unsigned int grainSize, const RangeJob& job)
+{
+    if (count == 0)
+        return;
+
+    grainSize = std::max(grainSize, 1u);
+
+    // Not worth waking anybody up for a single chunk
+    if (workers.empty() || count <= grainSize)
+    {
+        job(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = &job;
+        this->count = count;
+        this->grainSize = grainSize;
+        nextIndex = 0;
+        busyWorkers = (unsigned int)workers.size();
+        batch++;
+    }
+    wakeCondition.notify_all();
+
+    runChunks();
+
+    // Every worker has to check out of the batch before job goes out of scope
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+    this->job = nullptr;
+}
+
+unsigned int JobPool::DefaultWorkerCount()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void JobPool::workerLoop()
+{
+    unsigned long long lastBatch = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [this, lastBatch] { return quit || batch != lastBatch; });
+            if (quit)
+                return;
+            lastBatch = batch;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busyWorkers--;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+void JobPool::runChunks()
+{
+    while (true)
+    {
+        unsigned int begin = nextIndex.fetch_add(grainSize);
+        if (begin >= count)
+            return;
+        (*job)(begin, std::min(begin + grainSize, count));
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that split index ranges between them. The
+// calling thread takes part in the work, so a pool of N workers runs
+// ParallelFor on N + 1 threads.
+class JobPool
+{
+    public:
+        // processes the indices [begin, end)
+        typedef std::function<void(unsigned int begin, unsigned int end)> RangeJob;
+
+        JobPool(unsigned int workerCount = DefaultWorkerCount());
+        ~JobPool();
+
+        JobPool(const JobPool&) = delete;
+        JobPool& operator=(const JobPool&) = delete;
+
+        // Runs job over [0, count) in chunks of at most grainSize indices and
+        // returns once every chunk is done
+        void ParallelFor(unsigned int count, unsigned int grainSize, const RangeJob& job);
+
+        unsigned int ThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+        static unsigned int DefaultWorkerCount();
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable doneCondition;
+        bool quit;
+
+        // the batch currently being processed
+        const RangeJob* job;
+        unsigned int count, grainSize;
+        unsigned long long batch;
+        std::atomic<unsigned int> nextIndex;
+        unsigned int busyWorkers;
+
+        void workerLoop();
+        void runChunks();
+};
+
+#endif
@@ -2,16 +2,27 @@
 
 #include <stb_image.h>
 
+#include "gl_state.hpp"
+
 Level::Level(const GLchar *file, Texture2D texture) : texture(texture)
 {
-    load(file);
+    // Load level data from image
+    TextureImage image;
+    DecodeTextureImage(file, image, 1);
+    load(image);
+    initRenderData();
+}
+
+Level::Level(const TextureImage& image, Texture2D texture) : texture(texture)
+{
+    load(image);
     initRenderData();
 }
 
 Level::~Level()
 {
     stbi_image_free(levelData);
-    glDeleteVertexArrays(1, &VAO);
+    GlState::DeleteVertexArray(VAO);
 }
 
 void Level::Draw(Shader shader)
@@ -21,17 +32,15 @@ void Level::Draw(Shader shader)
 
     for (unsigned int i = 0; i < lights.size(); i++)
     {
-        shader.SetVector3f("lights[" + std::to_string(i) + "].position", lights[i].position);
-        shader.SetVector3f("lights[" + std::to_string(i) + "].color", lights[i].color);
-        shader.SetFloat("lights[" + std::to_string(i) + "].attenuation", lights[i].attenuation);
+        shader.SetVector3f(lightUniforms[i].Position, lights[i].position);
+        shader.SetVector3f(lightUniforms[i].Color, lights[i].color);
+        shader.SetFloat(lightUniforms[i].Attenuation, lights[i].attenuation);
     }
 
-    glActiveTexture(GL_TEXTURE0);
     texture.Bind();
 
-    glBindVertexArray(VAO);
+    GlState::BindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-    glBindVertexArray(0);
 }
 
 GLboolean Level::HasWallAt(GLfloat x, GLfloat z)
@@ -39,6 +48,12 @@ GLboolean Level::HasWallAt(GLfloat x, GLfloat z)
     return tileAt(x, z) == 128;
 }
 
+GLboolean Level::HasFloorAt(GLfloat x, GLfloat z)
+{
+    int tile = tileAt(x, z);
+    return tile == 255 || tile == 76 || tile == 149 || tile == 28;
+}
+
 void Level::pushQuad(GLfloat x1, GLfloat y1, GLfloat z1,
                      GLfloat x2, GLfloat y2, GLfloat z2,
                      GLfloat x3, GLfloat y3, GLfloat z3,
@@ -109,11 +124,11 @@ void Level::pushBlock(GLfloat x, GLfloat z)
             randomWallTile());
 }
 
-void Level::load(const GLchar *file)
+void Level::load(const TextureImage& image)
 {
-    // Load level data from image
-    int channels;
-    levelData = stbi_load(file, &levelWidth, &levelHeight, &channels, 1);
+    levelData = image.Pixels;
+    levelWidth = image.Width;
+    levelHeight = image.Height;
 
     for (int y = 0; y < levelHeight; y++)
     {
@@ -142,6 +157,7 @@ void Level::load(const GLchar *file)
                 light.color = glm::vec3(0.0f, 0.1f, 0.7f);
                 light.attenuation = 0.08f;
                 lights.push_back(light);
+                lightUniforms.push_back(LightUniforms((unsigned int)lightUniforms.size()));
                 pushFloor(x * quadSize, y * quadSize);
                 break;
             default:
@@ -159,7 +175,7 @@ void Level::initRenderData()
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
+    GlState::BindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
@@ -175,7 +191,7 @@ void Level::initRenderData()
     glEnableVertexAttribArray(2);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState::BindVertexArray(0);
 }
 
 int Level::randomFloorTile()
@@ -200,6 +216,9 @@ int Level::randomWallTile()
 
 int Level::tileAt(GLfloat x, GLfloat z)
 {
+    if (x < 0.0f || z < 0.0f || (int)x >= levelWidth || (int)z >= levelHeight)
+        return 0;
+
     int pos = levelWidth * (int)z + (int)x;
     return levelData[pos];
 }
@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -17,16 +18,31 @@ struct Light
     float attenuation;
 };
 
+// the names of a light's uniforms, hashed once when the light is placed
+struct LightUniforms
+{
+    UniformName Position, Color, Attenuation;
+
+    LightUniforms(unsigned int index)
+        : Position("lights[" + std::to_string(index) + "].position"),
+          Color("lights[" + std::to_string(index) + "].color"),
+          Attenuation("lights[" + std::to_string(index) + "].attenuation") {}
+};
+
 class Level
 {
     public:
         Level(const GLchar* file, Texture2D texture);
+        // Builds the level from its image decoded beforehand with one channel, for
+        // levels read on a loader thread. Takes over the pixels
+        Level(const TextureImage& image, Texture2D texture);
         ~Level();
 
         glm::vec3 PlayerStartPosition;
 
         void Draw(Shader shader);
         GLboolean HasWallAt(GLfloat x, GLfloat z);
+        GLboolean HasFloorAt(GLfloat x, GLfloat z);
 
     private:
         const GLfloat tileFraction = 16.0f / 1024.0f;
@@ -39,8 +55,9 @@ class Level
         Texture2D texture;
         std::vector<GLfloat> vertices;
         std::vector<Light> lights;
+        std::vector<LightUniforms> lightUniforms;
 
-        void load(const GLchar* file);
+        void load(const TextureImage& image);
         void initRenderData();
         void pushQuad(GLfloat x1, GLfloat y1, GLfloat z1,
                     GLfloat x2, GLfloat y2, GLfloat z2,
@@ -0,0 +1,191 @@
+#include "lz4_block.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+static const unsigned int HASH_BITS = 16;
+static const size_t MIN_MATCH = 4;
+// the format ends every block with literals: the last match starts 12 bytes before
+// the end at the latest and the last 5 bytes are never part of one
+static const size_t MATCH_START_LIMIT = 12;
+static const size_t LAST_LITERALS = 5;
+static const size_t MAX_OFFSET = 65535;
+
+static uint32_t read32(const unsigned char* bytes)
+{
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// the 255 run that follows a length nibble of 15
+static unsigned char* writeLength(unsigned char* out, size_t length)
+{
+    while (length >= 255)
+    {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (unsigned char)length;
+    return out;
+}
+
+size_t Lz4CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t Lz4Compress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t capacity)
+{
+    unsigned char* out = destination;
+    unsigned char* outEnd = destination + capacity;
+    size_t anchor = 0;
+
+    if (sourceSize > MATCH_START_LIMIT)
+    {
+        // positions of the last sequence seen with each hash, 0 doubles as empty
+        std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0);
+        size_t matchEnd = sourceSize - LAST_LITERALS;
+        size_t position = 0;
+        while (position + MATCH_START_LIMIT <= sourceSize)
+        {
+            uint32_t sequence = read32(source + position);
+            uint32_t hash = hashSequence(sequence);
+            size_t candidate = table[hash];
+            table[hash] = (uint32_t)position;
+            if (candidate >= position || position - candidate > MAX_OFFSET || read32(source + candidate) != sequence)
+            {
+                position++;
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while (position + length < matchEnd && source[candidate + length] == source[position + length])
+                length++;
+            // the match may start earlier, in the literals not yet written
+            while (position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1])
+            {
+                position--;
+                candidate--;
+                length++;
+            }
+
+            size_t literals = position - anchor;
+            if ((size_t)(outEnd - out) < 1 + literals / 255 + 1 + literals + 2 + (length - MIN_MATCH) / 255 + 1)
+                return 0;
+            unsigned char* token = out++;
+            *token = (unsigned char)((literals < 15 ? literals : 15) << 4);
+            if (literals >= 15)
+                out = writeLength(out, literals - 15);
+            std::memcpy(out, source + anchor, literals);
+            out += literals;
+
+            size_t offset = position - candidate;
+            *out++ = (unsigned char)(offset & 0xFF);
+            *out++ = (unsigned char)(offset >> 8);
+            size_t matchLength = length - MIN_MATCH;
+            *token |= (unsigned char)(matchLength < 15 ? matchLength : 15);
+            if (matchLength >= 15)
+                out = writeLength(out, matchLength - 15);
+
+            position += length;
+            anchor = position;
+        }
+    }
+
+    size_t literals = sourceSize - anchor;
+    if ((size_t)(outEnd - out) < 1 + literals / 255 + 1 + literals)
+        return 0;
+    *out++ = (unsigned char)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15)
+        out = writeLength(out, literals - 15);
+    std::memcpy(out, source + anchor, literals);
+    out += literals;
+    return (size_t)(out - destination);
+}
+
+bool Lz4Decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t size)
+{
+    const unsigned char* in = source;
+    const unsigned char* inEnd = source + sourceSize;
+    unsigned char* out = destination;
+    unsigned char* outEnd = destination + size;
+
+    while (in < inEnd)
+    {
+        unsigned char token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15)
+        {
+            unsigned char extra;
+            do
+            {
+                if (in >= inEnd)
+                    return false;
+                extra = *in++;
+                literals += extra;
+            } while (extra == 255);
+        }
+        if (literals > (size_t)(inEnd - in) || literals > (size_t)(outEnd - out))
+            return false;
+        // short runs are copied 16 bytes at once when both sides have the room
+        if (literals <= 16 && inEnd - in >= 16 && outEnd - out >= 16)
+            std::memcpy(out, in, 16);
+        else
+            std::memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+
+        // the last sequence has literals only
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+        size_t offset = in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - destination))
+            return false;
+
+        size_t length = token & 15;
+        if (length == 15)
+        {
+            unsigned char extra;
+            do
+            {
+                if (in >= inEnd)
+                    return false;
+                extra = *in++;
+                length += extra;
+            } while (extra == 255);
+        }
+        length += MIN_MATCH;
+        if (length > (size_t)(outEnd - out))
+            return false;
+
+        const unsigned char* match = out - offset;
+        if (offset >= 8 && (size_t)(outEnd - out) >= length + 8)
+        {
+            // 8 bytes at a time, overshooting into bytes written later anyway
+            for (size_t i = 0; i < length; i += 8)
+                std::memcpy(out + i, match + i, 8);
+        }
+        else if (offset >= length)
+            std::memcpy(out, match, length);
+        else
+        {
+            // overlapping, the bytes repeat with the period of the offset
+            for (size_t i = 0; i < length; i++)
+                out[i] = match[i];
+        }
+        out += length;
+    }
+    return out == outEnd;
+}
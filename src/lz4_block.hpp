@@ -0,0 +1,20 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <cstddef>
+
+// The LZ4 block format, what pack files compress their entries with. Greedy matching
+// over a hash of 4 byte sequences: not the ratio of the reference compressor, but
+// its output decodes with any LZ4 block decoder and decoding runs at memory speed.
+
+// Largest compressed size of size bytes
+size_t Lz4CompressBound(size_t size);
+
+// Bytes written to destination, 0 when they would not fit in capacity
+size_t Lz4Compress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t capacity);
+
+// Decodes exactly size bytes, false when the block is damaged or decodes to another
+// size. Never reads or writes out of the buffers given
+bool Lz4Decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t size);
+
+#endif
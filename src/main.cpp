@@ -10,7 +10,9 @@
 #include <backends/imgui_impl_opengl3.h>
 
 #include "game.hpp"
+#include "gl_state.hpp"
 #include "resource_manager.hpp"
+#include "vfs.hpp"
 
 static void ToggleFullScreen();
 
@@ -80,10 +82,13 @@ int main()
     ImGui_ImplOpenGL3_Init("#version 150");
 
     // Setup OpenGL
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    GlState::Enable(GL_BLEND);
+    GlState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GlState::Enable(GL_DEPTH_TEST);
+    GlState::Enable(GL_CULL_FACE);
+
+    // The assets come from the pack when the build made one, see pack_assets
+    Vfs::Mount(std::string("doublegrit") + PACK_FILE_EXTENSION, "../");
 
     DoubleGrit = new Game(window, mode->width, mode->height, WindowSize[0] * FramebufferRatio, WindowSize[1] * FramebufferRatio);
     DoubleGrit->Init();
@@ -114,6 +119,7 @@ int main()
     }
 
     ResourceManager::Clear();
+    Vfs::UnmountAll();
 
     // imgui cleanup
     ImGui_ImplOpenGL3_Shutdown();
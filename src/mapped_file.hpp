@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read-only into memory. Pages are read by the OS as they are
+// touched, so a file that is uploaded straight from its mapping is never copied
+// into a buffer of our own first.
+class MappedFile
+{
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // False when the file does not exist, is empty or cannot be mapped
+        bool Open(const std::string& path);
+        void Close();
+
+        bool IsOpen() const { return data != nullptr; }
+        const unsigned char* Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        const unsigned char* data;
+        size_t size;
+};
+
+#endif
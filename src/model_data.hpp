@@ -0,0 +1,52 @@
+#ifndef MODEL_DATA_H
+#define MODEL_DATA_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "animation_clip.hpp"
+#include "skeleton.hpp"
+
+// Interleaved vertex of the model buffers, as the shaders read it
+struct ModelVertex
+{
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    glm::ivec4 BoneIDs;
+    glm::vec4 BoneWeights;
+};
+
+// One draw call: a range of the index buffer, indices relative to BaseVertex
+struct ModelSubmesh
+{
+    unsigned int BaseVertex;
+    unsigned int BaseIndex;
+    unsigned int IndicesCount;
+    unsigned int MaterialIndex;
+};
+
+// A texture of a submesh material, Path relative to the model file
+struct ModelTexture
+{
+    std::string Type;
+    std::string Path;
+};
+
+// Everything the runtime keeps of a model file, before anything is uploaded. The
+// importer builds it from a scene and the cooker stores it, so a cooked model holds
+// exactly what an imported one would
+struct ModelData
+{
+    std::vector<ModelVertex> Vertices;
+    std::vector<unsigned int> Indices;
+    std::vector<ModelSubmesh> Submeshes;
+    // in the order the submeshes list them, the same file may appear more than once
+    std::vector<ModelTexture> Textures;
+    Skeleton Rig;
+    std::vector<AnimationClip> Clips;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "model_importer.hpp"
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+
+#include <cassert>
+#include <iostream>
+#include <map>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#define NUM_BONES_PER_VERTEX 4
+
+static inline glm::mat4 mat4Convert(const aiMatrix4x4& matrix) { return glm::transpose(glm::make_mat4(&matrix.a1)); }
+
+// checks all material textures of a given type, the runtime loads each file once
+static void importMaterialTextures(const aiMaterial* material, aiTextureType type, const std::string& typeName, std::vector<ModelTexture>& textures)
+{
+    for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+    {
+        aiString path;
+        material->GetTexture(type, i, &path);
+
+        ModelTexture texture;
+        texture.Type = typeName;
+        texture.Path = path.C_Str();
+        textures.push_back(texture);
+    }
+}
+
+static void importMesh(const aiScene* scene,
+                       const aiMesh* mesh,
+                       unsigned int baseVertex,
+                       std::map<std::string, unsigned int>& boneMapping,
+                       ModelData& data)
+{
+    // Walk through each of the mesh's vertices
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    {
+        ModelVertex vertex;
+        vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        vertex.Normal = mesh->HasNormals() ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f);
+        // a vertex can contain up to 8 different texture coordinates, only the first set is used
+        if (mesh->HasTextureCoords(0))
+            vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+        else
+            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+
+        // Bone Weights are initialised in next for loop, unused slots stay zero so
+        // cooked files come out the same for the same input
+        vertex.BoneIDs = glm::ivec4(0);
+        vertex.BoneWeights = glm::vec4(0.0f);
+
+        data.Vertices.push_back(vertex);
+    }
+
+    // process bones
+    for (unsigned int i = 0; i < mesh->mNumBones; i++)
+    {
+        unsigned int boneIndex = 0;
+        std::string boneName(mesh->mBones[i]->mName.data);
+
+        if (boneMapping.find(boneName) == boneMapping.end())
+        {
+            // allocate an index for the new bone
+            boneIndex = (unsigned int)data.Rig.BoneOffsets.size();
+            data.Rig.BoneOffsets.push_back(mat4Convert(mesh->mBones[i]->mOffsetMatrix));
+            boneMapping[boneName] = boneIndex;
+        }
+        else
+            boneIndex = boneMapping[boneName];
+
+        for (unsigned int j = 0; j < mesh->mBones[i]->mNumWeights; j++)
+        {
+            unsigned int vertexID = baseVertex + mesh->mBones[i]->mWeights[j].mVertexId;
+            float boneWeight = mesh->mBones[i]->mWeights[j].mWeight;
+
+            for (unsigned int g = 0; g < NUM_BONES_PER_VERTEX; g++)
+            {
+                if (data.Vertices[vertexID].BoneWeights[g] == 0.0)
+                {
+                    data.Vertices[vertexID].BoneIDs[g] = boneIndex;
+                    data.Vertices[vertexID].BoneWeights[g] = boneWeight;
+                    break;
+                }
+            }
+        }
+    }
+
+    // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace& face = mesh->mFaces[i];
+        assert(face.mNumIndices == 3);
+        for (unsigned int j = 0; j < face.mNumIndices; j++)
+            data.Indices.push_back(face.mIndices[j]);
+    }
+
+    // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+    // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
+    // Same applies to other texture as the following list summarizes:
+    // diffuse: texture_diffuseN
+    // specular: texture_specularN
+    // normal: texture_normalN
+    // emission: texture_emissionN
+    const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    importMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.Textures);
+    importMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.Textures);
+    importMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data.Textures);
+    importMaterialTextures(material, aiTextureType_EMISSIVE, "texture_emission", data.Textures);
+}
+
+bool ImportModel(const std::string& path, ModelData& data)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_LimitBoneWeights | aiProcess_JoinIdenticalVertices | aiProcess_OptimizeMeshes | aiProcess_ForceGenNormals);
+    // check for errors
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+    // everything is copied out, the scene is freed with the importer
+    ImportScene(scene, data);
+    return true;
+}
+
+void ImportScene(const aiScene* scene, ModelData& data)
+{
+    data = ModelData();
+    data.Submeshes.resize(scene->mNumMeshes);
+
+    unsigned int verticesCount = 0;
+    unsigned int indicesCount = 0;
+
+    // Count the number of vertices and indices
+    for (unsigned int i = 0; i < data.Submeshes.size(); i++)
+    {
+        data.Submeshes[i].BaseVertex    = verticesCount;
+        data.Submeshes[i].BaseIndex     = indicesCount;
+        data.Submeshes[i].IndicesCount  = scene->mMeshes[i]->mNumFaces * 3;
+        data.Submeshes[i].MaterialIndex = scene->mMeshes[i]->mMaterialIndex;
+
+        verticesCount += scene->mMeshes[i]->mNumVertices;
+        indicesCount += data.Submeshes[i].IndicesCount;
+    }
+
+    data.Vertices.reserve(verticesCount);
+    data.Indices.reserve(indicesCount);
+
+    // bone names to indices, collected while the meshes are processed
+    std::map<std::string, unsigned int> boneMapping;
+    for (unsigned int i = 0; i < data.Submeshes.size(); i++)
+        importMesh(scene, scene->mMeshes[i], data.Submeshes[i].BaseVertex, boneMapping, data);
+
+    // Flatten the node hierarchy now that every bone has been mapped
+    data.Rig.GlobalInverseTransform = glm::inverse(mat4Convert(scene->mRootNode->mTransformation));
+    data.Rig.Build(scene->mRootNode, boneMapping);
+
+    // Resample every animation to a fixed rate once, so posing never has to search assimp keys
+    data.Clips.resize(scene->mNumAnimations);
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+        data.Clips[i].Bake(scene->mAnimations[i]);
+}
+
+#endif
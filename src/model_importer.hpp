@@ -0,0 +1,21 @@
+#ifndef MODEL_IMPORTER_H
+#define MODEL_IMPORTER_H
+
+#include <string>
+
+#include "model_data.hpp"
+
+// Assimp is only linked into builds configured with DOUBLEGRIT_USE_ASSIMP, the others
+// load cooked models alone
+#ifdef DOUBLEGRIT_USE_ASSIMP
+
+struct aiScene;
+
+// Reads a model file with assimp, triangulated and with at most four weights per vertex
+bool ImportModel(const std::string& path, ModelData& data);
+// Copies the meshes, material textures, skeleton and baked animations out of a scene
+void ImportScene(const aiScene* scene, ModelData& data);
+
+#endif
+
+#endif
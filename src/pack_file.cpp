@@ -0,0 +1,260 @@
+#include "pack_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "lz4_block.hpp"
+
+static const char PACK_FILE_MAGIC[4] = { 'D', 'G', 'P', 'K' };
+static const uint64_t PACK_ALIGNMENT = 16;
+
+uint64_t HashPackPath(const std::string& path)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        hash ^= (unsigned char)path[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void alignImage(std::vector<char>& image)
+{
+    image.resize((size_t)((image.size() + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT), 0);
+}
+
+// Cuts the file into blocks and compresses each on its own, false when that saves too little
+static bool compressEntry(const std::vector<char>& contents, std::vector<char>& stored, uint32_t& blockCount)
+{
+    blockCount = (uint32_t)((contents.size() + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE);
+    stored.assign(blockCount * sizeof(uint32_t), 0);
+    std::vector<unsigned char> block(Lz4CompressBound(PACK_BLOCK_SIZE));
+    for (uint32_t b = 0; b < blockCount; b++)
+    {
+        size_t begin = (size_t)b * PACK_BLOCK_SIZE;
+        size_t size = std::min((size_t)PACK_BLOCK_SIZE, contents.size() - begin);
+        uint32_t compressedSize = (uint32_t)Lz4Compress((const unsigned char*)contents.data() + begin, size, block.data(), block.size());
+        if (compressedSize == 0)
+            return false;
+        std::memcpy(&stored[b * sizeof(uint32_t)], &compressedSize, sizeof(compressedSize));
+        stored.insert(stored.end(), block.begin(), block.begin() + compressedSize);
+    }
+    return stored.size() < contents.size() - contents.size() / 8;
+}
+
+bool WritePackFile(const std::string& path, const std::vector<PackSource>& files)
+{
+    PackHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, PACK_FILE_MAGIC, sizeof(PACK_FILE_MAGIC));
+    header.Version = PACK_FILE_VERSION;
+    header.EntryCount = (uint32_t)files.size();
+
+    std::vector<char> image(sizeof(header), 0);
+    std::vector<PackEntry> entries(files.size());
+    std::string paths;
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        std::ifstream file(files[i].DiskPath.c_str(), std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::PACK_FILE: Failed to read " << files[i].DiskPath << std::endl;
+            return false;
+        }
+        std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        PackEntry& entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.PathHash = HashPackPath(files[i].Path);
+        entry.PathOffset = (uint32_t)paths.size();
+        entry.PathLength = (uint32_t)files[i].Path.size();
+        entry.Size = contents.size();
+        paths += files[i].Path;
+
+        std::vector<char> compressed;
+        uint32_t blockCount = 0;
+        const std::vector<char>* stored = &contents;
+        if (files[i].Compress && !contents.empty() && compressEntry(contents, compressed, blockCount))
+        {
+            entry.Flags = PACK_ENTRY_LZ4;
+            entry.BlockCount = blockCount;
+            stored = &compressed;
+        }
+
+        alignImage(image);
+        entry.Offset = image.size();
+        entry.StoredSize = stored->size();
+        image.insert(image.end(), stored->begin(), stored->end());
+    }
+
+    // sorted by hash, the reader searches it in place
+    std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.PathHash < b.PathHash; });
+    alignImage(image);
+    header.IndexOffset = image.size();
+    image.insert(image.end(), (const char*)entries.data(), (const char*)(entries.data() + entries.size()));
+    header.PathsOffset = image.size();
+    image.insert(image.end(), paths.begin(), paths.end());
+    header.FileSize = image.size();
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    // written aside and moved in place, so a running game never maps a half written pack
+    std::ostringstream temporary;
+    temporary << path << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    {
+        std::ofstream file(temporary.str().c_str(), std::ios::binary | std::ios::trunc);
+        file.write(image.data(), image.size());
+        if (!file)
+        {
+            std::cout << "ERROR::PACK_FILE: Failed to write " << path << std::endl;
+            file.close();
+            std::remove(temporary.str().c_str());
+            return false;
+        }
+    }
+    // Windows does not rename over an existing file
+    if (std::rename(temporary.str().c_str(), path.c_str()) != 0 &&
+        (std::remove(path.c_str()) != 0 || std::rename(temporary.str().c_str(), path.c_str()) != 0))
+    {
+        std::cout << "ERROR::PACK_FILE: Failed to write " << path << std::endl;
+        std::remove(temporary.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+PackFile::PackFile() : header(nullptr)
+{
+}
+
+bool PackFile::Open(const std::string& path)
+{
+    Close();
+    file = std::make_shared<MappedFile>();
+    if (!file->Open(path))
+    {
+        file.reset();
+        return false;
+    }
+
+    header = (const PackHeader*)file->Data();
+    if (!validate(path))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void PackFile::Close()
+{
+    file.reset();
+    header = nullptr;
+    blockOffsets.clear();
+    firstBlock.clear();
+}
+
+const PackEntry* PackFile::Find(const std::string& path) const
+{
+    uint64_t hash = HashPackPath(path);
+    const PackEntry* begin = entries();
+    const PackEntry* end = begin + header->EntryCount;
+    const PackEntry* entry = std::lower_bound(begin, end, hash, [](const PackEntry& a, uint64_t b) { return a.PathHash < b; });
+    // paths with the same hash sit next to each other
+    for (; entry != end && entry->PathHash == hash; ++entry)
+    {
+        if (entry->PathLength == path.size() && std::memcmp(file->Data() + header->PathsOffset + entry->PathOffset, path.data(), path.size()) == 0)
+            return entry;
+    }
+    return nullptr;
+}
+
+std::string PackFile::EntryPath(const PackEntry& entry) const
+{
+    return std::string((const char*)file->Data() + header->PathsOffset + entry.PathOffset, entry.PathLength);
+}
+
+bool PackFile::DecompressBlocks(const PackEntry& entry, unsigned int begin, unsigned int end, unsigned char* destination) const
+{
+    const uint64_t* offsets = &blockOffsets[firstBlock[&entry - entries()]];
+    for (unsigned int b = begin; b < end; b++)
+    {
+        size_t offset = (size_t)b * PACK_BLOCK_SIZE;
+        size_t size = std::min((size_t)PACK_BLOCK_SIZE, (size_t)entry.Size - offset);
+        if (!Lz4Decompress(file->Data() + offsets[b], (size_t)(offsets[b + 1] - offsets[b]), destination + offset, size))
+        {
+            std::cout << "ERROR::PACK_FILE: Block " << b << " of " << EntryPath(entry) << " is damaged" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PackFile::validate(const std::string& path)
+{
+    size_t size = file->Size();
+    if (size < sizeof(PackHeader) || std::memcmp(header->Magic, PACK_FILE_MAGIC, sizeof(PACK_FILE_MAGIC)) != 0)
+    {
+        std::cout << "ERROR::PACK_FILE: " << path << " is not a pack file" << std::endl;
+        return false;
+    }
+    if (header->Version != PACK_FILE_VERSION)
+    {
+        std::cout << "ERROR::PACK_FILE: " << path << " is of version " << header->Version << ", repack it" << std::endl;
+        return false;
+    }
+
+    bool valid = header->FileSize == size && header->IndexOffset % PACK_ALIGNMENT == 0 && header->IndexOffset <= size &&
+                 (uint64_t)header->EntryCount * sizeof(PackEntry) <= size - header->IndexOffset &&
+                 header->PathsOffset >= header->IndexOffset + (uint64_t)header->EntryCount * sizeof(PackEntry) && header->PathsOffset <= size;
+
+    for (unsigned int i = 0; valid && i < header->EntryCount; i++)
+    {
+        const PackEntry& entry = entries()[i];
+        valid = entry.Offset % PACK_ALIGNMENT == 0 && entry.Offset <= header->IndexOffset && entry.StoredSize <= header->IndexOffset - entry.Offset &&
+                (uint64_t)entry.PathOffset + entry.PathLength <= size - header->PathsOffset && (i == 0 || entries()[i - 1].PathHash <= entry.PathHash);
+        if (entry.Flags & PACK_ENTRY_LZ4)
+            valid = valid && entry.BlockCount == (entry.Size + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+        else
+            valid = valid && entry.StoredSize == entry.Size;
+    }
+    valid = valid && indexBlocks();
+
+    if (!valid)
+        std::cout << "ERROR::PACK_FILE: " << path << " is damaged" << std::endl;
+    return valid;
+}
+
+bool PackFile::indexBlocks()
+{
+    firstBlock.assign(header->EntryCount, 0);
+    for (unsigned int i = 0; i < header->EntryCount; i++)
+    {
+        const PackEntry& entry = entries()[i];
+        firstBlock[i] = (uint32_t)blockOffsets.size();
+        if (!(entry.Flags & PACK_ENTRY_LZ4))
+            continue;
+
+        uint64_t tableSize = (uint64_t)entry.BlockCount * sizeof(uint32_t);
+        if (tableSize > entry.StoredSize)
+            return false;
+        uint64_t offset = entry.Offset + tableSize;
+        for (unsigned int b = 0; b < entry.BlockCount; b++)
+        {
+            uint32_t blockSize;
+            std::memcpy(&blockSize, file->Data() + entry.Offset + b * sizeof(uint32_t), sizeof(blockSize));
+            blockOffsets.push_back(offset);
+            offset += blockSize;
+        }
+        blockOffsets.push_back(offset);
+        if (offset != entry.Offset + entry.StoredSize)
+            return false;
+    }
+    return true;
+}
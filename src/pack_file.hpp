@@ -0,0 +1,110 @@
+#ifndef PACK_FILE_H
+#define PACK_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+// Pack files hold every asset of a build in one file, see tools/pack.cpp
+const char* const PACK_FILE_EXTENSION = ".dgp";
+// Bumped whenever the layout changes
+const uint32_t PACK_FILE_VERSION = 1;
+// Compressed entries are cut into blocks of this many bytes, decompressed in parallel
+const uint32_t PACK_BLOCK_SIZE = 256 * 1024;
+
+// Entry flags
+const uint32_t PACK_ENTRY_LZ4 = 1;
+
+// FNV-1a of a path in the pack index
+uint64_t HashPackPath(const std::string& path);
+
+// The file layout, little-endian. The header, the entries one after the other each
+// aligned to 16 bytes, the index sorted by path hash and the paths. A compressed
+// entry is its BlockCount compressed block sizes (uint32) followed by the LZ4 blocks;
+// every block but the last decompresses to PACK_BLOCK_SIZE bytes
+struct PackHeader
+{
+    char Magic[4];
+    uint32_t Version;
+    uint64_t FileSize;
+    uint32_t EntryCount;
+    uint32_t Reserved;
+    uint64_t IndexOffset;
+    uint64_t PathsOffset;
+};
+
+struct PackEntry
+{
+    uint64_t PathHash;
+    uint64_t Offset;
+    // bytes in the pack and bytes of the file
+    uint64_t StoredSize;
+    uint64_t Size;
+    // into the paths, not null terminated
+    uint32_t PathOffset;
+    uint32_t PathLength;
+    uint32_t Flags;
+    uint32_t BlockCount;
+};
+
+// A file to pack, read from DiskPath and found in the pack as Path
+struct PackSource
+{
+    std::string Path;
+    std::string DiskPath;
+    // stored as it is when compressing saves less than an eighth
+    bool Compress;
+};
+
+// Writes the pack aside and moves it in place, false when a file cannot be read or the
+// pack cannot be written
+bool WritePackFile(const std::string& path, const std::vector<PackSource>& files);
+
+// A pack file mapped into memory. The index is checked once when it is opened and
+// searched in place, stored entries are read straight from the mapping.
+class PackFile
+{
+    public:
+        PackFile();
+
+        PackFile(const PackFile&) = delete;
+        PackFile& operator=(const PackFile&) = delete;
+
+        // False when the file is missing, not a pack of this version or damaged
+        bool Open(const std::string& path);
+        void Close();
+        bool IsOpen() const { return header != nullptr; }
+
+        // Binary search of the index, null when the pack has no such path
+        const PackEntry* Find(const std::string& path) const;
+        unsigned int EntryCount() const { return header->EntryCount; }
+        const PackEntry& Entry(unsigned int index) const { return entries()[index]; }
+        std::string EntryPath(const PackEntry& entry) const;
+
+        // The bytes of a stored entry, or the compressed blocks of one
+        const unsigned char* EntryData(const PackEntry& entry) const { return file->Data() + entry.Offset; }
+        // Thread safe. Decompresses blocks [begin, end) of an entry into its bytes at destination
+        bool DecompressBlocks(const PackEntry& entry, unsigned int begin, unsigned int end, unsigned char* destination) const;
+
+        // Views into the pack keep the mapping alive after Close
+        const std::shared_ptr<MappedFile>& File() const { return file; }
+
+    private:
+        std::shared_ptr<MappedFile> file;
+        const PackHeader* header;
+        // where the blocks of the compressed entries start in the file, BlockCount + 1
+        // per entry (the last is the end of the entry) from blockOffsets[firstBlock[entry]]
+        std::vector<uint64_t> blockOffsets;
+        std::vector<uint32_t> firstBlock;
+
+        const PackEntry* entries() const { return (const PackEntry*)(file->Data() + header->IndexOffset); }
+        bool validate(const std::string& path);
+        // builds blockOffsets, false when the block sizes of an entry do not add up
+        bool indexBlocks();
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "palette_texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "gl_state.hpp"
+
+PaletteTexture::PaletteTexture() : ID(0), Width(0), Height(0), BoneCount(0)
+{
+}
+
+void PaletteTexture::Bake(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, const std::vector<ChannelMap>& clipChannels)
+{
+    BoneCount = skeleton.BoneCount();
+    Width = BoneCount * 3;
+    Height = 0;
+
+    Clips.resize(clips.size());
+    for (unsigned int c = 0; c < clips.size(); c++)
+    {
+        Clips[c].FirstRow = Height;
+        Clips[c].FrameCount = clips[c].FrameCount;
+        Clips[c].Duration = clips[c].Duration;
+        Clips[c].SampleRate = clips[c].SampleRate;
+        Height += clips[c].FrameCount;
+    }
+
+    Texels.assign(Width * Height * 4, 0.0f);
+
+    PoseScratch scratch;
+    std::vector<Affine> palette(BoneCount);
+    for (unsigned int c = 0; c < clips.size(); c++)
+    {
+        for (unsigned int f = 0; f < clips[c].FrameCount; f++)
+        {
+            ClipFrame frame;
+            frame.Frame0 = f;
+            frame.Frame1 = f;
+            frame.Factor = 0.0f;
+            skeleton.Evaluate(clips[c], clipChannels[c], frame, scratch, palette.data());
+
+            // the three rows of an Affine are exactly the three texels of a bone
+            std::copy(&palette[0].Rows[0][0], &palette[0].Rows[0][0] + BoneCount * 12, &Texels[(Clips[c].FirstRow + f) * Width * 4]);
+        }
+    }
+}
+
+void PaletteTexture::Upload()
+{
+    if (Width == 0 || Height == 0)
+        return;
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if ((GLint)Width > maxSize || (GLint)Height > maxSize)
+    {
+        std::cout << "ERROR::PALETTE_TEXTURE: " << Width << "x" << Height << " texels exceed the maximum texture size of " << maxSize << std::endl;
+        return;
+    }
+
+    if (ID == 0)
+        glGenTextures(1, &ID);
+    GlState::BindTexture(PALETTE_TEXTURE_UNIT, GL_TEXTURE_2D, ID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Width, Height, 0, GL_RGBA, GL_FLOAT, &Texels[0]);
+    // read with texelFetch only, but a complete texture still needs non-mipmapped filters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void PaletteTexture::Release()
+{
+    if (ID != 0)
+        GlState::DeleteTexture(ID);
+    ID = 0;
+}
+
+void PaletteTexture::SetUniforms(Shader shader, unsigned int clip, float time) const
+{
+    // clips added to the model from a library after loading are not baked
+    if (clip >= Clips.size())
+        return;
+
+    GlState::BindTexture(PALETTE_TEXTURE_UNIT, GL_TEXTURE_2D, ID);
+
+    const BakedClip& baked = Clips[clip];
+    shader.SetInteger("bakedPalettes", PALETTE_TEXTURE_UNIT);
+    shader.SetInteger("bakedFirstRow", baked.FirstRow);
+    shader.SetInteger("bakedFrameCount", baked.FrameCount);
+    shader.SetFloat("bakedDuration", baked.Duration);
+    shader.SetFloat("bakedSampleRate", baked.SampleRate);
+    shader.SetFloat("bakedTime", time);
+}
+
+// Same arithmetic as the baked path of gritty.vs
+void PaletteTexture::Sample(unsigned int clip, float time, Affine* palette) const
+{
+    const BakedClip& baked = Clips[clip];
+    if (baked.FrameCount == 0)
+    {
+        std::fill(palette, palette + BoneCount, AffineFromMat4(glm::mat4(1.0f)));
+        return;
+    }
+
+    unsigned int frame0 = 0;
+    float factor = 0.0f;
+    if (baked.FrameCount >= 2 && baked.Duration > 0.0f)
+    {
+        float position = (time - baked.Duration * std::floor(time / baked.Duration)) * baked.SampleRate;
+        frame0 = std::min((unsigned int)position, baked.FrameCount - 2);
+        factor = glm::clamp(position - (float)frame0, 0.0f, 1.0f);
+    }
+    unsigned int frame1 = std::min(frame0 + 1, baked.FrameCount - 1);
+
+    const float* row0 = &Texels[(baked.FirstRow + frame0) * Width * 4];
+    const float* row1 = &Texels[(baked.FirstRow + frame1) * Width * 4];
+    float* out = &palette[0].Rows[0][0];
+    for (unsigned int i = 0; i < BoneCount * 12; i++)
+        out[i] = row0[i] + (row1[i] - row0[i]) * factor;
+}
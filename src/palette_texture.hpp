@@ -0,0 +1,51 @@
+#ifndef PALETTE_TEXTURE_H
+#define PALETTE_TEXTURE_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_state.hpp"
+#include "shader.hpp"
+#include "skeleton.hpp"
+#include "animation_clip.hpp"
+
+// Where the frames of one clip live in the palette texture
+struct BakedClip
+{
+    unsigned int FirstRow;
+    unsigned int FrameCount;
+    float Duration;
+    float SampleRate;
+};
+
+// Every baked frame of every clip of a model, posed once at load time and stored as
+// bone palettes in an RGBA32F texture. A row holds one frame, a bone takes three
+// texels (the top three rows of its matrix). The vertex shader fetches and blends
+// two rows itself, so a character drawn from it needs a clip and a time on the CPU
+// and no pose evaluation at all.
+class PaletteTexture
+{
+    public:
+        GLuint ID;
+        GLuint Width, Height;
+        unsigned int BoneCount;
+        std::vector<BakedClip> Clips;
+        // Width * Height RGBA texels, kept so that the bake can be checked on the CPU
+        std::vector<float> Texels;
+
+        PaletteTexture();
+
+        void Bake(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, const std::vector<ChannelMap>& clipChannels);
+        // Creates the GL texture from the baked texels, needs a current context
+        void Upload();
+        void Release();
+
+        // Binds the texture and sets the per-draw uniforms of the baked path in gritty.vs
+        void SetUniforms(Shader shader, unsigned int clip, float time) const;
+        // CPU mirror of the shader fetch, fills BoneCount matrices
+        void Sample(unsigned int clip, float time, Affine* palette) const;
+};
+
+#endif
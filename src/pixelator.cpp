@@ -3,6 +3,8 @@
 #include <iostream>
 #include <vector>
 
+#include "gl_state.hpp"
+
 Pixelator::Pixelator(GLuint windowWidth, GLuint windowHeight, GLuint framebufferWidth, GLuint framebufferHeight)
     : windowWidth(windowWidth), windowHeight(windowHeight), framebufferWidth(framebufferWidth), framebufferHeight(framebufferHeight)
 {
@@ -24,7 +26,7 @@ Pixelator::Pixelator(GLuint windowWidth, GLuint windowHeight, GLuint framebuffer
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
     // attach renderbuffer to framebuffer (at location = GL_COLOR_ATTACHMENT0)
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GlState::BindFramebuffer(GL_FRAMEBUFFER, FBO);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
     // specify the attachments in which to draw:
@@ -35,7 +37,7 @@ Pixelator::Pixelator(GLuint windowWidth, GLuint windowHeight, GLuint framebuffer
     glDrawBuffers(drawbuffers.size(), drawbuffers.data());
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::PIXELATOR: Failed to initialize FBO" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GlState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 Pixelator::~Pixelator()
@@ -52,7 +54,7 @@ void Pixelator::SetFramebufferSize(GLuint windowWidth, GLuint windowHeight, GLui
 
 void Pixelator::BeginRender()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GlState::BindFramebuffer(GL_FRAMEBUFFER, FBO);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0, 0, framebufferWidth, framebufferHeight);
 }
@@ -60,8 +62,8 @@ void Pixelator::BeginRender()
 void Pixelator::EndRender()
 {
     // copy off-screen framebuffer content into the screen framebuffer (also called "default framebuffer")
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);   // write into default framebuffer
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO); // read from off-screen framebuffer
+    GlState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);   // write into default framebuffer
+    GlState::BindFramebuffer(GL_READ_FRAMEBUFFER, FBO); // read from off-screen framebuffer
 
     // read from location "GL_COLOR_ATTACHMENT0" from the currently bound GL_READ_FRAMEBUFFER
     glReadBuffer(GL_COLOR_ATTACHMENT0);
@@ -73,7 +75,7 @@ void Pixelator::EndRender()
         GL_COLOR_BUFFER_BIT,                       // buffer bitfield: copy the color only (from location "GL_COLOR_ATTACHMENT0")
         GL_NEAREST);                               // filtering parameter
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0); // Binds both READ and WRITE framebuffer to default framebuffer
+    GlState::BindFramebuffer(GL_FRAMEBUFFER, 0); // Binds both READ and WRITE framebuffer to default framebuffer
 
     glViewport(0, 0, windowWidth, windowHeight);
 }
\ No newline at end of file
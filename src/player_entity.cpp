@@ -1,6 +1,6 @@
 #include "player_entity.hpp"
 
-PlayerEntity::PlayerEntity(glm::vec3 position, glm::vec3 size, Texture2D texture, AnimatedModel model) :
+PlayerEntity::PlayerEntity(glm::vec3 position, glm::vec3 size, const AtlasEntry* atlasEntry, AnimatedModelPtr model) :
     Position(position),
     size(size),
     rotation(NORTH * 45.0f),
@@ -8,9 +8,10 @@ PlayerEntity::PlayerEntity(glm::vec3 position, glm::vec3 size, Texture2D texture
     acceleration(glm::vec3(0.0f)),
     velocity(glm::vec3(0.0f)),
     running(GL_TRUE),
-    texture(texture),
-    model(model)
+    atlasEntry(atlasEntry),
+    animation(model)
 {
+    animation.TimeScale = PLAYER_ANIMATION_SPEED;
 }
 
 PlayerEntity::~PlayerEntity()
@@ -90,29 +91,41 @@ void PlayerEntity::Update(GLfloat deltaTime)
     Position.y = glm::clamp(Position.y, 0.0f, 1.0f);
 
     if (isNearlyEqual(acceleration.x, 0.0f) && isNearlyEqual(acceleration.z, 0.0f))
-        model.SetAnimation(IDLE);
+        animation.SetAnimation(IDLE);
     else
-        running ? model.SetAnimation(RUN) : model.SetAnimation(WALK);
+        running ? animation.SetAnimation(RUN) : animation.SetAnimation(WALK);
+    animation.Position = Position;
 }
 
-void PlayerEntity::Draw(Shader shader)
+glm::mat4 PlayerEntity::ModelMatrix() const
 {
-    // Prepare transformations
     glm::mat4 modelMat = glm::mat4(1.0f);
     modelMat = glm::translate(modelMat, Position);
     modelMat = glm::rotate(modelMat, glm::radians(rotation), glm::vec3(0.0f, 1.0f, 0.0f));
     modelMat = glm::scale(modelMat, size);
+    return modelMat;
+}
 
+glm::vec3 PlayerEntity::Facing() const
+{
+    return glm::vec3(std::sin(glm::radians(rotation)), 0.0f, std::cos(glm::radians(rotation)));
+}
+
+void PlayerEntity::Draw(Shader shader)
+{
     shader.Use();
     shader.SetInteger("entity", true);
-    shader.SetMatrix4("model", modelMat);
+    shader.SetMatrix4("model", ModelMatrix());
 
-    glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
+    // a model with textures binds them itself
+    bool atlased = atlasEntry != nullptr && animation.GetModel()->TextureCount() == 0;
+    if (atlased)
+        TextureAtlas::SetUniforms(shader, atlasEntry);
 
     // Set model transformation
-    model.SetBoneTransformations(shader, glfwGetTime() * 25.0f);
-    model.Draw(shader);
+    animation.Draw(shader);
 
+    if (atlased)
+        TextureAtlas::SetUniforms(shader, nullptr);
     shader.SetInteger("entity", false);
 }
\ No newline at end of file
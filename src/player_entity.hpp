@@ -10,8 +10,9 @@
 
 #include "utils.hpp"
 #include "shader.hpp"
-#include "texture.hpp"
+#include "texture_atlas.hpp"
 #include "animated_model.hpp"
+#include "animation_instance.hpp"
 
 // Defines several possible options for player movement. Used as abstraction to stay away from window-system specific input methods
 enum PlayerDirection
@@ -51,13 +52,15 @@ const GLfloat PLAYER_ACCELERATION = 8.0f;
 const GLfloat PLAYER_FRICTION = 12.0f;
 const GLfloat PLAYER_JUMP_VELOCITY = 4.0f;
 const GLfloat PLAYER_TURN_VELOCITY = 5.0f;
+const GLfloat PLAYER_ANIMATION_SPEED = 25.0f;
 
 class PlayerEntity
 {
     public:
         glm::vec3 Position;
 
-        PlayerEntity(glm::vec3 position, glm::vec3 size, Texture2D texture, AnimatedModel model);
+        // The model is drawn with the atlas entry unless it binds textures of its own
+        PlayerEntity(glm::vec3 position, glm::vec3 size, const AtlasEntry* atlasEntry, AnimatedModelPtr model);
         ~PlayerEntity();
 
         void Move(PlayerDirection direction);
@@ -68,14 +71,19 @@ class PlayerEntity
         void Update(GLfloat deltatime);
         void Draw(Shader shader);
 
+        AnimationInstance* GetAnimation() { return &animation; }
+        glm::mat4 ModelMatrix() const;
+        // unit vector the player faces, on the floor plane
+        glm::vec3 Facing() const;
+
     private:
         glm::vec3 size;
         GLfloat rotation;
         PlayerDirection direction;
         glm::vec3 acceleration, velocity;
         GLboolean running;
-        Texture2D texture;
-        AnimatedModel model;
+        const AtlasEntry* atlasEntry;
+        AnimationInstance animation;
 };
 
 #endif
\ No newline at end of file
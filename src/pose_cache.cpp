@@ -0,0 +1,169 @@
+#include "pose_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+size_t PoseKeyHash::operator()(const PoseKey& key) const
+{
+    size_t hash = std::hash<const void*>()(key.Model);
+    hash ^= (key.Animation * 2 + key.ReducedBones) * 0x9E3779B1u + (hash << 6) + (hash >> 2);
+    hash ^= key.Step * 0x85EBCA77u + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+PoseCache::PoseCache(BonePaletteBuffer& palettes) :
+    palettes(palettes),
+    quantum(0.0f),
+    frame(0),
+    lastLookups(0),
+    lastDistinctPoses(0),
+    lastEvaluations(0)
+{
+}
+
+PoseCache::~PoseCache()
+{
+    Clear();
+}
+
+void PoseCache::BeginFrame(GLfloat quantum)
+{
+    if (quantum != this->quantum)
+        Clear();
+
+    this->quantum = quantum;
+    frame++;
+    pending.clear();
+    lastLookups = 0;
+    lastDistinctPoses = 0;
+    lastEvaluations = 0;
+}
+
+// Clip time wrapped and rounded to the nearest quantum, the same way FrameAt wraps it
+PoseKey PoseCache::KeyOf(const AnimationInstance& instance, bool reducedBones) const
+{
+    PoseKey key;
+    key.Model = instance.GetModel().get();
+    key.Animation = instance.GetAnimation();
+    key.ReducedBones = reducedBones;
+    key.Step = 0;
+
+    const AnimationClip& clip = instance.GetModel()->GetClip(key.Animation);
+    if (clip.Duration > 0.0f && quantum > 0.0f)
+    {
+        float position = std::fmod(instance.GetTime(), clip.Duration) * clip.SampleRate;
+        if (position < 0.0f)
+            position += clip.Duration * clip.SampleRate;
+        key.Step = (unsigned int)(position / quantum + 0.5f);
+    }
+    return key;
+}
+
+// The last step is clamped to the last frame rather than wrapped to the first, which
+// only matches it in clips that loop seamlessly
+static ClipFrame frameOfStep(const AnimationClip& clip, unsigned int step, GLfloat quantum)
+{
+    ClipFrame frame;
+    frame.Frame0 = 0;
+    frame.Frame1 = 0;
+    frame.Factor = 0.0f;
+
+    if (clip.FrameCount < 2)
+        return frame;
+
+    float position = std::min(step * quantum, (float)(clip.FrameCount - 1));
+    frame.Frame0 = std::min((unsigned int)position, clip.FrameCount - 2);
+    frame.Frame1 = frame.Frame0 + 1;
+    frame.Factor = position - (float)frame.Frame0;
+    return frame;
+}
+
+unsigned int PoseCache::Lookup(const PoseKey& key, const AnimatedModelPtr& model)
+{
+    lastLookups++;
+
+    std::unordered_map<PoseKey, unsigned int, PoseKeyHash>::iterator found = lookup.find(key);
+    if (found != lookup.end())
+    {
+        Entry& entry = entries[found->second];
+        if (entry.UsedFrame != frame)
+        {
+            entry.UsedFrame = frame;
+            lastDistinctPoses++;
+        }
+        return found->second;
+    }
+
+    unsigned int index;
+    if (!freeEntries.empty())
+    {
+        index = freeEntries.back();
+        freeEntries.pop_back();
+    }
+    else
+    {
+        index = (unsigned int)entries.size();
+        entries.push_back(Entry());
+    }
+
+    Entry& entry = entries[index];
+    entry.Key = key;
+    entry.Model = model;
+    entry.Palette.resize(model->BonesCount());
+    entry.Offset = palettes.Allocate(model->BonesCount());
+    entry.UsedFrame = frame;
+    entry.AddedFrame = frame;
+
+    lookup[key] = index;
+    pending.push_back(index);
+    lastDistinctPoses++;
+    lastEvaluations++;
+    return index;
+}
+
+void PoseCache::EvaluatePending(JobPool& pool)
+{
+    pool.ParallelFor((unsigned int)pending.size(), 1, [this](unsigned int begin, unsigned int end)
+    {
+        for (unsigned int p = begin; p < end; p++)
+        {
+            Entry& entry = entries[pending[p]];
+            ClipFrame frame = frameOfStep(entry.Model->GetClip(entry.Key.Animation), entry.Key.Step, quantum);
+            entry.Model->Pose(entry.Key.Animation, frame, entry.Key.ReducedBones, entry.Scratch, entry.Palette.data());
+            palettes.Write(entry.Offset, entry.Palette.data(), (unsigned int)entry.Palette.size());
+        }
+    });
+    pending.clear();
+}
+
+void PoseCache::EndFrame()
+{
+    std::unordered_map<PoseKey, unsigned int, PoseKeyHash>::iterator it = lookup.begin();
+    while (it != lookup.end())
+    {
+        if (entries[it->second].UsedFrame != frame)
+        {
+            release(it->second);
+            it = lookup.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void PoseCache::Clear()
+{
+    for (std::unordered_map<PoseKey, unsigned int, PoseKeyHash>::iterator it = lookup.begin(); it != lookup.end(); ++it)
+        release(it->second);
+    lookup.clear();
+    pending.clear();
+}
+
+// The palette memory stays with the entry for reuse, the model and the buffer range go
+void PoseCache::release(unsigned int entry)
+{
+    palettes.Free(entries[entry].Offset, (unsigned int)entries[entry].Palette.size());
+    entries[entry].Model.reset();
+    freeEntries.push_back(entry);
+}
@@ -0,0 +1,109 @@
+#ifndef POSE_CACHE_H
+#define POSE_CACHE_H
+
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "job_pool.hpp"
+#include "animation_instance.hpp"
+#include "bone_palette_buffer.hpp"
+
+struct PoseCacheSettings
+{
+    bool Enabled;
+    // width of a step of clip time in frames at the clip rate, every instance of a
+    // model playing the same clip within one step shares one pose
+    GLfloat Quantum;
+
+    PoseCacheSettings() : Enabled(false), Quantum(1.0f) {}
+};
+
+// Identifies a shared pose: model, clip, skeleton and clip time in whole quanta
+struct PoseKey
+{
+    const AnimatedModel* Model;
+    unsigned int Animation;
+    unsigned int Step;
+    bool ReducedBones;
+
+    bool operator==(const PoseKey& other) const
+    {
+        return Model == other.Model && Animation == other.Animation && Step == other.Step && ReducedBones == other.ReducedBones;
+    }
+};
+
+struct PoseKeyHash
+{
+    size_t operator()(const PoseKey& key) const;
+};
+
+// The distinct poses of one update of the AnimationSystem. Instances that play the
+// same clip of the same model at about the same time look up one entry, which is
+// posed once and written to its own range of the palette buffer, and the instances
+// then draw from that range. Posing costs O(distinct poses) instead of O(instances),
+// and an entry that is still looked up on the next update is neither posed nor
+// uploaded again. Entries nobody looked up during an update are released at its end.
+class PoseCache
+{
+    public:
+        PoseCache(BonePaletteBuffer& palettes);
+        ~PoseCache();
+
+        PoseCache(const PoseCache&) = delete;
+        PoseCache& operator=(const PoseCache&) = delete;
+
+        // Starts an update, a quantum different from the last one drops every entry
+        void BeginFrame(GLfloat quantum);
+        PoseKey KeyOf(const AnimationInstance& instance, bool reducedBones) const;
+        // Not thread safe. Returns the entry of key, added to be posed by EvaluatePending when new
+        unsigned int Lookup(const PoseKey& key, const AnimatedModelPtr& model);
+        // Poses the entries added since BeginFrame across the pool and writes them to the palette buffer
+        void EvaluatePending(JobPool& pool);
+        // Releases the entries nobody looked up since BeginFrame
+        void EndFrame();
+        void Clear();
+
+        const Affine* Palette(unsigned int entry) const { return entries[entry].Palette.data(); }
+        GLintptr PaletteOffset(unsigned int entry) const { return entries[entry].Offset; }
+        // whether the entry holds a new pose this update rather than the one of the last
+        bool IsNew(unsigned int entry) const { return entries[entry].AddedFrame == frame; }
+
+        bool Empty() const { return lookup.empty(); }
+        // over the last update: lookups, entries looked up and entries posed
+        unsigned int LastLookups() const { return lastLookups; }
+        unsigned int LastDistinctPoses() const { return lastDistinctPoses; }
+        unsigned int LastEvaluations() const { return lastEvaluations; }
+        // share of the lookups that found their pose already evaluated
+        float LastHitRate() const { return lastLookups > 0 ? 1.0f - (float)lastEvaluations / lastLookups : 0.0f; }
+
+    private:
+        struct Entry
+        {
+            PoseKey Key;
+            // keeps the model alive for as long as its key may be compared
+            AnimatedModelPtr Model;
+            std::vector<Affine> Palette;
+            GLintptr Offset;
+            unsigned int UsedFrame, AddedFrame;
+            PoseScratch Scratch;
+        };
+
+        BonePaletteBuffer& palettes;
+        GLfloat quantum;
+        unsigned int frame;
+        // a deque so the palettes handed out stay put while entries are added
+        std::deque<Entry> entries;
+        std::vector<unsigned int> freeEntries;
+        std::unordered_map<PoseKey, unsigned int, PoseKeyHash> lookup;
+        std::vector<unsigned int> pending;
+
+        unsigned int lastLookups, lastDistinctPoses, lastEvaluations;
+
+        void release(unsigned int entry);
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "pose_kernels.hpp"
+
+#include <cmath>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define POSE_KERNELS_AVX
+    #define POSE_KERNELS_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define POSE_KERNELS_SSE
+#endif
+
+// Every SoA kernel is written once against a lane type and instantiated for the
+// widest vector unit available, with the scalar lane handling the tail.
+namespace
+{
+    struct ScalarLane
+    {
+        typedef float Type;
+        static const unsigned int Width = 1;
+
+        static Type Load(const float* p) { return *p; }
+        static void Store(float* p, Type v) { *p = v; }
+        static Type Set(float v) { return v; }
+        static Type Add(Type a, Type b) { return a + b; }
+        static Type Sub(Type a, Type b) { return a - b; }
+        static Type Mul(Type a, Type b) { return a * b; }
+        static Type Div(Type a, Type b) { return a / b; }
+        static Type Sqrt(Type a) { return std::sqrt(a); }
+        // +1 or -1 with the sign of a
+        static Type SignOf(Type a) { return a < 0.0f ? -1.0f : 1.0f; }
+        static Type Abs(Type a) { return std::fabs(a); }
+    };
+
+#if defined(POSE_KERNELS_AVX)
+    struct VectorLane
+    {
+        typedef __m256 Type;
+        static const unsigned int Width = 8;
+
+        static Type Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, Type v) { _mm256_storeu_ps(p, v); }
+        static Type Set(float v) { return _mm256_set1_ps(v); }
+        static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+        static Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+        static Type SignOf(Type a) { return _mm256_or_ps(_mm256_and_ps(a, _mm256_set1_ps(-0.0f)), _mm256_set1_ps(1.0f)); }
+        static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    };
+#elif defined(POSE_KERNELS_SSE)
+    struct VectorLane
+    {
+        typedef __m128 Type;
+        static const unsigned int Width = 4;
+
+        static Type Load(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, Type v) { _mm_storeu_ps(p, v); }
+        static Type Set(float v) { return _mm_set1_ps(v); }
+        static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+        static Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+        static Type SignOf(Type a) { return _mm_or_ps(_mm_and_ps(a, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f)); }
+        static Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    };
+#else
+    typedef ScalarLane VectorLane;
+#endif
+
+    template <typename L>
+    inline void lerpFloats(unsigned int i, const float* a, const float* b, typename L::Type t, float* out)
+    {
+        typename L::Type value = L::Load(a + i);
+        L::Store(out + i, L::Add(value, L::Mul(L::Sub(L::Load(b + i), value), t)));
+    }
+
+    // Adjusts a lerp factor so that a normalised lerp follows the constant angular
+    // velocity of slerp, a polynomial fit in the cosine of the angle between the
+    // quaternions that needs no trigonometry
+    template <typename L>
+    inline typename L::Type slerpFactor(typename L::Type cosine, typename L::Type t)
+    {
+        typename L::Type d = L::Abs(cosine);
+        typename L::Type a = L::Add(L::Set(1.0904f), L::Mul(d, L::Add(L::Set(-3.2452f), L::Mul(d, L::Add(L::Set(3.55645f), L::Mul(d, L::Set(-1.43519f)))))));
+        typename L::Type b = L::Add(L::Set(0.848013f), L::Mul(d, L::Add(L::Set(-1.06021f), L::Mul(d, L::Set(0.215638f)))));
+        typename L::Type centered = L::Sub(t, L::Set(0.5f));
+        typename L::Type k = L::Add(L::Mul(a, L::Mul(centered, centered)), b);
+        return L::Add(t, L::Mul(L::Mul(t, L::Mul(centered, L::Sub(t, L::Set(1.0f)))), k));
+    }
+
+    template <typename L>
+    inline void slerpQuat(unsigned int i, unsigned int stride, const float* a, const float* b, typename L::Type t, float* out)
+    {
+        typename L::Type ax = L::Load(a + i), ay = L::Load(a + stride + i), az = L::Load(a + 2 * stride + i), aw = L::Load(a + 3 * stride + i);
+        typename L::Type bx = L::Load(b + i), by = L::Load(b + stride + i), bz = L::Load(b + 2 * stride + i), bw = L::Load(b + 3 * stride + i);
+
+        // flip b into a's hemisphere so the blend takes the short way round
+        typename L::Type dot = L::Add(L::Add(L::Mul(ax, bx), L::Mul(ay, by)), L::Add(L::Mul(az, bz), L::Mul(aw, bw)));
+        typename L::Type sign = L::SignOf(dot);
+        t = slerpFactor<L>(dot, t);
+
+        typename L::Type x = L::Add(ax, L::Mul(L::Sub(L::Mul(bx, sign), ax), t));
+        typename L::Type y = L::Add(ay, L::Mul(L::Sub(L::Mul(by, sign), ay), t));
+        typename L::Type z = L::Add(az, L::Mul(L::Sub(L::Mul(bz, sign), az), t));
+        typename L::Type w = L::Add(aw, L::Mul(L::Sub(L::Mul(bw, sign), aw), t));
+
+        typename L::Type length = L::Sqrt(L::Add(L::Add(L::Mul(x, x), L::Mul(y, y)), L::Add(L::Mul(z, z), L::Mul(w, w))));
+        typename L::Type inverse = L::Div(L::Set(1.0f), length);
+        L::Store(out + i, L::Mul(x, inverse));
+        L::Store(out + stride + i, L::Mul(y, inverse));
+        L::Store(out + 2 * stride + i, L::Mul(z, inverse));
+        L::Store(out + 3 * stride + i, L::Mul(w, inverse));
+    }
+
+    template <typename L>
+    inline void composeAffine(unsigned int i, unsigned int stride, const float* translations, const float* rotations, const float* scales, float* out)
+    {
+        typename L::Type x = L::Load(rotations + i), y = L::Load(rotations + stride + i), z = L::Load(rotations + 2 * stride + i), w = L::Load(rotations + 3 * stride + i);
+        typename L::Type sx = L::Load(scales + i), sy = L::Load(scales + stride + i), sz = L::Load(scales + 2 * stride + i);
+        typename L::Type one = L::Set(1.0f), two = L::Set(2.0f);
+
+        typename L::Type xx = L::Mul(x, x), yy = L::Mul(y, y), zz = L::Mul(z, z);
+        typename L::Type xy = L::Mul(x, y), xz = L::Mul(x, z), yz = L::Mul(y, z);
+        typename L::Type wx = L::Mul(w, x), wy = L::Mul(w, y), wz = L::Mul(w, z);
+
+        // rotation matrix with every column scaled by the matching scale factor
+        L::Store(out + 0 * stride + i, L::Mul(L::Sub(one, L::Mul(two, L::Add(yy, zz))), sx));
+        L::Store(out + 1 * stride + i, L::Mul(L::Mul(two, L::Sub(xy, wz)), sy));
+        L::Store(out + 2 * stride + i, L::Mul(L::Mul(two, L::Add(xz, wy)), sz));
+        L::Store(out + 3 * stride + i, L::Load(translations + i));
+
+        L::Store(out + 4 * stride + i, L::Mul(L::Mul(two, L::Add(xy, wz)), sx));
+        L::Store(out + 5 * stride + i, L::Mul(L::Sub(one, L::Mul(two, L::Add(xx, zz))), sy));
+        L::Store(out + 6 * stride + i, L::Mul(L::Mul(two, L::Sub(yz, wx)), sz));
+        L::Store(out + 7 * stride + i, L::Load(translations + stride + i));
+
+        L::Store(out + 8 * stride + i, L::Mul(L::Mul(two, L::Sub(xz, wy)), sx));
+        L::Store(out + 9 * stride + i, L::Mul(L::Mul(two, L::Add(yz, wx)), sy));
+        L::Store(out + 10 * stride + i, L::Mul(L::Sub(one, L::Mul(two, L::Add(xx, yy))), sz));
+        L::Store(out + 11 * stride + i, L::Load(translations + 2 * stride + i));
+    }
+
+    template <typename L>
+    inline void multiplyAffine(unsigned int i, unsigned int stride, const float* a, const float* b, float* out)
+    {
+        typename L::Type bm[12];
+        for (unsigned int k = 0; k < 12; k++)
+            bm[k] = L::Load(b + k * stride + i);
+
+        for (unsigned int row = 0; row < 3; row++)
+        {
+            typename L::Type a0 = L::Load(a + (row * 4 + 0) * stride + i);
+            typename L::Type a1 = L::Load(a + (row * 4 + 1) * stride + i);
+            typename L::Type a2 = L::Load(a + (row * 4 + 2) * stride + i);
+            typename L::Type a3 = L::Load(a + (row * 4 + 3) * stride + i);
+
+            L::Store(out + (row * 4 + 0) * stride + i, L::Add(L::Add(L::Mul(a0, bm[0]), L::Mul(a1, bm[4])), L::Mul(a2, bm[8])));
+            L::Store(out + (row * 4 + 1) * stride + i, L::Add(L::Add(L::Mul(a0, bm[1]), L::Mul(a1, bm[5])), L::Mul(a2, bm[9])));
+            L::Store(out + (row * 4 + 2) * stride + i, L::Add(L::Add(L::Mul(a0, bm[2]), L::Mul(a1, bm[6])), L::Mul(a2, bm[10])));
+            L::Store(out + (row * 4 + 3) * stride + i, L::Add(L::Add(L::Add(L::Mul(a0, bm[3]), L::Mul(a1, bm[7])), L::Mul(a2, bm[11])), a3));
+        }
+    }
+}
+
+void LerpFloats(unsigned int n, const float* a, const float* b, float t, float* out)
+{
+    unsigned int i = 0;
+    for (; i + VectorLane::Width <= n; i += VectorLane::Width)
+        lerpFloats<VectorLane>(i, a, b, VectorLane::Set(t), out);
+    for (; i < n; i++)
+        lerpFloats<ScalarLane>(i, a, b, t, out);
+}
+
+void SlerpQuats(unsigned int n, unsigned int stride, const float* a, const float* b, float t, float* out)
+{
+    unsigned int i = 0;
+    for (; i + VectorLane::Width <= n; i += VectorLane::Width)
+        slerpQuat<VectorLane>(i, stride, a, b, VectorLane::Set(t), out);
+    for (; i < n; i++)
+        slerpQuat<ScalarLane>(i, stride, a, b, t, out);
+}
+
+void ComposeAffines(unsigned int n, unsigned int stride, const float* translations, const float* rotations, const float* scales, float* out)
+{
+    unsigned int i = 0;
+    for (; i + VectorLane::Width <= n; i += VectorLane::Width)
+        composeAffine<VectorLane>(i, stride, translations, rotations, scales, out);
+    for (; i < n; i++)
+        composeAffine<ScalarLane>(i, stride, translations, rotations, scales, out);
+}
+
+void MultiplyAffines(unsigned int n, unsigned int stride, const float* a, const float* b, float* out)
+{
+    unsigned int i = 0;
+    for (; i + VectorLane::Width <= n; i += VectorLane::Width)
+        multiplyAffine<VectorLane>(i, stride, a, b, out);
+    for (; i < n; i++)
+        multiplyAffine<ScalarLane>(i, stride, a, b, out);
+}
+
+void GatherAffine(unsigned int i, unsigned int stride, const float* planes, Affine& out)
+{
+    for (unsigned int k = 0; k < 12; k++)
+        out.Rows[k / 4][k % 4] = planes[k * stride + i];
+}
+
+// Row i of a * b is a[i][0] * b.row0 + a[i][1] * b.row1 + a[i][2] * b.row2 + (0, 0, 0, a[i][3]),
+// which maps one row onto one SSE register
+void MultiplyAffine(const Affine& a, const Affine& b, Affine& out)
+{
+#if defined(POSE_KERNELS_SSE)
+    __m128 b0 = _mm_loadu_ps(b.Rows[0]);
+    __m128 b1 = _mm_loadu_ps(b.Rows[1]);
+    __m128 b2 = _mm_loadu_ps(b.Rows[2]);
+
+    for (unsigned int row = 0; row < 3; row++)
+    {
+        __m128 value = _mm_mul_ps(_mm_set1_ps(a.Rows[row][0]), b0);
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(a.Rows[row][1]), b1));
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(a.Rows[row][2]), b2));
+        value = _mm_add_ps(value, _mm_set_ps(a.Rows[row][3], 0.0f, 0.0f, 0.0f));
+        _mm_storeu_ps(out.Rows[row], value);
+    }
+#else
+    for (unsigned int row = 0; row < 3; row++)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            out.Rows[row][column] = a.Rows[row][0] * b.Rows[0][column] +
+                                    a.Rows[row][1] * b.Rows[1][column] +
+                                    a.Rows[row][2] * b.Rows[2][column];
+        }
+        out.Rows[row][3] += a.Rows[row][3];
+    }
+#endif
+}
+
+void MultiplyAffines(unsigned int n, const Affine* a, const Affine* b, Affine* out)
+{
+    for (unsigned int i = 0; i < n; i++)
+        MultiplyAffine(a[i], b[i], out[i]);
+}
+
+void SkinVertices(unsigned int n, const SkinningVertex* vertices, const Affine* palette, SkinnedVertex* out)
+{
+    for (unsigned int v = 0; v < n; v++)
+    {
+        const SkinningVertex& vertex = vertices[v];
+#if defined(POSE_KERNELS_SSE)
+        __m128 rows[3];
+        for (unsigned int row = 0; row < 3; row++)
+        {
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(vertex.Weights[0]), _mm_loadu_ps(palette[vertex.Bones[0]].Rows[row]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(vertex.Weights[1]), _mm_loadu_ps(palette[vertex.Bones[1]].Rows[row])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(vertex.Weights[2]), _mm_loadu_ps(palette[vertex.Bones[2]].Rows[row])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(vertex.Weights[3]), _mm_loadu_ps(palette[vertex.Bones[3]].Rows[row])));
+            rows[row] = sum;
+        }
+
+        // columns of the blended matrix, so a point is a weighted sum of registers
+        __m128 c0 = rows[0], c1 = rows[1], c2 = rows[2], c3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Position[0])), _mm_mul_ps(c1, _mm_set1_ps(vertex.Position[1]))),
+                                     _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.Position[2])), c3));
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Normal[0])), _mm_mul_ps(c1, _mm_set1_ps(vertex.Normal[1]))),
+                                   _mm_mul_ps(c2, _mm_set1_ps(vertex.Normal[2])));
+
+        float p[4], q[4];
+        _mm_storeu_ps(p, position);
+        _mm_storeu_ps(q, normal);
+#else
+        float m[3][4] = { { 0.0f } };
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            const Affine& bone = palette[vertex.Bones[i]];
+            for (unsigned int row = 0; row < 3; row++)
+                for (unsigned int column = 0; column < 4; column++)
+                    m[row][column] += vertex.Weights[i] * bone.Rows[row][column];
+        }
+
+        float p[3], q[3];
+        for (unsigned int row = 0; row < 3; row++)
+        {
+            p[row] = m[row][0] * vertex.Position[0] + m[row][1] * vertex.Position[1] + m[row][2] * vertex.Position[2] + m[row][3];
+            q[row] = m[row][0] * vertex.Normal[0] + m[row][1] * vertex.Normal[1] + m[row][2] * vertex.Normal[2];
+        }
+#endif
+        float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+        float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+
+        out[v].Position[0] = p[0];
+        out[v].Position[1] = p[1];
+        out[v].Position[2] = p[2];
+        out[v].Normal[0] = q[0] * inverse;
+        out[v].Normal[1] = q[1] * inverse;
+        out[v].Normal[2] = q[2] * inverse;
+    }
+}
+
+Affine AffineFromMat4(const glm::mat4& matrix)
+{
+    Affine affine;
+    for (unsigned int row = 0; row < 3; row++)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+            affine.Rows[row][column] = matrix[column][row];
+    }
+    return affine;
+}
+
+glm::mat4 Mat4FromAffine(const Affine& affine)
+{
+    glm::mat4 matrix(1.0f);
+    for (unsigned int row = 0; row < 3; row++)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+            matrix[column][row] = affine.Rows[row][column];
+    }
+    return matrix;
+}
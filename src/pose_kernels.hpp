@@ -0,0 +1,65 @@
+#ifndef POSE_KERNELS_H
+#define POSE_KERNELS_H
+
+#include <glm/glm.hpp>
+
+// Batch math kernels for pose evaluation. They use AVX or SSE when the compiler
+// targets them and fall back to plain loops (which NEON compilers auto-vectorise)
+// everywhere else, with identical results up to float rounding.
+
+// Lanes processed per iteration by the SoA kernels, arrays padded to a multiple
+// of this never need the scalar tail
+const unsigned int POSE_KERNEL_WIDTH = 8;
+
+// Affine transformation stored as the top three rows of a 4x4 matrix, row-major,
+// the implicit fourth row being (0, 0, 0, 1)
+struct Affine
+{
+    float Rows[3][4];
+};
+
+// The SoA kernels work on planes: a batch of N vectors is stored as one plane of
+// `stride` floats per component (x plane, then y plane, ...), stride >= N, so lane i
+// of every component sits at the same offset and whole registers load at once.
+
+// out = a + (b - a) * t over n plain floats, for translation and scale planes alike
+void LerpFloats(unsigned int n, const float* a, const float* b, float t, float* out);
+// Slerp along the shorter arc, quaternions as x, y, z, w planes. Computed as a
+// normalised lerp with a corrected blend factor, within about 1e-5 of the true slerp
+// for the small angles between neighbouring baked frames
+void SlerpQuats(unsigned int n, unsigned int stride, const float* a, const float* b, float t, float* out);
+// out = translation * rotation * scaling as 12 planes in row-major order, rotations must be unit quaternions
+void ComposeAffines(unsigned int n, unsigned int stride, const float* translations, const float* rotations, const float* scales, float* out);
+// out = a * b for 12-plane affines
+void MultiplyAffines(unsigned int n, unsigned int stride, const float* a, const float* b, float* out);
+// Copies lane i of a 12-plane affine into an AoS matrix
+void GatherAffine(unsigned int i, unsigned int stride, const float* planes, Affine& out);
+
+// out[i] = a[i] * b[i] for matrices stored one after the other, out may not alias a or b
+void MultiplyAffines(unsigned int n, const Affine* a, const Affine* b, Affine* out);
+void MultiplyAffine(const Affine& a, const Affine& b, Affine& out);
+
+// Vertex data read by the CPU skinning kernel
+struct SkinningVertex
+{
+    float Position[3];
+    float Normal[3];
+    int Bones[4];
+    float Weights[4];
+};
+
+// Output of the CPU skinning kernel, the layout of the streaming vertex buffers
+struct SkinnedVertex
+{
+    float Position[3];
+    float Normal[3];
+};
+
+// Linear blend skinning: positions by the weighted sum of their bone matrices,
+// normals by its 3x3 part and renormalised. One bone matrix row per SSE register.
+void SkinVertices(unsigned int n, const SkinningVertex* vertices, const Affine* palette, SkinnedVertex* out);
+
+Affine AffineFromMat4(const glm::mat4& matrix);
+glm::mat4 Mat4FromAffine(const Affine& affine);
+
+#endif
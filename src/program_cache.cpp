@@ -0,0 +1,220 @@
+#include "program_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "mapped_file.hpp"
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'D', 'G', 'P', 'C' };
+
+// The file layout, little-endian. The header, then Count records of a ProgramRecord
+// followed by its Size bytes of binary
+struct ProgramCacheHeader
+{
+    char Magic[4];
+    uint32_t Version;
+    uint64_t DriverHash;
+    uint32_t Count;
+    uint32_t Reserved;
+};
+
+struct ProgramRecord
+{
+    uint64_t Key;
+    uint32_t Format;
+    uint32_t Size;
+};
+
+// FNV-1a, continued from hash
+static uint64_t hashBytes(const void* bytes, size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= ((const unsigned char*)bytes)[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashString(const char* text, uint64_t hash)
+{
+    // the terminator too, so "ab" + "c" and "a" + "bc" differ
+    return hashBytes(text != nullptr ? text : "", text != nullptr ? std::strlen(text) + 1 : 1, hash);
+}
+
+ProgramCache::ProgramCache()
+    : driverHash(0), opened(false), supported(false), dirty(false), hits(0), misses(0), invalidations(0)
+{
+}
+
+void ProgramCache::Open(const std::string& path)
+{
+    this->path = path;
+    opened = true;
+    binaries.clear();
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    supported = formatCount > 0;
+    if (!supported)
+        return;
+
+    driverHash = hashString((const char*)glGetString(GL_VENDOR), 14695981039346656037ULL);
+    driverHash = hashString((const char*)glGetString(GL_RENDERER), driverHash);
+    driverHash = hashString((const char*)glGetString(GL_VERSION), driverHash);
+    read();
+}
+
+uint64_t ProgramCache::Key(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource) const
+{
+    uint64_t key = hashString(vertexSource.c_str(), driverHash);
+    key = hashString(fragmentSource.c_str(), key);
+    return hashString(geometrySource.c_str(), key);
+}
+
+bool ProgramCache::Load(uint64_t key, GLuint program)
+{
+    std::map<uint64_t, Binary>::iterator found = binaries.find(key);
+    if (!supported || found == binaries.end())
+    {
+        misses++;
+        return false;
+    }
+
+    glProgramBinary(program, found->second.Format, found->second.Data.data(), (GLsizei)found->second.Data.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        // a driver update the version string does not show, say
+        binaries.erase(found);
+        dirty = true;
+        invalidations++;
+        misses++;
+        return false;
+    }
+    hits++;
+    return true;
+}
+
+void ProgramCache::Store(uint64_t key, GLuint program)
+{
+    if (!supported)
+        return;
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return;
+
+    Binary binary;
+    binary.Data.resize((size_t)size);
+    GLsizei length = 0;
+    glGetProgramBinary(program, size, &length, &binary.Format, binary.Data.data());
+    if (length <= 0)
+        return;
+    binary.Data.resize((size_t)length);
+
+    // the file is only written again for a binary it does not have yet
+    std::map<uint64_t, Binary>::iterator found = binaries.find(key);
+    if (found != binaries.end() && found->second.Format == binary.Format && found->second.Data == binary.Data)
+        return;
+    binaries[key].Format = binary.Format;
+    binaries[key].Data.swap(binary.Data);
+    dirty = true;
+}
+
+void ProgramCache::Save()
+{
+    if (!supported || !dirty)
+        return;
+    dirty = false;
+
+    ProgramCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.Version = PROGRAM_CACHE_VERSION;
+    header.DriverHash = driverHash;
+    header.Count = (uint32_t)binaries.size();
+
+    std::vector<char> image((const char*)&header, (const char*)(&header + 1));
+    for (std::map<uint64_t, Binary>::const_iterator binary = binaries.begin(); binary != binaries.end(); ++binary)
+    {
+        ProgramRecord record = { binary->first, binary->second.Format, (uint32_t)binary->second.Data.size() };
+        image.insert(image.end(), (const char*)&record, (const char*)(&record + 1));
+        image.insert(image.end(), binary->second.Data.begin(), binary->second.Data.end());
+    }
+
+    // written aside and moved in place, so a crash never leaves half a file behind
+    std::ostringstream temporary;
+    temporary << path << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    {
+        std::ofstream file(temporary.str().c_str(), std::ios::binary | std::ios::trunc);
+        file.write(image.data(), image.size());
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE: Failed to write " << path << std::endl;
+            file.close();
+            std::remove(temporary.str().c_str());
+            return;
+        }
+    }
+    // Windows does not rename over an existing file
+    if (std::rename(temporary.str().c_str(), path.c_str()) != 0 &&
+        (std::remove(path.c_str()) != 0 || std::rename(temporary.str().c_str(), path.c_str()) != 0))
+    {
+        std::cout << "ERROR::PROGRAM_CACHE: Failed to write " << path << std::endl;
+        std::remove(temporary.str().c_str());
+    }
+}
+
+void ProgramCache::read()
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return;
+
+    const unsigned char* data = file.Data();
+    size_t size = file.Size();
+    ProgramCacheHeader header;
+    if (size < sizeof(header))
+        return;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0 || header.Version != PROGRAM_CACHE_VERSION ||
+        header.DriverHash != driverHash)
+    {
+        // compiled again and written over on the next Save
+        if (std::memcmp(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) == 0)
+            invalidations += header.Count;
+        dirty = true;
+        return;
+    }
+
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.Count; i++)
+    {
+        // a cut off file keeps the programs before the cut
+        ProgramRecord record;
+        if (size - offset < sizeof(record))
+        {
+            dirty = true;
+            break;
+        }
+        std::memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+        if (size - offset < record.Size)
+        {
+            dirty = true;
+            break;
+        }
+        Binary& binary = binaries[record.Key];
+        binary.Format = record.Format;
+        binary.Data.assign(data + offset, data + offset + record.Size);
+        offset += record.Size;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Where the game keeps the binaries of its linked programs, in its working directory
+const char* const PROGRAM_CACHE_FILE = "doublegrit.dgs";
+// Bumped whenever the layout changes, an older file is dropped
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// The program binaries of earlier runs, so a program the driver linked once is loaded
+// with glProgramBinary instead of compiled again. A binary is found by a hash of the
+// sources of its stages (with whatever they #define) and of the driver's vendor,
+// renderer and version strings. A new driver drops the whole file, a binary the driver
+// turns down anyway is dropped alone; both are compiled again. GL thread only.
+class ProgramCache
+{
+    public:
+        ProgramCache();
+
+        ProgramCache(const ProgramCache&) = delete;
+        ProgramCache& operator=(const ProgramCache&) = delete;
+
+        // Reads the file, keeping none of it when it was written for another driver.
+        // Without program binaries in the context the cache stays empty and unused
+        void Open(const std::string& path);
+        bool IsOpen() const { return opened; }
+        // Whether the context can save and load program binaries at all
+        bool IsSupported() const { return supported; }
+
+        uint64_t Key(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource) const;
+        // Loads the binary stored for key into the program, false when there is none or
+        // the driver turned it down; the program then has to be compiled
+        bool Load(uint64_t key, GLuint program);
+        // Keeps the binary of a program linked as retrievable, written by Save
+        void Store(uint64_t key, GLuint program);
+        // Writes the file aside and moves it in place when a new binary was stored or
+        // one dropped since it was last written
+        void Save();
+
+        unsigned int Count() const { return (unsigned int)binaries.size(); }
+        // since Open, programs loaded from binaries, compiled because there was none and
+        // binaries dropped, one by one or with the whole file
+        unsigned int Hits() const { return hits; }
+        unsigned int Misses() const { return misses; }
+        unsigned int Invalidations() const { return invalidations; }
+
+    private:
+        struct Binary
+        {
+            GLenum Format;
+            std::vector<char> Data;
+        };
+
+        std::string path;
+        std::map<uint64_t, Binary> binaries;
+        uint64_t driverHash;
+        bool opened, supported, dirty;
+        unsigned int hits, misses, invalidations;
+
+        void read();
+};
+
+#endif
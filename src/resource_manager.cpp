@@ -1,101 +1,450 @@
 #include "resource_manager.hpp"
 
+#include <algorithm>
+
+#include "cooked_model.hpp"
+#include "gl_state.hpp"
+#include "model_importer.hpp"
+#include "vfs.hpp"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 // Instantiate static variables
-std::map<std::string, Texture2D> ResourceManager::textures;
-std::map<std::string, Shader> ResourceManager::shaders;
-std::map<std::string, AnimatedModel> ResourceManager::models;
+ResourcePool<Texture2D> ResourceManager::textures(&ResourceManager::unloadTexture, &ResourceManager::measureTexture);
+ResourcePool<Shader> ResourceManager::shaders(&ResourceManager::unloadShader, &ResourceManager::measureShader);
+ResourcePool<AnimatedModelPtr> ResourceManager::models(&ResourceManager::unloadModel, &ResourceManager::measureModel, &ResourceManager::isModelShared);
+ClipLibrary ResourceManager::clipLibrary;
+TextureCache ResourceManager::textureCache;
+ProgramCache ResourceManager::programCache;
+std::vector<ResourceManager::PendingShader> ResourceManager::pendingShaders;
+std::chrono::high_resolution_clock::time_point ResourceManager::shaderBatchStart;
+double ResourceManager::shaderCompileTime = 0.0;
+std::unique_ptr<AssetLoader> ResourceManager::loader;
+size_t ResourceManager::cpuBudget = RESOURCE_CPU_BUDGET;
+size_t ResourceManager::gpuBudget = RESOURCE_GPU_BUDGET;
+uint64_t ResourceManager::frame = 0;
 
-Shader ResourceManager::LoadShader(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename, std::string name)
+ShaderHandle ResourceManager::LoadShader(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename, std::string name)
 {
-    shaders[name] = loadShaderFromFilename(vShaderFilename, fShaderFilename, gShaderFilename);
-    return shaders[name];
+    return shaders.Add(name, loadShaderFromFilename(vShaderFilename, fShaderFilename, gShaderFilename), frame,
+                       shaderLoader(vShaderFilename, fShaderFilename, gShaderFilename != nullptr ? gShaderFilename : ""));
 }
 
-Shader ResourceManager::GetShader(std::string name)
+TextureHandle ResourceManager::LoadTexture(const GLchar *textureFilename, GLboolean alpha, std::string name, GLuint wrap, GLuint filterMin, GLuint filterMax)
 {
-    return shaders[name];
+    return textures.Add(name, loadTextureFromFilename(textureFilename, alpha, wrap, filterMin, filterMax), frame,
+                        textureLoader(textureFilename, alpha, wrap, filterMin, filterMax));
 }
 
-Texture2D ResourceManager::LoadTexture(const GLchar *textureFilename, GLboolean alpha, std::string name, GLuint wrap, GLuint filterMin, GLuint filterMax)
+ModelHandle ResourceManager::LoadModel(const GLchar *modelFilename, std::string name, const ClipCompressionSettings* compression,
+                                       const std::vector<std::string>& libraryClips)
 {
-    textures[name] = loadTextureFromFilename(textureFilename, alpha, wrap, filterMin, filterMax);
-    return textures[name];
+    return models.Add(name, loadModelFromFilename(modelFilename, compression, libraryClips), frame,
+                      modelLoader(modelFilename, compression, libraryClips));
 }
 
-Texture2D ResourceManager::GetTexture(std::string name)
+void ResourceManager::RegisterClip(const GLchar *animationFilename, std::string name, std::string animation, const ClipCompressionSettings* compression)
 {
-    return textures[name];
+    clipLibrary.Register(name, animationFilename, animation, compression);
 }
 
-AnimatedModel ResourceManager::LoadModel(const GLchar *modelFilename, std::string name)
+std::shared_future<ShaderHandle> ResourceManager::LoadShaderAsync(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename, std::string name)
 {
-    models[name] = loadModelFromFilename(modelFilename);
-    return models[name];
+    std::shared_ptr<std::promise<ShaderHandle> > promise = std::make_shared<std::promise<ShaderHandle> >();
+    std::shared_ptr<ShaderSources> sources = std::make_shared<ShaderSources>();
+    // the file names may not outlive the call
+    std::string vertexFile = vShaderFilename, fragmentFile = fShaderFilename;
+    std::string geometryFile = gShaderFilename != nullptr ? gShaderFilename : "";
+
+    GetLoader().Load([=]()
+    {
+        readShaderSources(vertexFile, fragmentFile, geometryFile, *sources);
+        return sources->Vertex.size() + sources->Fragment.size() + sources->Geometry.size();
+    },
+    [=]()
+    {
+        PendingShader pending;
+        if (beginShader(*sources, pending.Program, pending.Key))
+        {
+            promise->set_value(shaders.Add(name, pending.Program, frame, shaderLoader(vertexFile, fragmentFile, geometryFile)));
+            if (pendingShaders.empty())
+                endShaderBatch();
+            return;
+        }
+        // checked by PumpShaderCompiles, after every compile of the frame was issued
+        pending.Name = name;
+        pending.Load = shaderLoader(vertexFile, fragmentFile, geometryFile);
+        pending.Promise = promise;
+        pendingShaders.push_back(pending);
+    },
+    [=]()
+    {
+        promise->set_value(ShaderHandle());
+    });
+    return promise->get_future().share();
 }
 
-AnimatedModel ResourceManager::GetModel(std::string name)
+unsigned int ResourceManager::PumpShaderCompiles()
 {
-    return models[name];
+    if (pendingShaders.empty())
+        return 0;
+
+    // without KHR_parallel_shader_compile every program counts as done, the first
+    // check then waits for the driver
+    for (unsigned int i = 0; i < pendingShaders.size();)
+    {
+        PendingShader& pending = pendingShaders[i];
+        if (!pending.Program.IsCompileDone())
+        {
+            i++;
+            continue;
+        }
+        finishShader(pending.Program, pending.Key);
+        pending.Promise->set_value(shaders.Add(pending.Name, pending.Program, frame, pending.Load));
+        pendingShaders.erase(pendingShaders.begin() + i);
+    }
+
+    if (pendingShaders.empty())
+    {
+        endShaderBatch();
+        programCache.Save();
+    }
+    return (unsigned int)pendingShaders.size();
 }
 
-void ResourceManager::Clear()
+std::shared_future<TextureHandle> ResourceManager::LoadTextureAsync(const GLchar *textureFilename, GLboolean alpha, std::string name, GLuint wrap, GLuint filterMin, GLuint filterMax)
 {
-    // (Properly) delete all shaders
-    for (auto iter : shaders)
-        glDeleteProgram(iter.second.ID);
-    // (Properly) delete all textures
-    for (auto iter : textures)
-        glDeleteTextures(1, &iter.second.ID);
+    std::shared_ptr<std::promise<TextureHandle> > promise = std::make_shared<std::promise<TextureHandle> >();
+    std::shared_ptr<TextureSource> source = std::make_shared<TextureSource>();
+    std::string file = textureFilename;
+
+    GetLoader().Load([=]()
+    {
+        ReadTextureSource(file, *source);
+        return source->Size();
+    },
+    [=]()
+    {
+        TextureHandle texture = textures.Add(name, textureFromSource(*source, alpha, wrap, filterMin, filterMax), frame,
+                                             textureLoader(file, alpha, wrap, filterMin, filterMax));
+        ReleaseTextureSource(*source);
+        promise->set_value(texture);
+    },
+    [=]()
+    {
+        ReleaseTextureSource(*source);
+        promise->set_value(TextureHandle());
+    });
+    return promise->get_future().share();
 }
 
-Shader ResourceManager::loadShaderFromFilename(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename)
+std::shared_future<ModelHandle> ResourceManager::LoadModelAsync(const GLchar *modelFilename, std::string name, const ClipCompressionSettings* compression,
+                                                                const std::vector<std::string>& libraryClips)
 {
-    // 1. Retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    try
-    {
-        // Open files
-        std::ifstream vertexShaderFile(vShaderFilename);
-        std::ifstream fragmentShaderFile(fShaderFilename);
-        std::stringstream vShaderStream, fShaderStream;
-        // Read file's buffer contents into streams
-        vShaderStream << vertexShaderFile.rdbuf();
-        fShaderStream << fragmentShaderFile.rdbuf();
-        // close file handlers
-        vertexShaderFile.close();
-        fragmentShaderFile.close();
-        // Convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-        // If geometry shader path is present, also load a geometry shader
-        if (gShaderFilename != nullptr)
+    std::shared_ptr<std::promise<ModelHandle> > promise = std::make_shared<std::promise<ModelHandle> >();
+    std::shared_ptr<AnimatedModel> model = std::make_shared<AnimatedModel>();
+    // the file stays mapped until the upload has read the vertices from it
+    std::shared_ptr<CookedModel> cooked = std::make_shared<CookedModel>();
+    std::shared_ptr<bool> loaded = std::make_shared<bool>(false);
+    std::string path = modelFilename;
+    bool compress = compression != nullptr;
+    ClipCompressionSettings settings = compress ? *compression : ClipCompressionSettings();
+
+    GetLoader().Load([=]()
+    {
+        *loaded = prepareModel(path, compress ? &settings : nullptr, libraryClips, *model, *cooked);
+        return *loaded ? model->UploadSize() : 0;
+    },
+    [=]()
+    {
+        if (*loaded)
+            model->Upload();
+        cooked->Close();
+        promise->set_value(models.Add(name, model, frame, modelLoader(path, compress ? &settings : nullptr, libraryClips)));
+    },
+    [=]()
+    {
+        cooked->Close();
+        promise->set_value(ModelHandle());
+    });
+    return promise->get_future().share();
+}
+
+AssetLoader& ResourceManager::GetLoader()
+{
+    if (!loader)
+        loader.reset(new AssetLoader());
+    return *loader;
+}
+
+void ResourceManager::SetBudget(size_t cpuBytes, size_t gpuBytes)
+{
+    cpuBudget = cpuBytes;
+    gpuBudget = gpuBytes;
+}
+
+const ResourceUsage& ResourceManager::GetUsage(ResourceCategory category)
+{
+    if (category == RESOURCE_SHADER)
+        return shaders.Usage();
+    if (category == RESOURCE_TEXTURE)
+        return textures.Usage();
+    return models.Usage();
+}
+
+// A resource Trim may evict, its handle taken apart so the three pools share one list
+struct EvictionCandidate
+{
+    uint64_t LastUse;
+    ResourceCategory Category;
+    uint32_t Index;
+    uint32_t Generation;
+    ResourceSize Size;
+};
+
+template <typename T>
+static void gatherEvictionCandidates(const ResourcePool<T>& pool, ResourceCategory category, uint64_t frame,
+                                     std::vector<EvictionCandidate>& candidates)
+{
+    pool.ForEach([&](ResourceHandle<T> handle)
+    {
+        if (!pool.IsEvictable(handle) || pool.LastUse(handle) >= frame)
+            return;
+        EvictionCandidate candidate;
+        candidate.LastUse = pool.LastUse(handle);
+        candidate.Category = category;
+        candidate.Index = handle.Index;
+        candidate.Generation = handle.Generation;
+        candidate.Size = pool.GetSize(handle);
+        candidates.push_back(candidate);
+    });
+}
+
+// Everything the budgets cover, the model textures go with the last model using them
+static void usedBytes(size_t& cpuBytes, size_t& gpuBytes)
+{
+    cpuBytes = 0;
+    gpuBytes = ResourceManager::GetTextureCache().GpuMemorySize();
+    for (unsigned int c = 0; c < RESOURCE_CATEGORY_COUNT; c++)
+    {
+        cpuBytes += ResourceManager::GetUsage((ResourceCategory)c).CpuBytes;
+        gpuBytes += ResourceManager::GetUsage((ResourceCategory)c).GpuBytes;
+    }
+}
+
+void ResourceManager::Trim()
+{
+    size_t cpuBytes, gpuBytes;
+    usedBytes(cpuBytes, gpuBytes);
+
+    if (cpuBytes > cpuBudget || gpuBytes > gpuBudget)
+    {
+        std::vector<EvictionCandidate> candidates;
+        gatherEvictionCandidates(shaders, RESOURCE_SHADER, frame, candidates);
+        gatherEvictionCandidates(textures, RESOURCE_TEXTURE, frame, candidates);
+        gatherEvictionCandidates(models, RESOURCE_MODEL, frame, candidates);
+        std::sort(candidates.begin(), candidates.end(), [](const EvictionCandidate& a, const EvictionCandidate& b) { return a.LastUse < b.LastUse; });
+
+        for (unsigned int i = 0; i < candidates.size() && (cpuBytes > cpuBudget || gpuBytes > gpuBudget); i++)
         {
-            std::ifstream geometryShaderFile(gShaderFilename);
-            std::stringstream gShaderStream;
-            gShaderStream << geometryShaderFile.rdbuf();
-            geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
+            const EvictionCandidate& candidate = candidates[i];
+            // only what frees memory of a budget that is exceeded goes
+            if (!(cpuBytes > cpuBudget && candidate.Size.Cpu > 0) && !(gpuBytes > gpuBudget && candidate.Size.Gpu > 0))
+                continue;
+
+            if (candidate.Category == RESOURCE_SHADER)
+                shaders.Evict(ShaderHandle(candidate.Index, candidate.Generation));
+            else if (candidate.Category == RESOURCE_TEXTURE)
+                textures.Evict(TextureHandle(candidate.Index, candidate.Generation));
+            else
+                models.Evict(ModelHandle(candidate.Index, candidate.Generation));
+            usedBytes(cpuBytes, gpuBytes);
         }
     }
-    catch (std::exception e)
+    frame++;
+}
+
+void ResourceManager::Clear()
+{
+    // Loads still in flight are cancelled before what they would be stored with, their
+    // futures get the null handle
+    loader.reset();
+    for (unsigned int i = 0; i < pendingShaders.size(); i++)
     {
-        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+        pendingShaders[i].Program.FinishCompile();
+        unloadShader(pendingShaders[i].Program);
+        pendingShaders[i].Promise->set_value(ShaderHandle());
     }
-    const GLchar *vShaderCode = vertexCode.c_str();
-    const GLchar *fShaderCode = fragmentCode.c_str();
-    const GLchar *gShaderCode = geometryCode.c_str();
-    // 2. Now create shader object from source code
+    pendingShaders.clear();
+    // the binaries of the programs compiled since the last batch, reloads after eviction
+    programCache.Save();
+    // (Properly) delete all resources, the pools unload them with their GL objects
+    shaders.Clear();
+    textures.Clear();
+    models.Clear();
+}
+
+void ResourceManager::unloadShader(Shader& shader)
+{
+    if (shader.ID != 0)
+        GlState::DeleteProgram(shader.ID);
+}
+
+// A linked program is small and the driver does not tell its size, shaders are only counted
+ResourceSize ResourceManager::measureShader(const Shader&)
+{
+    return ResourceSize();
+}
+
+void ResourceManager::unloadTexture(Texture2D& texture)
+{
+    texture.Release();
+}
+
+ResourceSize ResourceManager::measureTexture(const Texture2D& texture)
+{
+    // the pixels are freed once uploaded
+    return ResourceSize(0, texture.MemorySize());
+}
+
+void ResourceManager::unloadModel(AnimatedModelPtr& model)
+{
+    // models are shared read-only, the manager made this one and is the one to free it
+    if (model)
+        const_cast<AnimatedModel&>(*model).Release();
+}
+
+ResourceSize ResourceManager::measureModel(const AnimatedModelPtr& model)
+{
+    if (!model)
+        return ResourceSize();
+    return ResourceSize(model->MemorySize(), model->GpuMemorySize());
+}
+
+bool ResourceManager::isModelShared(const AnimatedModelPtr& model)
+{
+    return model.use_count() > 1;
+}
+
+ResourcePool<Shader>::Loader ResourceManager::shaderLoader(const std::string& vShaderFilename, const std::string& fShaderFilename, const std::string& gShaderFilename)
+{
+    return [=]()
+    {
+        ShaderSources sources;
+        readShaderSources(vShaderFilename, fShaderFilename, gShaderFilename, sources);
+        return compileShader(sources);
+    };
+}
+
+ResourcePool<Texture2D>::Loader ResourceManager::textureLoader(const std::string& textureFilename, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax)
+{
+    return [=]()
+    {
+        return loadTextureFromFilename(textureFilename.c_str(), alpha, wrap, filterMin, filterMax);
+    };
+}
+
+ResourcePool<AnimatedModelPtr>::Loader ResourceManager::modelLoader(const std::string& path, const ClipCompressionSettings* compression,
+                                                                    const std::vector<std::string>& libraryClips)
+{
+    bool compress = compression != nullptr;
+    ClipCompressionSettings settings = compress ? *compression : ClipCompressionSettings();
+    return [=]()
+    {
+        return loadModelFromFilename(path, compress ? &settings : nullptr, libraryClips);
+    };
+}
+
+Shader ResourceManager::loadShaderFromFilename(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename)
+{
+    ShaderSources sources;
+    readShaderSources(vShaderFilename, fShaderFilename, gShaderFilename != nullptr ? gShaderFilename : "", sources);
+    return compileShader(sources);
+}
+
+Texture2D ResourceManager::loadTextureFromFilename(const GLchar *textureFilename, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax)
+{
+    // Load image, its cooked copy when there is one
+    TextureSource source;
+    ReadTextureSource(textureFilename, source);
+    // Now generate texture
+    Texture2D texture = textureFromSource(source, alpha, wrap, filterMin, filterMax);
+    ReleaseTextureSource(source);
+    return texture;
+}
+
+AnimatedModelPtr ResourceManager::loadModelFromFilename(const std::string &path, const ClipCompressionSettings* compression,
+                                                        const std::vector<std::string>& libraryClips)
+{
+    std::shared_ptr<AnimatedModel> model = std::make_shared<AnimatedModel>();
+    CookedModel cooked;
+    if (prepareModel(path, compression, libraryClips, *model, cooked))
+        model->Upload();
+    return model;
+}
+
+void ResourceManager::readShaderSources(const std::string& vShaderFilename, const std::string& fShaderFilename, const std::string& gShaderFilename,
+                                        ShaderSources& sources)
+{
+    // Retrieve the vertex/fragment source code from filePath, an empty geometry
+    // shader path stands for none
+    sources.HasGeometry = !gShaderFilename.empty();
+    bool read = Vfs::ReadString(vShaderFilename, sources.Vertex) && Vfs::ReadString(fShaderFilename, sources.Fragment);
+    // If geometry shader path is present, also load a geometry shader
+    if (sources.HasGeometry)
+        read = Vfs::ReadString(gShaderFilename, sources.Geometry) && read;
+    if (!read)
+        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+}
+
+Shader ResourceManager::compileShader(const ShaderSources& sources)
+{
+    // Now create shader object from source code, or from the binary linked from it before
     Shader shader;
-    shader.Compile(vShaderCode, fShaderCode, gShaderFilename != nullptr ? gShaderCode : nullptr);
+    uint64_t key;
+    if (!beginShader(sources, shader, key))
+        finishShader(shader, key);
+    if (pendingShaders.empty())
+        endShaderBatch();
     return shader;
 }
 
-Texture2D ResourceManager::loadTextureFromFilename(const GLchar *textureFilename, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax)
+bool ResourceManager::beginShader(const ShaderSources& sources, Shader& shader, uint64_t& key)
+{
+    if (pendingShaders.empty())
+        shaderBatchStart = std::chrono::high_resolution_clock::now();
+    if (!programCache.IsOpen())
+        programCache.Open(PROGRAM_CACHE_FILE);
+
+    key = programCache.Key(sources.Vertex, sources.Fragment, sources.HasGeometry ? sources.Geometry : "");
+    if (programCache.IsSupported())
+    {
+        // a binary the driver turns down leaves the program as it was, it is compiled into
+        shader.ID = glCreateProgram();
+        if (programCache.Load(key, shader.ID))
+        {
+            shader.Reflect();
+            return true;
+        }
+    }
+    shader.BeginCompile(sources.Vertex.c_str(), sources.Fragment.c_str(), sources.HasGeometry ? sources.Geometry.c_str() : nullptr,
+                        programCache.IsSupported());
+    return false;
+}
+
+void ResourceManager::endShaderBatch()
+{
+    shaderCompileTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - shaderBatchStart).count();
+}
+
+void ResourceManager::finishShader(Shader& shader, uint64_t key)
+{
+    if (shader.FinishCompile())
+        programCache.Store(key, shader.ID);
+}
+
+Texture2D ResourceManager::textureFromSource(const TextureSource& source, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax)
 {
     // Create Texture object
     Texture2D texture;
@@ -108,30 +457,40 @@ Texture2D ResourceManager::loadTextureFromFilename(const GLchar *textureFilename
     texture.WrapT = wrap;
     texture.FilterMin = filterMin;
     texture.FilterMax = filterMax;
-    // Load image
-    int width, height, channels;
-    unsigned char *image = stbi_load(textureFilename, &width, &height, &channels, 0);
-    // Now generate texture
-    texture.Generate(width, height, image);
-    stbi_image_free(image);
+    texture.Generate(source);
     return texture;
 }
 
-AnimatedModel ResourceManager::loadModelFromFilename(const std::string &path)
+bool ResourceManager::prepareModel(const std::string &path, const ClipCompressionSettings* compression,
+                                   const std::vector<std::string>& libraryClips, AnimatedModel& model, CookedModel& cooked)
 {
-    AnimatedModel model;
-    // read file via ASSIMP
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_LimitBoneWeights | aiProcess_JoinIdenticalVertices | aiProcess_OptimizeMeshes | aiProcess_ForceGenNormals);
-    // check for errors
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    // textures are looked up next to the model file, shared with every other model
+    model.SetDirectory(path.substr(0, path.find_last_of('/')));
+    model.SetTextureCache(&textureCache);
+
+    bool loaded = false;
+    std::string cookedPath = CookedModelPath(path);
+    if (cooked.Open(cookedPath))
+        loaded = model.PrepareFromCooked(cooked);
+#ifdef DOUBLEGRIT_USE_ASSIMP
+    else if (cookedPath != path)
     {
-        std::cout << "ERROR::ASSIMP: " << importer.GetErrorString() << std::endl;
+        ModelData data;
+        loaded = ImportModel(path, data);
+        if (loaded)
+            model.PrepareFromData(data);
     }
-    else {
-        // retrieve the directory path of the filepath
-        model.SetDirectory(path.substr(0, path.find_last_of('/')));
-        model.InitFromScene(importer.GetOrphanedScene());
+#endif
+    else
+        std::cout << "ERROR::RESOURCE_MANAGER: No cooked model at " << cookedPath << std::endl;
+
+    if (loaded)
+    {
+        if (compression != nullptr)
+            model.CompressClips(*compression);
+        // unknown names still take their index, so the ones after them keep theirs
+        for (unsigned int i = 0; i < libraryClips.size(); i++)
+            model.AddLibraryClip(&clipLibrary, libraryClips[i]);
     }
-    return model;
-}
\ No newline at end of file
+    return loaded;
+}
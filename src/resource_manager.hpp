@@ -1,43 +1,187 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
-#include <map>
+#include <chrono>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <future>
+#include <memory>
 
 #include <glad/glad.h>
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
 #include "texture.hpp"
 #include "shader.hpp"
 #include "animated_model.hpp"
+#include "asset_loader.hpp"
+#include "resource_pool.hpp"
+#include "clip_library.hpp"
+#include "texture_cache.hpp"
+#include "program_cache.hpp"
+
+typedef ResourceHandle<Shader> ShaderHandle;
+typedef ResourceHandle<Texture2D> TextureHandle;
+typedef ResourceHandle<AnimatedModelPtr> ModelHandle;
 
+// Memory the resources may keep before unreferenced ones are evicted, SetBudget
+// changes them at runtime
+const size_t RESOURCE_CPU_BUDGET = 256 * 1024 * 1024;
+const size_t RESOURCE_GPU_BUDGET = 512 * 1024 * 1024;
+
+enum ResourceCategory
+{
+    RESOURCE_SHADER,
+    RESOURCE_TEXTURE,
+    RESOURCE_MODEL,
+    RESOURCE_CATEGORY_COUNT
+};
+
+// Resources are stored under a name and reached by a typed handle. Names are resolved
+// once, when a resource is loaded or looked up with Find (HashName("gritty") is folded
+// by the compiler); Get is then an index into a slot array and returns a reference.
+//
+// Whatever keeps a copy of a resource (a Texture2D, the ID of a shader) or of its
+// model pointer beyond the frame acquires its handle. Once a frame Trim evicts what
+// nothing references, least recently used first, until the memory fits the budgets.
+// The handle of an evicted resource stays good: Get reads the file again and uploads
+// it, so a reference or a fresh Get is all a caller needs
 class ResourceManager
 {
     public:
-        static Shader LoadShader(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename, std::string name);
-        static Shader GetShader(std::string name);
-        static Texture2D LoadTexture(const GLchar *textureFilename, GLboolean alpha, std::string name, GLuint wrap, GLuint filterMin, GLuint filterMax);
-        static Texture2D GetTexture(std::string name);
-        static AnimatedModel LoadModel(const GLchar *modelFilename, std::string name);
-        static AnimatedModel GetModel(std::string name);
+        static ShaderHandle LoadShader(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename, std::string name);
+        static ShaderHandle FindShader(uint32_t nameHash) { return shaders.Find(nameHash); }
+        static Shader& GetShader(ShaderHandle shader) { return shaders.Get(shader, frame); }
+        static TextureHandle LoadTexture(const GLchar *textureFilename, GLboolean alpha, std::string name, GLuint wrap, GLuint filterMin, GLuint filterMax);
+        static TextureHandle FindTexture(uint32_t nameHash) { return textures.Find(nameHash); }
+        static Texture2D& GetTexture(TextureHandle texture) { return textures.Get(texture, frame); }
+        // A cooked copy next to the file (see CookedModelPath) is mapped instead when there
+        // is one, the file itself is only imported by builds with assimp. Clips are
+        // compressed within the given tolerances, or kept as baked without them.
+        // The library clips named are appended to the clips of the file, in that order
+        static ModelHandle LoadModel(const GLchar *modelFilename, std::string name, const ClipCompressionSettings* compression = nullptr,
+                                     const std::vector<std::string>& libraryClips = std::vector<std::string>());
+        static ModelHandle FindModel(uint32_t nameHash) { return models.Find(nameHash); }
+        static const AnimatedModelPtr& GetModel(ModelHandle model) { return models.Get(model, frame); }
+        // References keep a resource from eviction, a stale handle is ignored
+        static void Acquire(ShaderHandle shader) { shaders.Acquire(shader); }
+        static void Acquire(TextureHandle texture) { textures.Acquire(texture); }
+        static void Acquire(ModelHandle model) { models.Acquire(model); }
+        static void Release(ShaderHandle shader) { shaders.Release(shader); }
+        static void Release(TextureHandle texture) { textures.Release(texture); }
+        static void Release(ModelHandle model) { models.Release(model); }
+        // Names a clip of an animation-only file for LoadModel, read the first time it is played
+        static void RegisterClip(const GLchar *animationFilename, std::string name, std::string animation = "",
+                                 const ClipCompressionSettings* compression = nullptr);
+        static ClipLibrary& GetClipLibrary() { return clipLibrary; }
+        // The material textures of every model loaded here, one GPU copy per image
+        static TextureCache& GetTextureCache() { return textureCache; }
+
+        // The same loads through the asset loader: the files are read, decoded and parsed
+        // on its workers and the GL objects created by GetLoader().PumpUploads on the GL
+        // thread. The resource is stored under its name once the future is ready, so Find
+        // finds it from then on. A load Clear cancels makes the future the null handle
+        static std::shared_future<ShaderHandle> LoadShaderAsync(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename, std::string name);
+        static std::shared_future<TextureHandle> LoadTextureAsync(const GLchar *textureFilename, GLboolean alpha, std::string name, GLuint wrap, GLuint filterMin, GLuint filterMax);
+        static std::shared_future<ModelHandle> LoadModelAsync(const GLchar *modelFilename, std::string name, const ClipCompressionSettings* compression = nullptr,
+                                                              const std::vector<std::string>& libraryClips = std::vector<std::string>());
+        // Started on first use, stopped by Clear
+        static AssetLoader& GetLoader();
+        // The uploads of LoadShaderAsync only issue the compiles, so the driver builds
+        // every program of a frame at once. Once a frame on the GL thread after
+        // PumpUploads, finishes the programs the driver is done with and stores their
+        // shaders. Returns how many are still compiling. The program cache file is written
+        // once the batch is done, programs compiled one by one outside of it by Clear
+        static unsigned int PumpShaderCompiles();
+        static unsigned int PendingShaderCount() { return (unsigned int)pendingShaders.size(); }
+        // The binaries of the programs linked before, one file for every shader
+        static const ProgramCache& GetProgramCache() { return programCache; }
+        // Milliseconds from issuing shaders to their programs being linked, since start
+        static double GetShaderCompileTime() { return shaderCompileTime; }
+
+        static void SetBudget(size_t cpuBytes, size_t gpuBytes);
+        static size_t GetCpuBudget() { return cpuBudget; }
+        static size_t GetGpuBudget() { return gpuBudget; }
+        static const ResourceUsage& GetUsage(ResourceCategory category);
+        // Once a frame on the GL thread, after the frame was drawn. Nothing used during
+        // the frame is evicted
+        static void Trim();
+
+        // Deletes every resource, referenced or not, with its GL objects
         static void Clear();
 
     private:
         ResourceManager() {}
 
-        static std::map<std::string, Shader> shaders;
-        static std::map<std::string, Texture2D> textures;
-        static std::map<std::string, AnimatedModel> models;
+        static ResourcePool<Shader> shaders;
+        static ResourcePool<Texture2D> textures;
+        static ResourcePool<AnimatedModelPtr> models;
+        static ClipLibrary clipLibrary;
+        static TextureCache textureCache;
+        static ProgramCache programCache;
+        static std::unique_ptr<AssetLoader> loader;
+        static size_t cpuBudget, gpuBudget;
+        // counts the frames Trim ended, what Get stamps the LRU order with
+        static uint64_t frame;
+
+        struct ShaderSources
+        {
+            std::string Vertex;
+            std::string Fragment;
+            std::string Geometry;
+            bool HasGeometry;
+        };
+
+        // a shader of LoadShaderAsync the driver is still compiling, stored once it is done
+        struct PendingShader
+        {
+            std::string Name;
+            Shader Program;
+            uint64_t Key;
+            ResourcePool<Shader>::Loader Load;
+            std::shared_ptr<std::promise<ShaderHandle> > Promise;
+        };
+
+        static std::vector<PendingShader> pendingShaders;
+        // when the first shader compiling now was issued
+        static std::chrono::high_resolution_clock::time_point shaderBatchStart;
+        static double shaderCompileTime;
+
+        // what the pools call to size and free their resources
+        static void unloadShader(Shader& shader);
+        static ResourceSize measureShader(const Shader& shader);
+        static void unloadTexture(Texture2D& texture);
+        static ResourceSize measureTexture(const Texture2D& texture);
+        static void unloadModel(AnimatedModelPtr& model);
+        static ResourceSize measureModel(const AnimatedModelPtr& model);
+        static bool isModelShared(const AnimatedModelPtr& model);
+        // how an evicted resource is loaded again, synchronously on the GL thread
+        static ResourcePool<Shader>::Loader shaderLoader(const std::string& vShaderFilename, const std::string& fShaderFilename, const std::string& gShaderFilename);
+        static ResourcePool<Texture2D>::Loader textureLoader(const std::string& textureFilename, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax);
+        static ResourcePool<AnimatedModelPtr>::Loader modelLoader(const std::string& path, const ClipCompressionSettings* compression,
+                                                                  const std::vector<std::string>& libraryClips);
 
         static Shader loadShaderFromFilename(const GLchar *vShaderFilename, const GLchar *fShaderFilename, const GLchar *gShaderFilename = nullptr);
         static Texture2D loadTextureFromFilename(const GLchar *textureFilename, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax);
-        static AnimatedModel loadModelFromFilename(const std::string &path);
+        static AnimatedModelPtr loadModelFromFilename(const std::string &path, const ClipCompressionSettings* compression,
+                                                      const std::vector<std::string>& libraryClips);
+        // the halves of the loads above that touch no GL state, safe on any thread
+        static void readShaderSources(const std::string& vShaderFilename, const std::string& fShaderFilename, const std::string& gShaderFilename,
+                                      ShaderSources& sources);
+        // compiles at once, leaving the binary for the next save of the program cache
+        static Shader compileShader(const ShaderSources& sources);
+        // GL thread. Loads the program from its cached binary and returns true, or issues
+        // its compile; finishShader then checks it and caches its binary
+        static bool beginShader(const ShaderSources& sources, Shader& shader, uint64_t& key);
+        static void finishShader(Shader& shader, uint64_t key);
+        // adds the time since shaderBatchStart once nothing is compiling
+        static void endShaderBatch();
+        static Texture2D textureFromSource(const TextureSource& source, GLboolean alpha, GLuint wrap, GLuint filterMin, GLuint filterMax);
+        // everything but Upload, cooked keeps the file the model uploads from mapped.
+        // False when there was nothing to load, the model stays empty
+        static bool prepareModel(const std::string &path, const ClipCompressionSettings* compression,
+                                 const std::vector<std::string>& libraryClips, AnimatedModel& model, CookedModel& cooked);
 };
 
 #endif
\ No newline at end of file
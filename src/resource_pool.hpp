@@ -0,0 +1,284 @@
+#ifndef RESOURCE_POOL_H
+#define RESOURCE_POOL_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hash_name.hpp"
+
+// A slot of a ResourcePool and the generation of the resource in it. A handle to a
+// resource that was removed resolves to nothing, whatever took its slot since. The
+// type only tells the pools apart, a ShaderHandle cannot index the textures
+template <typename T>
+struct ResourceHandle
+{
+    uint32_t Index;
+    // 0 for the null handle, slots start at generation 1
+    uint32_t Generation;
+
+    ResourceHandle() : Index(0), Generation(0) {}
+    ResourceHandle(uint32_t index, uint32_t generation) : Index(index), Generation(generation) {}
+
+    bool IsNull() const { return Generation == 0; }
+    bool operator==(const ResourceHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+    bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+};
+
+// Bytes a resource keeps in main memory and on the GPU
+struct ResourceSize
+{
+    size_t Cpu;
+    size_t Gpu;
+
+    ResourceSize() : Cpu(0), Gpu(0) {}
+    ResourceSize(size_t cpu, size_t gpu) : Cpu(cpu), Gpu(gpu) {}
+};
+
+// What a pool holds at the moment, evicted resources only count in Count
+struct ResourceUsage
+{
+    unsigned int Count;
+    unsigned int Resident;
+    unsigned int Referenced;
+    size_t CpuBytes;
+    size_t GpuBytes;
+    // since the pool was made
+    unsigned int Evictions;
+    unsigned int Reloads;
+
+    ResourceUsage() : Count(0), Resident(0), Referenced(0), CpuBytes(0), GpuBytes(0), Evictions(0), Reloads(0) {}
+};
+
+// Resources in a dense array of slots, reached by handle with an index and a
+// generation check. Names are hashed when a resource is added or looked up, never on
+// access. A resource added with a loader can be evicted while nothing references it,
+// its handles stay good and the next Get loads it again. Not thread safe, the resource
+// manager only touches its pools on the GL thread.
+template <typename T>
+class ResourcePool
+{
+    public:
+        typedef ResourceHandle<T> Handle;
+        // Makes the resource again after it was evicted
+        typedef std::function<T()> Loader;
+        // Frees what a resource holds, GL objects included
+        typedef void (*Unloader)(T& value);
+        typedef ResourceSize (*Measurer)(const T& value);
+        // True while the value is held outside the pool, which keeps it from eviction
+        // like a reference does
+        typedef bool (*SharedTest)(const T& value);
+
+        ResourcePool(Unloader unload, Measurer measure, SharedTest shared = nullptr)
+            : unload(unload), measure(measure), shared(shared)
+        {
+        }
+
+        // Stores value under name. A name already in the pool keeps its slot, handle and
+        // references, the value it had is unloaded and replaced. While that value is
+        // referenced or shared it stays instead, value is unloaded and the handle to the
+        // old one returned. Without a loader the resource is never evicted
+        Handle Add(const std::string& name, const T& value, uint64_t now, Loader load = Loader())
+        {
+            uint32_t nameHash = HashName(name);
+            std::unordered_map<uint32_t, uint32_t>::const_iterator found = names.find(nameHash);
+            uint32_t index;
+            if (found != names.end())
+            {
+                index = found->second;
+                Slot& slot = slots[index];
+                if (slot.References > 0 || (slot.Resident && shared != nullptr && shared(slot.Value)))
+                {
+                    std::cout << "ERROR::RESOURCE_POOL: " << slot.Name << " is in use, " << name << " does not replace it" << std::endl;
+                    T rejected = value;
+                    unload(rejected);
+                    return Handle(index, slot.Generation);
+                }
+                if (slot.Name != name)
+                    std::cout << "ERROR::RESOURCE_POOL: " << name << " hashes like " << slot.Name << ", it replaces it" << std::endl;
+                unloadSlot(slot);
+            }
+            else
+            {
+                if (!freeSlots.empty())
+                {
+                    index = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+                else
+                {
+                    index = (uint32_t)slots.size();
+                    slots.push_back(Slot());
+                }
+                slots[index].Used = true;
+                names[nameHash] = index;
+                usage.Count++;
+            }
+
+            Slot& slot = slots[index];
+            slot.Name = name;
+            slot.Load = load;
+            slot.LastUse = now;
+            residentSlot(slot, value);
+            return Handle(index, slot.Generation);
+        }
+
+        // The null handle when nothing is stored under the name
+        Handle Find(uint32_t nameHash) const
+        {
+            std::unordered_map<uint32_t, uint32_t>::const_iterator found = names.find(nameHash);
+            if (found == names.end())
+                return Handle();
+            return Handle(found->second, slots[found->second].Generation);
+        }
+
+        bool IsValid(Handle handle) const
+        {
+            return handle.Index < slots.size() && slots[handle.Index].Used && slots[handle.Index].Generation == handle.Generation;
+        }
+
+        // The per-frame access, an index and a stamp for the LRU order once the handle is
+        // known good. An evicted resource is loaded again right here
+        T& Get(Handle handle, uint64_t now)
+        {
+            assert(IsValid(handle));
+            Slot& slot = slots[handle.Index];
+            slot.LastUse = now;
+            if (!slot.Resident)
+            {
+                residentSlot(slot, slot.Load());
+                usage.Reloads++;
+            }
+            return slot.Value;
+        }
+        const std::string& GetName(Handle handle) const { return slots[handle.Index].Name; }
+
+        // A referenced resource is never evicted. Both do nothing for a stale handle, so
+        // a reference can outlive the pool being cleared
+        void Acquire(Handle handle)
+        {
+            if (IsValid(handle) && slots[handle.Index].References++ == 0)
+                usage.Referenced++;
+        }
+        void Release(Handle handle)
+        {
+            if (IsValid(handle) && slots[handle.Index].References > 0 && --slots[handle.Index].References == 0)
+                usage.Referenced--;
+        }
+
+        bool IsResident(Handle handle) const { return slots[handle.Index].Resident; }
+        bool IsEvictable(Handle handle) const
+        {
+            const Slot& slot = slots[handle.Index];
+            return slot.Resident && slot.References == 0 && slot.Load && (shared == nullptr || !shared(slot.Value));
+        }
+        uint64_t LastUse(Handle handle) const { return slots[handle.Index].LastUse; }
+        ResourceSize GetSize(Handle handle) const { return slots[handle.Index].Size; }
+
+        // Unloads the resource and keeps its slot, false when it is not evictable
+        bool Evict(Handle handle)
+        {
+            if (!IsValid(handle) || !IsEvictable(handle))
+                return false;
+            unloadSlot(slots[handle.Index]);
+            usage.Evictions++;
+            return true;
+        }
+
+        // Unloads the resource, referenced or not, and every handle to it goes stale. Its
+        // slot is taken by the next Add
+        void Remove(Handle handle)
+        {
+            if (!IsValid(handle))
+                return;
+            Slot& slot = slots[handle.Index];
+            unloadSlot(slot);
+            if (slot.References > 0)
+                usage.Referenced--;
+            usage.Count--;
+            names.erase(HashName(slot.Name));
+            slot.Name.clear();
+            slot.Load = Loader();
+            slot.References = 0;
+            slot.Used = false;
+            // 0 is the null handle
+            if (++slot.Generation == 0)
+                slot.Generation = 1;
+            freeSlots.push_back(handle.Index);
+        }
+
+        void Clear()
+        {
+            for (uint32_t i = 0; i < slots.size(); i++)
+                Remove(Handle(i, slots[i].Generation));
+        }
+
+        // Calls function(handle) for every resource in the pool, evicted ones included
+        template <typename Function>
+        void ForEach(Function function) const
+        {
+            for (uint32_t i = 0; i < slots.size(); i++)
+            {
+                if (slots[i].Used)
+                    function(Handle(i, slots[i].Generation));
+            }
+        }
+
+        unsigned int Size() const { return usage.Count; }
+        const ResourceUsage& Usage() const { return usage; }
+
+    private:
+        struct Slot
+        {
+            T Value;
+            std::string Name;
+            Loader Load;
+            ResourceSize Size;
+            uint64_t LastUse;
+            uint32_t Generation;
+            unsigned int References;
+            bool Used;
+            bool Resident;
+
+            Slot() : Value(), LastUse(0), Generation(1), References(0), Used(false), Resident(false) {}
+        };
+
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+        // name hash to slot
+        std::unordered_map<uint32_t, uint32_t> names;
+        Unloader unload;
+        Measurer measure;
+        SharedTest shared;
+        ResourceUsage usage;
+
+        void residentSlot(Slot& slot, const T& value)
+        {
+            slot.Value = value;
+            slot.Size = measure(slot.Value);
+            slot.Resident = true;
+            usage.Resident++;
+            usage.CpuBytes += slot.Size.Cpu;
+            usage.GpuBytes += slot.Size.Gpu;
+        }
+
+        void unloadSlot(Slot& slot)
+        {
+            if (!slot.Resident)
+                return;
+            unload(slot.Value);
+            slot.Value = T();
+            slot.Resident = false;
+            usage.Resident--;
+            usage.CpuBytes -= slot.Size.Cpu;
+            usage.GpuBytes -= slot.Size.Gpu;
+            slot.Size = ResourceSize();
+        }
+};
+
+#endif
@@ -1,120 +1,308 @@
 #include "shader.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+#include "gl_state.hpp"
+
+unsigned int Shader::uniformUploads = 0;
+unsigned int Shader::uniformUploadsSkipped = 0;
+
 Shader &Shader::Use()
 {
-    glUseProgram(ID);
+    GlState::UseProgram(ID);
     return *this;
 }
 
+// KHR_parallel_shader_compile and its ARB twin, for loaders without them
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 void Shader::Compile(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource)
+{
+    BeginCompile(vertexSource, fragmentSource, geometrySource);
+    FinishCompile();
+}
+
+void Shader::BeginCompile(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource, GLboolean retrievable)
 {
     GLuint sVertex, sFragment, gShader;
     // Vertex Shader
     sVertex = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(sVertex, 1, &vertexSource, NULL);
     glCompileShader(sVertex);
-    checkCompileErrors(sVertex, "VERTEX");
     // Fragment Shader
     sFragment = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(sFragment, 1, &fragmentSource, NULL);
     glCompileShader(sFragment);
-    checkCompileErrors(sFragment, "FRAGMENT");
+    // Shader Program, the name is kept when the caller made it already
+    if (ID == 0)
+        ID = glCreateProgram();
+    if (retrievable)
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(ID, sVertex);
+    glAttachShader(ID, sFragment);
     // If geometry shader source code is given, also compile geometry shader
     if (geometrySource != nullptr)
     {
         gShader = glCreateShader(GL_GEOMETRY_SHADER);
         glShaderSource(gShader, 1, &geometrySource, NULL);
         glCompileShader(gShader);
-        checkCompileErrors(gShader, "GEOMETRY");
-    }
-    // Shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, sVertex);
-    glAttachShader(ID, sFragment);
-    if (geometrySource != nullptr)
         glAttachShader(ID, gShader);
+    }
+    // the link waits for the compiles in the driver, not here
     glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    // Delete the shaders as they're linked into our program now and no longer necessery
-    glDeleteShader(sVertex);
-    glDeleteShader(sFragment);
-    if (geometrySource != nullptr)
-        glDeleteShader(gShader);
 }
 
-void Shader::SetFloat(const std::string &name, GLfloat value, GLboolean useShader)
+bool Shader::IsCompileDone() const
 {
-    if (useShader)
-        Use();
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    if (!HasParallelCompile())
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
 }
 
-void Shader::SetInteger(const std::string &name, GLint value, GLboolean useShader)
+bool Shader::FinishCompile()
 {
-    if (useShader)
-        Use();
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    // the stages are only looked at when the link failed, their logs say why
+    bool linked = checkCompileErrors(ID, "PROGRAM");
+    GLuint stages[3];
+    GLsizei stageCount = 0;
+    glGetAttachedShaders(ID, 3, &stageCount, stages);
+    for (GLsizei i = 0; i < stageCount; i++)
+    {
+        if (!linked)
+        {
+            GLint type;
+            glGetShaderiv(stages[i], GL_SHADER_TYPE, &type);
+            checkCompileErrors(stages[i], type == GL_VERTEX_SHADER ? "VERTEX" : type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "GEOMETRY");
+        }
+        // Delete the shaders as they're linked into our program now and no longer necessery
+        glDetachShader(ID, stages[i]);
+        glDeleteShader(stages[i]);
+    }
+    if (linked)
+        Reflect();
+    return linked;
 }
 
-void Shader::SetVector2f(const std::string &name, GLfloat x, GLfloat y, GLboolean useShader)
+// bytes of one value of a uniform type, samplers are set as ints
+static unsigned int uniformTypeSize(GLenum type)
 {
-    if (useShader)
-        Use();
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    switch (type)
+    {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2:
+            return 8;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+            return 12;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+            return 16;
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2:
+            return 24;
+        case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2:
+            return 32;
+        case GL_FLOAT_MAT3:
+            return 36;
+        case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3:
+            return 48;
+        case GL_FLOAT_MAT4:
+            return 64;
+        default:
+            return 4;
+    }
 }
 
-void Shader::SetVector2f(const std::string &name, const glm::vec2 &value, GLboolean useShader)
+void Shader::Reflect()
+{
+    uniforms = std::make_shared<UniformTable>();
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = GL_FLOAT;
+        glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+        // the members of uniform blocks have no location, their buffer holds them
+        GLint location = glGetUniformLocation(ID, name.data());
+        if (location >= 0)
+            addUniform(std::string(name.data(), length), location, type, size);
+    }
+}
+
+void Shader::addUniform(const std::string& name, GLint location, GLenum type, GLint count)
+{
+    unsigned int size = uniformTypeSize(type);
+    unsigned int offset = (unsigned int)uniforms->Values.size();
+    uniforms->Values.resize(offset + size * count);
+
+    // an array answers to its name with and without [0], and every element to its
+    // own; they share the values, so setting one is seen by the others
+    std::vector<std::pair<std::string, Uniform> > names;
+    std::string base = name;
+    if (base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+        base.resize(base.size() - 3);
+    Uniform uniform = { location, offset, size * count, false };
+    names.push_back(std::make_pair(base, uniform));
+    if (base != name || count > 1)
+    {
+        names.push_back(std::make_pair(base + "[0]", uniform));
+        for (GLint i = 1; i < count; i++)
+        {
+            std::string element = base + "[" + std::to_string(i) + "]";
+            Uniform elementUniform = { glGetUniformLocation(ID, element.c_str()), offset + size * i, size * (count - i), false };
+            names.push_back(std::make_pair(element, elementUniform));
+        }
+    }
+
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        if (!uniforms->Uniforms.insert(std::make_pair(HashName(names[i].first), names[i].second)).second)
+            std::cout << "ERROR::SHADER: Uniform " << names[i].first << " hashes like another one, it cannot be set" << std::endl;
+    }
+}
+
+GLint Shader::changedLocation(UniformName name, const void* value, size_t size)
+{
+    if (!uniforms)
+        return -1;
+    std::unordered_map<uint32_t, Uniform>::iterator found = uniforms->Uniforms.find(name.Hash);
+    if (found == uniforms->Uniforms.end())
+        return -1;
+
+    Uniform& uniform = found->second;
+    if (size > uniform.Size)
+    {
+        // more than the uniform holds, GL reports it; nothing is kept
+        uniform.Set = false;
+        uniformUploads++;
+        return uniform.Location;
+    }
+    unsigned char* held = &uniforms->Values[uniform.Offset];
+    if (uniform.Set && std::memcmp(held, value, size) == 0)
+    {
+        uniformUploadsSkipped++;
+        return -1;
+    }
+    std::memcpy(held, value, size);
+    uniform.Set = true;
+    uniformUploads++;
+    return uniform.Location;
+}
+
+bool Shader::HasParallelCompile()
+{
+    // asked once, the answer does not change for the context
+    static int parallel = -1;
+    if (parallel < 0)
+    {
+        parallel = 0;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension != nullptr && (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 ||
+                                         std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0))
+                parallel = 1;
+        }
+    }
+    return parallel == 1;
+}
+
+void Shader::SetFloat(UniformName name, GLfloat value, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), value.x, value.y);
+    GLint location = changedLocation(name, &value, sizeof(value));
+    if (location >= 0)
+        glProgramUniform1f(ID, location, value);
 }
 
-void Shader::SetVector3f(const std::string &name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader)
+void Shader::SetInteger(UniformName name, GLint value, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    GLint location = changedLocation(name, &value, sizeof(value));
+    if (location >= 0)
+        glProgramUniform1i(ID, location, value);
 }
 
-void Shader::SetVector3f(const std::string &name, const glm::vec3 &value, GLboolean useShader)
+void Shader::SetVector2f(UniformName name, GLfloat x, GLfloat y, GLboolean useShader)
+{
+    SetVector2f(name, glm::vec2(x, y), useShader);
+}
+
+void Shader::SetVector2f(UniformName name, const glm::vec2 &value, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z);
+    GLint location = changedLocation(name, glm::value_ptr(value), sizeof(value));
+    if (location >= 0)
+        glProgramUniform2f(ID, location, value.x, value.y);
 }
 
-void Shader::SetVector4f(const std::string &name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader)
+void Shader::SetVector3f(UniformName name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader)
+{
+    SetVector3f(name, glm::vec3(x, y, z), useShader);
+}
+
+void Shader::SetVector3f(UniformName name, const glm::vec3 &value, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    GLint location = changedLocation(name, glm::value_ptr(value), sizeof(value));
+    if (location >= 0)
+        glProgramUniform3f(ID, location, value.x, value.y, value.z);
+}
+
+void Shader::SetVector4f(UniformName name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader)
+{
+    SetVector4f(name, glm::vec4(x, y, z, w), useShader);
 }
 
-void Shader::SetVector4f(const std::string &name, const glm::vec4 &value, GLboolean useShader)
+void Shader::SetVector4f(UniformName name, const glm::vec4 &value, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z, value.w);
+    GLint location = changedLocation(name, glm::value_ptr(value), sizeof(value));
+    if (location >= 0)
+        glProgramUniform4f(ID, location, value.x, value.y, value.z, value.w);
 }
 
-void Shader::SetMatrix4(const std::string &name, const glm::mat4 &matrix, GLboolean useShader)
+void Shader::SetMatrix4(UniformName name, const glm::mat4 &matrix, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix));
+    GLint location = changedLocation(name, glm::value_ptr(matrix), sizeof(matrix));
+    if (location >= 0)
+        glProgramUniformMatrix4fv(ID, location, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
-void Shader::SetMatrix4v(const std::string &name, const std::vector<glm::mat4> &matrices, GLboolean useShader)
+void Shader::SetMatrix4v(UniformName name, const std::vector<glm::mat4> &matrices, GLboolean useShader)
 {
     if (useShader)
         Use();
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), (GLsizei)matrices.size(), GL_FALSE, glm::value_ptr(matrices[0]));
+    if (matrices.empty())
+        return;
+    GLint location = changedLocation(name, glm::value_ptr(matrices[0]), matrices.size() * sizeof(glm::mat4));
+    if (location >= 0)
+        glProgramUniformMatrix4fv(ID, location, (GLsizei)matrices.size(), GL_FALSE, glm::value_ptr(matrices[0]));
+}
+
+void Shader::SetUniformBlockBinding(const std::string &name, GLuint binding)
+{
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, index, binding);
 }
 
-void Shader::checkCompileErrors(GLuint object, std::string type)
+bool Shader::checkCompileErrors(GLuint object, std::string type)
 {
     GLint success;
     GLchar infoLog[1024];
@@ -140,4 +328,5 @@ void Shader::checkCompileErrors(GLuint object, std::string type)
                       << std::endl;
         }
     }
+    return success == GL_TRUE;
 }
\ No newline at end of file
@@ -1,36 +1,103 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "hash_name.hpp"
+
+// The name of a uniform, kept as its hash. A string literal is hashed by the compiler,
+// names built at run time are better hashed once and kept
+struct UniformName
+{
+    uint32_t Hash;
+
+    template <size_t Size>
+    constexpr UniformName(const char (&name)[Size]) : Hash(UnrolledHashName<Size - 1>::Hash(name)) {}
+    UniformName(const std::string& name) : Hash(HashName(name)) {}
+};
+
+// A linked program. Its active uniforms are looked up once when it is linked (or loaded
+// from a binary) and the setters find them by the hash of their names. The values set
+// are kept, setting the value a uniform already holds issues no glProgramUniform call.
+// The setters write this program whether it is in use or not, copies of a Shader share
+// the uniforms.
 class Shader
 {
     public:
         GLuint ID;
 
-        Shader() {}
+        Shader() : ID(0) {}
 
         Shader &Use();
 
         void Compile(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource = nullptr);
-        void SetFloat(const std::string &name, GLfloat value, GLboolean useShader = false);
-        void SetInteger(const std::string &name, GLint value, GLboolean useShader = false);
-        void SetVector2f(const std::string &name, GLfloat x, GLfloat y, GLboolean useShader = false);
-        void SetVector2f(const std::string &name, const glm::vec2 &value, GLboolean useShader = false);
-        void SetVector3f(const std::string &name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader = false);
-        void SetVector3f(const std::string &name, const glm::vec3 &value, GLboolean useShader = false);
-        void SetVector4f(const std::string &name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader = false);
-        void SetVector4f(const std::string &name, const glm::vec4 &value, GLboolean useShader = false);
-        void SetMatrix4(const std::string &name, const glm::mat4 &matrix, GLboolean useShader = false);
-        void SetMatrix4v(const std::string &name, const std::vector<glm::mat4> &matrices, GLboolean useShader = false);
+        // Compile in two halves, so the driver can build several programs at once.
+        // BeginCompile issues the compiles and the link without asking for any result,
+        // a retrievable program can be read back with glGetProgramBinary
+        void BeginCompile(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource = nullptr,
+                          GLboolean retrievable = GL_FALSE);
+        // True once the driver is done with the program. Only asks without waiting with
+        // KHR_parallel_shader_compile, always true otherwise
+        bool IsCompileDone() const;
+        // Reports the errors of the stages and the link and frees the stages, false
+        // when the program did not link. Reflects the uniforms of a linked one
+        bool FinishCompile();
+        // Looks up the active uniforms of the program and forgets the values set, after
+        // it was linked or loaded with glProgramBinary
+        void Reflect();
+        // Whether the driver compiles programs on threads of its own, GL thread
+        static bool HasParallelCompile();
+        void SetFloat(UniformName name, GLfloat value, GLboolean useShader = false);
+        void SetInteger(UniformName name, GLint value, GLboolean useShader = false);
+        void SetVector2f(UniformName name, GLfloat x, GLfloat y, GLboolean useShader = false);
+        void SetVector2f(UniformName name, const glm::vec2 &value, GLboolean useShader = false);
+        void SetVector3f(UniformName name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader = false);
+        void SetVector3f(UniformName name, const glm::vec3 &value, GLboolean useShader = false);
+        void SetVector4f(UniformName name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader = false);
+        void SetVector4f(UniformName name, const glm::vec4 &value, GLboolean useShader = false);
+        void SetMatrix4(UniformName name, const glm::mat4 &matrix, GLboolean useShader = false);
+        void SetMatrix4v(UniformName name, const std::vector<glm::mat4> &matrices, GLboolean useShader = false);
+        // #version 330 has no layout(binding), so uniform blocks are bound from here
+        void SetUniformBlockBinding(const std::string &name, GLuint binding);
+
+        // glProgramUniform calls the setters issued and left out since ResetUniformCounters,
+        // for every shader together
+        static unsigned int UniformUploads() { return uniformUploads; }
+        static unsigned int UniformUploadsSkipped() { return uniformUploadsSkipped; }
+        static void ResetUniformCounters() { uniformUploads = uniformUploadsSkipped = 0; }
 
     private:
-        void checkCompileErrors(GLuint object, std::string type);
+        struct Uniform
+        {
+            GLint Location;
+            // bytes of Values holding the last value, nothing was set while Set is false
+            unsigned int Offset, Size;
+            bool Set;
+        };
+
+        struct UniformTable
+        {
+            std::unordered_map<uint32_t, Uniform> Uniforms;
+            std::vector<unsigned char> Values;
+        };
+
+        std::shared_ptr<UniformTable> uniforms;
+
+        static unsigned int uniformUploads, uniformUploadsSkipped;
+
+        // The location to upload value to, or -1 when the uniform is not active or holds
+        // value already. Keeps value as the one the uniform holds
+        GLint changedLocation(UniformName name, const void* value, size_t size);
+        void addUniform(const std::string& name, GLint location, GLenum type, GLint count);
+        bool checkCompileErrors(GLuint object, std::string type);
 };
 
 #endif
\ No newline at end of file
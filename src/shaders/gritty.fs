@@ -5,12 +5,28 @@ in vec2 TexCoords;
 out vec4 FragColor;
 
 uniform sampler2D image;
+// entity textures packed into layers, see TextureAtlas
+uniform sampler2DArray atlas;
+uniform bool atlased;
+uniform vec4 atlasRect;
+uniform float atlasLayer;
+uniform bool atlasRepeat;
 uniform bool freeCam;
 uniform bool retro;
 
 void main()
 {
-    vec4 tex = texture(image, TexCoords);
+    vec4 tex;
+    if (atlased)
+    {
+        // the gradients of the unwrapped coordinates, so fract does not pick the
+        // smallest mip level along the seam
+        vec2 uv = atlasRepeat ? fract(TexCoords) : clamp(TexCoords, 0.0, 1.0);
+        tex = textureGrad(atlas, vec3(atlasRect.xy + uv * atlasRect.zw, atlasLayer),
+                          dFdx(TexCoords) * atlasRect.zw, dFdy(TexCoords) * atlasRect.zw);
+    }
+    else
+        tex = texture(image, TexCoords);
     FragColor = tex * vec4(VertexLight, 1.0);
 
     if (!freeCam)
@@ -12,10 +12,14 @@ struct Light {
 };
 
 const int MAX_LIGHTS = 32;
-const int MAX_BONES = 100;
+const int MAX_BONES = 256;
 
 uniform bool entity;
 uniform bool animated;
+// palettes fetched from the baked texture instead of gBones
+uniform bool baked;
+// model matrix and palette fetched from the crowd buffer by gl_InstanceID
+uniform bool instanced;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -27,12 +31,31 @@ uniform float linearAtt;
 uniform float constantAtt;
 uniform float quadraticAtt;
 uniform Light lights[MAX_LIGHTS];
-uniform mat4 gBones[MAX_BONES];
+
+// Bone palette range of the instance being drawn. A mat3x4 holds the top three rows
+// of a bone matrix as its columns, so vec4(p, 1.0) * bone is the transformed point
+layout (std140) uniform BonePalette
+{
+    mat3x4 gBones[MAX_BONES];
+};
+
+uniform sampler2D bakedPalettes;
+uniform int bakedFirstRow;
+uniform int bakedFrameCount;
+uniform float bakedDuration;
+uniform float bakedSampleRate;
+uniform float bakedTime;
+
+// Per instance: three texels for the model matrix rows, then three per bone
+uniform samplerBuffer crowdPalettes;
+uniform int crowdStride;
 
 out vec3 VertexLight;
 out vec2 TexCoords;
 
 vec3 CalcPointLight(vec3 lightPos, vec3 vertexPos, vec3 lightColor);
+mat3x4 BakedBone(int bone, int row0, int row1, float factor);
+mat3x4 CrowdRows(int texel);
 
 void main()
 {
@@ -41,13 +64,43 @@ void main()
     {
         if (animated)
         {
-            mat4 BoneTransform  = gBones[aBoneIDs[0]] * aWeights[0];
-                 BoneTransform += gBones[aBoneIDs[1]] * aWeights[1];
-                 BoneTransform += gBones[aBoneIDs[2]] * aWeights[2];
-                 BoneTransform += gBones[aBoneIDs[3]] * aWeights[3];
-
-            vec4 tPos = BoneTransform * vec4(aPos, 1.0);
-            worldPos = model * tPos;
+            int crowdBase = gl_InstanceID * crowdStride;
+            mat3x4 BoneTransform;
+            if (baked)
+            {
+                // same frame selection as AnimationClip::FrameAt
+                float position = bakedDuration > 0.0 ? mod(bakedTime, bakedDuration) * bakedSampleRate : 0.0;
+                int frame0 = min(int(position), max(bakedFrameCount - 2, 0));
+                int frame1 = min(frame0 + 1, bakedFrameCount - 1);
+                float factor = clamp(position - float(frame0), 0.0, 1.0);
+                int row0 = bakedFirstRow + frame0;
+                int row1 = bakedFirstRow + frame1;
+
+                BoneTransform  = BakedBone(aBoneIDs[0], row0, row1, factor) * aWeights[0];
+                BoneTransform += BakedBone(aBoneIDs[1], row0, row1, factor) * aWeights[1];
+                BoneTransform += BakedBone(aBoneIDs[2], row0, row1, factor) * aWeights[2];
+                BoneTransform += BakedBone(aBoneIDs[3], row0, row1, factor) * aWeights[3];
+            }
+            else if (instanced)
+            {
+                BoneTransform  = CrowdRows(crowdBase + 3 + aBoneIDs[0] * 3) * aWeights[0];
+                BoneTransform += CrowdRows(crowdBase + 3 + aBoneIDs[1] * 3) * aWeights[1];
+                BoneTransform += CrowdRows(crowdBase + 3 + aBoneIDs[2] * 3) * aWeights[2];
+                BoneTransform += CrowdRows(crowdBase + 3 + aBoneIDs[3] * 3) * aWeights[3];
+            }
+            else
+            {
+                BoneTransform  = gBones[aBoneIDs[0]] * aWeights[0];
+                BoneTransform += gBones[aBoneIDs[1]] * aWeights[1];
+                BoneTransform += gBones[aBoneIDs[2]] * aWeights[2];
+                BoneTransform += gBones[aBoneIDs[3]] * aWeights[3];
+            }
+
+            vec4 tPos = vec4(vec4(aPos, 1.0) * BoneTransform, 1.0);
+            if (instanced)
+                worldPos = vec4(tPos * CrowdRows(crowdBase), 1.0);
+            else
+                worldPos = model * tPos;
         }
         else
             worldPos = model * vec4(aPos, 1.0);
@@ -70,6 +123,21 @@ void main()
     TexCoords = aTexCoords;
 }
 
+// A bone takes three texels per row, the top three rows of its matrix
+mat3x4 BakedBone(int bone, int row0, int row1, float factor)
+{
+    vec4 r0 = mix(texelFetch(bakedPalettes, ivec2(bone * 3 + 0, row0), 0), texelFetch(bakedPalettes, ivec2(bone * 3 + 0, row1), 0), factor);
+    vec4 r1 = mix(texelFetch(bakedPalettes, ivec2(bone * 3 + 1, row0), 0), texelFetch(bakedPalettes, ivec2(bone * 3 + 1, row1), 0), factor);
+    vec4 r2 = mix(texelFetch(bakedPalettes, ivec2(bone * 3 + 2, row0), 0), texelFetch(bakedPalettes, ivec2(bone * 3 + 2, row1), 0), factor);
+    return mat3x4(r0, r1, r2);
+}
+
+// Three consecutive texels of the crowd buffer, the top three rows of a matrix
+mat3x4 CrowdRows(int texel)
+{
+    return mat3x4(texelFetch(crowdPalettes, texel), texelFetch(crowdPalettes, texel + 1), texelFetch(crowdPalettes, texel + 2));
+}
+
 vec3 CalcPointLight(vec3 lightPos, vec3 vertexPos, vec3 lightColor)
 {
     float attenuation = 0.0001;
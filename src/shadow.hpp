@@ -5,7 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "texture.hpp"
+#include "gl_state.hpp"
+#include "texture_atlas.hpp"
 #include "shader.hpp"
 
 class Shadow
@@ -13,11 +14,12 @@ class Shadow
     public:
         glm::vec3 Position;
 
-        Shadow(glm::vec3 position, glm::vec3 size, Texture2D texture) :
+        // Drawn from its entry in the bound atlas, nothing without one
+        Shadow(glm::vec3 position, glm::vec3 size, const AtlasEntry* atlasEntry) :
             Position(position),
             size(size),
             rotation(0.0f),
-            texture(texture)
+            atlasEntry(atlasEntry)
         {
             // Configure VAO/VBO
             GLuint VBO;
@@ -33,7 +35,7 @@ class Shadow
             glGenVertexArrays(1, &VAO);
             glGenBuffers(1, &VBO);
 
-            glBindVertexArray(VAO);
+            GlState::BindVertexArray(VAO);
 
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
             glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -49,12 +51,12 @@ class Shadow
             glEnableVertexAttribArray(2);
 
             glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
+            GlState::BindVertexArray(0);
         }
 
         ~Shadow()
         {
-            glDeleteVertexArrays(1, &VAO);
+            GlState::DeleteVertexArray(VAO);
         }
 
         void Update(GLfloat deltatime)
@@ -63,6 +65,9 @@ class Shadow
 
         void Draw(Shader shader)
         {
+            if (atlasEntry == nullptr)
+                return;
+
             // Prepare transformations
             glm::mat4 modelMat = glm::mat4(1.0f);
             modelMat = glm::translate(modelMat, Position);
@@ -77,20 +82,19 @@ class Shadow
             shader.SetInteger("entity", true);
             shader.SetMatrix4("model", modelMat);
 
-            glActiveTexture(GL_TEXTURE0);
-            texture.Bind();
+            TextureAtlas::SetUniforms(shader, atlasEntry);
 
-            glBindVertexArray(VAO);
+            GlState::BindVertexArray(VAO);
             glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
 
+            TextureAtlas::SetUniforms(shader, nullptr);
             shader.SetInteger("entity", false);
         }
 
     private:
         glm::vec3 size;
         GLfloat rotation;
-        Texture2D texture;
+        const AtlasEntry* atlasEntry;
         GLuint VAO;
 };
 
@@ -0,0 +1,196 @@
+#include "skeleton.hpp"
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+#include <assimp/scene.h>
+#endif
+
+void PoseScratch::Resize(unsigned int channelStride, unsigned int nodeCount)
+{
+    Channels.resize(CLIP_COMPONENTS * channelStride);
+    Locals.resize(12 * channelStride);
+    Globals.resize(nodeCount);
+}
+
+Skeleton::Skeleton() : GlobalInverseTransform(1.0f)
+{
+    globalInverseAffine = AffineFromMat4(GlobalInverseTransform);
+}
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+void Skeleton::Build(const aiNode* root, const std::map<std::string, unsigned int>& boneMapping)
+{
+    NodeNames.clear();
+    Parents.clear();
+    BindTransforms.clear();
+    BoneIndices.clear();
+
+    addNode(root, -1, boneMapping);
+    Prepare();
+}
+#endif
+
+void Skeleton::Prepare()
+{
+    bindAffines.resize(NodeCount());
+    for (unsigned int i = 0; i < NodeCount(); i++)
+        bindAffines[i] = AffineFromMat4(BindTransforms[i]);
+
+    offsetAffines.resize(BoneCount());
+    for (unsigned int b = 0; b < BoneCount(); b++)
+        offsetAffines[b] = AffineFromMat4(BoneOffsets[b]);
+
+    globalInverseAffine = AffineFromMat4(GlobalInverseTransform);
+}
+
+ChannelMap Skeleton::BindClip(const AnimationClip& clip) const
+{
+    ChannelMap channels(NodeCount());
+    for (unsigned int i = 0; i < NodeCount(); i++)
+        channels[i] = clip.FindChannel(NodeNames[i]);
+    return channels;
+}
+
+unsigned int Skeleton::Reduce(const std::vector<float>& boneWeights, float minWeightShare, Skeleton& reduced) const
+{
+    // children come after their parents, so one backwards pass sums every subtree
+    std::vector<float> subtreeWeights(NodeCount(), 0.0f);
+    for (int i = (int)NodeCount() - 1; i >= 0; i--)
+    {
+        if (BoneIndices[i] >= 0)
+            subtreeWeights[i] += boneWeights[BoneIndices[i]];
+        if (Parents[i] >= 0)
+            subtreeWeights[Parents[i]] += subtreeWeights[i];
+    }
+
+    float totalWeight = 0.0f;
+    for (unsigned int i = 0; i < NodeCount(); i++)
+    {
+        if (Parents[i] < 0)
+            totalWeight += subtreeWeights[i];
+    }
+
+    reduced.NodeNames.clear();
+    reduced.Parents.clear();
+    reduced.BindTransforms.clear();
+    reduced.BoneIndices.clear();
+    reduced.BoneOffsets = BoneOffsets;
+    reduced.GlobalInverseTransform = GlobalInverseTransform;
+
+    // a subtree never outweighs its parent, so the kept nodes always include their ancestors
+    std::vector<int> reducedIndices(NodeCount(), -1);
+    for (unsigned int i = 0; i < NodeCount(); i++)
+    {
+        if (Parents[i] >= 0 && subtreeWeights[i] < minWeightShare * totalWeight)
+            continue;
+
+        reducedIndices[i] = (int)reduced.NodeCount();
+        reduced.NodeNames.push_back(NodeNames[i]);
+        reduced.Parents.push_back(Parents[i] >= 0 ? reducedIndices[Parents[i]] : -1);
+        reduced.BindTransforms.push_back(BindTransforms[i]);
+        reduced.BoneIndices.push_back(BoneIndices[i]);
+    }
+    unsigned int animatedCount = reduced.NodeCount();
+
+    for (unsigned int i = 0; i < NodeCount(); i++)
+    {
+        if (reducedIndices[i] >= 0 || BoneIndices[i] < 0)
+            continue;
+
+        // bind chain from the nearest kept ancestor down to the bone
+        glm::mat4 chain = BindTransforms[i];
+        int ancestor = Parents[i];
+        for (; reducedIndices[ancestor] < 0; ancestor = Parents[ancestor])
+            chain = BindTransforms[ancestor] * chain;
+
+        reduced.NodeNames.push_back(NodeNames[i]);
+        reduced.Parents.push_back(reducedIndices[ancestor]);
+        reduced.BindTransforms.push_back(chain);
+        reduced.BoneIndices.push_back(BoneIndices[i]);
+    }
+
+    reduced.Prepare();
+    return animatedCount;
+}
+
+// The channels are blended and composed in SoA batches with the pose kernels, then the
+// hierarchy is walked once. That walk stays one AoS multiply per node, since every
+// node depends on its parent and there is nothing to run side by side.
+void Skeleton::Evaluate(const AnimationClip& clip, const ChannelMap& channels, const ClipFrame& frame,
+                        PoseScratch& scratch, Affine* palette) const
+{
+    unsigned int stride = clip.ChannelStride;
+    scratch.Resize(stride, NodeCount());
+
+    float* blended = scratch.Channels.data();
+    const float* frame0;
+    const float* frame1;
+    if (clip.IsCompressed())
+    {
+        // rebuild the two frames, everything after is the same as for baked samples
+        scratch.Frames.resize(2 * CLIP_COMPONENTS * stride);
+        clip.Compressed.DecompressFrame(frame.Frame0, stride, &scratch.Frames[0]);
+        clip.Compressed.DecompressFrame(frame.Frame1, stride, &scratch.Frames[CLIP_COMPONENTS * stride]);
+        frame0 = &scratch.Frames[0];
+        frame1 = &scratch.Frames[CLIP_COMPONENTS * stride];
+    }
+    else
+    {
+        frame0 = clip.Plane(frame.Frame0, 0);
+        frame1 = clip.Plane(frame.Frame1, 0);
+    }
+    LerpFloats(3 * stride, frame0 + CLIP_TX * stride, frame1 + CLIP_TX * stride, frame.Factor, blended + CLIP_TX * stride);
+    SlerpQuats(stride, stride, frame0 + CLIP_RX * stride, frame1 + CLIP_RX * stride, frame.Factor, blended + CLIP_RX * stride);
+    LerpFloats(3 * stride, frame0 + CLIP_SX * stride, frame1 + CLIP_SX * stride, frame.Factor, blended + CLIP_SX * stride);
+    ComposeAffines(stride, stride, blended + CLIP_TX * stride, blended + CLIP_RX * stride, blended + CLIP_SX * stride, scratch.Locals.data());
+
+    Affine* globals = scratch.Globals.data();
+    for (unsigned int i = 0; i < NodeCount(); i++)
+    {
+        Affine animated;
+        const Affine* local = &bindAffines[i];
+        if (channels[i] >= 0)
+        {
+            GatherAffine(channels[i], stride, scratch.Locals.data(), animated);
+            local = &animated;
+        }
+
+        // parents always come first, so their global transformation is already final;
+        // the global inverse is folded into the root and reaches every node through it
+        MultiplyAffine(Parents[i] < 0 ? globalInverseAffine : globals[Parents[i]], *local, globals[i]);
+
+        int bone = BoneIndices[i];
+        if (bone >= 0)
+            MultiplyAffine(globals[i], offsetAffines[bone], palette[bone]);
+    }
+}
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+// Depth-first, pre-order: a node is appended before any of its children and removed
+// again once it turns out that neither it nor any descendant drives a bone
+bool Skeleton::addNode(const aiNode* node, int parent, const std::map<std::string, unsigned int>& boneMapping)
+{
+    int index = (int)Parents.size();
+    std::string name(node->mName.C_Str());
+    std::map<std::string, unsigned int>::const_iterator bone = boneMapping.find(name);
+
+    NodeNames.push_back(name);
+    Parents.push_back(parent);
+    BindTransforms.push_back(glm::transpose(glm::make_mat4(&node->mTransformation.a1)));
+    BoneIndices.push_back(bone != boneMapping.end() ? (int)bone->second : -1);
+
+    bool keep = BoneIndices[index] >= 0;
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+        keep = addNode(node->mChildren[i], index, boneMapping) || keep;
+
+    if (!keep)
+    {
+        // pruned children have already removed themselves, so this node is the last one
+        NodeNames.pop_back();
+        Parents.pop_back();
+        BindTransforms.pop_back();
+        BoneIndices.pop_back();
+    }
+
+    return keep;
+}
+#endif
@@ -0,0 +1,78 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "animation_clip.hpp"
+#include "pose_kernels.hpp"
+
+struct aiNode;
+
+// Channel index of every skeleton node in a given clip, -1 when the clip does not animate the node
+typedef std::vector<int> ChannelMap;
+
+// Working memory of one pose evaluation, owned by whoever evaluates so that
+// concurrent evaluations of the same skeleton never share it
+struct PoseScratch
+{
+    std::vector<float> Frames;     // two frames decompressed from a compressed clip
+    std::vector<float> Channels;   // CLIP_COMPONENTS planes of blended channel samples
+    std::vector<float> Locals;     // 12 planes of local affines, one lane per channel
+    std::vector<Affine> Globals;   // global transformation of every node
+
+    void Resize(unsigned int channelStride, unsigned int nodeCount);
+};
+
+// The node hierarchy of a skinned scene flattened once at load. Nodes are stored in
+// topological order (a parent always precedes its children) and nodes that affect
+// no bone are pruned, so a pose is one linear pass over plain arrays with no
+// recursion, string compares or map lookups.
+class Skeleton
+{
+    public:
+        std::vector<std::string> NodeNames;
+        std::vector<int> Parents;                // index of the parent node, -1 for the root
+        std::vector<glm::mat4> BindTransforms;   // node transformation from the scene, used when a clip has no channel for it
+        std::vector<int> BoneIndices;            // bone driven by the node, -1 for intermediate nodes
+        std::vector<glm::mat4> BoneOffsets;      // mesh space to bone space, indexed by bone
+        glm::mat4 GlobalInverseTransform;
+
+        Skeleton();
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+        void Build(const aiNode* root, const std::map<std::string, unsigned int>& boneMapping);
+#endif
+        // Derives the affine copies of the transformations above, call after changing them
+        void Prepare();
+        ChannelMap BindClip(const AnimationClip& clip) const;
+        // Copy for far animation LOD tiers without the subtrees that carry less than
+        // minWeightShare of the skin weight (boneWeights is the total weight per bone).
+        // Every dropped bone hangs off its nearest kept ancestor with its bind pose, so
+        // the palette keeps all bones. Returns how many nodes are still animated, those
+        // come first in the reduced skeleton
+        unsigned int Reduce(const std::vector<float>& boneWeights, float minWeightShare, Skeleton& reduced) const;
+
+        // palette must hold BoneCount() matrices
+        void Evaluate(const AnimationClip& clip, const ChannelMap& channels, const ClipFrame& frame,
+                      PoseScratch& scratch, Affine* palette) const;
+
+        unsigned int NodeCount() const { return (unsigned int)Parents.size(); }
+        unsigned int BoneCount() const { return (unsigned int)BoneOffsets.size(); }
+
+    private:
+        std::vector<Affine> bindAffines;
+        std::vector<Affine> offsetAffines;
+        Affine globalInverseAffine;
+
+#ifdef DOUBLEGRIT_USE_ASSIMP
+        bool addNode(const aiNode* node, int parent, const std::map<std::string, unsigned int>& boneMapping);
+#endif
+};
+
+#endif
@@ -3,7 +3,9 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include "gl_state.hpp"
 #include "text_renderer.hpp"
+#include "vfs.hpp"
 
 TextRenderer::TextRenderer(Shader shader) : shader(shader)
 {
@@ -12,26 +14,39 @@ TextRenderer::TextRenderer(Shader shader) : shader(shader)
 
 TextRenderer::~TextRenderer()
 {
-    glDeleteVertexArrays(1, &quadVAO);
+    GlState::DeleteVertexArray(quadVAO);
     glDeleteBuffers(1, &VBO);
 }
 
 void TextRenderer::LoadFont(std::string font, GLuint fontSize)
 {
-    // First clear the previously loaded Characters
-    characters.clear();
-    // Then initialize and load the FreeType library
+    std::vector<GlyphBitmap> glyphs;
+    RasterizeFont(font, fontSize, glyphs);
+    LoadGlyphs(glyphs);
+}
+
+bool TextRenderer::RasterizeFont(std::string font, GLuint fontSize, std::vector<GlyphBitmap>& glyphs)
+{
+    glyphs.clear();
+    // Initialize and load the FreeType library, one per call so that fonts can be
+    // rasterized on several threads at once
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) // All functions return a value different than 0 whenever an error occurred
+    {
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-    // Load font as face
+        return false;
+    }
+    // Load font as face, FreeType reads the file's bytes until the face is done
+    FileView file;
     FT_Face face;
-    if (FT_New_Face(ft, font.c_str(), 0, &face))
+    if (!Vfs::Open(font, file) || FT_New_Memory_Face(ft, file.Data(), (FT_Long)file.Size(), 0, &face))
+    {
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+        FT_Done_FreeType(ft);
+        return false;
+    }
     // Set size to load glyphs as
     FT_Set_Pixel_Sizes(face, 0, fontSize);
-    // Disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     // Then for the first 128 ASCII characters, pre-load/compile their characters and store them
     for (GLubyte c = 0; c < 128; c++) // lol see what I did there
     {
@@ -41,20 +56,51 @@ void TextRenderer::LoadFont(std::string font, GLuint fontSize)
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
             continue;
         }
+
+        // Copy the bitmap out, FreeType reuses it for the next glyph
+        GlyphBitmap glyph;
+        glyph.Char = c;
+        glyph.Size = glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows);
+        glyph.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+        glyph.Advance = GLuint(face->glyph->advance.x);
+        for (int row = 0; row < glyph.Size.y; row++)
+        {
+            const unsigned char* pixels = face->glyph->bitmap.buffer + row * face->glyph->bitmap.pitch;
+            glyph.Pixels.insert(glyph.Pixels.end(), pixels, pixels + glyph.Size.x);
+        }
+        glyphs.push_back(glyph);
+    }
+    // Destroy FreeType once we're finished
+    FT_Done_Face(face);
+    FT_Done_FreeType(ft);
+    return true;
+}
+
+void TextRenderer::LoadGlyphs(const std::vector<GlyphBitmap>& glyphs)
+{
+    // First clear the previously loaded Characters
+    for (std::map<GLchar, Character>::iterator iter = characters.begin(); iter != characters.end(); iter++)
+        GlState::DeleteTexture(iter->second.TextureID);
+    characters.clear();
+    // Disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int i = 0; i < glyphs.size(); i++)
+    {
+        const GlyphBitmap& glyph = glyphs[i];
         // Generate texture
         GLuint texture;
         glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        GlState::BindTexture(0, GL_TEXTURE_2D, texture);
         glTexImage2D(
             GL_TEXTURE_2D,
             0,
             GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
+            glyph.Size.x,
+            glyph.Size.y,
             0,
             GL_RED,
             GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer);
+            glyph.Pixels.empty() ? nullptr : glyph.Pixels.data());
         // Set texture options
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -64,15 +110,12 @@ void TextRenderer::LoadFont(std::string font, GLuint fontSize)
         // Now store character for later use
         Character character = {
             texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            GLuint(face->glyph->advance.x)};
-        characters.insert(std::pair<GLchar, Character>(c, character));
+            glyph.Size,
+            glyph.Bearing,
+            glyph.Advance};
+        characters.insert(std::pair<GLchar, Character>(glyph.Char, character));
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    // Destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+    GlState::BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
@@ -80,8 +123,7 @@ void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat sc
     // Activate corresponding render state
     shader.Use();
     shader.SetVector3f("textColor", color);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(quadVAO);
+    GlState::BindVertexArray(quadVAO);
 
     // Iterate through all characters
     std::string::const_iterator c;
@@ -104,7 +146,7 @@ void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat sc
             {xpos + w, ypos + h, 1.0, 1.0},
             {xpos + w, ypos, 1.0, 0.0}};
         // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+        GlState::BindTexture(0, GL_TEXTURE_2D, ch.TextureID);
         // Update content of VBO memory
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
@@ -115,8 +157,6 @@ void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat sc
         // Now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void TextRenderer::initRenderData()
@@ -128,9 +168,9 @@ void TextRenderer::initRenderData()
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
 
-    glBindVertexArray(quadVAO);
+    GlState::BindVertexArray(quadVAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState::BindVertexArray(0);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define TEXT_RENDERER_H
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -16,6 +18,16 @@ struct Character
     GLuint Advance;     // Horizontal offset to advance to next glyph
 };
 
+// A glyph rendered by FreeType and not uploaded yet
+struct GlyphBitmap
+{
+    GLchar Char;
+    glm::ivec2 Size;
+    glm::ivec2 Bearing;
+    GLuint Advance;
+    std::vector<unsigned char> Pixels; // Size.x * Size.y, one byte each
+};
+
 class TextRenderer
 {
     public:
@@ -23,6 +35,10 @@ class TextRenderer
         ~TextRenderer();
 
         void LoadFont(std::string font, GLuint fontSize);
+        // The halves of LoadFont: the first 128 characters rendered on any thread, then
+        // their textures created on the GL thread
+        static bool RasterizeFont(std::string font, GLuint fontSize, std::vector<GlyphBitmap>& glyphs);
+        void LoadGlyphs(const std::vector<GlyphBitmap>& glyphs);
         void RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(1.0f));
 
     private:
@@ -2,21 +2,62 @@
 
 #include <iostream>
 
+#include <stb_image.h>
+
+#include "gl_state.hpp"
+#include "vfs.hpp"
+
+bool DecodeTextureImage(const std::string& path, TextureImage& image, int channels)
+{
+    int fileChannels = 0;
+    FileView file;
+    image.Pixels = nullptr;
+    if (Vfs::Open(path, file))
+        image.Pixels = stbi_load_from_memory(file.Data(), (int)file.Size(), &image.Width, &image.Height, &fileChannels, channels);
+    image.Channels = channels != 0 ? channels : fileChannels;
+    if (image.Pixels == nullptr)
+    {
+        image.Width = image.Height = image.Channels = 0;
+        return false;
+    }
+    return true;
+}
+
+void FreeTextureImage(TextureImage& image)
+{
+    stbi_image_free(image.Pixels);
+    image.Pixels = nullptr;
+}
+
+bool ReadTextureSource(const std::string& path, TextureSource& source)
+{
+    if (OpenCookedImage(path, source.Cooked))
+        return true;
+    return DecodeTextureImage(path, source.Image);
+}
+
+void ReleaseTextureSource(TextureSource& source)
+{
+    source.Cooked.Close();
+    FreeTextureImage(source.Image);
+}
+
 Texture2D::Texture2D()
-    : Width(0), Height(0),
+    : ID(0), Width(0), Height(0),
     InternalFormat(GL_RGB), ImageFormat(GL_RGB),
     WrapS(GL_REPEAT), WrapT(GL_REPEAT),
     FilterMin(GL_LINEAR), FilterMax(GL_LINEAR)
 {
-    glGenTextures(1, &ID);
 }
 
 void Texture2D::Generate(GLuint width, GLuint height, unsigned char *data)
 {
     Width = width;
     Height = height;
-    // Create Texture
-    glBindTexture(GL_TEXTURE_2D, ID);
+    // Create Texture, the name is only made here so that default constructed textures cost nothing
+    if (ID == 0)
+        glGenTextures(1, &ID);
+    GlState::BindTexture(0, GL_TEXTURE_2D, ID);
     glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, width, height, 0, ImageFormat, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
     // Set Texture wrap and filter modes
@@ -25,10 +66,75 @@ void Texture2D::Generate(GLuint width, GLuint height, unsigned char *data)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, FilterMin);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FilterMax);
     // Unbind texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GlState::BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 void Texture2D::Bind() const
 {
-    glBindTexture(GL_TEXTURE_2D, ID);
-}
\ No newline at end of file
+    GlState::BindTexture(0, GL_TEXTURE_2D, ID);
+}
+
+void Texture2D::Release()
+{
+    if (ID != 0)
+        GlState::DeleteTexture(ID);
+    ID = 0;
+}
+
+size_t Texture2D::MemorySize() const
+{
+    if (ID == 0)
+        return 0;
+
+    size_t texelSize = 4;
+    if (InternalFormat == GL_RED)
+        texelSize = 1;
+    else if (InternalFormat == GL_RG)
+        texelSize = 2;
+    else if (InternalFormat == GL_RGB)
+        texelSize = 3;
+
+    // both Generate fill every level down to 1x1
+    size_t size = 0;
+    GLuint width = Width, height = Height;
+    while (true)
+    {
+        size += (size_t)width * height * texelSize;
+        if (width <= 1 && height <= 1)
+            break;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+void Texture2D::Generate(const TextureSource& source)
+{
+    const CookedImage& cooked = source.Cooked;
+    if (!cooked.IsOpen())
+    {
+        Generate(source.Image.Width, source.Image.Height, source.Image.Pixels);
+        return;
+    }
+
+    Width = cooked.Width();
+    Height = cooked.Height();
+    if (ID == 0)
+        glGenTextures(1, &ID);
+    GlState::BindTexture(0, GL_TEXTURE_2D, ID);
+    // the levels are tightly packed, the rows of the small ones are not 4 byte aligned
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int level = 0; level < cooked.LevelCount(); level++)
+        glTexImage2D(GL_TEXTURE_2D, level, InternalFormat, cooked.Level(level).Width, cooked.Level(level).Height, 0, ImageFormat, GL_UNSIGNED_BYTE, cooked.LevelPixels(level));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, cooked.LevelCount() - 1);
+    // Set Texture wrap and filter modes
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, WrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, WrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, FilterMin);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FilterMax);
+    // Unbind texture
+    GlState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
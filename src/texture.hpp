@@ -1,8 +1,44 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <string>
+
 #include <glad/glad.h>
 
+#include "cooked_image.hpp"
+
+// Pixels of an image file decoded off the GL thread, waiting for their upload
+struct TextureImage
+{
+    int Width, Height;
+    int Channels;
+    unsigned char *Pixels;
+
+    TextureImage() : Width(0), Height(0), Channels(0), Pixels(nullptr) {}
+    size_t Size() const { return (size_t)Width * Height * Channels; }
+};
+
+// Thread safe. Decodes to the channels of the file unless channels is set, false when
+// the file cannot be read. The pixels are freed with FreeTextureImage
+bool DecodeTextureImage(const std::string& path, TextureImage& image, int channels = 0);
+void FreeTextureImage(TextureImage& image);
+
+// An image file ready for upload: its cooked copy mapped with the whole mip chain (see
+// OpenCookedImage), or the file decoded when no cooked copy can be written
+struct TextureSource
+{
+    CookedImage Cooked;
+    TextureImage Image;
+
+    int Channels() const { return Cooked.IsOpen() ? (int)Cooked.Channels() : Image.Channels; }
+    // bytes the upload sends
+    size_t Size() const { return Cooked.IsOpen() ? Cooked.PixelSize() : Image.Size(); }
+};
+
+// Thread safe, false when the file can be read neither way
+bool ReadTextureSource(const std::string& path, TextureSource& source);
+void ReleaseTextureSource(TextureSource& source);
+
 class Texture2D
 {
     public:
@@ -15,10 +51,19 @@ class Texture2D
         GLuint FilterMin;
         GLuint FilterMax;
 
+        // No GL texture until Generate, so textures can be default constructed anywhere
         Texture2D();
 
         void Generate(GLuint width, GLuint height, unsigned char *data);
+        // Uploads a cooked image level by level, anything else as Generate does
+        void Generate(const TextureSource& source);
+        // to unit 0, where the entity shaders sample their image
         void Bind() const;
+        // Deletes the GL texture, Generate makes a new one
+        void Release();
+        // Bytes the texture takes on the GPU with its whole mip chain, as far as the
+        // format tells
+        size_t MemorySize() const;
 };
 
 #endif
\ No newline at end of file
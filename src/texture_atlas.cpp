@@ -0,0 +1,279 @@
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+#include "cooked_image.hpp"
+#include "gl_state.hpp"
+#include "texture.hpp"
+
+// The smallest layer tried, doubled up to ATLAS_MAX_LAYER_SIZE
+static const unsigned int ATLAS_MIN_LAYER_SIZE = 64;
+
+// An image with its gutters, rounded up so the next one starts on a multiple of the gutter
+static unsigned int cellSize(unsigned int size)
+{
+    return (size + 2 * ATLAS_GUTTER + ATLAS_GUTTER - 1) / ATLAS_GUTTER * ATLAS_GUTTER;
+}
+
+// the texel of an image a gutter texel copies, coordinate may be outside [0, size)
+static unsigned int gutterSource(int coordinate, unsigned int size, bool repeat)
+{
+    if (repeat)
+        return (unsigned int)(((coordinate % (int)size) + (int)size) % (int)size);
+    return (unsigned int)std::min(std::max(coordinate, 0), (int)size - 1);
+}
+
+TextureAtlas::TextureAtlas() : layerSize(0), layerCount(0), id(0), gpuSize(0), uploaded(false)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    Release();
+}
+
+bool TextureAtlas::Add(const std::string& name, const std::string& path, GLboolean alpha, bool repeat)
+{
+    TextureSource source;
+    if (!ReadTextureSource(path, source))
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS: Failed to read " << path << std::endl;
+        return false;
+    }
+    bool added;
+    if (source.Cooked.IsOpen())
+        added = Add(name, source.Cooked.LevelPixels(0), source.Cooked.Width(), source.Cooked.Height(), source.Cooked.Channels(), alpha, repeat);
+    else
+        added = Add(name, source.Image.Pixels, source.Image.Width, source.Image.Height, source.Image.Channels, alpha, repeat);
+    ReleaseTextureSource(source);
+    return added;
+}
+
+bool TextureAtlas::Add(const std::string& name, const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+                       GLboolean alpha, bool repeat)
+{
+    if (uploaded)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS: Cannot add " << name << " after Upload" << std::endl;
+        return false;
+    }
+    if (width == 0 || height == 0 || channels < 1 || channels > 4 ||
+        cellSize(width) > ATLAS_MAX_LAYER_SIZE || cellSize(height) > ATLAS_MAX_LAYER_SIZE)
+        return false;
+
+    Image image;
+    image.Name = name;
+    image.Width = width;
+    image.Height = height;
+    image.Repeat = repeat;
+    image.Pixels.resize((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const unsigned char* texel = pixels + i * channels;
+        unsigned char* rgba = &image.Pixels[i * 4];
+        // grey, grey and alpha, RGB or RGBA as stb_image decodes them
+        rgba[0] = texel[0];
+        rgba[1] = channels >= 3 ? texel[1] : texel[0];
+        rgba[2] = channels >= 3 ? texel[2] : texel[0];
+        rgba[3] = alpha && (channels == 2 || channels == 4) ? texel[channels - 1] : 255;
+    }
+
+    std::unordered_map<std::string, unsigned int>::iterator found = names.find(name);
+    if (found != names.end())
+        images[found->second] = image;
+    else
+    {
+        names[name] = (unsigned int)images.size();
+        images.push_back(image);
+    }
+    return true;
+}
+
+void TextureAtlas::Pack()
+{
+    if (uploaded)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS: Cannot pack after Upload" << std::endl;
+        return;
+    }
+    entries.clear();
+    levels.clear();
+    layerCount = 0;
+    if (images.empty())
+        return;
+
+    // the layer size that takes the fewest texels in all, the fewer layers when two tie
+    size_t bestArea = 0;
+    for (unsigned int size = ATLAS_MIN_LAYER_SIZE; size <= ATLAS_MAX_LAYER_SIZE; size *= 2)
+    {
+        unsigned int count = place(size, entries);
+        if (count == UINT_MAX)
+            continue;
+        size_t area = (size_t)size * size * count;
+        if (bestArea == 0 || area <= bestArea)
+        {
+            bestArea = area;
+            layerSize = size;
+        }
+        if (count == 1)
+            break;
+    }
+    layerCount = place(layerSize, entries);
+
+    size_t layerBytes = (size_t)layerSize * layerSize * 4;
+    std::vector<unsigned char> base(layerBytes * layerCount, 0);
+    for (unsigned int i = 0; i < images.size(); i++)
+    {
+        const Image& image = images[i];
+        const AtlasEntry& entry = entries[i];
+        unsigned char* layer = &base[(size_t)entry.Layer * layerBytes];
+        // the gutters reach the end of the cell, past ATLAS_GUTTER where it was rounded up
+        int right = (int)(cellSize(image.Width) - ATLAS_GUTTER), bottom = (int)(cellSize(image.Height) - ATLAS_GUTTER);
+        for (int y = -(int)ATLAS_GUTTER; y < bottom; y++)
+        {
+            unsigned int sourceY = gutterSource(y, image.Height, image.Repeat);
+            for (int x = -(int)ATLAS_GUTTER; x < right; x++)
+            {
+                unsigned int sourceX = gutterSource(x, image.Width, image.Repeat);
+                const unsigned char* texel = &image.Pixels[((size_t)sourceY * image.Width + sourceX) * 4];
+                std::copy(texel, texel + 4, &layer[(((size_t)(entry.Y + y)) * layerSize + entry.X + x) * 4]);
+            }
+        }
+    }
+
+    // past log2(ATLAS_GUTTER) a texel would average two images
+    unsigned int levelCount = 1;
+    for (unsigned int gutter = ATLAS_GUTTER, size = layerSize; gutter > 1 && size > 1; gutter /= 2, size /= 2)
+        levelCount++;
+
+    levels.resize(levelCount);
+    std::vector<std::vector<unsigned char> > chain;
+    for (unsigned int layer = 0; layer < layerCount; layer++)
+    {
+        BuildMipChain(&base[layer * layerBytes], layerSize, layerSize, 4, chain);
+        for (unsigned int level = 0; level < levelCount; level++)
+            levels[level].insert(levels[level].end(), chain[level].begin(), chain[level].end());
+    }
+}
+
+unsigned int TextureAtlas::place(unsigned int size, std::vector<AtlasEntry>& placed) const
+{
+    // shelves, the tallest images first so each shelf wastes little above the rest
+    std::vector<unsigned int> order(images.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return images[a].Height > images[b].Height; });
+
+    placed.resize(images.size());
+    unsigned int layer = 0, x = 0, y = 0, shelfHeight = 0;
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        const Image& image = images[order[i]];
+        unsigned int width = cellSize(image.Width), height = cellSize(image.Height);
+        if (width > size || height > size)
+            return UINT_MAX;
+        if (x + width > size)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        if (y + height > size)
+        {
+            layer++;
+            x = y = shelfHeight = 0;
+        }
+
+        AtlasEntry& entry = placed[order[i]];
+        entry.X = x + ATLAS_GUTTER;
+        entry.Y = y + ATLAS_GUTTER;
+        entry.Width = image.Width;
+        entry.Height = image.Height;
+        entry.Layer = (GLfloat)layer;
+        entry.Repeat = image.Repeat;
+        entry.Rect = glm::vec4(entry.X, entry.Y, entry.Width, entry.Height) / (float)size;
+        x += width;
+        shelfHeight = std::max(shelfHeight, height);
+    }
+    return layer + 1;
+}
+
+void TextureAtlas::Upload()
+{
+    if (layerCount == 0 || uploaded)
+        return;
+
+    if (id == 0)
+        glGenTextures(1, &id);
+    GlState::BindTexture(ATLAS_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, id);
+    gpuSize = 0;
+    unsigned int size = layerSize;
+    for (unsigned int level = 0; level < levels.size(); level++)
+    {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].data());
+        gpuSize += levels[level].size();
+        size = std::max(size / 2, 1u);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    std::vector<std::vector<unsigned char> >().swap(levels);
+    for (unsigned int i = 0; i < images.size(); i++)
+        std::vector<unsigned char>().swap(images[i].Pixels);
+    uploaded = true;
+}
+
+void TextureAtlas::Bind() const
+{
+    GlState::BindTexture(ATLAS_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, id);
+}
+
+void TextureAtlas::Release()
+{
+    if (id != 0)
+        GlState::DeleteTexture(id);
+    id = 0;
+    gpuSize = 0;
+}
+
+const AtlasEntry* TextureAtlas::Find(const std::string& name) const
+{
+    std::unordered_map<std::string, unsigned int>::const_iterator found = names.find(name);
+    if (found == names.end() || found->second >= entries.size())
+        return nullptr;
+    return &entries[found->second];
+}
+
+void TextureAtlas::SetUniforms(Shader shader, const AtlasEntry* entry)
+{
+    shader.SetInteger("atlased", entry != nullptr);
+    if (entry == nullptr)
+        return;
+    shader.SetVector4f("atlasRect", entry->Rect);
+    shader.SetFloat("atlasLayer", entry->Layer);
+    shader.SetInteger("atlasRepeat", entry->Repeat);
+}
+
+size_t TextureAtlas::UploadSize() const
+{
+    size_t size = 0;
+    for (unsigned int level = 0; level < levels.size(); level++)
+        size += levels[level].size();
+    return size;
+}
+
+float TextureAtlas::Coverage() const
+{
+    if (layerCount == 0)
+        return 0.0f;
+    size_t covered = 0;
+    for (unsigned int i = 0; i < entries.size(); i++)
+        covered += (size_t)entries[i].Width * entries[i].Height;
+    return (float)covered / ((float)layerSize * layerSize * layerCount);
+}
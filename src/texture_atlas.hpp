@@ -0,0 +1,107 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_state.hpp"
+#include "shader.hpp"
+
+// The largest layer, more images than fit one take more layers of this size
+const unsigned int ATLAS_MAX_LAYER_SIZE = 2048;
+// Texels around every image, copies of its edge (or of its other side when it repeats).
+// The images start on multiples of it, so the first log2(ATLAS_GUTTER) + 1 mip levels
+// never mix texels of two images
+const unsigned int ATLAS_GUTTER = 8;
+
+// Where an image ended up: Rect is its offset and size in the layer in texture
+// coordinates, so the shader samples Rect.xy + uv * Rect.zw of Layer
+struct AtlasEntry
+{
+    glm::vec4 Rect;
+    GLfloat Layer;
+    bool Repeat;
+    // texels, for the tools
+    unsigned int X, Y, Width, Height;
+};
+
+// Small images packed into the layers of one GL_TEXTURE_2D_ARRAY, so draws that use
+// different ones bind nothing between them; they only set the entry's uniforms. Add
+// and Pack touch no GL state and may run on a loader thread, Upload runs on the GL
+// thread. Sampled with GL_NEAREST like the textures it replaces, which have no mipmaps;
+// the few nearest mip levels here only steady it when it is drawn small.
+class TextureAtlas
+{
+    public:
+        TextureAtlas();
+        ~TextureAtlas();
+
+        TextureAtlas(const TextureAtlas&) = delete;
+        TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+        // Thread safe for different atlases. Reads an image file (its cooked copy when
+        // there is one) as RGBA, with an opaque alpha unless alpha is set. False when the
+        // file cannot be read or the image does not fit a layer; it is then left out
+        bool Add(const std::string& name, const std::string& path, GLboolean alpha, bool repeat = false);
+        // The same for pixels in memory, channels 1 to 4
+        bool Add(const std::string& name, const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+                 GLboolean alpha, bool repeat = false);
+        // Places every image added in the layers of the size that wastes the least, and
+        // builds the mip levels. Adding afterwards needs another Pack
+        void Pack();
+        // GL thread. Creates the array texture from the packed layers and frees them and
+        // the images. The atlas is sealed then: Add and Pack fail, Upload does nothing
+        void Upload();
+        void Bind() const;
+        void Release();
+
+        // Null when no image of that name was added
+        const AtlasEntry* Find(const std::string& name) const;
+        // Sets atlased, atlasRect, atlasLayer and atlasRepeat on the shader; null
+        // turns the atlas off again
+        static void SetUniforms(Shader shader, const AtlasEntry* entry);
+
+        GLuint ID() const { return id; }
+        unsigned int EntryCount() const { return (unsigned int)entries.size(); }
+        unsigned int LayerCount() const { return layerCount; }
+        unsigned int LayerSize() const { return layerSize; }
+        unsigned int LevelCount() const { return (unsigned int)levels.size(); }
+        // the texels of every layer of a level, one layer after the other, until Upload
+        const unsigned char* LevelPixels(unsigned int level) const { return levels[level].data(); }
+        // bytes Upload sends, and bytes on the GPU once it did
+        size_t UploadSize() const;
+        size_t MemorySize() const { return gpuSize; }
+        // share of the layers the images cover, gutters not counted
+        float Coverage() const;
+
+    private:
+        struct Image
+        {
+            std::string Name;
+            unsigned int Width, Height;
+            bool Repeat;
+            // RGBA
+            std::vector<unsigned char> Pixels;
+        };
+
+        std::vector<Image> images;
+        std::vector<AtlasEntry> entries;
+        std::unordered_map<std::string, unsigned int> names;
+        unsigned int layerSize, layerCount;
+        // every layer of a level one after the other, RGBA, until Upload
+        std::vector<std::vector<unsigned char> > levels;
+        GLuint id;
+        size_t gpuSize;
+        // set by Upload, which frees the pixels Add and Pack work on
+        bool uploaded;
+
+        // places the images in layers of size, returns how many it took
+        unsigned int place(unsigned int size, std::vector<AtlasEntry>& placed) const;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "texture_cache.hpp"
+
+#include <iostream>
+
+#include "gl_state.hpp"
+
+TextureCache::TextureCache() : sharedCount(0), gpuSize(0)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    // the GL textures go with the models that release them, only the pixels of images
+    // that were never uploaded are left
+    for (std::unordered_map<uint64_t, CachedTexturePtr>::iterator it = textures.begin(); it != textures.end(); ++it)
+        ReleaseTextureSource(it->second->source);
+}
+
+CachedTexturePtr TextureCache::Acquire(const std::string& path)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t hash;
+    std::unordered_map<std::string, uint64_t>::const_iterator known = paths.find(path);
+    if (known != paths.end())
+        hash = known->second;
+    else
+    {
+        // hashing reads the whole file, other files go on meanwhile
+        lock.unlock();
+        if (!contentHash(path, hash))
+        {
+            std::cout << "ERROR::TEXTURE_CACHE: Texture failed to load at path: " << path << std::endl;
+            return CachedTexturePtr();
+        }
+        lock.lock();
+        paths[path] = hash;
+    }
+
+    CachedTexturePtr& cached = textures[hash];
+    if (cached)
+        sharedCount++;
+    else
+    {
+        cached = std::make_shared<CachedTexture>();
+        cached->ContentHash = hash;
+    }
+    CachedTexturePtr texture = cached;
+    texture->users++;
+    lock.unlock();
+
+    // the first user reads the pixels, any other waits for them here
+    std::lock_guard<std::mutex> textureLock(texture->mutex);
+    if (!texture->read)
+    {
+        texture->read = true;
+        if (!ReadTextureSource(path, texture->source))
+            std::cout << "ERROR::TEXTURE_CACHE: Texture failed to load at path: " << path << std::endl;
+    }
+    return texture;
+}
+
+size_t TextureCache::UploadSize(const CachedTexturePtr& texture)
+{
+    if (!texture)
+        return 0;
+    std::lock_guard<std::mutex> lock(texture->mutex);
+    return texture->ID == 0 ? texture->source.Size() : 0;
+}
+
+GLuint TextureCache::Upload(const CachedTexturePtr& texture)
+{
+    if (!texture)
+        return 0;
+
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(texture->mutex);
+        const TextureSource& source = texture->source;
+        if (texture->ID != 0 || !(source.Cooked.IsOpen() || source.Image.Pixels))
+            return texture->ID;
+
+        GLenum format;
+        if (source.Channels() == 1)
+            format = GL_RED;
+        else if (source.Channels() == 3)
+            format = GL_RGB;
+        else if (source.Channels() == 4)
+            format = GL_RGBA;
+        else
+            format = GL_RED;
+
+        Texture2D generated;
+        generated.InternalFormat = format;
+        generated.ImageFormat = format;
+        generated.WrapS = GL_REPEAT;
+        generated.WrapT = GL_REPEAT;
+        generated.FilterMin = GL_NEAREST_MIPMAP_NEAREST;
+        generated.FilterMax = GL_NEAREST;
+        generated.Generate(source);
+        ReleaseTextureSource(texture->source);
+
+        texture->ID = generated.ID;
+        texture->Size = size = generated.MemorySize();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    gpuSize += size;
+    return texture->ID;
+}
+
+void TextureCache::Release(const CachedTexturePtr& texture)
+{
+    if (!texture)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--texture->users > 0)
+        return;
+
+    std::lock_guard<std::mutex> textureLock(texture->mutex);
+    if (texture->ID != 0)
+        GlState::DeleteTexture(texture->ID);
+    ReleaseTextureSource(texture->source);
+    gpuSize -= texture->Size;
+    texture->ID = 0;
+    texture->Size = 0;
+    textures.erase(texture->ContentHash);
+}
+
+unsigned int TextureCache::Count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (unsigned int)textures.size();
+}
+
+unsigned int TextureCache::SharedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sharedCount;
+}
+
+size_t TextureCache::GpuMemorySize() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return gpuSize;
+}
+
+bool TextureCache::contentHash(const std::string& path, uint64_t& hash)
+{
+    if (HashFileContents(path, hash))
+        return true;
+    // only the cooked copy shipped, it remembers the hash of the image it came from
+    CookedImage cooked;
+    if (!cooked.Open(CookedImagePath(path)))
+        return false;
+    hash = cooked.SourceHash();
+    return true;
+}
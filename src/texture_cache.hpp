@@ -0,0 +1,82 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "texture.hpp"
+
+// One image as a GL texture, shared by every material of every model whose texture
+// file has its contents
+struct CachedTexture
+{
+    // FNV-1a of the image file, see HashFileContents
+    uint64_t ContentHash;
+    // 0 until the first model that uses it is uploaded
+    GLuint ID;
+    // GPU bytes once uploaded
+    size_t Size;
+
+    CachedTexture() : ContentHash(0), ID(0), Size(0), read(false), users(0) {}
+
+    private:
+        friend class TextureCache;
+
+        // guards everything below and ID, the source is read by the first model
+        // prepared with it and released by the upload
+        std::mutex mutex;
+        TextureSource source;
+        bool read;
+        unsigned int users;
+};
+
+typedef std::shared_ptr<CachedTexture> CachedTexturePtr;
+
+// Material textures keyed by the contents of their files, so models sharing a texture
+// sheet, or byte-identical images at different paths, cost one read and one GPU copy.
+// Paths seen before find their image through a hash map without reading the file
+// again. The resource manager keeps the one the models it loads share.
+class TextureCache
+{
+    public:
+        TextureCache();
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // Thread safe. The texture of an image file, its pixels read the first time its
+        // contents are seen. Null when neither the file nor a cooked copy of it can be
+        // read. Every Acquire is matched by a Release
+        CachedTexturePtr Acquire(const std::string& path);
+        // Thread safe, bytes Upload would still send for the texture
+        size_t UploadSize(const CachedTexturePtr& texture);
+        // GL thread. Creates the GL texture unless a model did so already, returns its name
+        GLuint Upload(const CachedTexturePtr& texture);
+        // GL thread. The last user deletes the GL texture and the image is read again
+        // by the next Acquire
+        void Release(const CachedTexturePtr& texture);
+
+        // distinct images held, Acquires that found their image already held and the
+        // GPU bytes of the images uploaded
+        unsigned int Count() const;
+        unsigned int SharedCount() const;
+        size_t GpuMemorySize() const;
+
+    private:
+        std::unordered_map<std::string, uint64_t> paths;
+        std::unordered_map<uint64_t, CachedTexturePtr> textures;
+        mutable std::mutex mutex;
+        unsigned int sharedCount;
+        size_t gpuSize;
+
+        bool contentHash(const std::string& path, uint64_t& hash);
+};
+
+#endif
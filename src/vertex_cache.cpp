@@ -0,0 +1,167 @@
+#include "vertex_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Scoring constants from the paper
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    // no triangle left to draw, never pick it again
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // the vertices of the last triangle score the same, whatever order they came in
+        if (cachePosition < 3)
+            score = LAST_TRIANGLE_SCORE;
+        else
+            score = std::pow(1.0f - (float)(cachePosition - 3) / (VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+
+    // vertices with few triangles left are finished off first, so they leave the cache for good
+    score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+void OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount)
+{
+    unsigned int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // the triangles of every vertex, packed. The first remaining[v] of a vertex's
+    // range are the ones not drawn yet
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int i = 0; i < triangleCount * 3; i++)
+        remaining[indices[i]]++;
+
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+    std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+    std::vector<unsigned int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (unsigned int i = 0; i < triangleCount * 3; i++)
+        vertexTriangles[filled[indices[i]]++] = i / 3;
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        scores[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<bool> drawn(triangleCount, false);
+    std::vector<unsigned int> order(indices, indices + triangleCount * 3);
+    // three more entries than the cache, for the vertices that fall out of it
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(VERTEX_CACHE_SIZE + 3);
+    nextCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+    int best = -1;
+    unsigned int scan = 0;
+    for (unsigned int output = 0; output < triangleCount; output++)
+    {
+        // nothing in the cache has triangles left, start on the next piece of the mesh
+        if (best < 0)
+        {
+            while (drawn[scan])
+                scan++;
+            best = (int)scan;
+        }
+
+        const unsigned int* triangle = &order[best * 3];
+        std::copy(triangle, triangle + 3, indices + output * 3);
+        drawn[best] = true;
+
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            // move the triangle past the remaining ones of the vertex
+            unsigned int v = triangle[k];
+            unsigned int* first = &vertexTriangles[firstTriangle[v]];
+            unsigned int* last = first + remaining[v] - 1;
+            std::swap(*std::find(first, last + 1, (unsigned int)best), *last);
+            remaining[v]--;
+        }
+        for (unsigned int i = 0; i < cache.size(); i++)
+        {
+            if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+                nextCache.push_back(cache[i]);
+        }
+        cache.swap(nextCache);
+
+        for (unsigned int i = 0; i < cache.size(); i++)
+        {
+            cachePositions[cache[i]] = i < VERTEX_CACHE_SIZE ? (int)i : -1;
+            scores[cache[i]] = vertexScore(cachePositions[cache[i]], remaining[cache[i]]);
+        }
+        if (cache.size() > VERTEX_CACHE_SIZE)
+            cache.resize(VERTEX_CACHE_SIZE);
+
+        // only the triangles of cached vertices changed score
+        best = -1;
+        float bestScore = -1.0f;
+        for (unsigned int i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            for (unsigned int t = firstTriangle[v]; t < firstTriangle[v] + remaining[v]; t++)
+            {
+                const unsigned int* candidate = &order[vertexTriangles[t] * 3];
+                float score = scores[candidate[0]] + scores[candidate[1]] + scores[candidate[2]];
+                if (score > bestScore)
+                {
+                    best = (int)vertexTriangles[t];
+                    bestScore = score;
+                }
+            }
+        }
+    }
+}
+
+void OptimizeVertexFetch(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, std::vector<unsigned int>& remap)
+{
+    const unsigned int unused = 0xFFFFFFFF;
+    remap.assign(vertexCount, unused);
+
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < indexCount; i++)
+    {
+        if (remap[indices[i]] == unused)
+            remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+    for (unsigned int v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] == unused)
+            remap[v] = next++;
+    }
+}
+
+float VertexCacheMissRatio(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+    if (indexCount < 3)
+        return 0.0f;
+
+    // how many misses came before each vertex entered the FIFO, it is pushed out
+    // by the cacheSize-th miss after its own
+    std::vector<unsigned int> entered(vertexCount, 0);
+    std::vector<bool> seen(vertexCount, false);
+    unsigned int misses = 0;
+    for (unsigned int i = 0; i < indexCount; i++)
+    {
+        unsigned int v = indices[i];
+        if (!seen[v] || misses - entered[v] > cacheSize)
+        {
+            entered[v] = misses;
+            seen[v] = true;
+            misses++;
+        }
+    }
+    return (float)misses / (indexCount / 3);
+}
@@ -0,0 +1,26 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <vector>
+
+// Entries of the LRU cache the triangle order is optimised for, a little more than the
+// post-transform caches of current GPUs so the order holds up on all of them
+const unsigned int VERTEX_CACHE_SIZE = 32;
+
+// Reorders the triangles of an indexed list so consecutive triangles reuse the vertices
+// the GPU just transformed (Forsyth, Linear-Speed Vertex Cache Optimisation). Every
+// vertex is scored by how recently it was used and how few triangles it has left, and
+// the next triangle is the best scored one among those of the cached vertices. The
+// triangles and their winding are kept, only their order changes
+void OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount);
+
+// Renumbers vertices in the order the indices first use them, so the vertex fetch
+// walks the buffer forwards. remap[old] is the new index, unused vertices go last.
+// Rewrites the indices, the caller moves the vertices
+void OptimizeVertexFetch(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, std::vector<unsigned int>& remap);
+
+// Vertices transformed per triangle through a FIFO cache of the given size, 3 when
+// nothing is reused and about 0.6 for a well ordered regular grid
+float VertexCacheMissRatio(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize);
+
+#endif
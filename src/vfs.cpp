@@ -0,0 +1,230 @@
+#include "vfs.hpp"
+
+#include "mapped_file.hpp"
+
+// Instantiate static variables
+std::vector<Vfs::MountedPack> Vfs::packs;
+std::map<std::string, FileView> Vfs::preloaded;
+std::mutex Vfs::mutex;
+std::unique_ptr<JobPool> Vfs::jobs;
+std::mutex Vfs::jobsMutex;
+std::atomic<unsigned int> Vfs::packReads(0);
+std::atomic<unsigned int> Vfs::diskReads(0);
+std::atomic<size_t> Vfs::decompressedSize(0);
+
+void FileView::Close()
+{
+    data = nullptr;
+    size = 0;
+    owner.reset();
+}
+
+bool Vfs::Mount(const std::string& packPath, const std::string& mountPoint)
+{
+    std::shared_ptr<PackFile> pack = std::make_shared<PackFile>();
+    if (!pack->Open(packPath))
+        return false;
+
+    MountedPack mounted;
+    mounted.Pack = pack;
+    mounted.MountPoint = normalize(mountPoint);
+    if (!mounted.MountPoint.empty())
+        mounted.MountPoint += '/';
+
+    std::lock_guard<std::mutex> lock(mutex);
+    packs.insert(packs.begin(), mounted);
+    return true;
+}
+
+void Vfs::UnmountAll()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    packs.clear();
+    preloaded.clear();
+}
+
+bool Vfs::Open(const std::string& path, FileView& view)
+{
+    view.Close();
+    std::string normalized = normalize(path);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, FileView>::iterator found = preloaded.find(normalized);
+        if (found != preloaded.end())
+        {
+            view = found->second;
+            preloaded.erase(found);
+            packReads++;
+            return true;
+        }
+    }
+
+    std::shared_ptr<PackFile> pack;
+    const PackEntry* entry;
+    if (find(normalized, pack, entry))
+    {
+        std::shared_ptr<std::vector<unsigned char> > buffer;
+        viewEntry(pack, *entry, view, buffer);
+        if (buffer && !pack->DecompressBlocks(*entry, 0, entry->BlockCount, buffer->data()))
+        {
+            view.Close();
+            return false;
+        }
+        packReads++;
+        return true;
+    }
+    return OpenOnDisk(path, view);
+}
+
+bool Vfs::OpenOnDisk(const std::string& path, FileView& view)
+{
+    view.Close();
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(path))
+        return false;
+    view.data = file->Data();
+    view.size = file->Size();
+    view.owner = file;
+    diskReads++;
+    return true;
+}
+
+bool Vfs::ReadString(const std::string& path, std::string& contents)
+{
+    FileView view;
+    if (!Open(path, view))
+    {
+        contents.clear();
+        return false;
+    }
+    contents.assign((const char*)view.Data(), view.Size());
+    return true;
+}
+
+void Vfs::Preload(const std::vector<std::string>& paths)
+{
+    struct Block
+    {
+        std::shared_ptr<PackFile> Pack;
+        const PackEntry* Entry;
+        unsigned int Index;
+        unsigned char* Destination;
+    };
+
+    std::vector<std::string> names;
+    std::vector<FileView> views;
+    std::vector<Block> blocks;
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        std::string normalized = normalize(paths[i]);
+        std::shared_ptr<PackFile> pack;
+        const PackEntry* entry;
+        if (!find(normalized, pack, entry) || !(entry->Flags & PACK_ENTRY_LZ4))
+            continue;
+
+        FileView view;
+        std::shared_ptr<std::vector<unsigned char> > buffer;
+        viewEntry(pack, *entry, view, buffer);
+        for (unsigned int b = 0; b < entry->BlockCount; b++)
+        {
+            Block block = { pack, entry, b, buffer->data() };
+            blocks.push_back(block);
+        }
+        names.push_back(normalized);
+        views.push_back(view);
+    }
+    if (blocks.empty())
+        return;
+
+    std::vector<unsigned char> failed(blocks.size(), 0);
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        if (!jobs)
+            jobs.reset(new JobPool());
+        jobs->ParallelFor((unsigned int)blocks.size(), 1, [&](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int i = begin; i < end; i++)
+                failed[i] = !blocks[i].Pack->DecompressBlocks(*blocks[i].Entry, blocks[i].Index, blocks[i].Index + 1, blocks[i].Destination);
+        });
+    }
+
+    // a damaged entry is left out, its Open tries again and fails
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned int block = 0;
+    for (unsigned int i = 0; i < views.size(); i++)
+    {
+        bool damaged = false;
+        for (; block < blocks.size() && blocks[block].Destination == views[i].Data(); block++)
+            damaged = damaged || failed[block];
+        if (!damaged)
+            preloaded[names[i]] = views[i];
+    }
+}
+
+std::string Vfs::normalize(const std::string& path)
+{
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    while (begin <= path.size())
+    {
+        size_t end = path.find_first_of("/\\", begin);
+        if (end == std::string::npos)
+            end = path.size();
+        std::string part = path.substr(begin, end - begin);
+        if (part == "..")
+        {
+            if (!parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else
+                parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".")
+            parts.push_back(part);
+        begin = end + 1;
+    }
+
+    std::string normalized = !path.empty() && (path[0] == '/' || path[0] == '\\') ? "/" : "";
+    for (unsigned int i = 0; i < parts.size(); i++)
+    {
+        if (i > 0)
+            normalized += '/';
+        normalized += parts[i];
+    }
+    return normalized;
+}
+
+bool Vfs::find(const std::string& path, std::shared_ptr<PackFile>& pack, const PackEntry*& entry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (unsigned int i = 0; i < packs.size(); i++)
+    {
+        const std::string& mountPoint = packs[i].MountPoint;
+        if (path.compare(0, mountPoint.size(), mountPoint) != 0)
+            continue;
+        entry = packs[i].Pack->Find(path.substr(mountPoint.size()));
+        if (entry != nullptr)
+        {
+            pack = packs[i].Pack;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Vfs::viewEntry(const std::shared_ptr<PackFile>& pack, const PackEntry& entry, FileView& view,
+                    std::shared_ptr<std::vector<unsigned char> >& buffer)
+{
+    if (!(entry.Flags & PACK_ENTRY_LZ4))
+    {
+        view.data = pack->EntryData(entry);
+        view.size = (size_t)entry.Size;
+        view.owner = pack->File();
+        return;
+    }
+
+    buffer = std::make_shared<std::vector<unsigned char> >((size_t)entry.Size);
+    view.data = buffer->data();
+    view.size = buffer->size();
+    view.owner = buffer;
+    decompressedSize += buffer->size();
+}
@@ -0,0 +1,93 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "job_pool.hpp"
+#include "pack_file.hpp"
+
+// The bytes of a file opened through the Vfs. Copies share them, they stay valid as
+// long as a copy is open, packs being unmounted meanwhile or not
+class FileView
+{
+    public:
+        FileView() : data(nullptr), size(0) {}
+
+        bool IsOpen() const { return data != nullptr; }
+        const unsigned char* Data() const { return data; }
+        size_t Size() const { return size; }
+        void Close();
+
+    private:
+        friend class Vfs;
+
+        const unsigned char* data;
+        size_t size;
+        // the pack or disk file mapping, or the bytes decompressed
+        std::shared_ptr<const void> owner;
+};
+
+// Every file the game reads goes through here: shaders, images and their cooked
+// copies, fonts, levels and cooked models. A path is looked up in the mounted packs
+// first, the newest one first, then read from disk. Entries stored as they are and
+// files on disk are mapped, so a view points straight at their pages; compressed
+// entries are decompressed into memory the view owns.
+class Vfs
+{
+    public:
+        // Maps a pack and answers the paths under mountPoint from it: with a mount
+        // point of "../" the pack's "assets/tiles.png" is "../assets/tiles.png". The
+        // whole pack is paged in at once. Mount before anything is loaded
+        static bool Mount(const std::string& packPath, const std::string& mountPoint);
+        static void UnmountAll();
+
+        // Thread safe, false when no pack has the file and it is not on disk
+        static bool Open(const std::string& path, FileView& view);
+        // Thread safe, the file on disk even when a pack has it too
+        static bool OpenOnDisk(const std::string& path, FileView& view);
+        static bool ReadString(const std::string& path, std::string& contents);
+        // Thread safe. Decompresses the compressed pack entries of the paths, the
+        // blocks of all of them in parallel, and keeps them for their Open. Anything
+        // else is left to Open, the pages of the packs are read already
+        static void Preload(const std::vector<std::string>& paths);
+
+        // since start, files read from packs and from disk and the bytes decompressed
+        static unsigned int PackReadCount() { return packReads; }
+        static unsigned int DiskReadCount() { return diskReads; }
+        static size_t DecompressedSize() { return decompressedSize; }
+
+    private:
+        Vfs() {}
+
+        struct MountedPack
+        {
+            std::shared_ptr<PackFile> Pack;
+            // normalized, empty or ending in '/'
+            std::string MountPoint;
+        };
+
+        static std::vector<MountedPack> packs;
+        static std::map<std::string, FileView> preloaded;
+        static std::mutex mutex;
+        // Preload's workers, one batch at a time
+        static std::unique_ptr<JobPool> jobs;
+        static std::mutex jobsMutex;
+        static std::atomic<unsigned int> packReads, diskReads;
+        static std::atomic<size_t> decompressedSize;
+
+        // forward slashes, no "." and no "dir/.." in the path
+        static std::string normalize(const std::string& path);
+        // the pack and entry of a normalized path, false when no pack has it
+        static bool find(const std::string& path, std::shared_ptr<PackFile>& pack, const PackEntry*& entry);
+        // the view of a stored entry, or a buffer of the entry's size for a compressed one
+        static void viewEntry(const std::shared_ptr<PackFile>& pack, const PackEntry& entry, FileView& view,
+                              std::shared_ptr<std::vector<unsigned char> >& buffer);
+};
+
+#endif
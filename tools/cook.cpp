@@ -0,0 +1,97 @@
+// Cooks a model file into the format the game maps and uploads as it is:
+//
+//   doublegrit-cook <model> [<cooked model>]
+//
+// Without an output path the cooked file goes next to the model, where
+// ResourceManager::LoadModel looks for it. The triangles of every submesh are put in
+// vertex cache order and the vertices in the order those triangles first use them.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cooked_model.hpp"
+#include "model_importer.hpp"
+#include "vertex_cache.hpp"
+
+// Reorders the triangles and then the vertices of each submesh, within its own ranges
+static void optimizeSubmeshes(ModelData& data, float& missRatioBefore, float& missRatioAfter)
+{
+    unsigned int triangles = 0;
+    missRatioBefore = 0.0f;
+    missRatioAfter = 0.0f;
+
+    std::vector<unsigned int> remap;
+    std::vector<ModelVertex> reordered;
+    for (unsigned int s = 0; s < data.Submeshes.size(); s++)
+    {
+        const ModelSubmesh& submesh = data.Submeshes[s];
+        unsigned int vertexEnd = s + 1 < data.Submeshes.size() ? data.Submeshes[s + 1].BaseVertex : (unsigned int)data.Vertices.size();
+        unsigned int vertexCount = vertexEnd - submesh.BaseVertex;
+        unsigned int* indices = &data.Indices[submesh.BaseIndex];
+        unsigned int submeshTriangles = submesh.IndicesCount / 3;
+
+        missRatioBefore += submeshTriangles * VertexCacheMissRatio(indices, submesh.IndicesCount, vertexCount, VERTEX_CACHE_SIZE);
+        OptimizeVertexCache(indices, submesh.IndicesCount, vertexCount);
+        missRatioAfter += submeshTriangles * VertexCacheMissRatio(indices, submesh.IndicesCount, vertexCount, VERTEX_CACHE_SIZE);
+        triangles += submeshTriangles;
+
+        OptimizeVertexFetch(indices, submesh.IndicesCount, vertexCount, remap);
+        reordered.resize(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; v++)
+            reordered[remap[v]] = data.Vertices[submesh.BaseVertex + v];
+        std::copy(reordered.begin(), reordered.end(), data.Vertices.begin() + submesh.BaseVertex);
+    }
+
+    if (triangles > 0)
+    {
+        missRatioBefore /= triangles;
+        missRatioAfter /= triangles;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::printf("usage: %s <model> [<cooked model>]\n", argv[0]);
+        return 2;
+    }
+
+    std::string input = argv[1];
+    std::string output = argc > 2 ? argv[2] : CookedModelPath(input);
+    if (output == input)
+    {
+        std::printf("ERROR::COOK: %s is cooked already\n", input.c_str());
+        return 2;
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    ModelData data;
+    if (!ImportModel(input, data))
+        return 1;
+
+    // every submesh must start where the previous one ends for the ranges above
+    for (unsigned int s = 1; s < data.Submeshes.size(); s++)
+    {
+        if (data.Submeshes[s].BaseVertex < data.Submeshes[s - 1].BaseVertex)
+        {
+            std::printf("ERROR::COOK: Submeshes of %s are out of order\n", input.c_str());
+            return 1;
+        }
+    }
+
+    float missRatioBefore, missRatioAfter;
+    optimizeSubmeshes(data, missRatioBefore, missRatioAfter);
+
+    if (!WriteCookedModel(output, data))
+        return 1;
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::printf("%s: %u vertices, %u triangles, %u bones, %u clips, %.2f -> %.2f vertex cache misses per triangle, %.1f ms\n",
+                output.c_str(), (unsigned int)data.Vertices.size(), (unsigned int)data.Indices.size() / 3, data.Rig.BoneCount(),
+                (unsigned int)data.Clips.size(), missRatioBefore, missRatioAfter, milliseconds);
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Packs the game's files into one pack file the game maps at startup:
+//
+//   doublegrit-pack <pack> <root> <file>...
+//
+// The files are given relative to root and found in the pack by that path. Images are
+// cooked first and their cooked copies packed too, so the game never decodes them.
+// Cooked images and models are stored as they are and used straight from the mapping,
+// everything else is compressed when that is worth it.
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cooked_image.hpp"
+#include "cooked_model.hpp"
+#include "pack_file.hpp"
+
+static bool hasExtension(const std::string& path, const char* extension)
+{
+    std::string suffix = extension;
+    return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool isImage(const std::string& path)
+{
+    return hasExtension(path, ".png") || hasExtension(path, ".jpg") || hasExtension(path, ".tga") || hasExtension(path, ".bmp");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::printf("usage: %s <pack> <root> <file>...\n", argv[0]);
+        return 2;
+    }
+
+    std::string output = argv[1];
+    std::string root = argv[2];
+    if (!root.empty() && root[root.size() - 1] != '/' && root[root.size() - 1] != '\\')
+        root += '/';
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    std::vector<PackSource> files;
+    for (int i = 3; i < argc; i++)
+    {
+        PackSource file;
+        file.Path = argv[i];
+        file.DiskPath = root + file.Path;
+        file.Compress = !hasExtension(file.Path, COOKED_IMAGE_EXTENSION) && !hasExtension(file.Path, COOKED_MODEL_EXTENSION);
+        files.push_back(file);
+
+        if (isImage(file.Path))
+        {
+            CookedImage cooked;
+            if (!OpenCookedImage(file.DiskPath, cooked))
+            {
+                std::printf("ERROR::PACK: Failed to cook %s\n", file.DiskPath.c_str());
+                return 1;
+            }
+            PackSource cookedFile;
+            cookedFile.Path = CookedImagePath(file.Path);
+            cookedFile.DiskPath = root + cookedFile.Path;
+            cookedFile.Compress = false;
+            files.push_back(cookedFile);
+        }
+    }
+
+    if (!WritePackFile(output, files))
+        return 1;
+
+    PackFile pack;
+    if (!pack.Open(output))
+        return 1;
+    unsigned long long size = 0, stored = 0;
+    unsigned int compressed = 0;
+    for (unsigned int i = 0; i < pack.EntryCount(); i++)
+    {
+        const PackEntry& entry = pack.Entry(i);
+        size += entry.Size;
+        stored += entry.StoredSize;
+        if (entry.Flags & PACK_ENTRY_LZ4)
+            compressed++;
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::printf("%s: %u files, %u compressed, %.1f KiB -> %.1f KiB, %.1f ms\n", output.c_str(), pack.EntryCount(), compressed,
+                size / 1024.0, stored / 1024.0, milliseconds);
+    return 0;
+}